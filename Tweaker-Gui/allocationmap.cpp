@@ -0,0 +1,349 @@
+#include "allocationmap.h"
+#include "imagewriter.h"
+#include "partitiontable.h"
+#include <QByteArray>
+#include <QtEndian>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+namespace {
+
+const int kExtSuperblockOffset = 1024;
+const int kExtSuperblockSize = 1024;
+const quint16 kExtMagic = 0xEF53;
+
+// ext4 feature flags that matter for finding allocated blocks
+const quint32 kExtCompatHasJournal = 0x0004;
+const quint32 kExtCompatResizeInode = 0x0010;
+const quint32 kExtCompatSparseSuper2 = 0x0200;
+const quint32 kExtIncompatMetaBg = 0x0010;
+const quint32 kExtIncompatExtents = 0x0040;
+const quint32 kExtIncompat64Bit = 0x0080;
+const quint32 kExtRoCompatSparseSuper = 0x0001;
+const quint32 kExtRoCompatGdtCsum = 0x0010;
+const quint32 kExtRoCompatBigalloc = 0x0200;
+const quint32 kExtRoCompatMetadataCsum = 0x0400;
+const quint16 kExtBgBlockUninit = 0x0002;
+
+const qint64 kMaxFatTableSize = 128 * 1024 * 1024;
+
+bool readAt(int fd, char *data, qint64 length, qint64 offset)
+{
+    qint64 done = 0;
+    while (done < length) {
+        ssize_t n = ::pread(fd, data + done, length - done, offset + done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+template <typename T>
+T field(const char *data, int offset)
+{
+    return qFromLittleEndian<T>(reinterpret_cast<const uchar *>(data) + offset);
+}
+
+bool isPowerOf(quint64 value, quint64 base)
+{
+    while (value > 1 && value % base == 0) {
+        value /= base;
+    }
+    return value == 1;
+}
+
+// With sparse_super only groups 0, 1 and powers of 3, 5 and 7 carry a
+// superblock / group descriptor backup
+bool groupHasSuperblock(quint64 group, bool sparseSuper)
+{
+    if (!sparseSuper || group <= 1) return true;
+    return isPowerOf(group, 3) || isPowerOf(group, 5) || isPowerOf(group, 7);
+}
+
+QString megabytes(qint64 bytes)
+{
+    return QString("%1 MiB").arg(bytes / (1024 * 1024));
+}
+
+} // namespace
+
+AllocationMap::AllocationMap()
+    : m_diskSize(0)
+    , m_requiredSize(0)
+    , m_isGpt(false)
+    , m_sectorSize(512)
+{
+}
+
+bool AllocationMap::build(const QString &devicePath, QString &error)
+{
+    m_ranges.clear();
+    m_summary.clear();
+    m_isGpt = false;
+
+    int fd = ::open(devicePath.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = QString("Cannot open %1: %2").arg(devicePath, QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+
+    m_diskSize = ImageWriter::deviceSize(fd);
+    if (m_diskSize <= 0) {
+        error = QString("Cannot determine size of %1").arg(devicePath);
+        ::close(fd);
+        return false;
+    }
+
+    PartitionTable table;
+    if (!table.read(fd, m_diskSize, m_sectorSize) || table.partitions().isEmpty()) {
+        // No partition table: treat the device as a single filesystem
+        mapPartition(fd, 0, m_diskSize, devicePath);
+        m_requiredSize = m_diskSize;
+        m_ranges = normalizeRanges(m_ranges);
+        ::close(fd);
+        return true;
+    }
+
+    m_isGpt = table.isGpt();
+    QVector<PartitionEntry> partitions = table.partitions();
+    std::sort(partitions.begin(), partitions.end(), [](const PartitionEntry &a, const PartitionEntry &b) {
+        return a.offset < b.offset;
+    });
+
+    // Raw areas before and between partitions are copied as-is: they hold
+    // the partition table and, on Rockchip boards, idbloader/u-boot
+    qint64 cursor = 0;
+    for (const PartitionEntry &partition : partitions) {
+        if (partition.offset >= m_diskSize) continue;
+        qint64 size = qMin(partition.size, m_diskSize - partition.offset);
+        if (partition.offset > cursor) {
+            appendRange(m_ranges, cursor, partition.offset - cursor);
+        }
+        mapPartition(fd, partition.offset, size, QString("Partition %1").arg(partition.number));
+        cursor = qMax(cursor, partition.offset + size);
+    }
+
+    // Trailing unpartitioned space (and the source's backup GPT) is dropped;
+    // the backup GPT is rewritten at the end of the target afterwards
+    m_requiredSize = cursor + table.backupGptSize();
+    m_ranges = normalizeRanges(m_ranges);
+    ::close(fd);
+    return true;
+}
+
+void AllocationMap::mapPartition(int fd, qint64 offset, qint64 size, const QString &name)
+{
+    ByteRangeList ranges;
+    QString description;
+    bool mapped = mapExt(fd, offset, size, ranges, description);
+    if (!mapped) {
+        ranges.clear();
+        mapped = mapFat(fd, offset, size, ranges, description);
+    }
+    if (!mapped) {
+        ranges.clear();
+        appendRange(ranges, offset, size);
+        description = "unknown filesystem, copied in full";
+    }
+
+    m_ranges += ranges;
+    m_summary << QString("%1: %2 (%3 of %4)")
+                     .arg(name, description, megabytes(totalRangeLength(ranges)), megabytes(size));
+}
+
+bool AllocationMap::mapExt(int fd, qint64 offset, qint64 size, ByteRangeList &ranges, QString &description)
+{
+    char sb[kExtSuperblockSize];
+    if (size < kExtSuperblockOffset + kExtSuperblockSize ||
+        !readAt(fd, sb, kExtSuperblockSize, offset + kExtSuperblockOffset) ||
+        field<quint16>(sb, 56) != kExtMagic) {
+        return false;
+    }
+
+    quint32 logBlockSize = field<quint32>(sb, 24);
+    quint32 blocksPerGroup = field<quint32>(sb, 32);
+    quint32 inodesPerGroup = field<quint32>(sb, 40);
+    quint32 firstDataBlock = field<quint32>(sb, 20);
+    quint32 compat = field<quint32>(sb, 92);
+    quint32 incompat = field<quint32>(sb, 96);
+    quint32 roCompat = field<quint32>(sb, 100);
+    quint32 revLevel = field<quint32>(sb, 76);
+    quint16 inodeSize = revLevel > 0 ? field<quint16>(sb, 88) : 128;
+    quint16 reservedGdtBlocks = (compat & kExtCompatResizeInode) ? field<quint16>(sb, 206) : 0;
+    bool is64Bit = (incompat & kExtIncompat64Bit);
+    quint64 blocksCount = field<quint32>(sb, 4);
+    if (is64Bit) {
+        blocksCount |= quint64(field<quint32>(sb, 336)) << 32;
+    }
+
+    if (logBlockSize > 6 || blocksPerGroup == 0 || blocksCount <= firstDataBlock) {
+        return false;
+    }
+    qint64 blockSize = qint64(1024) << logBlockSize;
+    quint32 descSize = is64Bit ? field<quint16>(sb, 254) : 32;
+    if (descSize < 32 || qint64(blocksCount) * blockSize > size) {
+        return false;
+    }
+
+    QString name = (compat & kExtCompatHasJournal) ? ((incompat & kExtIncompatExtents) ? "ext4" : "ext3") : "ext2";
+
+    // Layouts where the bitmaps alone don't describe everything: copy in full
+    if ((incompat & kExtIncompatMetaBg) || (roCompat & kExtRoCompatBigalloc) ||
+        (compat & kExtCompatSparseSuper2)) {
+        appendRange(ranges, offset, size);
+        description = name + " (meta_bg/bigalloc/sparse_super2), copied in full";
+        return true;
+    }
+
+    quint64 groupCount = (blocksCount - firstDataBlock + blocksPerGroup - 1) / blocksPerGroup;
+    qint64 gdtBytes = qint64(groupCount) * descSize;
+    qint64 gdtBlocks = (gdtBytes + blockSize - 1) / blockSize;
+    QByteArray gdt(int(gdtBytes), '\0');
+    if (!readAt(fd, gdt.data(), gdtBytes, offset + qint64(firstDataBlock + 1) * blockSize)) {
+        return false;
+    }
+
+    const bool trustUninit = (roCompat & (kExtRoCompatGdtCsum | kExtRoCompatMetadataCsum));
+    const bool sparseSuper = (roCompat & kExtRoCompatSparseSuper);
+    const qint64 inodeTableBlocks = (qint64(inodesPerGroup) * inodeSize + blockSize - 1) / blockSize;
+
+    // Everything up to and including the primary superblock (boot block)
+    appendRange(ranges, offset, qint64(firstDataBlock + 1) * blockSize);
+
+    QByteArray bitmap(int(blockSize), '\0');
+    for (quint64 group = 0; group < groupCount; ++group) {
+        const char *desc = gdt.constData() + group * descSize;
+        quint64 blockBitmap = field<quint32>(desc, 0);
+        quint64 inodeBitmap = field<quint32>(desc, 4);
+        quint64 inodeTable = field<quint32>(desc, 8);
+        quint16 flags = field<quint16>(desc, 18);
+        if (descSize >= 64) {
+            blockBitmap |= quint64(field<quint32>(desc, 32)) << 32;
+            inodeBitmap |= quint64(field<quint32>(desc, 36)) << 32;
+            inodeTable |= quint64(field<quint32>(desc, 40)) << 32;
+        }
+
+        // Group metadata may live in another group (flex_bg); always copy it
+        appendRange(ranges, offset + qint64(blockBitmap) * blockSize, blockSize);
+        appendRange(ranges, offset + qint64(inodeBitmap) * blockSize, blockSize);
+        appendRange(ranges, offset + qint64(inodeTable) * blockSize, inodeTableBlocks * blockSize);
+
+        quint64 groupStart = firstDataBlock + group * blocksPerGroup;
+        quint64 groupBlocks = qMin<quint64>(blocksPerGroup, blocksCount - groupStart);
+
+        if (trustUninit && (flags & kExtBgBlockUninit)) {
+            // Bitmap was never written; only the superblock backup and
+            // descriptor copies in this group are in use
+            if (groupHasSuperblock(group, sparseSuper)) {
+                appendRange(ranges, offset + qint64(groupStart) * blockSize,
+                            (1 + gdtBlocks + reservedGdtBlocks) * blockSize);
+            }
+            continue;
+        }
+
+        if (!readAt(fd, bitmap.data(), blockSize, offset + qint64(blockBitmap) * blockSize)) {
+            return false;
+        }
+
+        const uchar *bits = reinterpret_cast<const uchar *>(bitmap.constData());
+        quint64 runStart = 0;
+        bool inRun = false;
+        for (quint64 bit = 0; bit < groupBlocks; ) {
+            // Whole bytes that don't end or start a run can be skipped at once
+            if ((bit & 7) == 0 && bit + 8 <= groupBlocks &&
+                bits[bit >> 3] == (inRun ? 0xFF : 0x00)) {
+                bit += 8;
+                continue;
+            }
+            bool used = bits[bit >> 3] & (1 << (bit & 7));
+            if (used && !inRun) {
+                runStart = bit;
+                inRun = true;
+            } else if (!used && inRun) {
+                appendRange(ranges, offset + qint64(groupStart + runStart) * blockSize,
+                            qint64(bit - runStart) * blockSize);
+                inRun = false;
+            }
+            ++bit;
+        }
+        if (inRun) {
+            appendRange(ranges, offset + qint64(groupStart + runStart) * blockSize,
+                        qint64(groupBlocks - runStart) * blockSize);
+        }
+    }
+
+    ranges = normalizeRanges(ranges);
+    description = name;
+    return true;
+}
+
+bool AllocationMap::mapFat(int fd, qint64 offset, qint64 size, ByteRangeList &ranges, QString &description)
+{
+    char boot[512];
+    if (size < 512 || !readAt(fd, boot, sizeof(boot), offset) ||
+        uchar(boot[510]) != 0x55 || uchar(boot[511]) != 0xAA) {
+        return false;
+    }
+
+    quint32 bytesPerSector = field<quint16>(boot, 11);
+    quint32 sectorsPerCluster = uchar(boot[13]);
+    quint32 reservedSectors = field<quint16>(boot, 14);
+    quint32 fatCount = uchar(boot[16]);
+    quint32 rootEntries = field<quint16>(boot, 17);
+    quint32 totalSectors = field<quint16>(boot, 19);
+    quint32 fatSectors = field<quint16>(boot, 22);
+    if (totalSectors == 0) totalSectors = field<quint32>(boot, 32);
+    if (fatSectors == 0) fatSectors = field<quint32>(boot, 36);
+
+    if ((bytesPerSector != 512 && bytesPerSector != 1024 && bytesPerSector != 2048 && bytesPerSector != 4096) ||
+        sectorsPerCluster == 0 || (sectorsPerCluster & (sectorsPerCluster - 1)) != 0 ||
+        reservedSectors == 0 || fatCount == 0 || fatSectors == 0) {
+        return false;
+    }
+
+    quint64 rootDirSectors = (quint64(rootEntries) * 32 + bytesPerSector - 1) / bytesPerSector;
+    quint64 firstDataSector = reservedSectors + quint64(fatCount) * fatSectors + rootDirSectors;
+    if (firstDataSector >= totalSectors || qint64(totalSectors) * bytesPerSector > size) {
+        return false;
+    }
+    quint64 clusterCount = (totalSectors - firstDataSector) / sectorsPerCluster;
+    int fatBits = clusterCount < 4085 ? 12 : (clusterCount < 65525 ? 16 : 32);
+    qint64 clusterBytes = qint64(sectorsPerCluster) * bytesPerSector;
+
+    // Boot sector, FATs and (FAT12/16) root directory
+    appendRange(ranges, offset, qint64(firstDataSector) * bytesPerSector);
+
+    qint64 fatBytes = qint64(fatSectors) * bytesPerSector;
+    qint64 neededBytes = qint64(clusterCount + 2) * fatBits / 8 + 2;
+    if (fatBytes > kMaxFatTableSize || neededBytes > fatBytes) {
+        return false;
+    }
+    QByteArray fat(int(fatBytes), '\0');
+    if (!readAt(fd, fat.data(), fatBytes, offset + qint64(reservedSectors) * bytesPerSector)) {
+        return false;
+    }
+
+    const char *table = fat.constData();
+    qint64 dataOffset = offset + qint64(firstDataSector) * bytesPerSector;
+    for (quint64 cluster = 2; cluster < clusterCount + 2; ++cluster) {
+        quint32 entry;
+        if (fatBits == 32) {
+            entry = field<quint32>(table, int(cluster * 4)) & 0x0FFFFFFF;
+        } else if (fatBits == 16) {
+            entry = field<quint16>(table, int(cluster * 2));
+        } else {
+            quint16 pair = field<quint16>(table, int(cluster + cluster / 2));
+            entry = (cluster & 1) ? (pair >> 4) : (pair & 0x0FFF);
+        }
+        if (entry != 0) {
+            appendRange(ranges, dataOffset + qint64(cluster - 2) * clusterBytes, clusterBytes);
+        }
+    }
+
+    description = QString("FAT%1").arg(fatBits);
+    return true;
+}
@@ -0,0 +1,45 @@
+#ifndef ALLOCATIONMAP_H
+#define ALLOCATIONMAP_H
+
+#include "blockrange.h"
+#include <QString>
+#include <QStringList>
+
+// Works out which byte ranges of a disk hold data worth copying: the raw
+// areas around partitions (boot loaders live there on Rockchip boards), the
+// allocated blocks of ext2/3/4 and FAT partitions, and any other partition
+// in full. Free filesystem space and unpartitioned tail space are left out.
+class AllocationMap
+{
+public:
+    AllocationMap();
+
+    bool build(const QString &devicePath, QString &error);
+
+    ByteRangeList ranges() const { return m_ranges; }
+    qint64 usedBytes() const { return totalRangeLength(m_ranges); }
+    qint64 diskSize() const { return m_diskSize; }
+
+    // Smallest target that can take the clone (includes room for a backup GPT)
+    qint64 requiredSize() const { return m_requiredSize; }
+
+    bool isGpt() const { return m_isGpt; }
+    int sectorSize() const { return m_sectorSize; }
+
+    // One line per partition describing how it was mapped
+    QStringList summary() const { return m_summary; }
+
+private:
+    void mapPartition(int fd, qint64 offset, qint64 size, const QString &name);
+    bool mapExt(int fd, qint64 offset, qint64 size, ByteRangeList &ranges, QString &description);
+    bool mapFat(int fd, qint64 offset, qint64 size, ByteRangeList &ranges, QString &description);
+
+    ByteRangeList m_ranges;
+    QStringList m_summary;
+    qint64 m_diskSize;
+    qint64 m_requiredSize;
+    bool m_isGpt;
+    int m_sectorSize;
+};
+
+#endif // ALLOCATIONMAP_H
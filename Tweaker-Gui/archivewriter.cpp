@@ -0,0 +1,252 @@
+#include "archivewriter.h"
+#include "imagecompressor.h"
+#include <QProcess>
+#include <QSet>
+#include <QStorageInfo>
+
+#include <fts.h>
+#include <sys/stat.h>
+
+namespace {
+
+const int kPollIntervalMs = 100;
+const qint64 kProgressIntervalMs = 100;
+
+// tar --exclude patterns as used here: "/dir/*" or a plain path
+bool isExcluded(const QString &path, const QStringList &excludes)
+{
+    for (const QString &exclude : excludes) {
+        QString excluded = exclude.endsWith("/*") ? exclude.left(exclude.size() - 2) : exclude;
+        if (path == excluded || path.startsWith(excluded + "/")) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Disk space taken by everything below path on path's own filesystem,
+// like du -sx. Unreadable directories are left out, so this errs low.
+qint64 usedBytes(const QString &path, const QAtomicInt *stop)
+{
+    QByteArray encoded = path.toLocal8Bit();
+    char *paths[] = { encoded.data(), nullptr };
+    FTS *tree = fts_open(paths, FTS_PHYSICAL | FTS_XDEV | FTS_NOCHDIR, nullptr);
+    if (!tree) return 0;
+
+    qint64 total = 0;
+    while (FTSENT *entry = fts_read(tree)) {
+        if (stop && stop->load()) break;
+        // Directories are seen again on the way out; count them once
+        if (entry->fts_info == FTS_DP || !entry->fts_statp) continue;
+        if (entry->fts_info == FTS_NS || entry->fts_info == FTS_ERR) continue;
+        total += qint64(entry->fts_statp->st_blocks) * 512;
+    }
+    fts_close(tree);
+    return total;
+}
+
+} // namespace
+
+ArchiveWriter::ArchiveWriter(const QString &archivePath, ImageDecompressor::Format format, QObject *parent)
+    : QThread(parent)
+    , m_archivePath(archivePath)
+    , m_sourcePath("/")
+    , m_format(format)
+    , m_estimatedBytes(0)
+    , m_lastReportBytes(0)
+    , m_lastReportTime(0)
+    , m_throughput(0.0)
+{
+}
+
+ArchiveWriter::~ArchiveWriter()
+{
+    requestInterruption();
+    wait();
+}
+
+void ArchiveWriter::run()
+{
+    m_progressTimer.start();
+    m_lastReportBytes = 0;
+    m_lastReportTime = 0;
+    m_throughput = 0.0;
+
+    QString message;
+    bool success = writeArchive(message);
+    emit archiveFinished(success, message);
+}
+
+qint64 ArchiveWriter::estimateSize(const QString &root, const QStringList &excludes, const QAtomicInt *stop)
+{
+    // The filesystem holding root, then everything mounted below it
+    QStorageInfo base(root);
+    QSet<QByteArray> counted;
+    qint64 total = 0;
+    if (base.isValid() && base.isReady()) {
+        counted.insert(base.device());
+        total += base.bytesTotal() - base.bytesFree();
+    }
+
+    QString prefix = root.endsWith("/") ? root : root + "/";
+    for (const QStorageInfo &volume : QStorageInfo::mountedVolumes()) {
+        QString mountPoint = volume.rootPath();
+        if (!volume.isValid() || !volume.isReady() || !mountPoint.startsWith(prefix) ||
+            isExcluded(mountPoint, excludes)) {
+            continue;
+        }
+        // Bind mounts and subvolumes show the same filesystem twice
+        if (counted.contains(volume.device())) continue;
+        counted.insert(volume.device());
+        total += volume.bytesTotal() - volume.bytesFree();
+    }
+
+    // Excluded directories that aren't mounts of their own (/home without
+    // its own partition) are inside a counted filesystem; only a walk can
+    // tell how much of it they take
+    for (const QString &exclude : excludes) {
+        QString excluded = exclude.endsWith("/*") ? exclude.left(exclude.size() - 2) : exclude;
+        if (!excluded.startsWith(prefix)) continue;
+        QStorageInfo volume(excluded);
+        if (!volume.isValid() || volume.rootPath() == excluded || !counted.contains(volume.device())) continue;
+        total -= usedBytes(excluded, stop);
+    }
+    return qMax<qint64>(total, 0);
+}
+
+bool ArchiveWriter::writeArchive(QString &message)
+{
+    QString &error = message;
+
+    ImageCompressor compressor;
+    if (!compressor.open(m_archivePath, m_format, error)) {
+        return false;
+    }
+
+    QStringList args;
+    for (const QString &exclude : m_excludes) {
+        args << QString("--exclude=%1").arg(exclude);
+    }
+    // The archive may well be inside the tree being archived
+    args << QString("--exclude=%1.part").arg(m_archivePath);
+    args << "-cpf" << "-" << m_sourcePath;
+
+    QProcess tar;
+    tar.start("tar", args);
+    if (!tar.waitForStarted()) {
+        error = QString("Cannot run tar: %1").arg(tar.errorString());
+        return false;
+    }
+
+    QStringList cores;
+    for (int core : compressor.pinnedCores()) {
+        cores << QString::number(core);
+    }
+    emit statusMessage(QString("Archiving %1 with %2 compression on %3 thread%4%5")
+                           .arg(m_sourcePath, ImageDecompressor::formatName(m_format))
+                           .arg(compressor.threadCount())
+                           .arg(compressor.threadCount() == 1 ? "" : "s")
+                           .arg(cores.isEmpty() ? QString() : QString(" (cores %1)").arg(cores.join(","))));
+
+    // The estimate may walk a large excluded /home; tar copies meanwhile
+    // and progress has a total once it is known
+    m_estimatedBytes.store(0);
+    QAtomicInt stopEstimate;
+    QThread *estimator = QThread::create([this, &stopEstimate]() {
+        m_estimatedBytes.store(estimateSize(m_sourcePath, m_excludes, &stopEstimate));
+    });
+    estimator->start(QThread::LowPriority);
+    bool estimateReported = false;
+    auto stopEstimator = [&]() {
+        stopEstimate.store(1);
+        estimator->wait();
+        delete estimator;
+        estimator = nullptr;
+    };
+
+    // tar warnings (sockets skipped, files changed while read) are passed on
+    QString lastDiagnostic;
+    auto forwardDiagnostics = [&]() {
+        QString diagnostics = QString::fromLocal8Bit(tar.readAllStandardError());
+        for (const QString &line : diagnostics.split('\n')) {
+            if (line.trimmed().isEmpty()) continue;
+            lastDiagnostic = line;
+            emit statusMessage(line);
+        }
+    };
+
+    for (;;) {
+        if (isInterruptionRequested()) {
+            tar.kill();
+            tar.waitForFinished();
+            stopEstimator();
+            error = "Snapshot cancelled";
+            return false;
+        }
+
+        bool ready = tar.waitForReadyRead(kPollIntervalMs);
+        QByteArray data = tar.readAllStandardOutput();
+        if (!data.isEmpty() && !compressor.write(data.constData(), data.size(), error)) {
+            tar.kill();
+            tar.waitForFinished();
+            stopEstimator();
+            return false;
+        }
+        forwardDiagnostics();
+        if (!estimateReported && estimator->isFinished()) {
+            estimateReported = true;
+            emit statusMessage(QString("About %1 MiB to archive").arg(estimatedBytes() / (1024 * 1024)));
+        }
+        reportProgress(compressor.bytesIn(), estimatedBytes(), false);
+
+        if (!ready && tar.state() == QProcess::NotRunning) {
+            break;
+        }
+    }
+    forwardDiagnostics();
+    stopEstimator();
+
+    // Exit code 1 means some files changed while being read, which is
+    // expected on a live system; the archive is still complete
+    if (tar.exitStatus() != QProcess::NormalExit || tar.exitCode() > 1) {
+        error = QString("tar failed (exit code %1)%2").arg(tar.exitCode())
+                    .arg(lastDiagnostic.isEmpty() ? QString() : QString(": %1").arg(lastDiagnostic));
+        return false;
+    }
+    if (tar.exitCode() == 1) {
+        emit statusMessage("Some files changed while they were archived");
+    }
+
+    emit statusMessage(QString("Flushing %1...").arg(m_archivePath));
+    if (!compressor.finish(error)) {
+        return false;
+    }
+    reportProgress(compressor.bytesIn(), compressor.bytesIn(), true);
+
+    qint64 bytesIn = compressor.bytesIn();
+    message = QString("Snapshot saved to %1: %2 MiB archived, %3 MiB compressed (%4%)")
+                  .arg(m_archivePath).arg(bytesIn / (1024 * 1024))
+                  .arg(compressor.bytesOut() / (1024 * 1024))
+                  .arg(bytesIn > 0 ? compressor.bytesOut() * 100 / bytesIn : 0);
+    return true;
+}
+
+void ArchiveWriter::reportProgress(qint64 bytesDone, qint64 totalBytes, bool force)
+{
+    qint64 now = m_progressTimer.elapsed();
+    qint64 interval = now - m_lastReportTime;
+    if (!force && interval < kProgressIntervalMs) {
+        return;
+    }
+
+    if (interval > 0) {
+        // Exponential moving average smooths out tar's bursts
+        double instant = (bytesDone - m_lastReportBytes) * 1000.0 / interval;
+        m_throughput = (m_throughput > 0.0) ? 0.8 * m_throughput + 0.2 * instant : instant;
+        emit throughputChanged(m_throughput);
+    }
+
+    m_lastReportBytes = bytesDone;
+    m_lastReportTime = now;
+    emit progressChanged(bytesDone, totalBytes);
+}
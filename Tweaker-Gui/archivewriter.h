@@ -0,0 +1,70 @@
+#ifndef ARCHIVEWRITER_H
+#define ARCHIVEWRITER_H
+
+#include "imagedecompressor.h"
+#include <QAtomicInt>
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QElapsedTimer>
+
+// Writes a compressed tar snapshot of a directory tree (normally /) on its
+// own thread. tar only produces the uncompressed stream; compression runs
+// in-process on ImageCompressor's worker pool, so it isn't limited to the
+// single core a gzip or zstd child process would get from tar -z.
+class ArchiveWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    ArchiveWriter(const QString &archivePath, ImageDecompressor::Format format, QObject *parent = nullptr);
+    ~ArchiveWriter() override;
+
+    void setSourcePath(const QString &path) { m_sourcePath = path; }
+    QString sourcePath() const { return m_sourcePath; }
+
+    // Paths or patterns passed to tar --exclude
+    void setExcludes(const QStringList &excludes) { m_excludes = excludes; }
+    QStringList excludes() const { return m_excludes; }
+
+    QString archivePath() const { return m_archivePath; }
+    ImageDecompressor::Format format() const { return m_format; }
+
+    // Estimated uncompressed size, 0 until it has been worked out
+    qint64 estimatedBytes() const { return m_estimatedBytes.load(); }
+
+    // Bytes tar will read below root: the used space of the filesystems it
+    // walks, from statfs, less what excluded directories on those
+    // filesystems take. Only the excluded directories are walked, which
+    // can take a while for a large /home, so call it off the GUI thread;
+    // setting stop ends the walk early.
+    static qint64 estimateSize(const QString &root, const QStringList &excludes,
+                               const QAtomicInt *stop = nullptr);
+
+signals:
+    // Uncompressed bytes archived so far, against the estimate
+    void progressChanged(qint64 bytesDone, qint64 totalBytes);
+    void throughputChanged(double bytesPerSecond);
+    void statusMessage(const QString &message);
+    void archiveFinished(bool success, const QString &message);
+
+protected:
+    void run() override;
+
+private:
+    bool writeArchive(QString &message);
+    void reportProgress(qint64 bytesDone, qint64 totalBytes, bool force);
+
+    QString m_archivePath;
+    QString m_sourcePath;
+    QStringList m_excludes;
+    ImageDecompressor::Format m_format;
+    QAtomicInteger<qint64> m_estimatedBytes;     // Set by the estimating thread
+
+    QElapsedTimer m_progressTimer;
+    qint64 m_lastReportBytes;
+    qint64 m_lastReportTime;
+    double m_throughput;
+};
+
+#endif // ARCHIVEWRITER_H
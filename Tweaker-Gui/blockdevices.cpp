@@ -0,0 +1,270 @@
+#include "blockdevices.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QStringList>
+
+#include <algorithm>
+#include <sys/statvfs.h>
+
+namespace {
+
+const char kSysBlockPath[] = "/sys/block";
+const char kSysClassBlockPath[] = "/sys/class/block";
+const char kSysDevBlockPath[] = "/sys/dev/block";
+const char kUdevDataPath[] = "/run/udev/data";
+const char kMountInfoPath[] = "/proc/self/mountinfo";
+
+struct MountEntry {
+    QByteArray dev;         // "8:17"
+    QByteArray source;      // "/dev/sdb1", "/dev/root"
+    QString mountPoint;
+    QString fsType;
+};
+
+QByteArray readAttribute(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll().trimmed();
+}
+
+// Devices lsblk reports with a TYPE other than disk or part
+bool isIgnoredDevice(const QString &name)
+{
+    static const QRegularExpression ignored("^(loop|ram|sr|dm-|md)\\d");
+    return ignored.match(name).hasMatch();
+}
+
+// mountinfo escapes space, tab, newline and backslash as \ooo
+QString unescapeMountPath(const QByteArray &path)
+{
+    QByteArray result;
+    result.reserve(path.size());
+    for (int i = 0; i < path.size(); ++i) {
+        if (path[i] == '\\' && i + 3 < path.size()) {
+            bool ok = false;
+            int value = path.mid(i + 1, 3).toInt(&ok, 8);
+            if (ok) {
+                result.append(char(value));
+                i += 3;
+                continue;
+            }
+        }
+        result.append(path[i]);
+    }
+    return QString::fromLocal8Bit(result);
+}
+
+QList<MountEntry> readMountTable()
+{
+    QList<MountEntry> mounts;
+    QFile file(kMountInfoPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return mounts;
+    }
+
+    for (const QByteArray &line : file.readAll().split('\n')) {
+        // id parent major:minor root mount-point options [optional...] - type source super-options
+        QList<QByteArray> fields = line.split(' ');
+        int separator = fields.indexOf("-");
+        if (fields.size() < 5 || separator < 0 || separator + 2 >= fields.size()) continue;
+
+        MountEntry entry;
+        entry.dev = fields[2];
+        entry.source = fields[separator + 2];
+        entry.mountPoint = unescapeMountPath(fields[4]);
+        entry.fsType = QString::fromLatin1(fields[separator + 1]);
+        mounts.append(entry);
+    }
+    return mounts;
+}
+
+// First mount of dev or devicePath. Filesystems such as btrfs report an
+// anonymous device number, so the mount source is checked as well.
+const MountEntry *findMount(const QList<MountEntry> &mounts, const QByteArray &dev, const QString &devicePath)
+{
+    QByteArray source = devicePath.toLocal8Bit();
+    for (const MountEntry &entry : mounts) {
+        if (entry.dev == dev || entry.source == source) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+// Filesystem type and label probed by udev, as lsblk shows them
+void readUdevProperties(const QByteArray &dev, StorageDevice &device)
+{
+    QFile file(QString("%1/b%2").arg(kUdevDataPath, QString::fromLatin1(dev)));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    for (const QByteArray &line : file.readAll().split('\n')) {
+        if (line.startsWith("E:ID_FS_TYPE=")) {
+            device.filesystem = QString::fromUtf8(line.mid(13));
+        } else if (line.startsWith("E:ID_FS_LABEL=")) {
+            device.label = QString::fromUtf8(line.mid(14));
+        }
+    }
+}
+
+bool readDevice(const QString &name, const QList<MountEntry> &mounts, StorageDevice &device)
+{
+    if (name.isEmpty() || name.contains('/') || isIgnoredDevice(name)) {
+        return false;
+    }
+
+    QString sysPath = QString("%1/%2").arg(kSysClassBlockPath, name);
+    QByteArray dev = readAttribute(sysPath + "/dev");
+    if (dev.isEmpty()) {
+        return false;
+    }
+
+    device = StorageDevice();
+    device.device = "/dev/" + name;
+    device.isDisk = !QFile::exists(sysPath + "/partition");
+    device.size = BlockDevices::formatSize(readAttribute(sysPath + "/size").toLongLong() * 512);
+
+    // Partitions live in their disk's directory and take its removable flag
+    QString diskPath = device.isDisk ? sysPath : QFileInfo(QFileInfo(sysPath).canonicalFilePath()).path();
+    device.isRemovable = (readAttribute(diskPath + "/removable") == "1");
+
+    readUdevProperties(dev, device);
+
+    const MountEntry *mount = findMount(mounts, dev, device.device);
+    device.isMounted = (mount != nullptr);
+    if (mount) {
+        device.mountPoint = mount->mountPoint;
+        if (device.filesystem.isEmpty()) {
+            device.filesystem = mount->fsType;
+        }
+
+        // Same figures QStorageInfo gives: used counts the root reserve
+        struct statvfs stats;
+        if (statvfs(QFile::encodeName(device.mountPoint).constData(), &stats) == 0) {
+            qint64 total = qint64(stats.f_blocks) * stats.f_frsize;
+            qint64 available = qint64(stats.f_bavail) * stats.f_frsize;
+            device.used = BlockDevices::formatSize(total - available);
+            device.available = BlockDevices::formatSize(available);
+        }
+    }
+    device.isSystemDrive = (device.mountPoint == "/");
+    return true;
+}
+
+// Compares as a plain string in natural order: SCSI-style disk letters
+// get their count in front ("sdaa" -> "sd02aa") and every number is
+// zero-padded to the same width
+QString sortKey(const QString &device)
+{
+    static const QRegularExpression letters("^(.*/)?(sd|vd|hd|xvd)([a-z]+)");
+    static const QRegularExpression number("\\d+");
+
+    QString key = device;
+    QRegularExpressionMatch match = letters.match(key);
+    if (match.hasMatch()) {
+        key.insert(match.capturedStart(3), QString::number(match.capturedLength(3)).rightJustified(2, '0'));
+    }
+
+    QString padded;
+    int position = 0;
+    QRegularExpressionMatchIterator numbers = number.globalMatch(key);
+    while (numbers.hasNext()) {
+        QRegularExpressionMatch run = numbers.next();
+        padded += key.midRef(position, run.capturedStart() - position);
+        padded += run.captured().rightJustified(10, '0');
+        position = run.capturedEnd();
+    }
+    padded += key.midRef(position);
+    return padded;
+}
+
+} // namespace
+
+QList<StorageDevice> BlockDevices::enumerate()
+{
+    QList<StorageDevice> devices;
+    QList<MountEntry> mounts = readMountTable();
+
+    QStringList disks = QDir(kSysBlockPath).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    std::sort(disks.begin(), disks.end(), lessThan);
+    for (const QString &disk : disks) {
+        StorageDevice device;
+        if (!readDevice(disk, mounts, device)) continue;
+        devices.append(device);
+
+        // Partitions are subdirectories with a partition number
+        QList<QPair<int, QString>> partitions;
+        const QStringList entries = QDir(QString("%1/%2").arg(kSysBlockPath, disk))
+                                        .entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+        for (const QString &entry : entries) {
+            if (!entry.startsWith(disk)) continue;
+            QByteArray number = readAttribute(QString("%1/%2/%3/partition").arg(kSysBlockPath, disk, entry));
+            if (!number.isEmpty()) {
+                partitions.append(qMakePair(number.toInt(), entry));
+            }
+        }
+        std::sort(partitions.begin(), partitions.end());
+
+        for (const QPair<int, QString> &partition : partitions) {
+            if (readDevice(partition.second, mounts, device)) {
+                devices.append(device);
+            }
+        }
+    }
+    return devices;
+}
+
+bool BlockDevices::read(const QString &name, StorageDevice &device)
+{
+    return readDevice(name, readMountTable(), device);
+}
+
+QString BlockDevices::deviceForMountPoint(const QString &mountPoint)
+{
+    // The last mount at a path is the one visible there
+    const QList<MountEntry> mounts = readMountTable();
+    for (int i = mounts.size() - 1; i >= 0; --i) {
+        const MountEntry &entry = mounts.at(i);
+        if (entry.mountPoint != mountPoint) continue;
+
+        // /sys/dev/block/<major:minor> links to the kernel's name for it
+        QString target = QFileInfo(QString("%1/%2").arg(kSysDevBlockPath, QString::fromLatin1(entry.dev)))
+                             .canonicalFilePath();
+        if (!target.isEmpty()) {
+            return "/dev/" + QFileInfo(target).fileName();
+        }
+        return QString::fromLocal8Bit(entry.source);
+    }
+    return QString();
+}
+
+bool BlockDevices::lessThan(const QString &a, const QString &b)
+{
+    return sortKey(a) < sortKey(b);
+}
+
+QString BlockDevices::formatSize(qint64 bytes)
+{
+    static const char units[] = "KMGTPE";
+
+    if (bytes < 1024) {
+        return QString("%1B").arg(bytes);
+    }
+    double value = bytes;
+    int unit = -1;
+    while (value >= 1024 && unit < 5) {
+        value /= 1024;
+        ++unit;
+    }
+    // One decimal, dropped when it rounds to zero
+    QString number = QString::number(value, 'f', 1);
+    if (number.endsWith(".0")) {
+        number.chop(2);
+    }
+    return number + QChar(units[unit]);
+}
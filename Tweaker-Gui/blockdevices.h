@@ -0,0 +1,51 @@
+#ifndef BLOCKDEVICES_H
+#define BLOCKDEVICES_H
+
+#include <QList>
+#include <QString>
+
+struct StorageDevice {
+    QString device;          // e.g., /dev/sda
+    QString mountPoint;      // e.g., /mnt/sda1
+    QString filesystem;      // e.g., ext4, ntfs
+    QString label;          // Volume label
+    QString size;           // Total size
+    QString used;           // Used space
+    QString available;      // Available space
+    bool isRemovable;       // USB, SD card, etc.
+    bool isMounted;         // Currently mounted
+    bool isSystemDrive;     // Contains the OS
+    bool isDisk;            // Whole disk rather than a partition
+};
+
+// Block device details read straight from the kernel: sysfs for the device
+// itself, the udev database for filesystem type and label,
+// /proc/self/mountinfo for where it is mounted and statvfs for usage.
+// Nothing here forks or needs an event loop, so it is cheap enough to
+// refresh a single device whenever the kernel reports it and safe to run
+// on a worker thread.
+class BlockDevices
+{
+public:
+    // Every disk followed by its partitions, as lsblk lists them
+    static QList<StorageDevice> enumerate();
+
+    // Fills device from /sys/class/block/<name> ("sdb1", "mmcblk0").
+    // Returns false if the device is gone or isn't a disk or partition
+    // (loop, optical, device-mapper and RAID devices are left out).
+    static bool read(const QString &name, StorageDevice &device);
+
+    // Device mounted at mountPoint ("/dev/mmcblk0p2"), with aliases such
+    // as /dev/root resolved through the device number; empty if nothing is
+    // mounted there
+    static QString deviceForMountPoint(const QString &mountPoint);
+
+    // Natural device order, the kernel's: sdz before sdaa, mmcblk0p2
+    // before mmcblk0p10, a disk right before its partitions
+    static bool lessThan(const QString &a, const QString &b);
+
+    // Human-readable size in lsblk's style ("29.7G", "512M", "0B")
+    static QString formatSize(qint64 bytes);
+};
+
+#endif // BLOCKDEVICES_H
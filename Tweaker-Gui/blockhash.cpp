@@ -0,0 +1,95 @@
+#include "blockhash.h"
+#include <QtEndian>
+
+namespace {
+
+const quint64 kPrime1 = 0x9E3779B185EBCA87ULL;
+const quint64 kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+const quint64 kPrime3 = 0x165667B19E3779F9ULL;
+const quint64 kPrime4 = 0x85EBCA77C2B2AE63ULL;
+const quint64 kPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline quint64 rotateLeft(quint64 value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// The reference hash is defined on little-endian words
+inline quint64 read64(const unsigned char *p)
+{
+    return qFromLittleEndian<quint64>(p);
+}
+
+inline quint32 read32(const unsigned char *p)
+{
+    return qFromLittleEndian<quint32>(p);
+}
+
+inline quint64 hashRound(quint64 accumulator, quint64 input)
+{
+    accumulator += input * kPrime2;
+    accumulator = rotateLeft(accumulator, 31);
+    return accumulator * kPrime1;
+}
+
+inline quint64 mergeRound(quint64 accumulator, quint64 value)
+{
+    accumulator ^= hashRound(0, value);
+    return accumulator * kPrime1 + kPrime4;
+}
+
+} // namespace
+
+quint64 BlockHash::xxh64(const char *data, qint64 length, quint64 seed)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    const unsigned char *end = p + length;
+    quint64 hash;
+
+    if (length >= 32) {
+        // Four independent lanes keep the multipliers busy
+        quint64 v1 = seed + kPrime1 + kPrime2;
+        quint64 v2 = seed + kPrime2;
+        quint64 v3 = seed;
+        quint64 v4 = seed - kPrime1;
+        const unsigned char *limit = end - 32;
+        do {
+            v1 = hashRound(v1, read64(p));
+            v2 = hashRound(v2, read64(p + 8));
+            v3 = hashRound(v3, read64(p + 16));
+            v4 = hashRound(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+        hash = mergeRound(hash, v1);
+        hash = mergeRound(hash, v2);
+        hash = mergeRound(hash, v3);
+        hash = mergeRound(hash, v4);
+    } else {
+        hash = seed + kPrime5;
+    }
+
+    hash += static_cast<quint64>(length);
+
+    for (; p + 8 <= end; p += 8) {
+        hash ^= hashRound(0, read64(p));
+        hash = rotateLeft(hash, 27) * kPrime1 + kPrime4;
+    }
+    if (p + 4 <= end) {
+        hash ^= static_cast<quint64>(read32(p)) * kPrime1;
+        hash = rotateLeft(hash, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        hash ^= *p * kPrime5;
+        hash = rotateLeft(hash, 11) * kPrime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
@@ -0,0 +1,14 @@
+#ifndef BLOCKHASH_H
+#define BLOCKHASH_H
+
+#include <QtGlobal>
+
+// Fast non-cryptographic hash (XXH64) used to verify written blocks. Runs at
+// several GB/s, well ahead of any card, so hashing hides behind the writes.
+class BlockHash
+{
+public:
+    static quint64 xxh64(const char *data, qint64 length, quint64 seed = 0);
+};
+
+#endif // BLOCKHASH_H
@@ -0,0 +1,52 @@
+#ifndef BLOCKRANGE_H
+#define BLOCKRANGE_H
+
+#include <QVector>
+#include <QtGlobal>
+#include <algorithm>
+
+// Byte range on a device or image
+struct ByteRange {
+    qint64 offset;
+    qint64 length;
+
+    qint64 end() const { return offset + length; }
+};
+
+typedef QVector<ByteRange> ByteRangeList;
+
+// Append a range, merging it into the previous one when they touch.
+// Out-of-order ranges are kept as-is; normalizeRanges() sorts them out.
+inline void appendRange(ByteRangeList &ranges, qint64 offset, qint64 length)
+{
+    if (length <= 0) return;
+    if (!ranges.isEmpty() && offset >= ranges.last().offset && offset <= ranges.last().end()) {
+        ranges.last().length = qMax(ranges.last().end(), offset + length) - ranges.last().offset;
+        return;
+    }
+    ranges.append(ByteRange{offset, length});
+}
+
+// Sort and merge overlapping or adjacent ranges
+inline ByteRangeList normalizeRanges(ByteRangeList ranges)
+{
+    std::sort(ranges.begin(), ranges.end(), [](const ByteRange &a, const ByteRange &b) {
+        return a.offset < b.offset;
+    });
+    ByteRangeList merged;
+    for (const ByteRange &range : ranges) {
+        appendRange(merged, range.offset, range.length);
+    }
+    return merged;
+}
+
+inline qint64 totalRangeLength(const ByteRangeList &ranges)
+{
+    qint64 total = 0;
+    for (const ByteRange &range : ranges) {
+        total += range.length;
+    }
+    return total;
+}
+
+#endif // BLOCKRANGE_H
@@ -0,0 +1,145 @@
+#include "devicebenchmark.h"
+#include "blockdevices.h"
+#include <QElapsedTimer>
+#include <QMap>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QStorageInfo>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+
+#include <algorithm>
+
+namespace {
+
+struct Timing {
+    double meanMs = 0.0;
+    double medianMs = 0.0;
+    double minMs = 0.0;
+};
+
+// The scan as StorageManager ran it before: lsblk -P parsed with a regex,
+// usage from QStorageInfo
+QList<StorageDevice> enumerateWithLsblk()
+{
+    QList<StorageDevice> devices;
+
+    QProcess lsblk;
+    lsblk.start("lsblk", QStringList()
+        << "-o" << "NAME,FSTYPE,LABEL,SIZE,RM,TYPE,MOUNTPOINT"
+        << "-n" << "-P");
+    if (!lsblk.waitForFinished()) {
+        return devices;
+    }
+
+    QString output = lsblk.readAllStandardOutput();
+    QRegularExpression rx("(\\w+)=\"([^\"]*)\"");
+    for (const QString &line : output.split('\n')) {
+        if (line.isEmpty()) continue;
+
+        QMap<QString, QString> deviceInfo;
+        QRegularExpressionMatchIterator it = rx.globalMatch(line);
+        while (it.hasNext()) {
+            QRegularExpressionMatch match = it.next();
+            deviceInfo[match.captured(1)] = match.captured(2);
+        }
+        if (deviceInfo["TYPE"] != "disk" && deviceInfo["TYPE"] != "part") continue;
+
+        StorageDevice device = StorageDevice();
+        device.device = "/dev/" + deviceInfo["NAME"];
+        device.size = deviceInfo["SIZE"];
+        device.filesystem = deviceInfo["FSTYPE"];
+        device.mountPoint = deviceInfo["MOUNTPOINT"];
+        device.label = deviceInfo["LABEL"];
+        device.isRemovable = (deviceInfo["RM"] == "1");
+        device.isDisk = (deviceInfo["TYPE"] == "disk");
+        device.isMounted = !device.mountPoint.isEmpty();
+        if (device.isMounted) {
+            QStorageInfo storageInfo(device.mountPoint);
+            device.used = BlockDevices::formatSize(storageInfo.bytesTotal() - storageInfo.bytesAvailable());
+            device.available = BlockDevices::formatSize(storageInfo.bytesAvailable());
+        }
+        devices.append(device);
+    }
+    return devices;
+}
+
+template <typename Scan>
+Timing measure(int iterations, Scan scan, QList<StorageDevice> &devices)
+{
+    QVector<double> samples;
+    samples.reserve(iterations);
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        timer.start();
+        devices = scan();
+        samples.append(timer.nsecsElapsed() / 1e6);
+    }
+
+    std::sort(samples.begin(), samples.end());
+    Timing timing;
+    for (double sample : samples) {
+        timing.meanMs += sample;
+    }
+    timing.meanMs /= samples.size();
+    timing.medianMs = samples.at(samples.size() / 2);
+    timing.minMs = samples.first();
+    return timing;
+}
+
+QString describe(const StorageDevice &device)
+{
+    return QString("%1 %2 %3").arg(device.size, device.isDisk ? "disk" : "part", device.mountPoint);
+}
+
+} // namespace
+
+int runDeviceBenchmark(int iterations)
+{
+    QTextStream out(stdout);
+    out << QString("Enumerating block devices %1 times each\n").arg(iterations);
+
+    QList<StorageDevice> lsblkDevices;
+    QList<StorageDevice> sysfsDevices;
+    Timing lsblk = measure(iterations, enumerateWithLsblk, lsblkDevices);
+    Timing sysfs = measure(iterations, BlockDevices::enumerate, sysfsDevices);
+
+    auto report = [&out](const char *name, const Timing &timing, int count) {
+        out << QString("%1 %2 devices, mean %3 ms, median %4 ms, min %5 ms\n")
+                   .arg(QString(name).leftJustified(22))
+                   .arg(count)
+                   .arg(timing.meanMs, 0, 'f', 3)
+                   .arg(timing.medianMs, 0, 'f', 3)
+                   .arg(timing.minMs, 0, 'f', 3);
+    };
+    report("lsblk + QStorageInfo:", lsblk, lsblkDevices.size());
+    report("sysfs + statvfs:", sysfs, sysfsDevices.size());
+    if (sysfs.meanMs > 0.0) {
+        out << QString("sysfs + statvfs is %1x faster\n").arg(lsblk.meanMs / sysfs.meanMs, 0, 'f', 1);
+    }
+
+    // Both should describe the same devices
+    QMap<QString, QString> expected;
+    for (const StorageDevice &device : lsblkDevices) {
+        expected[device.device] = describe(device);
+    }
+    int differences = 0;
+    for (const StorageDevice &device : sysfsDevices) {
+        QString actual = describe(device);
+        QString wanted = expected.take(device.device);
+        if (wanted != actual) {
+            out << QString("  %1: lsblk '%2', sysfs '%3'\n").arg(device.device, wanted, actual);
+            ++differences;
+        }
+    }
+    for (auto it = expected.constBegin(); it != expected.constEnd(); ++it) {
+        out << QString("  %1: lsblk '%2', missing from sysfs\n").arg(it.key(), it.value());
+        ++differences;
+    }
+    if (differences > 0) {
+        out << QString("%1 device%2\n").arg(differences).arg(differences == 1 ? " differs" : "s differ");
+    }
+    out.flush();
+    return differences > 0 ? 1 : 0;
+}
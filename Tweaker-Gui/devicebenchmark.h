@@ -0,0 +1,10 @@
+#ifndef DEVICEBENCHMARK_H
+#define DEVICEBENCHMARK_H
+
+// Times BlockDevices::enumerate() against the lsblk scan StorageManager
+// used to run, and checks both see the same devices. Started with
+// --benchmark-devices [iterations]; prints to stdout and returns the exit
+// code.
+int runDeviceBenchmark(int iterations);
+
+#endif // DEVICEBENCHMARK_H
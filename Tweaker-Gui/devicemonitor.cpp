@@ -0,0 +1,213 @@
+#include "devicemonitor.h"
+#include <QByteArray>
+#include <QSocketNotifier>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+namespace {
+
+const unsigned kKernelGroup = 1;            // Raw kernel uevents
+const unsigned kUdevGroup = 2;              // udevd's rebroadcast after probing
+const int kReceiveBufferSize = 1024 * 1024; // A card with many partitions arrives as a burst
+const int kMessageSize = 8192;
+const unsigned kUdevMagic = 0xfeedcafe;
+
+// Header udevd puts in front of its messages (libudev's monitor_netlink_header)
+struct UdevHeader {
+    char prefix[8];                 // "libudev"
+    unsigned magic;                 // kUdevMagic, network byte order
+    unsigned headerSize;
+    unsigned propertiesOffset;
+    unsigned propertiesLength;
+    unsigned filterSubsystemHash;
+    unsigned filterDevtypeHash;
+    unsigned filterTagBloomHigh;
+    unsigned filterTagBloomLow;
+};
+
+} // namespace
+
+DeviceMonitor::DeviceMonitor(QObject *parent)
+    : QObject(parent)
+    , m_socket(-1)
+    , m_mountsFd(-1)
+    , m_socketNotifier(nullptr)
+    , m_mountsNotifier(nullptr)
+{
+}
+
+DeviceMonitor::~DeviceMonitor()
+{
+    stop();
+}
+
+bool DeviceMonitor::start(QString &error)
+{
+    if (isRunning()) {
+        return true;
+    }
+
+    m_socket = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (m_socket < 0) {
+        error = QString("Cannot open uevent socket: %1").arg(strerror(errno));
+        return false;
+    }
+
+    // The forced size needs CAP_NET_ADMIN; the plain one is capped by rmem_max
+    int size = kReceiveBufferSize;
+    if (setsockopt(m_socket, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) < 0) {
+        setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    }
+    // Sender credentials, so only root (the kernel, udevd) is listened to
+    int on = 1;
+    setsockopt(m_socket, SOL_SOCKET, SO_PASSCRED, &on, sizeof(on));
+
+    struct sockaddr_nl address;
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = kKernelGroup | kUdevGroup;
+    if (bind(m_socket, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0) {
+        error = QString("Cannot listen for uevents: %1").arg(strerror(errno));
+        ::close(m_socket);
+        m_socket = -1;
+        return false;
+    }
+
+    m_socketNotifier = new QSocketNotifier(m_socket, QSocketNotifier::Read, this);
+    connect(m_socketNotifier, &QSocketNotifier::activated, this, &DeviceMonitor::onSocketActivated);
+
+    // Mounting produces no uevent; the mount table signals POLLPRI instead
+    m_mountsFd = open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+    if (m_mountsFd >= 0) {
+        m_mountsNotifier = new QSocketNotifier(m_mountsFd, QSocketNotifier::Exception, this);
+        connect(m_mountsNotifier, &QSocketNotifier::activated, this, &DeviceMonitor::onMountsActivated);
+    }
+    return true;
+}
+
+void DeviceMonitor::stop()
+{
+    delete m_socketNotifier;
+    m_socketNotifier = nullptr;
+    delete m_mountsNotifier;
+    m_mountsNotifier = nullptr;
+
+    if (m_socket >= 0) {
+        ::close(m_socket);
+        m_socket = -1;
+    }
+    if (m_mountsFd >= 0) {
+        ::close(m_mountsFd);
+        m_mountsFd = -1;
+    }
+}
+
+void DeviceMonitor::onSocketActivated()
+{
+    char buffer[kMessageSize];
+    char control[CMSG_SPACE(sizeof(struct ucred))];
+
+    for (;;) {
+        struct iovec iov;
+        iov.iov_base = buffer;
+        iov.iov_len = sizeof(buffer);
+
+        struct sockaddr_nl sender;
+        memset(&sender, 0, sizeof(sender));
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_name = &sender;
+        message.msg_namelen = sizeof(sender);
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        ssize_t received = recvmsg(m_socket, &message, 0);
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            if (errno == ENOBUFS) {
+                emit eventsLost();
+                continue;
+            }
+            break;  // EAGAIN: drained
+        }
+        if (message.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) continue;
+
+        // Broadcasts only, from uid 0
+        if (sender.nl_groups == 0) continue;
+        struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+        if (!header || header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_CREDENTIALS) continue;
+        struct ucred credentials;
+        memcpy(&credentials, CMSG_DATA(header), sizeof(credentials));
+        if (credentials.uid != 0) continue;
+
+        // The kernel sends from port 0, udevd from its own
+        handleMessage(buffer, int(received), sender.nl_pid != 0);
+    }
+}
+
+void DeviceMonitor::onMountsActivated()
+{
+    emit mountsChanged();
+}
+
+void DeviceMonitor::handleMessage(const char *data, int size, bool fromUdev)
+{
+    // Both carry NUL-separated KEY=VALUE properties; the kernel's follow an
+    // "action@devpath" line, udevd's sit at an offset given in its header
+    int offset;
+    int end = size;
+    if (fromUdev) {
+        UdevHeader header;
+        if (size < int(sizeof(header))) return;
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.prefix, "libudev", 8) != 0 || ntohl(header.magic) != kUdevMagic) return;
+        if (header.propertiesOffset < sizeof(header) ||
+            header.propertiesOffset + header.propertiesLength > unsigned(size)) return;
+        offset = int(header.propertiesOffset);
+        end = offset + int(header.propertiesLength);
+    } else {
+        const char *summaryEnd = static_cast<const char *>(memchr(data, '\0', size));
+        if (!summaryEnd || !memchr(data, '@', summaryEnd - data)) return;
+        offset = int(summaryEnd - data) + 1;
+    }
+
+    QByteArray action;
+    QByteArray devPath;
+    QByteArray subsystem;
+    while (offset < end) {
+        const char *property = data + offset;
+        const char *propertyEnd = static_cast<const char *>(memchr(property, '\0', end - offset));
+        int length = propertyEnd ? int(propertyEnd - property) : end - offset;
+        QByteArray entry = QByteArray::fromRawData(property, length);
+
+        if (entry.startsWith("ACTION=")) {
+            action = entry.mid(7);
+        } else if (entry.startsWith("DEVPATH=")) {
+            devPath = entry.mid(8);
+        } else if (entry.startsWith("SUBSYSTEM=")) {
+            subsystem = entry.mid(10);
+        }
+        offset += length + 1;
+    }
+
+    if (subsystem != "block" || devPath.isEmpty()) return;
+
+    // The kernel name is the last DEVPATH component, whatever udev renamed the node to
+    QString name = QString::fromLatin1(devPath.mid(devPath.lastIndexOf('/') + 1));
+    if (action == "add") {
+        emit deviceAdded(name);
+    } else if (action == "remove") {
+        emit deviceRemoved(name);
+    } else {
+        // change (media inserted into a card reader, partition table reread), move, online...
+        emit deviceChanged(name);
+    }
+}
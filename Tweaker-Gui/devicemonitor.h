@@ -0,0 +1,48 @@
+#ifndef DEVICEMONITOR_H
+#define DEVICEMONITOR_H
+
+#include <QObject>
+#include <QString>
+
+class QSocketNotifier;
+
+// Reports block device hotplug and mount table changes as they happen.
+// Device events come from the kernel's uevent netlink socket, both the raw
+// kernel broadcast (immediately on insertion) and udev's rebroadcast (once
+// filesystem type and label have been probed); mount changes come from
+// polling /proc/self/mountinfo for POLLPRI. Nothing runs while idle.
+class DeviceMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DeviceMonitor(QObject *parent = nullptr);
+    ~DeviceMonitor() override;
+
+    bool start(QString &error);
+    void stop();
+    bool isRunning() const { return m_socket >= 0; }
+
+signals:
+    // Kernel names without /dev ("sdb", "mmcblk0p1")
+    void deviceAdded(const QString &name);
+    void deviceRemoved(const QString &name);
+    void deviceChanged(const QString &name);
+    void mountsChanged();
+    // The socket buffer overflowed and events were dropped; rescan
+    void eventsLost();
+
+private slots:
+    void onSocketActivated();
+    void onMountsActivated();
+
+private:
+    void handleMessage(const char *data, int size, bool fromUdev);
+
+    int m_socket;
+    int m_mountsFd;
+    QSocketNotifier *m_socketNotifier;
+    QSocketNotifier *m_mountsNotifier;
+};
+
+#endif // DEVICEMONITOR_H
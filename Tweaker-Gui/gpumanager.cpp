@@ -1,18 +1,72 @@
 #include "gpumanager.h"
+#include "processrunner.h"
 #include "systemmanager.h"
+#include "telemetrygraph.h"
+#include "telemetrylog.h"
+#include "telemetrythread.h"
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QProcess>
 #include <QTimer>
 #include <QDir>
 #include <QFile>
-#include <QTextStream>
 #include <QDesktopServices>
 #include <QUrl>
-#include <QPainter>
 #include <QDateTime>
 #include <QRandomGenerator>
-#include <QRegularExpression>
+
+#include <limits>
+
+namespace {
+
+const int kTelemetryIntervalMs = 100;   // Sampling, on the telemetry thread
+const int kDisplayIntervalMs = 33;      // Draining the samples and repainting
+const int kLabelIntervalMs = 500;       // Readable rate for the numbers
+const int kGlxinfoTimeoutMs = 2000;     // Library version query
+
+// Pen and full-scale value of each graph series, in GraphSeries order, and
+// the recorded channel it replays (divided down to graph units)
+struct SeriesStyle {
+    QRgb color;
+    double fullScale;
+    const char *channel;
+    double divisor;
+};
+const SeriesStyle kSeriesStyles[] = {
+    { 0xFF0000, 2.0, "gpu.frequency", 1000.0 },         // GPU frequency, 0-2 GHz
+    { 0x00FF00, 100.0, "gpu.temperature", 1.0 },        // GPU temperature, 0-100°C
+    { 0x0000FF, 100.0, "gpu.usage", 1.0 },              // GPU usage, 0-100%
+    { 0xFF00FF, 3.0, "cpu.big.frequency", 1000.0 },     // Big-core CPU frequency, 0-3 GHz
+    { 0xFFA500, 100.0, "cpu.temperature", 1.0 },        // CPU temperature, 0-100°C
+    { 0x008000, 100.0, "cpu.usage", 1.0 }               // CPU usage, 0-100%
+};
+
+// "CPU4-5 Cortex-A76: 1608 MHz, capped at 1608 of 2400 MHz, 64% (57% 71%)"
+QString clusterText(const TelemetrySample &sample, const CpuClusterSample &cluster)
+{
+    int lastCpu = cluster.firstCpu + cluster.cpuCount - 1;
+    QString text = cluster.cpuCount > 1 ? QString("CPU%1-%2").arg(cluster.firstCpu).arg(lastCpu)
+                                        : QString("CPU%1").arg(cluster.firstCpu);
+    if (const char *name = TelemetrySampler::coreName(cluster.corePart)) {
+        text += QString(" %1").arg(name);
+    }
+
+    text += QString(": %1 MHz").arg(cluster.frequency, 0, 'f', 0);
+    if (cluster.isThrottled()) {
+        text += QString(", <span style='color: #FF0000;'>capped at %1 of %2 MHz</span>")
+                    .arg(cluster.limitFrequency, 0, 'f', 0)
+                    .arg(cluster.maxFrequency, 0, 'f', 0);
+    }
+
+    QStringList cores;
+    for (int cpu = cluster.firstCpu; cpu <= lastCpu && cpu < sample.cpuCount; ++cpu) {
+        cores << QString("%1%").arg(sample.coreUsage[cpu], 0, 'f', 0);
+    }
+    text += QString(", %1% (%2)").arg(cluster.usage, 0, 'f', 0).arg(cores.join(" "));
+    return text;
+}
+
+} // namespace
 
 GpuManager::GpuManager(SystemManager *systemManager, QWidget *parent)
     : QWidget(parent)
@@ -198,13 +252,12 @@ void GpuManager::createGpuGraphGroup()
     QVBoxLayout *layout = new QVBoxLayout(m_gpuGraphGroup);
     
     // Create custom graph widget (30% smaller)
-    m_gpuGraphWidget = new QWidget();
+    m_gpuGraphWidget = new TelemetryGraph();
     m_gpuGraphWidget->setMinimumHeight(140);
     m_gpuGraphWidget->setMaximumHeight(140);
-    m_gpuGraphWidget->setStyleSheet("background-color: #F0F0F0; border: 1px solid #000000;");
-    
-    // Install event filter to handle painting
-    m_gpuGraphWidget->installEventFilter(this);
+    for (const SeriesStyle &style : kSeriesStyles) {
+        m_gpuGraphWidget->addSeries(QColor(style.color), style.fullScale);
+    }
     
     layout->addWidget(m_gpuGraphWidget);
     
@@ -224,7 +277,7 @@ void GpuManager::createGpuGraphGroup()
     valuesLayout->addWidget(m_systemResourcesLabel);
     
     // Add CPU information
-    m_cpuFreqLabel = new QLabel("CPU Freq: 0 MHz");
+    m_cpuFreqLabel = new QLabel("Big CPU Freq: 0 MHz");
     m_cpuFreqLabel->setStyleSheet("color: #FF00FF; font-weight: bold; font-size: 9pt;");
     valuesLayout->addWidget(m_cpuFreqLabel);
     
@@ -237,20 +290,61 @@ void GpuManager::createGpuGraphGroup()
     valuesLayout->addWidget(m_cpuUsageLabel);
     
     valuesLayout->addStretch();
+    
+    // How far back the graph goes; the history is sized to match
+    QLabel *historyLabel = new QLabel("History:");
+    historyLabel->setStyleSheet("color: #000000; font-size: 9pt;");
+    valuesLayout->addWidget(historyLabel);
+    
+    m_historyCombo = new QComboBox();
+    m_historyCombo->addItem("100 s", 100);
+    m_historyCombo->addItem("5 min", 5 * 60);
+    m_historyCombo->addItem("30 min", 30 * 60);
+    m_historyCombo->addItem("1 hour", 60 * 60);
+    m_historyCombo->addItem("4 hours", 4 * 60 * 60);
+    m_historyCombo->setStyleSheet(
+        "QComboBox { background-color: #F0F0F0; color: #000000; border: 1px solid #000000; padding: 2px; font-size: 9pt; }"
+        "QComboBox::drop-down { border: 0px; }"
+        "QComboBox QAbstractItemView { background-color: #F0F0F0; color: #000000; selection-background-color: #000000; selection-color: #FFFFFF; }"
+    );
+    connect(m_historyCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &GpuManager::onHistoryWindowChanged);
+    valuesLayout->addWidget(m_historyCombo);
+    
+    // Recordings made with --record-telemetry replay in the same graph
+    const QString smallButtonStyle =
+        "QPushButton { background-color: #F0F0F0; color: #000000; border: 1px solid #000000; padding: 2px 6px; font-size: 9pt; }"
+        "QPushButton:hover { background-color: #E0E0E0; }";
+    m_openRecordingButton = new QPushButton("Open Recording...");
+    m_openRecordingButton->setStyleSheet(smallButtonStyle);
+    connect(m_openRecordingButton, &QPushButton::clicked, this, &GpuManager::onOpenRecording);
+    valuesLayout->addWidget(m_openRecordingButton);
+    
+    m_liveButton = new QPushButton("Live");
+    m_liveButton->setStyleSheet(smallButtonStyle);
+    m_liveButton->setEnabled(false);
+    connect(m_liveButton, &QPushButton::clicked, this, &GpuManager::onShowLive);
+    valuesLayout->addWidget(m_liveButton);
+    
     layout->addLayout(valuesLayout);
     
-    // Initialize data vectors
-    m_voltageData.reserve(100);
-    m_powerData.reserve(100);
-    m_usageData.reserve(100);
-    m_cpuFreqData.reserve(100);
-    m_cpuTempData.reserve(100);
-    m_cpuUsageData.reserve(100);
+    // One line per cpufreq cluster, so a capped big cluster stands out
+    m_cpuClustersLabel = new QLabel();
+    m_cpuClustersLabel->setStyleSheet("color: #000000; font-size: 9pt;");
+    m_cpuClustersLabel->setTextFormat(Qt::RichText);
+    layout->addWidget(m_cpuClustersLabel);
+    
+    onHistoryWindowChanged(m_historyCombo->currentIndex());
+    
+    // Sensors are read on their own thread so a stalled read can't block the UI
+    m_telemetryThread = new TelemetryThread(this);
+    m_telemetryThread->setInterval(kTelemetryIntervalMs);
+    m_telemetryThread->start();
     
     // Timer for updating graph
     m_graphUpdateTimer = new QTimer(this);
     connect(m_graphUpdateTimer, &QTimer::timeout, this, &GpuManager::updateGpuGraph);
-    m_graphUpdateTimer->start(1000); // Update every second
+    m_graphUpdateTimer->start(kDisplayIntervalMs);
 }
 
 void GpuManager::createDriverActionsGroup()
@@ -542,7 +636,6 @@ void GpuManager::updateDriverStatus()
         
         QString currentDriver = "Unknown";
         QString driverVersion = "Unknown";
-        QString driverLibVersion = "Unknown";
         QString driverDate = "Unknown";
         QString driverCreator = "Unknown";
         QString driverSupports = "";
@@ -580,29 +673,10 @@ void GpuManager::updateDriverStatus()
             driverDate = "2024";
         }
         
-        // Get Mesa/library version if applicable
-        QProcess *mesaProcess = new QProcess(this);
-        mesaProcess->start("glxinfo", QStringList() << "-B");
-        mesaProcess->waitForFinished(2000);
-        QString glInfo = mesaProcess->readAllStandardOutput();
-        if (!glInfo.isEmpty() && glInfo.contains("Mesa")) {
-            QStringList lines = glInfo.split('\n');
-            for (const QString &line : lines) {
-                if (line.contains("OpenGL version")) {
-                    QRegExp rx("Mesa ([0-9.]+)");
-                    if (rx.indexIn(line) != -1) {
-                        driverLibVersion = "Mesa " + rx.cap(1);
-                    }
-                }
-            }
-        }
-        delete mesaProcess;
-        
         // Update all labels
         m_currentDriver = currentDriver;
         m_currentDriverLabel->setText(QString("Current Installed Driver: %1").arg(currentDriver));
         m_driverVersionLabel->setText(QString("Driver Version: %1").arg(driverVersion));
-        m_driverLibVersionLabel->setText(QString("Driver Library Version: %1").arg(driverLibVersion));
         m_driverDateLabel->setText(QString("Date Created: %1").arg(driverDate));
         m_driverCreatorLabel->setText(QString("Created By: %1").arg(driverCreator));
         m_driverSupportsLabel->setText(QString("Driver Supports: %1").arg(driverSupports));
@@ -611,6 +685,26 @@ void GpuManager::updateDriverStatus()
             m_driverLocationLink->setText(QString("<a href='#'>Driver Location: %1</a>").arg(m_driverLocation));
         }
         
+        // Get Mesa/library version if applicable; glxinfo can stall on a
+        // wedged GPU, so it gets a couple of seconds and no more
+        m_driverLibVersionLabel->setText("Driver Library Version: Detecting...");
+        ProcessRunner::run("glxinfo", QStringList() << "-B", this, [this](const ProcessResult &result) {
+            QString driverLibVersion = "Unknown";
+            QString glInfo = result.output();
+            if (!glInfo.isEmpty() && glInfo.contains("Mesa")) {
+                QStringList lines = glInfo.split('\n');
+                for (const QString &line : lines) {
+                    if (line.contains("OpenGL version")) {
+                        QRegExp rx("Mesa ([0-9.]+)");
+                        if (rx.indexIn(line) != -1) {
+                            driverLibVersion = "Mesa " + rx.cap(1);
+                        }
+                    }
+                }
+            }
+            m_driverLibVersionLabel->setText(QString("Driver Library Version: %1").arg(driverLibVersion));
+        }, kGlxinfoTimeoutMs);
+        
         driverProcess->deleteLater();
     });
     driverProcess->start("lsmod", QStringList());
@@ -618,304 +712,111 @@ void GpuManager::updateDriverStatus()
 
 void GpuManager::updateGpuGraph()
 {
-    // Read real GPU data
-    double gpuFreq = readGpuFrequency();
-    double gpuTemp = readGpuTemperature();
-    double gpuUsage = readGpuUsage();
-    
-    // Read real CPU data
-    double cpuFreq = readCpuFrequency();
-    double cpuTemp = readCpuTemperature();
-    double cpuUsage = readCpuUsage();
-    
-    // Update labels - show "N/A" when no real data available
-    m_powerVoltageLabel->setText(gpuFreq > 0 ? QString("GPU Freq: %1 MHz").arg(gpuFreq, 0, 'f', 0) : "GPU Freq: N/A");
-    m_powerWattsLabel->setText(gpuTemp > 0 ? QString("GPU Temp: %1°C").arg(gpuTemp, 0, 'f', 1) : "GPU Temp: N/A");
-    m_systemResourcesLabel->setText(gpuUsage > 0 ? QString("GPU Usage: %1%").arg(gpuUsage, 0, 'f', 0) : "GPU Usage: N/A");
-    m_cpuFreqLabel->setText(cpuFreq > 0 ? QString("CPU Freq: %1 MHz").arg(cpuFreq, 0, 'f', 0) : "CPU Freq: N/A");
-    m_cpuTempLabel->setText(cpuTemp > 0 ? QString("CPU Temp: %1°C").arg(cpuTemp, 0, 'f', 1) : "CPU Temp: N/A");
-    m_cpuUsageLabel->setText(cpuUsage > 0 ? QString("CPU Usage: %1%").arg(cpuUsage, 0, 'f', 0) : "CPU Usage: N/A");
-    
-    // Add to data vectors (keep last 100 samples)
-    m_voltageData.append(gpuFreq / 1000.0);  // Scale for graph
-    m_powerData.append(gpuTemp);
-    m_usageData.append(gpuUsage);
-    m_cpuFreqData.append(cpuFreq / 1000.0);  // Scale for graph
-    m_cpuTempData.append(cpuTemp);
-    m_cpuUsageData.append(cpuUsage);
-    
-    if (m_voltageData.size() > 100) {
-        m_voltageData.removeFirst();
-        m_powerData.removeFirst();
-        m_usageData.removeFirst();
-        m_cpuFreqData.removeFirst();
-        m_cpuTempData.removeFirst();
-        m_cpuUsageData.removeFirst();
+    // Take everything sampled since the last repaint
+    TelemetrySample sample;
+    bool received = false;
+    while (m_telemetryThread->takeSample(sample)) {
+        // Add to history; the oldest sample drops out once it is full
+        const float values[SeriesCount] = {
+            float(sample.gpuFrequency / 1000.0),    // Scale for graph
+            float(sample.gpuTemperature),
+            float(sample.gpuUsage),
+            float(sample.bigCoreFrequency() / 1000.0),  // Scale for graph
+            float(sample.cpuTemperature),
+            float(sample.cpuUsage)
+        };
+        m_gpuGraphWidget->append(values);
+        received = true;
     }
+    if (!received) return;
     
-    // Trigger repaint
-    m_gpuGraphWidget->update();
-}
-
-bool GpuManager::eventFilter(QObject *watched, QEvent *event)
-{
-    if (watched == m_gpuGraphWidget && event->type() == QEvent::Paint) {
-        QPainter painter(m_gpuGraphWidget);
-        painter.setRenderHint(QPainter::Antialiasing);
-        
-        int width = m_gpuGraphWidget->width();
-        int height = m_gpuGraphWidget->height();
+    if (!m_labelUpdateTimer.isValid() || m_labelUpdateTimer.elapsed() >= kLabelIntervalMs) {
+        m_labelUpdateTimer.start();
         
-        // Draw background
-        painter.fillRect(0, 0, width, height, Qt::white);
+        double gpuFreq = sample.gpuFrequency;
+        double gpuTemp = sample.gpuTemperature;
+        double gpuUsage = sample.gpuUsage;
+        double cpuFreq = sample.bigCoreFrequency();
+        double cpuTemp = sample.cpuTemperature;
+        double cpuUsage = sample.cpuUsage;
         
-        // Draw grid
-        painter.setPen(QPen(Qt::lightGray, 1));
-        for (int i = 0; i <= 10; i++) {
-            int y = height * i / 10;
-            painter.drawLine(0, y, width, y);
-        }
+        // Update labels - show "N/A" when no real data available
+        m_powerVoltageLabel->setText(gpuFreq > 0 ? QString("GPU Freq: %1 MHz").arg(gpuFreq, 0, 'f', 0) : "GPU Freq: N/A");
+        m_powerWattsLabel->setText(gpuTemp > 0 ? QString("GPU Temp: %1°C").arg(gpuTemp, 0, 'f', 1) : "GPU Temp: N/A");
+        m_systemResourcesLabel->setText(gpuUsage > 0 ? QString("GPU Usage: %1%").arg(gpuUsage, 0, 'f', 0) : "GPU Usage: N/A");
+        m_cpuFreqLabel->setText(cpuFreq > 0 ? QString("Big CPU Freq: %1 MHz").arg(cpuFreq, 0, 'f', 0) : "Big CPU Freq: N/A");
+        m_cpuTempLabel->setText(cpuTemp > 0 ? QString("CPU Temp: %1°C").arg(cpuTemp, 0, 'f', 1) : "CPU Temp: N/A");
+        m_cpuUsageLabel->setText(cpuUsage > 0 ? QString("CPU Usage: %1%").arg(cpuUsage, 0, 'f', 0) : "CPU Usage: N/A");
         
-        // Draw data if available
-        if (m_voltageData.size() > 1) {
-            double xStep = (double)width / (m_voltageData.size() - 1);
-            
-            // Draw GPU frequency (red)
-            painter.setPen(QPen(Qt::red, 2));
-            for (int i = 1; i < m_voltageData.size(); i++) {
-                double y1 = height - (m_voltageData[i-1] / 2.0) * height; // Scale 0-2GHz
-                double y2 = height - (m_voltageData[i] / 2.0) * height;
-                painter.drawLine((i-1) * xStep, y1, i * xStep, y2);
-            }
-            
-            // Draw GPU temperature (green)
-            painter.setPen(QPen(Qt::green, 2));
-            for (int i = 1; i < m_powerData.size(); i++) {
-                double y1 = height - (m_powerData[i-1] / 100.0) * height; // Scale 0-100°C
-                double y2 = height - (m_powerData[i] / 100.0) * height;
-                painter.drawLine((i-1) * xStep, y1, i * xStep, y2);
-            }
-            
-            // Draw GPU usage (blue)
-            painter.setPen(QPen(Qt::blue, 2));
-            for (int i = 1; i < m_usageData.size(); i++) {
-                double y1 = height - (m_usageData[i-1] / 100.0) * height; // Scale 0-100%
-                double y2 = height - (m_usageData[i] / 100.0) * height;
-                painter.drawLine((i-1) * xStep, y1, i * xStep, y2);
-            }
-            
-            // Draw CPU frequency (magenta)
-            painter.setPen(QPen(Qt::magenta, 2));
-            for (int i = 1; i < m_cpuFreqData.size(); i++) {
-                double y1 = height - (m_cpuFreqData[i-1] / 3.0) * height; // Scale 0-3GHz
-                double y2 = height - (m_cpuFreqData[i] / 3.0) * height;
-                painter.drawLine((i-1) * xStep, y1, i * xStep, y2);
-            }
-            
-            // Draw CPU temperature (orange)
-            painter.setPen(QPen(QColor(255, 165, 0), 2)); // Orange
-            for (int i = 1; i < m_cpuTempData.size(); i++) {
-                double y1 = height - (m_cpuTempData[i-1] / 100.0) * height; // Scale 0-100°C
-                double y2 = height - (m_cpuTempData[i] / 100.0) * height;
-                painter.drawLine((i-1) * xStep, y1, i * xStep, y2);
-            }
-            
-            // Draw CPU usage (dark green)
-            painter.setPen(QPen(QColor(0, 128, 0), 2)); // Dark green
-            for (int i = 1; i < m_cpuUsageData.size(); i++) {
-                double y1 = height - (m_cpuUsageData[i-1] / 100.0) * height; // Scale 0-100%
-                double y2 = height - (m_cpuUsageData[i] / 100.0) * height;
-                painter.drawLine((i-1) * xStep, y1, i * xStep, y2);
-            }
+        QStringList clusters;
+        for (int i = 0; i < sample.clusterCount; ++i) {
+            clusters << clusterText(sample, sample.clusters[i]);
         }
-        
-        return true;
+        m_cpuClustersLabel->setText(clusters.join("<br>"));
+        m_cpuClustersLabel->setVisible(!clusters.isEmpty());
     }
-    return QWidget::eventFilter(watched, event);
+    
+    // Trigger repaint
+    m_gpuGraphWidget->update();
 }
 
-void GpuManager::onOpenDriverLocation()
+void GpuManager::onHistoryWindowChanged(int index)
 {
-    if (!m_driverLocation.isEmpty()) {
-        QDesktopServices::openUrl(QUrl::fromLocalFile(m_driverLocation));
-    }
+    int seconds = m_historyCombo->itemData(index).toInt();
+    m_gpuGraphWidget->setCapacity(seconds * 1000 / kTelemetryIntervalMs);
 }
 
-// Real system monitoring functions
-double GpuManager::readGpuFrequency()
+void GpuManager::onOpenDriverLocation()
 {
-    // Try to read Mali GPU frequency from various possible locations
-    QStringList gpuFreqPaths = {
-        "/sys/class/devfreq/fb000000.gpu/cur_freq",
-        "/sys/devices/platform/fb000000.gpu/devfreq/fb000000.gpu/cur_freq",
-        "/sys/kernel/debug/clk/clk_gpu/clk_rate"
-    };
-    
-    for (const QString &path : gpuFreqPaths) {
-        QFile file(path);
-        if (file.open(QIODevice::ReadOnly)) {
-            QString content = file.readAll().trimmed();
-            bool ok;
-            double freq = content.toDouble(&ok);
-            if (ok && freq > 0) {
-                return freq / 1000000.0; // Convert Hz to MHz
-            }
-        }
+    if (!m_driverLocation.isEmpty()) {
+        QDesktopServices::openUrl(QUrl::fromLocalFile(m_driverLocation));
     }
-    
-    // No fallback - return 0 if unable to read real data
-    return 0.0;
 }
 
-double GpuManager::readGpuTemperature()
+void GpuManager::onOpenRecording()
 {
-    // Try to read GPU temperature from thermal zones
-    QStringList tempPaths = {
-        "/sys/class/thermal/thermal_zone1/temp", // Often GPU thermal zone
-        "/sys/class/thermal/thermal_zone2/temp",
-        "/sys/devices/virtual/thermal/thermal_zone1/temp"
-    };
-    
-    for (const QString &path : tempPaths) {
-        QFile file(path);
-        if (file.open(QIODevice::ReadOnly)) {
-            QString content = file.readAll().trimmed();
-            bool ok;
-            double temp = content.toDouble(&ok);
-            if (ok && temp > 10000) { // Temperature in millidegrees
-                return temp / 1000.0;
-            }
-        }
+    QString path = QFileDialog::getOpenFileName(this, "Open Telemetry Recording", QDir::homePath(),
+                                                "Telemetry recordings (*.tlog);;All files (*)");
+    if (path.isEmpty()) return;
+    
+    QString error;
+    TelemetryLogReader reader;
+    if (!reader.open(path, error)) {
+        QMessageBox::warning(this, "Open Recording", error);
+        return;
     }
     
-    // No fallback - return 0 if unable to read real data
-    return 0.0;
-}
-
-double GpuManager::readGpuUsage()
-{
-    // Try to read GPU utilization
-    QStringList usagePaths = {
-        "/sys/class/devfreq/fb000000.gpu/load",
-        "/sys/devices/platform/fb000000.gpu/devfreq/fb000000.gpu/load",
-        "/proc/mali/utilization"
-    };
-    
-    for (const QString &path : usagePaths) {
-        QFile file(path);
-        if (file.open(QIODevice::ReadOnly)) {
-            QString content = file.readAll().trimmed();
-            bool ok;
-            double usage = content.toDouble(&ok);
-            if (ok && usage >= 0 && usage <= 100) {
-                return usage;
-            }
-        }
+    QVector<qint64> timestamps;
+    QVector<double> values;
+    reader.read(0, std::numeric_limits<qint64>::max(), timestamps, values);
+    if (timestamps.size() < 2) {
+        QMessageBox::warning(this, "Open Recording", QString("%1 holds no samples").arg(path));
+        return;
     }
     
-    // No fallback - return 0 if unable to read real data
-    return 0.0;
-}
-
-double GpuManager::readCpuFrequency()
-{
-    // Read current CPU frequency (average of all cores)
-    QFile file("/proc/cpuinfo");
-    if (file.open(QIODevice::ReadOnly)) {
-        QTextStream stream(&file);
-        QString line;
-        double totalFreq = 0;
-        int coreCount = 0;
-        
-        while (stream.readLineInto(&line)) {
-            if (line.contains("cpu MHz")) {
-                QStringList parts = line.split(':');
-                if (parts.size() == 2) {
-                    bool ok;
-                    double freq = parts[1].trimmed().toDouble(&ok);
-                    if (ok) {
-                        totalFreq += freq;
-                        coreCount++;
-                    }
-                }
-            }
-        }
-        
-        if (coreCount > 0) {
-            return totalFreq / coreCount;
-        }
+    // Series the recording doesn't have stay at zero
+    int channels = reader.channels().size();
+    int sources[SeriesCount];
+    for (int series = 0; series < SeriesCount; ++series) {
+        sources[series] = reader.channelIndex(kSeriesStyles[series].channel);
     }
     
-    // Try to read from scaling frequency
-    QFile scalingFile("/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq");
-    if (scalingFile.open(QIODevice::ReadOnly)) {
-        QString content = scalingFile.readAll().trimmed();
-        bool ok;
-        double freq = content.toDouble(&ok);
-        if (ok) {
-            return freq / 1000.0; // Convert kHz to MHz
+    TelemetryHistory<float> samples(SeriesCount, timestamps.size());
+    float row[SeriesCount];
+    for (int i = 0; i < timestamps.size(); ++i) {
+        for (int series = 0; series < SeriesCount; ++series) {
+            int source = sources[series];
+            row[series] = source >= 0 ? float(values.at(i * channels + source) / kSeriesStyles[series].divisor) : 0.0f;
         }
+        samples.append(row);
     }
     
-    // No fallback - return 0 if unable to read real data
-    return 0.0;
+    m_gpuGraphWidget->showRecording(samples, timestamps);
+    m_liveButton->setEnabled(true);
 }
 
-double GpuManager::readCpuTemperature()
+void GpuManager::onShowLive()
 {
-    // Read CPU temperature from thermal zone 0 (usually CPU)
-    QFile file("/sys/class/thermal/thermal_zone0/temp");
-    if (file.open(QIODevice::ReadOnly)) {
-        QString content = file.readAll().trimmed();
-        bool ok;
-        double temp = content.toDouble(&ok);
-        if (ok && temp > 10000) {
-            return temp / 1000.0; // Convert millidegrees to degrees
-        }
-    }
-    
-    // No fallback - return 0 if unable to read real data
-    return 0.0;
+    m_gpuGraphWidget->showLive();
+    m_liveButton->setEnabled(false);
 }
-
-double GpuManager::readCpuUsage()
-{
-    static qint64 lastIdle = 0;
-    static qint64 lastTotal = 0;
-    
-    QFile file("/proc/stat");
-    if (file.open(QIODevice::ReadOnly)) {
-        QString line = file.readLine();
-        if (line.startsWith("cpu ")) {
-            QStringList values = line.split(QRegularExpression("\\s+"));
-            if (values.size() >= 5) {
-                qint64 user = values[1].toLongLong();
-                qint64 nice = values[2].toLongLong();
-                qint64 system = values[3].toLongLong();
-                qint64 idle = values[4].toLongLong();
-                qint64 iowait = values.size() > 5 ? values[5].toLongLong() : 0;
-                
-                qint64 totalIdle = idle + iowait;
-                qint64 total = user + nice + system + idle + iowait;
-                
-                if (lastTotal > 0) {
-                    qint64 totalDiff = total - lastTotal;
-                    qint64 idleDiff = totalIdle - lastIdle;
-                    
-                    if (totalDiff > 0) {
-                        double usage = 100.0 * (totalDiff - idleDiff) / totalDiff;
-                        lastIdle = totalIdle;
-                        lastTotal = total;
-                        return qMax(0.0, qMin(100.0, usage));
-                    }
-                }
-                
-                lastIdle = totalIdle;
-                lastTotal = total;
-            }
-        }
-    }
-    
-    // No fallback - return 0 if unable to read real data
-    return 0.0;
-}
\ No newline at end of file
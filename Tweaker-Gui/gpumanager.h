@@ -14,9 +14,11 @@
 #include <QCheckBox>
 #include <QVector>
 #include <QTimer>
-#include <QEvent>
+#include <QElapsedTimer>
 
 class SystemManager;
+class TelemetryGraph;
+class TelemetryThread;
 
 class GpuManager : public QWidget
 {
@@ -39,25 +41,28 @@ private slots:
     void updateDriverStatus();
     void updateGpuGraph();
     void onOpenDriverLocation();
+    void onHistoryWindowChanged(int index);
+    void onOpenRecording();
+    void onShowLive();
 
 private:
+    // Graph series, in the order they are added to the graph
+    enum GraphSeries {
+        GpuFrequencySeries,
+        GpuTemperatureSeries,
+        GpuUsageSeries,
+        CpuFrequencySeries,
+        CpuTemperatureSeries,
+        CpuUsageSeries,
+        SeriesCount
+    };
+    
     void setupUI();
     void createGpuGraphGroup();
     void createDriverInfoGroup();
     void createDriverActionsGroup();
     void createDriverConfigGroup();
     
-    // Real system monitoring functions
-    double readGpuFrequency();
-    double readGpuTemperature();
-    double readGpuUsage();
-    double readCpuFrequency();
-    double readCpuTemperature();
-    double readCpuUsage();
-    
-protected:
-    bool eventFilter(QObject *watched, QEvent *event) override;
-    
     // UI Components
     QGroupBox *m_gpuGraphGroup;
     QGroupBox *m_driverInfoGroup;
@@ -65,20 +70,20 @@ protected:
     QGroupBox *m_driverConfigGroup;
     
     // GPU Graph components
-    QWidget *m_gpuGraphWidget;
+    TelemetryGraph *m_gpuGraphWidget;
     QLabel *m_powerVoltageLabel;
     QLabel *m_powerWattsLabel;
     QLabel *m_systemResourcesLabel;
     QLabel *m_cpuFreqLabel;
     QLabel *m_cpuTempLabel;
     QLabel *m_cpuUsageLabel;
+    QLabel *m_cpuClustersLabel;
+    QComboBox *m_historyCombo;
+    QPushButton *m_openRecordingButton;
+    QPushButton *m_liveButton;
     QTimer *m_graphUpdateTimer;
-    QVector<double> m_voltageData;
-    QVector<double> m_powerData;
-    QVector<double> m_usageData;
-    QVector<double> m_cpuFreqData;
-    QVector<double> m_cpuTempData;
-    QVector<double> m_cpuUsageData;
+    QElapsedTimer m_labelUpdateTimer;
+    TelemetryThread *m_telemetryThread;
     
     // Driver info components
     QLabel *m_currentDriverLabel;
@@ -0,0 +1,455 @@
+#include "imagecompressor.h"
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QQueue>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+#include <QtEndian>
+
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+const qint64 kBlockSize = 4 * 1024 * 1024;     // Uncompressed bytes per frame / member
+const int kJobsPerThread = 2;                   // Blocks in flight per worker
+const int kDefaultZstdLevel = 3;
+const int kDefaultGzipLevel = 6;
+
+// zstd seekable format: a skippable frame holding the frame sizes
+const quint32 kSeekTableMagic = 0x184D2A5E;
+const quint32 kSeekableFooterMagic = 0x8F92EAB1;
+const int kSeekTableFooterSize = 9;
+
+// One block of input, compressed on its own
+struct BlockJob {
+    QByteArray input;
+    QByteArray output;
+    qint64 inputSize = 0;
+    bool done = false;
+    bool failed = false;
+    QString error;
+};
+
+bool writeFully(int fd, const char *data, qint64 length)
+{
+    qint64 done = 0;
+    while (done < length) {
+        ssize_t n = ::write(fd, data + done, length - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+qint64 readSysfsValue(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    bool ok = false;
+    qint64 value = file.readAll().trimmed().toLongLong(&ok);
+    return ok ? value : -1;
+}
+
+void pinToCores(const QList<int> &cores)
+{
+    if (cores.isEmpty()) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int core : cores) {
+        CPU_SET(core, &set);
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+#ifdef HAVE_ZSTD
+void compressZstd(ZSTD_CCtx *context, BlockJob *job)
+{
+    size_t bound = ZSTD_compressBound(size_t(job->input.size()));
+    job->output.resize(int(bound));
+    // compress2 records the content size, which frame-parallel decoding needs
+    size_t result = context ? ZSTD_compress2(context, job->output.data(), bound,
+                                             job->input.constData(), size_t(job->input.size()))
+                            : size_t(-1);
+    if (!context || ZSTD_isError(result)) {
+        job->failed = true;
+        job->error = QString("zstd: %1").arg(context ? ZSTD_getErrorName(result) : "failed to initialize encoder");
+        return;
+    }
+    job->output.resize(int(result));
+}
+#endif
+
+#ifdef HAVE_ZLIB
+void compressGzip(z_stream *stream, BlockJob *job)
+{
+    if (!stream || deflateReset(stream) != Z_OK) {
+        job->failed = true;
+        job->error = "gzip: failed to initialize encoder";
+        return;
+    }
+    job->output.resize(int(deflateBound(stream, uLong(job->input.size()))));
+    stream->next_in = reinterpret_cast<Bytef *>(job->input.data());
+    stream->avail_in = uInt(job->input.size());
+    stream->next_out = reinterpret_cast<Bytef *>(job->output.data());
+    stream->avail_out = uInt(job->output.size());
+    if (deflate(stream, Z_FINISH) != Z_STREAM_END) {
+        job->failed = true;
+        job->error = QString("gzip: %1").arg(stream->msg ? stream->msg : "compression failed");
+        return;
+    }
+    job->output.resize(int(stream->total_out));
+}
+#endif
+
+} // namespace
+
+struct ImageCompressor::EncoderState {
+    QByteArray block;           // Input collected for the next job
+    QQueue<BlockJob *> jobs;    // In file order, written by writeCompleted()
+    QQueue<BlockJob *> work;    // Waiting for a worker
+    QVector<QThread *> workers;
+    QMutex mutex;
+    QWaitCondition workAvailable;
+    QWaitCondition jobDone;
+    bool stopping = false;
+
+    // Compressed and uncompressed size of every frame, for the seek table
+    QVector<QPair<quint32, quint32>> frames;
+};
+
+ImageCompressor::ImageCompressor()
+    : m_format(ImageDecompressor::Uncompressed)
+    , m_fd(-1)
+    , m_level(0)
+    , m_threadCount(1)
+    , m_bytesIn(0)
+    , m_bytesOut(0)
+    , m_state(nullptr)
+{
+}
+
+ImageCompressor::~ImageCompressor()
+{
+    close();
+}
+
+bool ImageCompressor::isFormatSupported(ImageDecompressor::Format format)
+{
+    switch (format) {
+#ifdef HAVE_ZLIB
+    case ImageDecompressor::Gzip:
+        return true;
+#endif
+#ifdef HAVE_ZSTD
+    case ImageDecompressor::Zstd:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+QList<int> ImageCompressor::performanceCores()
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return QList<int>();
+    }
+
+    // cpu_capacity is the scheduler's view of big.LITTLE; kernels without
+    // it still show the difference in the maximum clock
+    QList<int> cores;
+    QVector<qint64> capacity;
+    QVector<qint64> maxFrequency;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed)) continue;
+        QString base = QString("/sys/devices/system/cpu/cpu%1/").arg(cpu);
+        cores.append(cpu);
+        capacity.append(readSysfsValue(base + "cpu_capacity"));
+        maxFrequency.append(readSysfsValue(base + "cpufreq/cpuinfo_max_freq"));
+    }
+
+    const QVector<qint64> &rank = capacity.contains(-1) ? maxFrequency : capacity;
+    if (cores.isEmpty() || rank.contains(-1)) {
+        return QList<int>();
+    }
+    qint64 best = *std::max_element(rank.constBegin(), rank.constEnd());
+    qint64 worst = *std::min_element(rank.constBegin(), rank.constEnd());
+    if (best == worst) {
+        return QList<int>();
+    }
+
+    QList<int> result;
+    for (int i = 0; i < cores.size(); ++i) {
+        if (rank[i] == best) result.append(cores[i]);
+    }
+    return result;
+}
+
+bool ImageCompressor::open(const QString &path, ImageDecompressor::Format format, QString &error)
+{
+    close();
+
+    if (!isFormatSupported(format)) {
+        error = QString("This build can't write %1 files").arg(ImageDecompressor::formatName(format));
+        return false;
+    }
+
+    m_format = format;
+    m_path = path;
+    m_bytesIn = 0;
+    m_bytesOut = 0;
+    QByteArray partPath = (path + ".part").toLocal8Bit();
+    m_fd = ::open(partPath.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        error = QString("Cannot create %1: %2").arg(path + ".part", QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+
+    // Compression is the bottleneck, so it gets the big cores; on a
+    // symmetric CPU it gets all of them
+    m_pinnedCores = performanceCores();
+    m_threadCount = m_pinnedCores.isEmpty() ? qMax(1, QThread::idealThreadCount()) : m_pinnedCores.size();
+    m_state = new EncoderState;
+    m_state->block.reserve(int(kBlockSize));
+
+    const int level = (m_level > 0) ? m_level
+                      : (format == ImageDecompressor::Zstd ? kDefaultZstdLevel : kDefaultGzipLevel);
+    EncoderState *state = m_state;
+    const QList<int> cores = m_pinnedCores;
+    for (int i = 0; i < m_threadCount; ++i) {
+        QThread *worker = QThread::create([state, format, level, cores]() {
+            pinToCores(cores);
+#ifdef HAVE_ZSTD
+            ZSTD_CCtx *zstd = nullptr;
+            if (format == ImageDecompressor::Zstd) {
+                zstd = ZSTD_createCCtx();
+                if (zstd) {
+                    ZSTD_CCtx_setParameter(zstd, ZSTD_c_compressionLevel, level);
+                    ZSTD_CCtx_setParameter(zstd, ZSTD_c_checksumFlag, 1);
+                }
+            }
+#endif
+#ifdef HAVE_ZLIB
+            z_stream zlib;
+            bool zlibReady = false;
+            if (format == ImageDecompressor::Gzip) {
+                memset(&zlib, 0, sizeof(zlib));
+                // 15 + 16: gzip wrapper, so every block is a complete member
+                zlibReady = (deflateInit2(&zlib, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+            }
+#endif
+
+            QMutexLocker locker(&state->mutex);
+            while (true) {
+                while (state->work.isEmpty() && !state->stopping) {
+                    state->workAvailable.wait(&state->mutex);
+                }
+                if (state->stopping) break;
+                BlockJob *job = state->work.dequeue();
+                locker.unlock();
+
+#ifdef HAVE_ZSTD
+                if (format == ImageDecompressor::Zstd) compressZstd(zstd, job);
+#endif
+#ifdef HAVE_ZLIB
+                if (format == ImageDecompressor::Gzip) compressGzip(zlibReady ? &zlib : nullptr, job);
+#endif
+
+                locker.relock();
+                job->input.clear();
+                job->done = true;
+                state->jobDone.wakeAll();
+            }
+
+#ifdef HAVE_ZSTD
+            ZSTD_freeCCtx(zstd);
+#endif
+#ifdef HAVE_ZLIB
+            if (zlibReady) deflateEnd(&zlib);
+#endif
+        });
+        m_state->workers.append(worker);
+        worker->start();
+    }
+    return true;
+}
+
+bool ImageCompressor::write(const char *data, qint64 length, QString &error)
+{
+    if (!m_state) {
+        error = "Compressor is not open";
+        return false;
+    }
+
+    while (length > 0) {
+        qint64 chunk = qMin(length, kBlockSize - m_state->block.size());
+        m_state->block.append(data, int(chunk));
+        data += chunk;
+        length -= chunk;
+        m_bytesIn += chunk;
+        if (m_state->block.size() == kBlockSize && !submitBlock(error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ImageCompressor::submitBlock(QString &error)
+{
+    // Bound the memory in flight: wait for the oldest block if needed
+    if (!writeCompleted(m_threadCount * kJobsPerThread - 1, error)) {
+        return false;
+    }
+
+    BlockJob *job = new BlockJob;
+    job->input.swap(m_state->block);
+    job->inputSize = job->input.size();
+    m_state->block.reserve(int(kBlockSize));
+
+    QMutexLocker locker(&m_state->mutex);
+    m_state->jobs.enqueue(job);
+    m_state->work.enqueue(job);
+    m_state->workAvailable.wakeOne();
+    return true;
+}
+
+bool ImageCompressor::writeCompleted(int maxPending, QString &error)
+{
+    EncoderState *state = m_state;
+    while (true) {
+        QMutexLocker locker(&state->mutex);
+        if (state->jobs.isEmpty()) {
+            return true;
+        }
+        BlockJob *job = state->jobs.head();
+        if (!job->done) {
+            if (state->jobs.size() <= maxPending) {
+                return true;
+            }
+            while (!job->done) {
+                state->jobDone.wait(&state->mutex);
+            }
+        }
+        state->jobs.dequeue();
+        locker.unlock();
+
+        if (job->failed) {
+            error = job->error;
+            delete job;
+            return false;
+        }
+        if (!writeFully(m_fd, job->output.constData(), job->output.size())) {
+            error = QString("Write error on %1: %2").arg(m_path, QString::fromLocal8Bit(strerror(errno)));
+            delete job;
+            return false;
+        }
+        m_bytesOut += job->output.size();
+        state->frames.append(qMakePair(quint32(job->output.size()), quint32(job->inputSize)));
+        delete job;
+    }
+}
+
+bool ImageCompressor::writeSeekTable(QString &error)
+{
+    const QVector<QPair<quint32, quint32>> &frames = m_state->frames;
+    QByteArray table(8 + frames.size() * 8 + kSeekTableFooterSize, '\0');
+    uchar *out = reinterpret_cast<uchar *>(table.data());
+    qToLittleEndian<quint32>(kSeekTableMagic, out);
+    qToLittleEndian<quint32>(quint32(table.size() - 8), out + 4);
+    out += 8;
+    for (const QPair<quint32, quint32> &frame : frames) {
+        qToLittleEndian<quint32>(frame.first, out);
+        qToLittleEndian<quint32>(frame.second, out + 4);
+        out += 8;
+    }
+    qToLittleEndian<quint32>(quint32(frames.size()), out);
+    out[4] = 0;     // Descriptor: no per-frame checksums, frames carry their own
+    qToLittleEndian<quint32>(kSeekableFooterMagic, out + 5);
+
+    if (!writeFully(m_fd, table.constData(), table.size())) {
+        error = QString("Write error on %1: %2").arg(m_path, QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+    m_bytesOut += table.size();
+    return true;
+}
+
+bool ImageCompressor::finish(QString &error)
+{
+    if (!m_state) {
+        error = "Compressor is not open";
+        return false;
+    }
+
+    // An empty input still gets one (empty) frame so it decodes cleanly
+    if ((!m_state->block.isEmpty() || m_bytesIn == 0) && !submitBlock(error)) {
+        return false;
+    }
+    if (!writeCompleted(0, error)) {
+        return false;
+    }
+    if (m_format == ImageDecompressor::Zstd && !writeSeekTable(error)) {
+        return false;
+    }
+
+    if (fsync(m_fd) != 0) {
+        error = QString("Failed to flush %1: %2").arg(m_path, QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+    ::close(m_fd);
+    m_fd = -1;
+    if (::rename((m_path + ".part").toLocal8Bit().constData(), m_path.toLocal8Bit().constData()) != 0) {
+        error = QString("Cannot rename %1: %2").arg(m_path + ".part", QString::fromLocal8Bit(strerror(errno)));
+        unlink((m_path + ".part").toLocal8Bit().constData());
+        return false;
+    }
+    close();
+    return true;
+}
+
+void ImageCompressor::close()
+{
+    if (m_state) {
+        {
+            QMutexLocker locker(&m_state->mutex);
+            m_state->stopping = true;
+            m_state->workAvailable.wakeAll();
+        }
+        for (QThread *worker : m_state->workers) {
+            worker->wait();
+            delete worker;
+        }
+        qDeleteAll(m_state->jobs);
+        delete m_state;
+        m_state = nullptr;
+    }
+    if (m_fd >= 0) {
+        // Not finished: don't leave a partial file behind
+        ::close(m_fd);
+        m_fd = -1;
+        unlink((m_path + ".part").toLocal8Bit().constData());
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef IMAGECOMPRESSOR_H
+#define IMAGECOMPRESSOR_H
+
+#include "imagedecompressor.h"
+#include <QList>
+#include <QString>
+
+// Parallel block compressor for snapshots and images. Input is cut into
+// fixed-size blocks that are compressed independently on a worker pool
+// pinned to the fastest cores, then written in order: one zstd frame or
+// gzip member per block. Any zstd or gzip decoder reads the result as a
+// single stream, ImageDecompressor decodes zstd output frame-parallel, and
+// zstd files end in a seek table (zstd seekable format) for random access.
+class ImageCompressor
+{
+public:
+    ImageCompressor();
+    ~ImageCompressor();
+
+    // Gzip and Zstd, depending on the libraries the build has
+    static bool isFormatSupported(ImageDecompressor::Format format);
+    // CPUs with the highest capacity, empty if all cores are alike
+    static QList<int> performanceCores();
+
+    // 0 picks the format's default level
+    void setLevel(int level) { m_level = level; }
+    int level() const { return m_level; }
+
+    // Output goes to path.part and is renamed into place by finish()
+    bool open(const QString &path, ImageDecompressor::Format format, QString &error);
+    bool write(const char *data, qint64 length, QString &error);
+    bool finish(QString &error);
+    // Drop the output without finishing it
+    void close();
+
+    ImageDecompressor::Format format() const { return m_format; }
+    int threadCount() const { return m_threadCount; }
+    QList<int> pinnedCores() const { return m_pinnedCores; }
+
+    qint64 bytesIn() const { return m_bytesIn; }
+    qint64 bytesOut() const { return m_bytesOut; }
+
+private:
+    struct EncoderState;
+
+    bool submitBlock(QString &error);
+    bool writeCompleted(int maxPending, QString &error);
+    bool writeSeekTable(QString &error);
+
+    ImageDecompressor::Format m_format;
+    QString m_path;
+    int m_fd;
+    int m_level;
+    int m_threadCount;
+    QList<int> m_pinnedCores;
+    qint64 m_bytesIn;
+    qint64 m_bytesOut;
+    EncoderState *m_state;
+};
+
+#endif // IMAGECOMPRESSOR_H
@@ -0,0 +1,752 @@
+#include "imagedecompressor.h"
+#include <QByteArray>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+const qint64 kInputChunkSize = 1024 * 1024;
+const qint64 kMaxParallelFrameSize = 64 * 1024 * 1024;  // Larger zstd frames are streamed
+const qint64 kParallelMemoryBudget = 256 * 1024 * 1024; // Compressed + decompressed frames in flight
+const quint64 kMaxThreadingMemory = 1024ull * 1024 * 1024;   // xz block decoder threads
+
+bool readAt(int fd, unsigned char *data, qint64 length, qint64 offset)
+{
+    qint64 done = 0;
+    while (done < length) {
+        ssize_t n = ::pread(fd, data + done, length - done, offset + done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+#ifdef HAVE_LZMA
+QString lzmaError(lzma_ret ret)
+{
+    switch (ret) {
+    case LZMA_MEM_ERROR:
+        return "xz: out of memory";
+    case LZMA_MEMLIMIT_ERROR:
+        return "xz: memory limit reached";
+    case LZMA_FORMAT_ERROR:
+        return "xz: file format not recognized";
+    case LZMA_OPTIONS_ERROR:
+        return "xz: unsupported compression options";
+    case LZMA_DATA_ERROR:
+        return "xz: compressed data is corrupt";
+    case LZMA_BUF_ERROR:
+        return "xz: compressed image is truncated";
+    default:
+        return QString("xz: decoder error %1").arg(int(ret));
+    }
+}
+
+// Sum the uncompressed sizes recorded in the index of every stream, walking
+// backwards from the end of the file. Returns -1 if the file can't be parsed.
+qint64 xzUncompressedSize(int fd, qint64 fileSize)
+{
+    qint64 total = 0;
+    qint64 end = fileSize;
+    while (end > 0) {
+        // Stream padding: multiples of four zero bytes between streams
+        unsigned char footer[LZMA_STREAM_HEADER_SIZE];
+        while (end >= 4) {
+            unsigned char word[4];
+            if (!readAt(fd, word, 4, end - 4)) return -1;
+            if (word[0] || word[1] || word[2] || word[3]) break;
+            end -= 4;
+        }
+        if (end < 2 * LZMA_STREAM_HEADER_SIZE || !readAt(fd, footer, sizeof(footer), end - sizeof(footer))) {
+            return -1;
+        }
+
+        lzma_stream_flags flags;
+        if (lzma_stream_footer_decode(&flags, footer) != LZMA_OK) {
+            return -1;
+        }
+        qint64 indexOffset = end - LZMA_STREAM_HEADER_SIZE - qint64(flags.backward_size);
+        if (indexOffset < LZMA_STREAM_HEADER_SIZE) {
+            return -1;
+        }
+
+        QByteArray indexData(int(flags.backward_size), '\0');
+        if (!readAt(fd, reinterpret_cast<unsigned char *>(indexData.data()), indexData.size(), indexOffset)) {
+            return -1;
+        }
+        lzma_index *index = nullptr;
+        uint64_t memlimit = UINT64_MAX;
+        size_t position = 0;
+        if (lzma_index_buffer_decode(&index, &memlimit, nullptr,
+                                     reinterpret_cast<const uint8_t *>(indexData.constData()),
+                                     &position, indexData.size()) != LZMA_OK) {
+            return -1;
+        }
+        total += qint64(lzma_index_uncompressed_size(index));
+        qint64 streamSize = qint64(lzma_index_stream_size(index));
+        lzma_index_end(index, nullptr);
+
+        if (streamSize > end) return -1;
+        end -= streamSize;
+    }
+    return total;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+// One independently decodable zstd frame
+struct FrameJob {
+    QByteArray input;
+    QByteArray output;
+    qint64 outputSize = 0;
+    qint64 footprint = 0;   // Memory held while in flight
+    qint64 inputEnd = 0;    // Compressed file offset just past this frame
+    bool done = false;
+    bool failed = false;
+    QString error;
+};
+#endif
+
+} // namespace
+
+struct ImageDecompressor::DecoderState {
+    // Sequential input for the streaming decoders
+    QByteArray input;
+    const char *inputNext = nullptr;
+    qint64 inputAvail = 0;
+    bool memberOpen = false;    // Inside a gzip member / zstd frame
+
+#ifdef HAVE_ZLIB
+    z_stream zlib;
+    bool zlibReady = false;
+#endif
+#ifdef HAVE_LZMA
+    lzma_stream lzma = LZMA_STREAM_INIT;
+    bool lzmaReady = false;
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD_DStream *zstd = nullptr;
+
+    // Frame-parallel decoding
+    bool parallelFrames = false;
+    bool streamRest = false;    // Hit a frame the pool can't take, stream from here on
+    QByteArray pending;         // Compressed bytes not yet split into frames
+    qint64 pendingPos = 0;
+    QQueue<FrameJob *> jobs;    // In file order, consumed by read()
+    QQueue<FrameJob *> work;    // Waiting for a worker
+    qint64 inFlightBytes = 0;
+    qint64 outputPos = 0;       // Bytes of jobs.head() already handed out
+    qint64 frameOffset = 0;     // Compressed offset of consumed output
+    QVector<QThread *> workers;
+    QMutex mutex;
+    QWaitCondition workAvailable;
+    QWaitCondition jobDone;
+    bool stopping = false;
+#endif
+};
+
+ImageDecompressor::ImageDecompressor()
+    : m_format(Uncompressed)
+    , m_fd(-1)
+    , m_threadCount(1)
+    , m_compressedSize(0)
+    , m_uncompressedSize(-1)
+    , m_fileOffset(0)
+    , m_inputEof(false)
+    , m_finished(false)
+    , m_state(nullptr)
+{
+}
+
+ImageDecompressor::~ImageDecompressor()
+{
+    close();
+}
+
+ImageDecompressor::Format ImageDecompressor::detectFormat(const QString &path)
+{
+    int fd = ::open(path.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return Uncompressed;
+    }
+    unsigned char magic[6] = {};
+    bool ok = readAt(fd, magic, sizeof(magic), 0);
+    ::close(fd);
+    if (!ok) {
+        return Uncompressed;
+    }
+
+    if (magic[0] == 0x1F && magic[1] == 0x8B) {
+        return Gzip;
+    }
+    if (memcmp(magic, "\xFD" "7zXZ\0", 6) == 0) {
+        return Xz;
+    }
+    if (magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD) {
+        return Zstd;
+    }
+    return Uncompressed;
+}
+
+QString ImageDecompressor::formatName(Format format)
+{
+    switch (format) {
+    case Gzip:
+        return "gzip";
+    case Xz:
+        return "xz";
+    case Zstd:
+        return "zstd";
+    default:
+        return "raw";
+    }
+}
+
+bool ImageDecompressor::isFormatSupported(Format format)
+{
+    switch (format) {
+    case Uncompressed:
+        return true;
+#ifdef HAVE_ZLIB
+    case Gzip:
+        return true;
+#endif
+#ifdef HAVE_LZMA
+    case Xz:
+        return true;
+#endif
+#ifdef HAVE_ZSTD
+    case Zstd:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+bool ImageDecompressor::open(const QString &path, QString &error)
+{
+    close();
+
+    m_format = detectFormat(path);
+    if (m_format == Uncompressed) {
+        error = QString("%1 is not a gzip, xz or zstd file").arg(path);
+        return false;
+    }
+    if (!isFormatSupported(m_format)) {
+        error = QString("This build has no %1 support").arg(formatName(m_format));
+        return false;
+    }
+
+    m_fd = ::open(path.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0) {
+        error = QString("Cannot open %1: %2").arg(path, QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+    posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    struct stat st;
+    m_compressedSize = (fstat(m_fd, &st) == 0) ? st.st_size : 0;
+    m_fileOffset = 0;
+    m_inputEof = false;
+    m_finished = false;
+    m_uncompressedSize = -1;
+    m_threadCount = qMax(1, QThread::idealThreadCount());
+    m_state = new DecoderState;
+
+#ifdef HAVE_ZLIB
+    if (m_format == Gzip) {
+        memset(&m_state->zlib, 0, sizeof(m_state->zlib));
+        // 15 + 16: gzip wrapper only
+        if (inflateInit2(&m_state->zlib, 15 + 16) != Z_OK) {
+            error = "gzip: failed to initialize decoder";
+            close();
+            return false;
+        }
+        m_state->zlibReady = true;
+        m_state->memberOpen = true;
+        m_threadCount = 1;
+    }
+#endif
+
+#ifdef HAVE_LZMA
+    if (m_format == Xz) {
+        m_uncompressedSize = xzUncompressedSize(m_fd, m_compressedSize);
+
+        // Blocks are decoded in parallel when the image was compressed with
+        // xz -T; the memory limit makes liblzma fall back to one thread
+        // rather than exceed it. liblzma before 5.4 can only decode serially.
+#if LZMA_VERSION >= UINT32_C(50040002)
+        quint64 physical = quint64(sysconf(_SC_PHYS_PAGES)) * quint64(sysconf(_SC_PAGESIZE));
+        lzma_mt options;
+        memset(&options, 0, sizeof(options));
+        options.flags = LZMA_CONCATENATED;
+        options.threads = quint32(m_threadCount);
+        options.memlimit_threading = qMin(physical / 4, kMaxThreadingMemory);
+        options.memlimit_stop = UINT64_MAX;
+        lzma_ret ret = lzma_stream_decoder_mt(&m_state->lzma, &options);
+#else
+        m_threadCount = 1;
+        lzma_ret ret = lzma_stream_decoder(&m_state->lzma, UINT64_MAX, LZMA_CONCATENATED);
+#endif
+        if (ret != LZMA_OK) {
+            error = lzmaError(ret);
+            close();
+            return false;
+        }
+        m_state->lzmaReady = true;
+    }
+#endif
+
+#ifdef HAVE_ZSTD
+    if (m_format == Zstd) {
+        m_state->zstd = ZSTD_createDStream();
+        if (!m_state->zstd) {
+            error = "zstd: failed to initialize decoder";
+            close();
+            return false;
+        }
+        ZSTD_initDStream(m_state->zstd);
+
+        // Files made of several frames (pzstd, zstd --adapt with frame
+        // splitting) can be decoded frame by frame on a worker pool
+        if (m_threadCount > 1) {
+            m_state->parallelFrames = true;
+            if (!queueZstdFrames(error)) {
+                close();
+                return false;
+            }
+            if (m_state->jobs.isEmpty() && m_state->streamRest) {
+                // One big frame (plain zstd -T0 output): stream it
+                m_state->parallelFrames = false;
+                m_state->input = m_state->pending;
+                m_state->inputNext = m_state->input.constData();
+                m_state->inputAvail = m_state->input.size();
+                m_state->pending.clear();
+                m_state->pendingPos = 0;
+            }
+        }
+        if (!m_state->parallelFrames) {
+            m_threadCount = 1;
+        }
+        if (m_state->parallelFrames && m_state->workers.isEmpty()) {
+            DecoderState *state = m_state;
+            for (int i = 0; i < m_threadCount; ++i) {
+                QThread *worker = QThread::create([state]() {
+                    ZSTD_DCtx *context = ZSTD_createDCtx();
+                    QMutexLocker locker(&state->mutex);
+                    while (true) {
+                        while (state->work.isEmpty() && !state->stopping) {
+                            state->workAvailable.wait(&state->mutex);
+                        }
+                        if (state->stopping) break;
+                        FrameJob *job = state->work.dequeue();
+                        locker.unlock();
+
+                        job->output.resize(int(job->outputSize));
+                        size_t result = context ? ZSTD_decompressDCtx(context, job->output.data(), job->outputSize,
+                                                                      job->input.constData(), job->input.size())
+                                                : size_t(-1);
+
+                        locker.relock();
+                        if (!context || ZSTD_isError(result) || qint64(result) != job->outputSize) {
+                            job->failed = true;
+                            job->error = QString("zstd: %1").arg(context && ZSTD_isError(result)
+                                                                    ? ZSTD_getErrorName(result)
+                                                                    : "frame size mismatch");
+                        }
+                        job->input.clear();
+                        job->done = true;
+                        state->jobDone.wakeAll();
+                    }
+                    ZSTD_freeDCtx(context);
+                });
+                m_state->workers.append(worker);
+                worker->start();
+            }
+        }
+    }
+#endif
+
+    return true;
+}
+
+void ImageDecompressor::close()
+{
+    if (m_state) {
+#ifdef HAVE_ZLIB
+        if (m_state->zlibReady) inflateEnd(&m_state->zlib);
+#endif
+#ifdef HAVE_LZMA
+        if (m_state->lzmaReady) lzma_end(&m_state->lzma);
+#endif
+#ifdef HAVE_ZSTD
+        {
+            QMutexLocker locker(&m_state->mutex);
+            m_state->stopping = true;
+            m_state->workAvailable.wakeAll();
+        }
+        for (QThread *worker : m_state->workers) {
+            worker->wait();
+            delete worker;
+        }
+        qDeleteAll(m_state->jobs);
+        ZSTD_freeDStream(m_state->zstd);
+#endif
+        delete m_state;
+        m_state = nullptr;
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+qint64 ImageDecompressor::compressedOffset() const
+{
+    if (!m_state) return 0;
+#ifdef HAVE_ZSTD
+    if (m_state->parallelFrames) return m_state->frameOffset;
+#endif
+    return m_fileOffset - m_state->inputAvail;
+}
+
+bool ImageDecompressor::fillInput(QString &error)
+{
+    m_state->input.resize(int(kInputChunkSize));
+    ssize_t n;
+    do {
+        n = ::read(m_fd, m_state->input.data(), kInputChunkSize);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        error = QString("Read error at offset %1: %2").arg(m_fileOffset).arg(QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+    m_state->inputNext = m_state->input.constData();
+    m_state->inputAvail = n;
+    m_fileOffset += n;
+    m_inputEof = (n == 0);
+    return true;
+}
+
+qint64 ImageDecompressor::read(char *data, qint64 length, QString &error)
+{
+    if (!m_state) {
+        error = "Decompressor is not open";
+        return -1;
+    }
+    if (m_finished) return 0;
+
+    switch (m_format) {
+    case Gzip:
+        return readGzip(data, length, error);
+    case Xz:
+        return readXz(data, length, error);
+    case Zstd:
+#ifdef HAVE_ZSTD
+        if (m_state->parallelFrames) return readZstdFrames(data, length, error);
+#endif
+        return readZstd(data, length, error);
+    default:
+        error = "Unsupported format";
+        return -1;
+    }
+}
+
+qint64 ImageDecompressor::readGzip(char *data, qint64 length, QString &error)
+{
+#ifdef HAVE_ZLIB
+    z_stream &stream = m_state->zlib;
+    qint64 produced = 0;
+    while (produced < length) {
+        if (m_state->inputAvail == 0 && !m_inputEof && !fillInput(error)) {
+            return -1;
+        }
+        if (!m_state->memberOpen) {
+            // Concatenated members (cat a.gz b.gz); anything else after the
+            // last member is trailing padding and ignored, like gzip -d does
+            if (m_state->inputAvail == 0 ||
+                (m_state->inputAvail >= 2 && (uchar(m_state->inputNext[0]) != 0x1F || uchar(m_state->inputNext[1]) != 0x8B)) ||
+                (m_state->inputAvail == 1 && m_inputEof)) {
+                m_finished = true;
+                break;
+            }
+            if (m_state->inputAvail == 1) {
+                // Header split across reads: keep the byte and fetch more
+                char first = m_state->inputNext[0];
+                if (!fillInput(error)) return -1;
+                m_state->input.prepend(first);
+                m_state->inputNext = m_state->input.constData();
+                m_state->inputAvail += 1;
+                m_state->input.resize(int(m_state->inputAvail));
+                continue;
+            }
+            inflateReset(&stream);
+            m_state->memberOpen = true;
+        }
+        if (m_state->inputAvail == 0 && m_inputEof) {
+            error = "gzip: compressed image is truncated";
+            return -1;
+        }
+
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(m_state->inputNext));
+        stream.avail_in = uInt(m_state->inputAvail);
+        stream.next_out = reinterpret_cast<Bytef *>(data + produced);
+        stream.avail_out = uInt(qMin<qint64>(length - produced, 1 << 30));
+        uInt outBefore = stream.avail_out;
+
+        int ret = inflate(&stream, Z_NO_FLUSH);
+        m_state->inputNext += m_state->inputAvail - stream.avail_in;
+        m_state->inputAvail = stream.avail_in;
+        produced += outBefore - stream.avail_out;
+
+        if (ret == Z_STREAM_END) {
+            m_state->memberOpen = false;
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            error = QString("gzip: %1").arg(stream.msg ? stream.msg : "compressed data is corrupt");
+            return -1;
+        }
+    }
+    return produced;
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(length);
+    error = "This build has no gzip support";
+    return -1;
+#endif
+}
+
+qint64 ImageDecompressor::readXz(char *data, qint64 length, QString &error)
+{
+#ifdef HAVE_LZMA
+    lzma_stream &stream = m_state->lzma;
+    qint64 produced = 0;
+    while (produced < length) {
+        if (m_state->inputAvail == 0 && !m_inputEof && !fillInput(error)) {
+            return -1;
+        }
+
+        stream.next_in = reinterpret_cast<const uint8_t *>(m_state->inputNext);
+        stream.avail_in = size_t(m_state->inputAvail);
+        stream.next_out = reinterpret_cast<uint8_t *>(data + produced);
+        stream.avail_out = size_t(length - produced);
+
+        lzma_ret ret = lzma_code(&stream, m_inputEof ? LZMA_FINISH : LZMA_RUN);
+        m_state->inputNext += m_state->inputAvail - qint64(stream.avail_in);
+        m_state->inputAvail = qint64(stream.avail_in);
+        produced = length - qint64(stream.avail_out);
+
+        if (ret == LZMA_STREAM_END) {
+            m_finished = true;
+            break;
+        }
+        if (ret != LZMA_OK) {
+            error = lzmaError(ret);
+            return -1;
+        }
+    }
+    return produced;
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(length);
+    error = "This build has no xz support";
+    return -1;
+#endif
+}
+
+qint64 ImageDecompressor::readZstd(char *data, qint64 length, QString &error)
+{
+#ifdef HAVE_ZSTD
+    qint64 produced = 0;
+    while (produced < length) {
+        if (m_state->inputAvail == 0 && !m_inputEof && !fillInput(error)) {
+            return -1;
+        }
+        if (m_state->inputAvail == 0 && m_inputEof && !m_state->memberOpen) {
+            m_finished = true;
+            break;
+        }
+
+        ZSTD_inBuffer in = { m_state->inputNext, size_t(m_state->inputAvail), 0 };
+        ZSTD_outBuffer out = { data + produced, size_t(length - produced), 0 };
+        size_t ret = ZSTD_decompressStream(m_state->zstd, &out, &in);
+        if (ZSTD_isError(ret)) {
+            error = QString("zstd: %1").arg(ZSTD_getErrorName(ret));
+            return -1;
+        }
+        m_state->inputNext += in.pos;
+        m_state->inputAvail -= qint64(in.pos);
+        produced += qint64(out.pos);
+        // 0 means the frame is complete and fully flushed
+        m_state->memberOpen = (ret != 0);
+
+        if (in.pos == 0 && out.pos == 0 && m_state->inputAvail == 0 && m_inputEof) {
+            error = "zstd: compressed image is truncated";
+            return -1;
+        }
+    }
+    return produced;
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(length);
+    error = "This build has no zstd support";
+    return -1;
+#endif
+}
+
+#ifdef HAVE_ZSTD
+bool ImageDecompressor::queueZstdFrames(QString &error)
+{
+    DecoderState *state = m_state;
+    const int maxJobs = m_threadCount * 2;
+
+    while (!state->streamRest) {
+        {
+            QMutexLocker locker(&state->mutex);
+            if (state->jobs.size() >= maxJobs ||
+                (!state->jobs.isEmpty() && state->inFlightBytes >= kParallelMemoryBudget)) {
+                return true;
+            }
+        }
+
+        qint64 avail = state->pending.size() - state->pendingPos;
+        const char *frame = state->pending.constData() + state->pendingPos;
+        size_t frameSize = avail > 0 ? ZSTD_findFrameCompressedSize(frame, size_t(avail)) : 0;
+
+        if (avail == 0 || ZSTD_isError(frameSize)) {
+            if (m_inputEof) {
+                // Clean end, or a damaged tail the stream decoder will report
+                state->streamRest = (avail > 0);
+                return true;
+            }
+            if (avail > kMaxParallelFrameSize) {
+                state->streamRest = true;
+                return true;
+            }
+            // Need more of this frame
+            state->pending.remove(0, int(state->pendingPos));
+            state->pendingPos = 0;
+            int oldSize = state->pending.size();
+            state->pending.resize(oldSize + int(kInputChunkSize));
+            ssize_t n;
+            do {
+                n = ::read(m_fd, state->pending.data() + oldSize, kInputChunkSize);
+            } while (n < 0 && errno == EINTR);
+            if (n < 0) {
+                error = QString("Read error at offset %1: %2").arg(m_fileOffset).arg(QString::fromLocal8Bit(strerror(errno)));
+                return false;
+            }
+            state->pending.resize(oldSize + int(n));
+            m_fileOffset += n;
+            m_inputEof = (n == 0);
+            continue;
+        }
+
+        unsigned long long contentSize = ZSTD_getFrameContentSize(frame, frameSize);
+        if (contentSize == ZSTD_CONTENTSIZE_UNKNOWN || contentSize == ZSTD_CONTENTSIZE_ERROR ||
+            contentSize > quint64(kMaxParallelFrameSize)) {
+            state->streamRest = true;
+            return true;
+        }
+
+        FrameJob *job = new FrameJob;
+        job->input = QByteArray(frame, int(frameSize));
+        job->outputSize = qint64(contentSize);
+        job->inputEnd = m_fileOffset - avail + qint64(frameSize);
+        state->pendingPos += qint64(frameSize);
+
+        QMutexLocker locker(&state->mutex);
+        state->jobs.enqueue(job);
+        state->work.enqueue(job);
+        job->footprint = job->input.size() + job->outputSize;
+        state->inFlightBytes += job->footprint;
+        state->workAvailable.wakeOne();
+    }
+    return true;
+}
+
+qint64 ImageDecompressor::readZstdFrames(char *data, qint64 length, QString &error)
+{
+    DecoderState *state = m_state;
+    qint64 produced = 0;
+    while (produced < length) {
+        if (!queueZstdFrames(error)) {
+            return -1;
+        }
+
+        QMutexLocker locker(&state->mutex);
+        if (state->jobs.isEmpty()) {
+            if (!state->streamRest) {
+                m_finished = true;
+                break;
+            }
+            // Remaining frames don't fit the pool: hand the rest to the
+            // stream decoder, starting at the next frame boundary
+            state->parallelFrames = false;
+            state->input = state->pending.mid(int(state->pendingPos));
+            state->inputNext = state->input.constData();
+            state->inputAvail = state->input.size();
+            state->pending.clear();
+            state->pendingPos = 0;
+            locker.unlock();
+
+            qint64 rest = readZstd(data + produced, length - produced, error);
+            return rest < 0 ? -1 : produced + rest;
+        }
+
+        FrameJob *job = state->jobs.head();
+        while (!job->done) {
+            state->jobDone.wait(&state->mutex);
+        }
+        if (job->failed) {
+            error = job->error;
+            return -1;
+        }
+
+        qint64 chunk = qMin(job->outputSize - state->outputPos, length - produced);
+        memcpy(data + produced, job->output.constData() + state->outputPos, chunk);
+        produced += chunk;
+        state->outputPos += chunk;
+
+        if (state->outputPos == job->outputSize) {
+            state->jobs.dequeue();
+            state->inFlightBytes -= job->footprint;
+            state->frameOffset = job->inputEnd;
+            state->outputPos = 0;
+            delete job;
+        }
+    }
+    return produced;
+}
+#else
+bool ImageDecompressor::queueZstdFrames(QString &error)
+{
+    error = "This build has no zstd support";
+    return false;
+}
+
+qint64 ImageDecompressor::readZstdFrames(char *data, qint64 length, QString &error)
+{
+    return readZstd(data, length, error);
+}
+#endif
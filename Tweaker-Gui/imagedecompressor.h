@@ -0,0 +1,66 @@
+#ifndef IMAGEDECOMPRESSOR_H
+#define IMAGEDECOMPRESSOR_H
+
+#include <QString>
+
+// Streaming decoder for compressed disk images (.gz, .xz, .zst). Reads the
+// compressed file sequentially and hands out decompressed bytes in order.
+// xz uses liblzma's block-parallel decoder, multi-frame zstd files have
+// their frames decoded on a small worker pool; memory use is bounded in
+// both cases. gzip has no independent blocks and is decoded serially.
+class ImageDecompressor
+{
+public:
+    enum Format {
+        Uncompressed,
+        Gzip,
+        Xz,
+        Zstd
+    };
+
+    ImageDecompressor();
+    ~ImageDecompressor();
+
+    // Identify the format by its magic bytes
+    static Format detectFormat(const QString &path);
+    static QString formatName(Format format);
+    static bool isFormatSupported(Format format);
+
+    bool open(const QString &path, QString &error);
+    void close();
+
+    // Fill data with up to length decompressed bytes. Returns fewer bytes
+    // only at the end of the stream, -1 on error.
+    qint64 read(char *data, qint64 length, QString &error);
+
+    Format format() const { return m_format; }
+    int threadCount() const { return m_threadCount; }
+
+    qint64 compressedSize() const { return m_compressedSize; }
+    // Compressed input consumed so far, for progress reporting
+    qint64 compressedOffset() const;
+    // Decompressed size if the container records it, -1 otherwise
+    qint64 uncompressedSize() const { return m_uncompressedSize; }
+
+private:
+    struct DecoderState;
+
+    bool fillInput(QString &error);
+    qint64 readGzip(char *data, qint64 length, QString &error);
+    qint64 readXz(char *data, qint64 length, QString &error);
+    qint64 readZstd(char *data, qint64 length, QString &error);
+    qint64 readZstdFrames(char *data, qint64 length, QString &error);
+    bool queueZstdFrames(QString &error);
+
+    Format m_format;
+    int m_fd;
+    int m_threadCount;
+    qint64 m_compressedSize;
+    qint64 m_uncompressedSize;
+    qint64 m_fileOffset;        // Compressed bytes read from the file
+    bool m_inputEof;
+    bool m_finished;
+    DecoderState *m_state;
+};
+
+#endif // IMAGEDECOMPRESSOR_H
@@ -0,0 +1,1162 @@
+#include "imagewriter.h"
+#include "allocationmap.h"
+#include "blockhash.h"
+#include "imagedecompressor.h"
+#include "partitiontable.h"
+#include "snapshotstore.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QVector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/sysmacros.h>
+#include <linux/fs.h>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const qint64 kDirectIoAlignment = 4096;
+const qint64 kDefaultBlockSize = 8 * 1024 * 1024;
+const int kBufferCount = 2;             // Double buffering
+const int kFanOutBufferCount = 8;       // Slack between fast and slow targets
+const qint64 kProgressIntervalMs = 100;
+const qint64 kZeroScanSize = 64 * 1024;  // Granularity of zero-block detection
+const qint64 kZeroBufferSize = 1024 * 1024;
+const int kMaxReportedMismatches = 16;
+
+struct IoBuffer {
+    char *data = nullptr;
+    qint64 offset = 0;
+    qint64 length = 0;
+    int sequence = -1;      // Block number the buffer currently holds
+    int pending = 0;        // Writers that still have to consume it
+    bool last = false;
+    bool hole = false;      // Unallocated source range, no data was read
+    bool unused = false;    // Hole outside the used-blocks ranges, not part of the copy
+    qint64 sourceOffset = 0; // Compressed input consumed once this buffer was filled
+};
+
+// Hands buffers from the reader thread to the writer threads. Buffers are
+// consumed strictly in order by every writer, and a slot is only refilled
+// once all writers still running have released it, so the slowest target
+// sets the pace once it is a full ring behind.
+class BufferRing
+{
+public:
+    BufferRing(int count, qint64 bufferSize, int consumers)
+        : m_buffers(count)
+        , m_consumers(consumers)
+        , m_aborted(false)
+    {
+        for (IoBuffer &buffer : m_buffers) {
+            void *memory = nullptr;
+            if (posix_memalign(&memory, kDirectIoAlignment, bufferSize) == 0) {
+                buffer.data = static_cast<char *>(memory);
+            }
+        }
+    }
+
+    ~BufferRing()
+    {
+        for (IoBuffer &buffer : m_buffers) {
+            free(buffer.data);
+        }
+    }
+
+    bool isValid() const
+    {
+        for (const IoBuffer &buffer : m_buffers) {
+            if (!buffer.data) return false;
+        }
+        return true;
+    }
+
+    // Reader side: wait for slot to be drained by every writer
+    IoBuffer *acquireEmpty(int sequence)
+    {
+        QMutexLocker locker(&m_mutex);
+        IoBuffer &buffer = m_buffers[sequence % m_buffers.size()];
+        while (buffer.pending > 0 && !m_aborted) {
+            m_emptied.wait(&m_mutex);
+        }
+        return m_aborted ? nullptr : &buffer;
+    }
+
+    void publish(IoBuffer *buffer, int sequence)
+    {
+        QMutexLocker locker(&m_mutex);
+        buffer->sequence = sequence;
+        buffer->pending = m_consumers;
+        m_filled.wakeAll();
+    }
+
+    // Writer side: wait for slot to be filled by the reader
+    IoBuffer *acquireFilled(int sequence)
+    {
+        QMutexLocker locker(&m_mutex);
+        IoBuffer &buffer = m_buffers[sequence % m_buffers.size()];
+        while ((buffer.sequence != sequence || buffer.pending == 0) && !m_aborted) {
+            m_filled.wait(&m_mutex);
+        }
+        return m_aborted ? nullptr : &buffer;
+    }
+
+    void release(IoBuffer *buffer)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (--buffer->pending == 0) {
+            m_emptied.wakeAll();
+        }
+    }
+
+    // A writer gave up before consuming block nextSequence: stop waiting for
+    // it, and stop the reader once nobody is left
+    void detach(int nextSequence)
+    {
+        QMutexLocker locker(&m_mutex);
+        for (IoBuffer &buffer : m_buffers) {
+            if (buffer.sequence >= nextSequence && buffer.pending > 0) {
+                --buffer.pending;
+            }
+        }
+        if (--m_consumers == 0) {
+            m_aborted = true;
+            m_filled.wakeAll();
+        }
+        m_emptied.wakeAll();
+    }
+
+    void abort()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_aborted = true;
+        m_filled.wakeAll();
+        m_emptied.wakeAll();
+    }
+
+private:
+    QVector<IoBuffer> m_buffers;
+    QMutex m_mutex;
+    QWaitCondition m_filled;
+    QWaitCondition m_emptied;
+    int m_consumers;
+    bool m_aborted;
+};
+
+// Open with O_DIRECT, falling back to buffered I/O on filesystems that
+// refuse it (tmpfs, some FUSE mounts)
+int openDirect(const QString &path, int flags, bool *direct)
+{
+    QByteArray nativePath = path.toLocal8Bit();
+    int fd = ::open(nativePath.constData(), flags | O_DIRECT | O_CLOEXEC);
+    if (fd >= 0) {
+        *direct = true;
+        return fd;
+    }
+    if (errno != EINVAL) {
+        return -1;
+    }
+    *direct = false;
+    return ::open(nativePath.constData(), flags | O_CLOEXEC);
+}
+
+// Read until the buffer is full or EOF; returns bytes read or -1
+qint64 readFully(int fd, char *data, qint64 length, qint64 offset)
+{
+    qint64 total = 0;
+    while (total < length) {
+        ssize_t n = ::pread(fd, data + total, length - total, offset + total);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break;
+        total += n;
+    }
+    return total;
+}
+
+bool writeFully(int fd, const char *data, qint64 length, qint64 offset)
+{
+    qint64 total = 0;
+    while (total < length) {
+        ssize_t n = ::pwrite(fd, data + total, length - total, offset + total);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        total += n;
+    }
+    return true;
+}
+
+qint64 alignDown(qint64 value, qint64 alignment)
+{
+    return (value / alignment) * alignment;
+}
+
+qint64 alignUp(qint64 value, qint64 alignment)
+{
+    return ((value + alignment - 1) / alignment) * alignment;
+}
+
+QString systemError(const QString &context)
+{
+    return QString("%1: %2").arg(context, QString::fromLocal8Bit(strerror(errno)));
+}
+
+// Whether the block device behind fd promises that discarded sectors read
+// back as zeros. Few do (and kernels since 4.12 report none), otherwise a
+// discarded range can still hold the old data.
+bool discardZeroesData(int fd)
+{
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISBLK(info.st_mode)) return false;
+
+    // A partition has no queue of its own, its disk's is one level up
+    QString device = QString("/sys/dev/block/%1:%2").arg(major(info.st_rdev)).arg(minor(info.st_rdev));
+    QFile file(device + "/queue/discard_zeroes_data");
+    if (!file.exists()) file.setFileName(device + "/../queue/discard_zeroes_data");
+    return file.open(QIODevice::ReadOnly) && file.readAll().trimmed() == "1";
+}
+
+} // namespace
+
+// Per-device state of a burn, owned by writeImage() and touched only by the
+// target's writer thread (progress fields under m_progressMutex)
+struct ImageWriter::Target {
+    int index = 0;
+    QString device;
+    int fd = -1;
+    bool direct = false;
+    int sectorSize = 512;
+    qint64 size = -1;
+    ZeroBlockPolicy policy = WriteZeroBlocks;   // Discard may fall back to skip per card
+    qint64 zeroRangeStart = 0;
+    qint64 zeroRangeLength = 0;
+    qint64 bytesSkipped = 0;
+    qint64 bytesVerified = 0;
+    bool active = false;        // Still writing, counts towards overall progress
+    bool success = false;
+    QString error;
+
+    // Progress throttling
+    qint64 done = 0;
+    qint64 lastReportBytes = 0;
+    qint64 lastReportTime = 0;
+    double throughput = 0.0;
+};
+
+ImageWriter::ImageWriter(const QString &sourcePath, const QString &targetDevice, QObject *parent)
+    : ImageWriter(sourcePath, QStringList(targetDevice), parent)
+{
+}
+
+ImageWriter::ImageWriter(const QString &sourcePath, const QStringList &targetDevices, QObject *parent)
+    : QThread(parent)
+    , m_sourcePath(sourcePath)
+    , m_targetDevices(targetDevices)
+    , m_blockSize(kDefaultBlockSize)
+    , m_zeroBlockPolicy(WriteZeroBlocks)
+    , m_usedBlocksOnly(false)
+    , m_verifyWrites(false)
+    , m_verifyZeroRanges(false)
+    , m_zeroBuffer(nullptr)
+    , m_lastReportTime(0)
+{
+}
+
+ImageWriter::~ImageWriter()
+{
+    requestInterruption();
+    wait();
+    free(m_zeroBuffer);
+}
+
+void ImageWriter::setBlockSize(qint64 bytes)
+{
+    // Keep blocks a multiple of the zero-scan granularity (and so of the
+    // direct I/O alignment)
+    m_blockSize = qMax(alignDown(bytes, kZeroScanSize), kZeroScanSize);
+}
+
+qint64 ImageWriter::deviceSize(int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return -1;
+    }
+    if (S_ISBLK(st.st_mode)) {
+        quint64 bytes = 0;
+        if (ioctl(fd, BLKGETSIZE64, &bytes) != 0) {
+            return -1;
+        }
+        return static_cast<qint64>(bytes);
+    }
+    return st.st_size;
+}
+
+qint64 ImageWriter::deviceSize(const QString &path)
+{
+    int fd = ::open(path.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    qint64 size = deviceSize(fd);
+    ::close(fd);
+    return size;
+}
+
+bool ImageWriter::isZeroBlock(const char *data, qint64 length)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+    qint64 i = 0;
+
+#if defined(__aarch64__)
+    for (; i + 64 <= length; i += 64) {
+        uint8x16_t acc = vorrq_u8(vorrq_u8(vld1q_u8(bytes + i), vld1q_u8(bytes + i + 16)),
+                                  vorrq_u8(vld1q_u8(bytes + i + 32), vld1q_u8(bytes + i + 48)));
+        if (vmaxvq_u8(acc) != 0) return false;
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 64 <= length; i += 64) {
+        const __m128i *p = reinterpret_cast<const __m128i *>(bytes + i);
+        __m128i acc = _mm_or_si128(_mm_or_si128(_mm_loadu_si128(p), _mm_loadu_si128(p + 1)),
+                                   _mm_or_si128(_mm_loadu_si128(p + 2), _mm_loadu_si128(p + 3)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, zero)) != 0xFFFF) return false;
+    }
+#else
+    for (; i + 8 <= length; i += 8) {
+        quint64 word;
+        memcpy(&word, bytes + i, sizeof(word));
+        if (word != 0) return false;
+    }
+#endif
+
+    for (; i < length; ++i) {
+        if (bytes[i] != 0) return false;
+    }
+    return true;
+}
+
+void ImageWriter::run()
+{
+    m_progressTimer.start();
+    m_lastReportTime = 0;
+
+    QString message;
+    bool success = writeImage(message);
+    emit writeFinished(success, message);
+}
+
+bool ImageWriter::writeImage(QString &message)
+{
+    QString &error = message;
+
+    // Compressed images are decoded on the fly; progress then follows the
+    // compressed input since the decompressed size isn't always known
+    ImageDecompressor decompressor;
+    const bool compressed = (ImageDecompressor::detectFormat(m_sourcePath) != ImageDecompressor::Uncompressed);
+    // A snapshot manifest is restored chunk by chunk from its store
+    const bool fromSnapshot = m_sourcePath.endsWith(".manifest");
+    SnapshotManifest snapshot;
+    bool sourceDirect = false;
+    int sourceFd = -1;
+    if (fromSnapshot) {
+        if (m_usedBlocksOnly) {
+            error = "Used-blocks copies need an uncompressed source";
+            return false;
+        }
+        if (!SnapshotStore::readManifest(m_sourcePath, snapshot, error)) {
+            return false;
+        }
+        if (snapshot.chunkSize > m_blockSize) {
+            error = QString("Snapshot chunks of %1 KiB don't fit in %2 KiB blocks")
+                        .arg(snapshot.chunkSize / 1024).arg(m_blockSize / 1024);
+            return false;
+        }
+    } else if (compressed) {
+        if (m_usedBlocksOnly) {
+            error = "Used-blocks copies need an uncompressed source";
+            return false;
+        }
+        if (!decompressor.open(m_sourcePath, error)) {
+            return false;
+        }
+    } else {
+        sourceFd = openDirect(m_sourcePath, O_RDONLY, &sourceDirect);
+        if (sourceFd < 0) {
+            error = systemError(QString("Cannot open %1").arg(m_sourcePath));
+            return false;
+        }
+        posix_fadvise(sourceFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    qint64 totalBytes = fromSnapshot ? snapshot.size
+                                     : (compressed ? decompressor.uncompressedSize() : deviceSize(sourceFd));
+    if (!compressed && totalBytes < 0) {
+        error = systemError(QString("Cannot determine size of %1").arg(m_sourcePath));
+        ::close(sourceFd);
+        return false;
+    }
+
+    // Used-blocks mode: copy only the ranges the source's filesystems use,
+    // everything else is handed to the writers as a hole
+    AllocationMap allocation;
+    ByteRangeList ranges;
+    qint64 copyEnd = totalBytes;
+    qint64 requiredBytes = totalBytes;
+    qint64 progressTotal = compressed ? decompressor.compressedSize() : totalBytes;
+    if (m_usedBlocksOnly) {
+        emit statusMessage(QString("Reading filesystem allocation of %1...").arg(m_sourcePath));
+        if (!allocation.build(m_sourcePath, error)) {
+            ::close(sourceFd);
+            return false;
+        }
+        for (const QString &line : allocation.summary()) {
+            emit statusMessage(line);
+        }
+        // Direct I/O needs aligned ranges
+        for (const ByteRange &range : allocation.ranges()) {
+            qint64 start = alignDown(range.offset, kDirectIoAlignment);
+            qint64 end = qMin(alignUp(range.end(), kDirectIoAlignment), totalBytes);
+            appendRange(ranges, start, end - start);
+        }
+        copyEnd = ranges.isEmpty() ? 0 : ranges.last().end();
+        requiredBytes = allocation.requiredSize();
+        progressTotal = totalRangeLength(ranges);
+    }
+
+    // Open every target up front; one that can't take the image is reported
+    // and left out while the others go ahead
+    QVector<Target> targets(m_targetDevices.size());
+    int activeTargets = 0;
+    bool allDirect = true;
+    for (int i = 0; i < targets.size(); ++i) {
+        Target &target = targets[i];
+        target.index = i;
+        target.device = m_targetDevices.at(i);
+        target.policy = m_zeroBlockPolicy;
+
+        // O_EXCL on a block device fails with EBUSY while it is mounted
+        target.fd = openDirect(target.device, O_RDWR | O_EXCL, &target.direct);
+        if (target.fd < 0) {
+            target.error = systemError(QString("Cannot open %1").arg(target.device));
+        } else {
+            target.size = deviceSize(target.fd);
+            ioctl(target.fd, BLKSSZGET, &target.sectorSize);
+
+            if (target.size >= 0 && requiredBytes > target.size) {
+                target.error = QString("Image is larger than %1 (%2 > %3 bytes)")
+                                   .arg(target.device).arg(requiredBytes).arg(target.size);
+            } else if (m_usedBlocksOnly && allocation.isGpt() && target.sectorSize != allocation.sectorSize()) {
+                target.error = QString("%1 uses %2 byte sectors, the GPT on %3 needs %4 byte sectors")
+                                   .arg(target.device).arg(target.sectorSize)
+                                   .arg(m_sourcePath).arg(allocation.sectorSize());
+            } else if (target.policy == DiscardZeroBlocks && !m_usedBlocksOnly && !discardZeroesData(target.fd)) {
+                // The image says zeros there, and a discard may leave old data
+                emit statusMessage(QString("%1 doesn't guarantee zeros after a discard, zeroing empty blocks instead")
+                                       .arg(target.device));
+                target.policy = ZeroOutZeroBlocks;
+            }
+        }
+
+        if (!target.error.isEmpty()) {
+            if (target.fd >= 0) ::close(target.fd);
+            target.fd = -1;
+            emit targetFinished(i, false, target.error);
+            continue;
+        }
+        target.active = true;
+        allDirect = allDirect && target.direct;
+        ++activeTargets;
+    }
+
+    if (activeTargets == 0) {
+        error = (targets.size() == 1) ? targets.first().error : QString("No target device could be opened");
+        ::close(sourceFd);
+        return false;
+    }
+
+    // Zeroing falls back to plain writes of this shared buffer, as do the
+    // unaligned tails of discarded ranges
+    if ((m_zeroBlockPolicy == DiscardZeroBlocks || m_zeroBlockPolicy == ZeroOutZeroBlocks) && !m_zeroBuffer) {
+        void *memory = nullptr;
+        if (posix_memalign(&memory, kDirectIoAlignment, kZeroBufferSize) == 0) {
+            memset(memory, 0, kZeroBufferSize);
+            m_zeroBuffer = static_cast<char *>(memory);
+        }
+    }
+
+    // The relocated GPT differs from the source by design
+    const bool verify = m_verifyWrites && !(m_usedBlocksOnly && allocation.isGpt());
+    if (m_verifyWrites && !verify) {
+        emit statusMessage("Verification skipped: the GPT is rewritten for the target size");
+    }
+
+    // The hasher is one more consumer of the ring, so the source is hashed
+    // once while the writers run, however many targets there are
+    BufferRing ring(targets.size() == 1 ? kBufferCount : kFanOutBufferCount, m_blockSize,
+                    activeTargets + (verify ? 1 : 0));
+    if (!ring.isValid()) {
+        error = "Failed to allocate aligned I/O buffers";
+        ::close(sourceFd);
+        for (const Target &target : targets) {
+            if (target.fd >= 0) ::close(target.fd);
+        }
+        return false;
+    }
+
+    // Zeros inside used filesystem blocks must read back as zeros, so a
+    // used-blocks copy writes its ranges verbatim and only skips the rest
+    const bool sparse = (m_zeroBlockPolicy != WriteZeroBlocks) && !m_usedBlocksOnly;
+
+    if (compressed) {
+        emit statusMessage(QString("Decompressing %1 image (%2 thread%3), %4")
+                               .arg(ImageDecompressor::formatName(decompressor.format()))
+                               .arg(decompressor.threadCount())
+                               .arg(decompressor.threadCount() == 1 ? "" : "s")
+                               .arg(totalBytes >= 0 ? QString("%1 bytes uncompressed").arg(totalBytes)
+                                                    : QString("uncompressed size unknown")));
+    }
+    emit statusMessage(QString("Writing %1 in %2 KiB blocks%3%4%5")
+                           .arg(compressed && totalBytes < 0 ? QString("image")
+                                : QString("%1 bytes").arg(compressed ? totalBytes : progressTotal))
+                           .arg(m_blockSize / 1024)
+                           .arg(targets.size() > 1 ? QString(" to %1 devices").arg(activeTargets) : QString())
+                           .arg(allDirect ? " (direct I/O)" : "")
+                           .arg(m_usedBlocksOnly ? ", used blocks only"
+                                                 : (sparse ? ", skipping empty blocks" : "")));
+
+    {
+        QMutexLocker locker(&m_progressMutex);
+        m_targets.clear();
+        for (Target &target : targets) {
+            if (target.active) m_targets.append(&target);
+        }
+    }
+    emit progressChanged(0, progressTotal);
+    for (const Target *target : m_targets) {
+        emit targetProgressChanged(target->index, 0, progressTotal);
+    }
+
+    // Reader thread: keeps the ring filled while the writers drain it.
+    // In sparse mode it walks the source extents with SEEK_DATA/SEEK_HOLE
+    // and hands over unallocated ranges as holes without reading them.
+    QString readError;
+    QThread *reader = QThread::create([&]() {
+        if (fromSnapshot) {
+            // One chunk per buffer; zero chunks are holes unless zeros are written
+            SnapshotStore store(QFileInfo(m_sourcePath).absolutePath());
+            for (int sequence = 0; sequence < snapshot.chunks.size(); ++sequence) {
+                IoBuffer *buffer = ring.acquireEmpty(sequence);
+                if (!buffer) return;
+
+                const SnapshotChunk &chunk = snapshot.chunks.at(sequence);
+                qint64 length = snapshot.chunkLength(sequence);
+                buffer->hole = chunk.isZero() && sparse;
+                buffer->unused = false;
+                if (chunk.isZero() && !sparse) {
+                    memset(buffer->data, 0, length);
+                } else if (!chunk.isZero() && !store.readChunk(chunk, buffer->data, length, readError)) {
+                    ring.abort();
+                    return;
+                }
+                buffer->offset = sequence * snapshot.chunkSize;
+                buffer->length = length;
+                buffer->last = (sequence == snapshot.chunks.size() - 1);
+                ring.publish(buffer, sequence);
+            }
+            return;
+        }
+
+        if (compressed) {
+            qint64 offset = 0;
+            for (int sequence = 0; ; ++sequence) {
+                IoBuffer *buffer = ring.acquireEmpty(sequence);
+                if (!buffer) return;
+
+                qint64 length = decompressor.read(buffer->data, m_blockSize, readError);
+                if (length < 0) {
+                    ring.abort();
+                    return;
+                }
+                buffer->hole = false;
+                buffer->unused = false;
+                buffer->offset = offset;
+                buffer->length = length;
+                buffer->last = (length < m_blockSize);
+                buffer->sourceOffset = decompressor.compressedOffset();
+                offset += length;
+                ring.publish(buffer, sequence);
+                if (buffer->last) return;
+            }
+        }
+
+        bool seekHoles = sparse;
+        qint64 dataEnd = 0;
+        qint64 offset = 0;
+        int rangeIndex = 0;
+        for (int sequence = 0; ; ++sequence) {
+            IoBuffer *buffer = ring.acquireEmpty(sequence);
+            if (!buffer) return;
+
+            qint64 readLength = m_blockSize;
+            buffer->hole = false;
+            buffer->unused = false;
+
+            if (m_usedBlocksOnly) {
+                while (rangeIndex < ranges.size() && ranges[rangeIndex].end() <= offset) {
+                    ++rangeIndex;
+                }
+                qint64 nextData = (rangeIndex < ranges.size()) ? ranges[rangeIndex].offset : copyEnd;
+                if (nextData > offset || offset >= copyEnd) {
+                    buffer->hole = true;
+                    buffer->unused = true;
+                    buffer->offset = offset;
+                    buffer->length = qMax<qint64>(nextData - offset, 0);
+                    buffer->last = (nextData >= copyEnd);
+                    offset = nextData;
+                    ring.publish(buffer, sequence);
+                    if (buffer->last) return;
+                    continue;
+                }
+                readLength = qMin(readLength, ranges[rangeIndex].end() - offset);
+            }
+
+            if (seekHoles && offset >= dataEnd && offset < copyEnd) {
+                off_t dataStart = lseek(sourceFd, offset, SEEK_DATA);
+                if (dataStart < 0 && errno == ENXIO) {
+                    dataStart = copyEnd;        // Only a hole remains
+                }
+                if (dataStart < 0) {
+                    seekHoles = false;          // Not supported here, read everything
+                } else {
+                    dataStart = qMin<qint64>(alignDown(dataStart, kDirectIoAlignment), copyEnd);
+                    if (dataStart > offset) {
+                        buffer->hole = true;
+                        buffer->offset = offset;
+                        buffer->length = dataStart - offset;
+                        buffer->last = (dataStart >= copyEnd);
+                        offset = dataStart;
+                        ring.publish(buffer, sequence);
+                        if (buffer->last) return;
+                        continue;
+                    }
+                    off_t holeStart = lseek(sourceFd, offset, SEEK_HOLE);
+                    dataEnd = (holeStart < 0) ? copyEnd
+                                              : qMin<qint64>(alignUp(holeStart, kDirectIoAlignment), copyEnd);
+                }
+            }
+            if (seekHoles && dataEnd > offset) {
+                // Direct reads need aligned lengths; EOF still stops a rounded-up read
+                readLength = qMin(readLength, alignUp(dataEnd - offset, kDirectIoAlignment));
+            }
+
+            qint64 length = readFully(sourceFd, buffer->data, readLength, offset);
+            if (length < 0) {
+                readError = systemError(QString("Read error at offset %1").arg(offset));
+                ring.abort();
+                return;
+            }
+            buffer->offset = offset;
+            buffer->length = length;
+            buffer->last = (length < readLength) || (offset + length >= copyEnd);
+            offset += length;
+            ring.publish(buffer, sequence);
+            if (buffer->last) return;
+        }
+    });
+
+    // Hasher thread: records a hash per segment of everything the writers
+    // put on the card. Empty blocks they discard or zero out are hashed as
+    // zeros only when asked for; skipped ones are never checked.
+    const bool zeroesVerified = !sparse || (m_verifyZeroRanges && m_zeroBlockPolicy != SkipZeroBlocks);
+    const quint64 zeroHash = (zeroesVerified && m_zeroBuffer) ? BlockHash::xxh64(m_zeroBuffer, kZeroScanSize) : 0;
+    QVector<SegmentHash> segments;
+    bool segmentsComplete = false;
+    QThread *hasher = !verify ? nullptr : QThread::create([&]() {
+        for (int sequence = 0; ; ++sequence) {
+            IoBuffer *buffer = ring.acquireFilled(sequence);
+            if (!buffer) return;
+
+            bool hashHole = buffer->hole && !buffer->unused && zeroesVerified && m_zeroBuffer;
+            for (qint64 position = 0; (!buffer->hole || hashHole) && position < buffer->length; position += kZeroScanSize) {
+                qint64 length = qMin(kZeroScanSize, buffer->length - position);
+                const char *data = hashHole ? m_zeroBuffer : buffer->data + position;
+                if (!zeroesVerified && isZeroBlock(data, length)) continue;
+
+                SegmentHash segment;
+                segment.offset = buffer->offset + position;
+                segment.length = length;
+                segment.hash = (hashHole && length == kZeroScanSize) ? zeroHash : BlockHash::xxh64(data, length);
+                segments.append(segment);
+            }
+
+            bool last = buffer->last;
+            ring.release(buffer);
+            if (last) {
+                segmentsComplete = true;
+                return;
+            }
+        }
+    });
+
+    // Called once per target when its result is final
+    auto finishTarget = [&](Target &target) {
+        int remaining = 0;
+        {
+            QMutexLocker locker(&m_progressMutex);
+            target.active = false;
+            for (const Target *other : m_targets) {
+                if (other->active) ++remaining;
+            }
+        }
+        if (remaining == 0) {
+            // Nobody left to feed: stop the reader and the hasher
+            ring.abort();
+        }
+
+        QString result = target.error;
+        if (target.success) {
+            result = QString("Wrote %1 to %2").arg(m_sourcePath, target.device);
+            if (target.bytesSkipped > 0) {
+                result += QString(" (%1 MiB of empty blocks not written)").arg(target.bytesSkipped / (1024 * 1024));
+            }
+            if (verify) {
+                result += QString(", verified %1 MiB").arg(target.bytesVerified / (1024 * 1024));
+            }
+        }
+        emit targetFinished(target.index, target.success, result);
+        return result;
+    };
+    QVector<QString> results(targets.size());
+
+    // One writer per target, each consuming the ring at its own pace
+    auto writeTarget = [&](Target &target) {
+        qint64 processed = 0;
+        qint64 written = 0;
+        bool success = true;
+        int sequence = 0;
+        for (; ; ++sequence) {
+            if (isInterruptionRequested()) {
+                target.error = "Write cancelled";
+                success = false;
+                break;
+            }
+
+            IoBuffer *buffer = ring.acquireFilled(sequence);
+            if (!buffer) {
+                target.error = readError.isEmpty() ? QString("Write aborted") : readError;
+                success = false;
+                break;
+            }
+
+            if (buffer->hole) {
+                // Holes are always sector aligned; extend the pending zero range
+                if (target.zeroRangeLength == 0) target.zeroRangeStart = buffer->offset;
+                target.zeroRangeLength += buffer->length;
+            } else if (!sparse) {
+                success = writeRange(target, buffer->data, buffer->length, buffer->offset);
+            } else {
+                // Split the block into zero and non-zero runs and only write the latter
+                qint64 position = 0;
+                while (success && position < buffer->length) {
+                    qint64 runStart = position;
+                    bool zero = false;
+                    while (position < buffer->length) {
+                        qint64 segment = qMin(kZeroScanSize, buffer->length - position);
+                        // An unaligned tail can't be discarded, treat it as data
+                        bool segmentZero = (segment % target.sectorSize == 0) &&
+                                           isZeroBlock(buffer->data + position, segment);
+                        if (position == runStart) {
+                            zero = segmentZero;
+                        } else if (segmentZero != zero) {
+                            break;
+                        }
+                        position += segment;
+                    }
+
+                    qint64 runOffset = buffer->offset + runStart;
+                    qint64 runLength = position - runStart;
+                    if (zero) {
+                        if (target.zeroRangeLength == 0) target.zeroRangeStart = runOffset;
+                        target.zeroRangeLength += runLength;
+                    } else {
+                        success = flushZeroRange(target) &&
+                                  writeRange(target, buffer->data + runStart, runLength, runOffset);
+                    }
+                }
+            }
+            if (!success) break;
+
+            if (compressed) {
+                processed = buffer->sourceOffset;
+            } else if (!buffer->unused) {
+                processed += buffer->length;
+            }
+            if (!buffer->unused) written += buffer->length;
+            bool last = buffer->last;
+            ring.release(buffer);
+            reportProgress(target, processed, progressTotal, written, false);
+
+            if (last) break;
+        }
+
+        if (!success) {
+            // Let the reader and the other writers carry on without us
+            ring.detach(sequence);
+        }
+
+        if (success) {
+            success = flushZeroRange(target);
+        }
+
+        if (success && m_usedBlocksOnly && allocation.isGpt() && target.size > 0) {
+            emit statusMessage(QString("Moving backup GPT to the end of %1").arg(target.device));
+            success = PartitionTable::relocateBackupGpt(target.fd, target.size, allocation.sectorSize(),
+                                                        target.error);
+        }
+
+        if (success) {
+            emit statusMessage(QString("Flushing %1...").arg(target.device));
+            if (fsync(target.fd) != 0) {
+                target.error = systemError(QString("Failed to flush %1").arg(target.device));
+                success = false;
+            }
+        }
+
+        ::close(target.fd);
+        target.fd = -1;
+
+        if (success) {
+            reportProgress(target, progressTotal, progressTotal, written, true);
+        }
+
+        target.success = success;
+        if (!success || !verify) {
+            results[target.index] = finishTarget(target);
+        }
+    };
+
+    reader->start();
+    if (hasher) {
+        hasher->start();
+    }
+    QVector<QThread *> writers;
+    for (Target &target : targets) {
+        if (!target.active) continue;
+        Target *current = &target;
+        QThread *writer = QThread::create([&writeTarget, current]() { writeTarget(*current); });
+        writer->start();
+        writers.append(writer);
+    }
+    for (QThread *writer : writers) {
+        writer->wait();
+    }
+    qDeleteAll(writers);
+    writers.clear();
+
+    // Read back every target that was written, in parallel
+    if (hasher) {
+        hasher->wait();
+        delete hasher;
+
+        for (Target &target : targets) {
+            if (!target.active) continue;
+            Target *current = &target;
+            QThread *verifier = QThread::create([&, current]() {
+                if (!segmentsComplete) {
+                    current->error = "Verification aborted: the source was not fully hashed";
+                    current->success = false;
+                } else {
+                    current->success = verifyTarget(*current, segments, sourceFd);
+                }
+                results[current->index] = finishTarget(*current);
+            });
+            verifier->start();
+            writers.append(verifier);
+        }
+        for (QThread *verifier : writers) {
+            verifier->wait();
+        }
+        qDeleteAll(writers);
+    }
+
+    ring.abort();
+    reader->wait();
+    delete reader;
+    ::close(sourceFd);
+
+    {
+        QMutexLocker locker(&m_progressMutex);
+        m_targets.clear();
+    }
+
+    if (targets.size() == 1) {
+        message = results.first().isEmpty() ? targets.first().error : results.first();
+        return targets.first().success;
+    }
+
+    QStringList failed;
+    for (const Target &target : targets) {
+        if (!target.success) failed.append(target.device);
+    }
+    message = QString("Wrote %1 to %2 of %3 devices").arg(m_sourcePath)
+                  .arg(targets.size() - failed.size()).arg(targets.size());
+    if (!failed.isEmpty()) {
+        message += QString(", failed: %1").arg(failed.join(", "));
+    }
+    return failed.isEmpty();
+}
+
+bool ImageWriter::verifyTarget(Target &target, const QVector<SegmentHash> &segments, int sourceFd)
+{
+    qint64 totalBytes = 0;
+    for (const SegmentHash &segment : segments) {
+        totalBytes += segment.length;
+    }
+    emit statusMessage(QString("Verifying %1 MiB on %2...").arg(totalBytes / (1024 * 1024)).arg(target.device));
+
+    // A fresh direct descriptor reads the card, not the page cache
+    bool direct = false;
+    int fd = openDirect(target.device, O_RDONLY, &direct);
+    if (fd < 0) {
+        target.error = systemError(QString("Cannot open %1 for verification").arg(target.device));
+        return false;
+    }
+    if (!direct) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+
+    void *memory = nullptr;
+    void *sourceMemory = nullptr;
+    if (posix_memalign(&memory, kDirectIoAlignment, m_blockSize) != 0 ||
+        posix_memalign(&sourceMemory, kDirectIoAlignment, kZeroScanSize) != 0) {
+        free(memory);
+        ::close(fd);
+        target.error = "Failed to allocate verification buffer";
+        return false;
+    }
+    char *buffer = static_cast<char *>(memory);
+    char *sourceBuffer = static_cast<char *>(sourceMemory);
+
+    {
+        QMutexLocker locker(&m_progressMutex);
+        target.lastReportBytes = 0;
+        target.lastReportTime = m_progressTimer.elapsed();
+        target.throughput = 0.0;
+    }
+
+    int mismatches = 0;
+    qint64 firstMismatch = -1;
+    bool success = true;
+    int index = 0;
+    while (index < segments.size()) {
+        if (isInterruptionRequested()) {
+            target.error = "Verification cancelled";
+            success = false;
+            break;
+        }
+
+        // Read adjacent segments in one go, up to a block
+        qint64 start = segments[index].offset;
+        int endIndex = index;
+        qint64 end = start;
+        while (endIndex < segments.size() && segments[endIndex].offset == end &&
+               end + segments[endIndex].length - start <= m_blockSize) {
+            end += segments[endIndex].length;
+            ++endIndex;
+        }
+
+        // Direct reads need aligned lengths; the device end still stops them
+        qint64 readLength = direct ? alignUp(end - start, kDirectIoAlignment) : end - start;
+        qint64 length = readFully(fd, buffer, readLength, start);
+        if (length < end - start) {
+            target.error = (length < 0) ? systemError(QString("Read error on %1 at offset %2").arg(target.device).arg(start))
+                                        : QString("%1 ends at offset %2").arg(target.device).arg(start + qMax<qint64>(length, 0));
+            success = false;
+            break;
+        }
+
+        for (; index < endIndex; ++index) {
+            const SegmentHash &segment = segments[index];
+            const char *data = buffer + (segment.offset - start);
+            if (BlockHash::xxh64(data, segment.length) == segment.hash) continue;
+
+            // Narrow the mismatch down to a byte when the source can be re-read
+            qint64 offset = segment.offset;
+            if (sourceFd >= 0 && readFully(sourceFd, sourceBuffer, kZeroScanSize, segment.offset) >= segment.length) {
+                for (qint64 i = 0; i < segment.length; ++i) {
+                    if (data[i] != sourceBuffer[i]) {
+                        offset = segment.offset + i;
+                        break;
+                    }
+                }
+            }
+            if (firstMismatch < 0) firstMismatch = offset;
+            if (++mismatches <= kMaxReportedMismatches) {
+                emit statusMessage(QString("Verify mismatch on %1 at offset %2 (block %3-%4)")
+                                       .arg(target.device).arg(offset)
+                                       .arg(segment.offset).arg(segment.offset + segment.length - 1));
+            }
+        }
+
+        target.bytesVerified += end - start;
+        reportProgress(target, target.bytesVerified, totalBytes, target.bytesVerified, false);
+    }
+
+    free(buffer);
+    free(sourceBuffer);
+    ::close(fd);
+
+    if (success && mismatches > 0) {
+        target.error = QString("Verification of %1 failed: %2 block%3, first at offset %4")
+                           .arg(target.device).arg(mismatches).arg(mismatches == 1 ? " differs" : "s differ").arg(firstMismatch);
+        success = false;
+    }
+    if (success) {
+        reportProgress(target, totalBytes, totalBytes, totalBytes, true);
+    }
+    return success;
+}
+
+bool ImageWriter::writeRange(Target &target, const char *data, qint64 length, qint64 offset)
+{
+    qint64 directLength = target.direct ? alignDown(length, target.sectorSize) : length;
+
+    if (directLength > 0 && !writeFully(target.fd, data, directLength, offset)) {
+        target.error = systemError(QString("Write error on %1 at offset %2").arg(target.device).arg(offset));
+        return false;
+    }
+
+    // Unaligned tail: drop O_DIRECT for the final partial sector
+    if (directLength < length) {
+        fcntl(target.fd, F_SETFL, fcntl(target.fd, F_GETFL) & ~O_DIRECT);
+        target.direct = false;
+        if (!writeFully(target.fd, data + directLength, length - directLength, offset + directLength)) {
+            target.error = systemError(QString("Write error on %1 at offset %2")
+                                           .arg(target.device).arg(offset + directLength));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ImageWriter::flushZeroRange(Target &target)
+{
+    if (target.zeroRangeLength == 0) {
+        return true;
+    }
+
+    qint64 start = target.zeroRangeStart;
+    qint64 length = target.zeroRangeLength;
+    target.zeroRangeLength = 0;
+
+    // A trailing hole may end off a sector boundary; the ioctls need whole
+    // sectors and the rest is written as zeros
+    qint64 aligned = alignDown(length, target.sectorSize);
+    quint64 range[2] = { static_cast<quint64>(start), static_cast<quint64>(aligned) };
+
+    if (target.policy == DiscardZeroBlocks) {
+        if (aligned == 0 || ioctl(target.fd, BLKDISCARD, range) == 0) {
+            target.bytesSkipped += aligned;
+            return m_usedBlocksOnly || aligned == length || writeZeroes(target, start + aligned, length - aligned);
+        }
+        if (m_usedBlocksOnly) {
+            // Free space of a clone can hold anything: leave it untouched
+            emit statusMessage(QString("Discard not supported by %1 (%2), skipping free space instead")
+                                   .arg(target.device, QString::fromLocal8Bit(strerror(errno))));
+            target.policy = SkipZeroBlocks;
+        } else {
+            // The image's empty blocks must still read back as zeros
+            emit statusMessage(QString("Discard not supported by %1 (%2), zeroing empty blocks instead")
+                                   .arg(target.device, QString::fromLocal8Bit(strerror(errno))));
+            target.policy = ZeroOutZeroBlocks;
+        }
+    }
+
+    if (target.policy == ZeroOutZeroBlocks) {
+        if (aligned > 0 && ioctl(target.fd, BLKZEROOUT, range) == 0) {
+            target.bytesSkipped += aligned;
+            return aligned == length || writeZeroes(target, start + aligned, length - aligned);
+        }
+        // Not a block device or no write-zeroes support: write them ourselves
+        return writeZeroes(target, start, length);
+    }
+
+    target.bytesSkipped += length;
+    return true;
+}
+
+bool ImageWriter::writeZeroes(Target &target, qint64 start, qint64 length)
+{
+    if (!m_zeroBuffer) {
+        target.error = "Failed to allocate zero buffer";
+        return false;
+    }
+
+    for (qint64 done = 0; done < length; ) {
+        qint64 chunk = qMin(kZeroBufferSize, length - done);
+        if (!writeRange(target, m_zeroBuffer, chunk, start + done)) {
+            return false;
+        }
+        done += chunk;
+    }
+    return true;
+}
+
+void ImageWriter::reportProgress(Target &target, qint64 bytesDone, qint64 totalBytes, qint64 bytesWritten, bool force)
+{
+    QMutexLocker locker(&m_progressMutex);
+    qint64 now = m_progressTimer.elapsed();
+    qint64 interval = now - target.lastReportTime;
+    if (!force && interval < kProgressIntervalMs) {
+        return;
+    }
+
+    if (interval > 0) {
+        // Exponential moving average smooths out per-block jitter
+        double instant = (bytesWritten - target.lastReportBytes) * 1000.0 / interval;
+        target.throughput = (target.throughput > 0.0) ? 0.8 * target.throughput + 0.2 * instant : instant;
+        emit targetThroughputChanged(target.index, target.throughput);
+    }
+
+    target.done = bytesDone;
+    target.lastReportBytes = bytesWritten;
+    target.lastReportTime = now;
+    emit targetProgressChanged(target.index, bytesDone, totalBytes);
+
+    if (!force && now - m_lastReportTime < kProgressIntervalMs) {
+        return;
+    }
+
+    // Overall figures follow the slowest target still writing
+    const Target *slowest = nullptr;
+    for (const Target *other : m_targets) {
+        if (other->active && (!slowest || other->done < slowest->done)) {
+            slowest = other;
+        }
+    }
+    if (!slowest) {
+        return;
+    }
+    m_lastReportTime = now;
+    emit throughputChanged(slowest->throughput);
+    emit progressChanged(slowest->done, totalBytes);
+}
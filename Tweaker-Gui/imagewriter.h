@@ -0,0 +1,118 @@
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QVector>
+
+// Native image burner: copies a source image (file or block device) to one
+// or more target block devices on its own thread, using O_DIRECT aligned
+// buffers. A single reader fills a shared buffer ring and every target gets
+// its own writer thread, so the source is read once however many cards are
+// being flashed, and a slow card only holds the others back once it falls a
+// full ring behind.
+class ImageWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    // What to do with all-zero regions of the source (holes and zero blocks)
+    enum ZeroBlockPolicy {
+        WriteZeroBlocks,    // Plain byte-for-byte copy
+        SkipZeroBlocks,     // Leave the target untouched
+        DiscardZeroBlocks,  // BLKDISCARD the range where the target then reads
+                            // zeros, otherwise as ZeroOutZeroBlocks
+        ZeroOutZeroBlocks   // BLKZEROOUT: target reads back as zeros
+    };
+
+    explicit ImageWriter(const QString &sourcePath, const QString &targetDevice, QObject *parent = nullptr);
+    // Fan-out burn: write the same image to every device in targetDevices
+    ImageWriter(const QString &sourcePath, const QStringList &targetDevices, QObject *parent = nullptr);
+    ~ImageWriter() override;
+
+    void setBlockSize(qint64 bytes);
+    qint64 blockSize() const { return m_blockSize; }
+
+    void setZeroBlockPolicy(ZeroBlockPolicy policy) { m_zeroBlockPolicy = policy; }
+    ZeroBlockPolicy zeroBlockPolicy() const { return m_zeroBlockPolicy; }
+
+    // Only copy the allocated blocks of the source's partitions, then move
+    // the backup GPT to the end of the target (drive cloning)
+    void setUsedBlocksOnly(bool enabled) { m_usedBlocksOnly = enabled; }
+    bool usedBlocksOnly() const { return m_usedBlocksOnly; }
+
+    // Hash the data while it is written, then read back what was written
+    // with direct I/O and compare. Empty blocks that weren't written are
+    // left out, so verifying a sparse image costs far less than writing it.
+    void setVerifyWrites(bool enabled) { m_verifyWrites = enabled; }
+    bool verifyWrites() const { return m_verifyWrites; }
+    // Also read back the empty blocks that were discarded or zeroed and
+    // check they are zeros; on a sparse image that is the whole device
+    void setVerifyZeroRanges(bool enabled) { m_verifyZeroRanges = enabled; }
+    bool verifyZeroRanges() const { return m_verifyZeroRanges; }
+
+    QString sourcePath() const { return m_sourcePath; }
+    QString targetDevice() const { return m_targetDevices.value(0); }
+    QStringList targetDevices() const { return m_targetDevices; }
+
+    // Size in bytes of a regular file or block device, -1 on error
+    static qint64 deviceSize(int fd);
+    static qint64 deviceSize(const QString &path);
+
+    // SIMD all-zero check used to find skippable blocks
+    static bool isZeroBlock(const char *data, qint64 length);
+
+signals:
+    // Overall progress follows the slowest target that is still writing
+    void progressChanged(qint64 bytesWritten, qint64 totalBytes);
+    void throughputChanged(double bytesPerSecond);
+    void statusMessage(const QString &message);
+    void writeFinished(bool success, const QString &message);
+
+    // Per-target state; target is an index into targetDevices()
+    void targetProgressChanged(int target, qint64 bytesWritten, qint64 totalBytes);
+    void targetThroughputChanged(int target, double bytesPerSecond);
+    void targetFinished(int target, bool success, const QString &message);
+
+protected:
+    void run() override;
+
+private:
+    struct Target;
+
+    // Hash of one written segment of the image
+    struct SegmentHash {
+        qint64 offset;
+        qint64 length;
+        quint64 hash;
+    };
+
+    bool writeImage(QString &message);
+    bool writeRange(Target &target, const char *data, qint64 length, qint64 offset);
+    bool flushZeroRange(Target &target);
+    bool writeZeroes(Target &target, qint64 start, qint64 length);
+    bool verifyTarget(Target &target, const QVector<SegmentHash> &segments, int sourceFd);
+    void reportProgress(Target &target, qint64 bytesDone, qint64 totalBytes, qint64 bytesWritten, bool force);
+
+    QString m_sourcePath;
+    QStringList m_targetDevices;
+    qint64 m_blockSize;
+    ZeroBlockPolicy m_zeroBlockPolicy;
+    bool m_usedBlocksOnly;
+    bool m_verifyWrites;
+    bool m_verifyZeroRanges;
+
+    // Shared by all writer threads, read-only once allocated
+    char *m_zeroBuffer;
+
+    // Progress throttling; targets report from their own threads
+    QMutex m_progressMutex;
+    QElapsedTimer m_progressTimer;
+    QVector<Target *> m_targets;
+    qint64 m_lastReportTime;
+};
+
+#endif // IMAGEWRITER_H
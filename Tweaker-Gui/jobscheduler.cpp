@@ -0,0 +1,150 @@
+#include "jobscheduler.h"
+
+namespace {
+
+bool conflicts(const QVector<JobResource> &first, const QVector<JobResource> &second)
+{
+    for (const JobResource &a : first) {
+        for (const JobResource &b : second) {
+            if (a.name == b.name && (a.access == JobResource::Exclusive || b.access == JobResource::Exclusive)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+JobScheduler::JobScheduler(QObject *parent)
+    : QObject(parent)
+    , m_nextId(1)
+    , m_dispatching(false)
+{
+}
+
+int JobScheduler::submit(const QString &description, const QVector<JobResource> &resources,
+                         const std::function<void(int job)> &start, const QList<int> &dependencies)
+{
+    int id = m_nextId++;
+    m_jobs.append(Job{ id, description, resources, dependencies, start, false });
+    emit jobQueued(id, description);
+    dispatch();
+    return id;
+}
+
+void JobScheduler::finish(int job, bool success, const QString &message)
+{
+    int index = indexOf(job);
+    if (index < 0 || !m_jobs.at(index).running) return;
+    drop(index, success, message);
+    dispatch();
+}
+
+void JobScheduler::setProgress(int job, int percent)
+{
+    if (isRunning(job)) {
+        emit jobProgress(job, percent);
+    }
+}
+
+void JobScheduler::cancel(int job)
+{
+    int index = indexOf(job);
+    if (index < 0) return;
+    if (m_jobs.at(index).running) {
+        emit cancelRequested(job);
+        return;
+    }
+    drop(index, false, "Cancelled");
+    dispatch();
+}
+
+bool JobScheduler::isQueued(int job) const
+{
+    int index = indexOf(job);
+    return index >= 0 && !m_jobs.at(index).running;
+}
+
+bool JobScheduler::isRunning(int job) const
+{
+    int index = indexOf(job);
+    return index >= 0 && m_jobs.at(index).running;
+}
+
+bool JobScheduler::hasJob(const QString &description) const
+{
+    for (const Job &job : m_jobs) {
+        if (job.description == description) return true;
+    }
+    return false;
+}
+
+int JobScheduler::indexOf(int job) const
+{
+    for (int i = 0; i < m_jobs.size(); ++i) {
+        if (m_jobs.at(i).id == job) return i;
+    }
+    return -1;
+}
+
+void JobScheduler::dispatch()
+{
+    // start() and the signal handlers may finish or submit jobs, which
+    // comes back in here; the outer call rescans after each change instead
+    if (m_dispatching) return;
+    m_dispatching = true;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 0; i < m_jobs.size() && !changed; ++i) {
+            if (m_jobs.at(i).running) continue;
+
+            // A dependency that is neither pending nor succeeded has failed
+            for (int dependency : m_jobs.at(i).dependencies) {
+                if (indexOf(dependency) < 0 && !m_outcomes.value(dependency, false)) {
+                    drop(i, false, "Cancelled: a job it depends on did not complete");
+                    changed = true;
+                    break;
+                }
+            }
+
+            if (!changed && canStart(i)) {
+                m_jobs[i].running = true;
+                int id = m_jobs.at(i).id;
+                std::function<void(int)> start = m_jobs.at(i).start;
+                emit jobStarted(id);
+                start(id);
+                changed = true;
+            }
+        }
+    }
+
+    m_dispatching = false;
+}
+
+bool JobScheduler::canStart(int index) const
+{
+    const Job &job = m_jobs.at(index);
+    for (int dependency : job.dependencies) {
+        if (!m_outcomes.value(dependency, false)) return false;
+    }
+
+    // Running jobs hold their claims, and queued ones keep their place in
+    // line, so a stream of readers can't starve a writer
+    for (int i = 0; i < m_jobs.size(); ++i) {
+        const Job &other = m_jobs.at(i);
+        if (i != index && (other.running || i < index) && conflicts(job.resources, other.resources)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void JobScheduler::drop(int index, bool success, const QString &message)
+{
+    Job job = m_jobs.takeAt(index);
+    m_outcomes.insert(job.id, success);
+    emit jobFinished(job.id, success, message);
+}
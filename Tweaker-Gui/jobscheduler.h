@@ -0,0 +1,86 @@
+#ifndef JOBSCHEDULER_H
+#define JOBSCHEDULER_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+// Something a job reads or changes. Claims on the same name conflict unless
+// both are Shared, so readers of /boot run side by side while a GRUB update
+// waits for all of them.
+struct JobResource {
+    enum Access { Shared, Exclusive };
+
+    QString name;
+    Access access;
+
+    static JobResource shared(const QString &name) { return JobResource{ name, Shared }; }
+    static JobResource exclusive(const QString &name) { return JobResource{ name, Exclusive }; }
+};
+
+// Runs jobs as soon as their claims allow: jobs that don't conflict run at
+// the same time, ones that do queue in submission order. A job may also wait
+// for others to succeed first; if one of those fails or is cancelled, so is
+// the job. The scheduler only decides when a job starts - the job does its
+// work asynchronously and reports back through finish().
+class JobScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit JobScheduler(QObject *parent = nullptr);
+
+    // start is called with the job's id once it may run, possibly before
+    // submit() returns. dependencies are ids from earlier submit() calls.
+    int submit(const QString &description, const QVector<JobResource> &resources,
+               const std::function<void(int job)> &start,
+               const QList<int> &dependencies = QList<int>());
+    // Ends a running job and starts whatever was waiting on it
+    void finish(int job, bool success, const QString &message);
+    void setProgress(int job, int percent);
+    // A queued job is dropped right away; a running one is asked to stop
+    // through cancelRequested() and still ends with finish()
+    void cancel(int job);
+
+    bool isQueued(int job) const;
+    bool isRunning(int job) const;
+    // A queued or running job with this description
+    bool hasJob(const QString &description) const;
+    bool isIdle() const { return m_jobs.isEmpty(); }
+
+signals:
+    void jobQueued(int job, const QString &description);
+    void jobStarted(int job);
+    void jobProgress(int job, int percent);
+    void jobFinished(int job, bool success, const QString &message);
+    void cancelRequested(int job);
+
+private:
+    struct Job {
+        int id;
+        QString description;
+        QVector<JobResource> resources;
+        QList<int> dependencies;
+        std::function<void(int)> start;
+        bool running;
+    };
+
+    int indexOf(int job) const;
+    // Starts every queued job that can run now
+    void dispatch();
+    // Whether jobs[index] can start: its dependencies have succeeded and
+    // nothing running or queued ahead of it holds a conflicting claim
+    bool canStart(int index) const;
+    void drop(int index, bool success, const QString &message);
+
+    QList<Job> m_jobs;              // Queued and running, in submission order
+    QHash<int, bool> m_outcomes;    // Finished jobs, for their dependents
+    int m_nextId;
+    bool m_dispatching;
+};
+
+#endif // JOBSCHEDULER_H
@@ -1,4 +1,9 @@
 #include "kernelmanager.h"
+#include "jobscheduler.h"
+#include "loadedmodulemonitor.h"
+#include "moduleinfocache.h"
+#include "processrunner.h"
+#include "processsequence.h"
 #include "systemmanager.h"
 #include <QMessageBox>
 #include <QFileDialog>
@@ -17,6 +22,49 @@
 #include <QFileInfo>
 #include <QDateTime>
 
+namespace {
+
+const int kDeviceQueryTimeoutMs = 10000;    // lsblk/findmnt on one device
+const int kModuleWatchIntervalMs = 1000;
+
+// "✅ name" while live, "⏳ name" while loading or unloading, with the
+// rest of its /proc/modules line as the tooltip
+void describeLoadedModule(QListWidgetItem *item, const LoadedModule &module)
+{
+    item->setText((module.state == "Live" ? "✅ " : "⏳ ") + module.name);
+    
+    QString usedBy = module.refcount < 0 ? QString("-") : QString::number(module.refcount);
+    if (!module.users.isEmpty()) {
+        usedBy += QString(" (%1)").arg(module.users.join(", "));
+    }
+    item->setToolTip(QString("Size: %1 KiB\nUsed by: %2\nState: %3")
+                     .arg(module.size / 1024).arg(usedBy, module.state));
+}
+
+const char *const kChrootFilesystems[] = { "/dev", "/proc", "/sys" };
+
+// Bind the live system's /dev, /proc and /sys into root for a chroot
+void addChrootMountSteps(ProcessSequence *sequence, const QString &root)
+{
+    for (const char *filesystem : kChrootFilesystems) {
+        sequence->addStep(QString("Mounting %1").arg(filesystem), "mount",
+                          QStringList() << "--bind" << filesystem << root + filesystem,
+                          ProcessSequence::Optional);
+    }
+}
+
+// Cleanup steps, so they run after a failed or cancelled chroot command too
+void addChrootUnmountSteps(ProcessSequence *sequence, const QString &root)
+{
+    for (int i = 2; i >= 0; --i) {
+        sequence->addStep(QString("Unmounting %1").arg(kChrootFilesystems[i]), "umount",
+                          QStringList() << root + kChrootFilesystems[i],
+                          ProcessSequence::Cleanup | ProcessSequence::Optional);
+    }
+}
+
+} // namespace
+
 KernelManager::KernelManager(SystemManager *systemManager, QWidget *parent)
     : QWidget(parent)
     , m_systemManager(systemManager)
@@ -451,7 +499,7 @@ void KernelManager::createModuleManagementTab()
         "QListWidget { background-color: #F0F0F0; color: #000000; border: 1px solid #000000; }"
         "QListWidget::item:selected { background-color: #00FF00; color: #000000; }"
     );
-    connect(m_loadedModulesList, &QListWidget::itemSelectionChanged,
+    connect(m_loadedModulesList, &QListWidget::currentItemChanged,
             this, &KernelManager::onModuleSelectionChanged);
     loadedLayout->addWidget(m_loadedModulesList);
     
@@ -473,6 +521,7 @@ void KernelManager::createModuleManagementTab()
     m_moduleSearchEdit = new QLineEdit();
     m_moduleSearchEdit->setPlaceholderText("Search modules...");
     m_moduleSearchEdit->setStyleSheet("background-color: #F0F0F0; color: #000000; border: 1px solid #000000;");
+    connect(m_moduleSearchEdit, &QLineEdit::textChanged, this, &KernelManager::showAvailableModules);
     availableLayout->addWidget(m_moduleSearchEdit);
     
     m_availableModulesList = new QListWidget();
@@ -480,6 +529,8 @@ void KernelManager::createModuleManagementTab()
         "QListWidget { background-color: #F0F0F0; color: #000000; border: 1px solid #000000; }"
         "QListWidget::item:selected { background-color: #000000; color: #FFFFFF; }"
     );
+    connect(m_availableModulesList, &QListWidget::currentItemChanged,
+            this, &KernelManager::onModuleSelectionChanged);
     availableLayout->addWidget(m_availableModulesList);
     
     rightLayout->addWidget(m_availableModulesGroup);
@@ -514,6 +565,36 @@ void KernelManager::createModuleManagementTab()
     connect(m_refreshModulesButton, &QPushButton::clicked, this, &KernelManager::onRefreshModules);
     actionsLayout->addWidget(m_refreshModulesButton);
     
+    // The loaded list follows /proc/modules; only what changed is touched,
+    // so the selection and scroll position survive a refresh
+    m_loadedModuleMonitor = new LoadedModuleMonitor(this);
+    connect(m_loadedModuleMonitor, &LoadedModuleMonitor::moduleRemoved, this, [this](int index, const QString &) {
+        delete m_loadedModulesList->takeItem(index);
+    });
+    connect(m_loadedModuleMonitor, &LoadedModuleMonitor::moduleInserted, this, [this](int index, const LoadedModule &module) {
+        QListWidgetItem *item = new QListWidgetItem();
+        describeLoadedModule(item, module);
+        m_loadedModulesList->insertItem(index, item);
+    });
+    connect(m_loadedModuleMonitor, &LoadedModuleMonitor::moduleChanged, this, [this](int index, const LoadedModule &module) {
+        describeLoadedModule(m_loadedModulesList->item(index), module);
+    });
+    connect(m_loadedModuleMonitor, &LoadedModuleMonitor::readFailed, this, [this](const QString &error) {
+        m_statusLabel->setText(error);
+    });
+    // Module loads and unloads show without waiting for a poll; the
+    // refresh is a single read when nothing changed
+    connect(m_systemManager->scheduler(), &JobScheduler::jobFinished,
+            m_loadedModuleMonitor, &LoadedModuleMonitor::refresh);
+    
+    m_watchModulesCheckbox = new QCheckBox("Watch loaded modules (every second)");
+    m_watchModulesCheckbox->setStyleSheet("color: #000000;");
+    connect(m_watchModulesCheckbox, &QCheckBox::toggled, this, [this](bool watch) {
+        if (watch) m_loadedModuleMonitor->start(kModuleWatchIntervalMs);
+        else m_loadedModuleMonitor->stop();
+    });
+    actionsLayout->addWidget(m_watchModulesCheckbox);
+    
     rightLayout->addWidget(m_moduleActionsGroup);
     
     // Module information
@@ -609,41 +690,43 @@ void KernelManager::onRefreshKernels()
 
 void KernelManager::onRefreshModules()
 {
-    m_statusLabel->setText("Scanning loaded modules...");
-    m_loadedModulesList->clear();
-    m_availableModulesList->clear();
+    // Loaded modules: the monitor updates the list with what changed
+    m_loadedModuleMonitor->refresh();
+    m_statusLabel->setText(QString("Found %1 loaded modules").arg(m_loadedModuleMonitor->modules().size()));
+    
+    // Get available modules from depmod's index of the running kernel
+    QString error;
+    if (!m_moduleIndex.load(m_systemManager->getCurrentKernel(), error)) {
+        m_statusLabel->setText(error);
+    }
     
-    // Get loaded modules
-    QProcess *lsmodProcess = new QProcess(this);
-    connect(lsmodProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [this, lsmodProcess](int, QProcess::ExitStatus) {
-        QString output = lsmodProcess->readAllStandardOutput();
-        QStringList lines = output.split('\n');
-        
-        m_loadedModules.clear();
-        for (int i = 1; i < lines.size(); ++i) { // Skip header
-            QString line = lines[i].trimmed();
-            if (!line.isEmpty()) {
-                QString moduleName = line.split(' ').first();
-                m_loadedModules.append(moduleName);
-                m_loadedModulesList->addItem("✅ " + moduleName);
-            }
+    // Details of every module are read in the background, so selecting one
+    // shows them without waiting; an unchanged index keeps what was read
+    ModuleInfoCache *moduleInfo = m_systemManager->moduleInfoCache();
+    moduleInfo->setIndex(m_moduleIndex);
+    moduleInfo->precompute();
+    
+    m_availableModules.clear();
+    for (const KernelModule &module : m_moduleIndex.modules()) {
+        if (!module.builtin) {
+            m_availableModules.append(module.name);
         }
-        
-        lsmodProcess->deleteLater();
-        m_statusLabel->setText(QString("Found %1 loaded modules").arg(m_loadedModules.size()));
-    });
-    lsmodProcess->start("lsmod", QStringList());
-    
-    // Get available modules (this is simplified - real implementation would scan /lib/modules)
-    QDir modulesDir(QString("/lib/modules/%1").arg(m_currentKernel));
-    if (modulesDir.exists()) {
-        // Simplified: just show some common module directories
-        QStringList dirs = modulesDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-        for (const QString &dir : dirs) {
-            m_availableModulesList->addItem("📦 " + dir);
+    }
+    showAvailableModules();
+}
+
+void KernelManager::showAvailableModules()
+{
+    // Built-in modules can't be loaded, so they aren't offered
+    QStringList items;
+    for (const KernelModule *module : m_moduleIndex.search(m_moduleSearchEdit->text().trimmed())) {
+        if (!module->builtin) {
+            items.append("📦 " + module->name);
         }
     }
+    
+    m_availableModulesList->clear();
+    m_availableModulesList->addItems(items);
 }
 
 void KernelManager::onKernelSelectionChanged()
@@ -805,13 +888,6 @@ void KernelManager::onInstallKernelToDevice()
     // Scan for block devices
     m_statusLabel->setText("Scanning for block devices...");
     
-    QProcess *lsblkProcess = new QProcess(this);
-    lsblkProcess->start("lsblk", QStringList() << "-J" << "-o" << "NAME,SIZE,TYPE,MOUNTPOINT,MODEL");
-    lsblkProcess->waitForFinished();
-    
-    QString lsblkOutput = lsblkProcess->readAllStandardOutput();
-    
-    // Parse lsblk output (simplified for now - in real implementation would use JSON parser)
     QDir devDir("/dev");
     QStringList blockDevices = devDir.entryList(QStringList() << "sd*" << "nvme*" << "mmcblk*", QDir::System);
     
@@ -825,37 +901,33 @@ void KernelManager::onInstallKernelToDevice()
         }
     }
     
-    // Add devices to list with details
+    // Add devices to list; details fill in as lsblk and findmnt answer, so
+    // a slow or sleeping disk doesn't hold up the dialog
     for (const QString &device : mainDevices) {
         QString devicePath = "/dev/" + device;
         
-        // Get device info
-        QProcess *deviceInfoProcess = new QProcess(this);
-        deviceInfoProcess->start("lsblk", QStringList() << "-n" << "-o" << "SIZE,MODEL" << devicePath);
-        deviceInfoProcess->waitForFinished();
-        QString deviceInfo = deviceInfoProcess->readAllStandardOutput().trimmed();
-        
-        QString listEntry = QString("💾 %1 - %2").arg(devicePath).arg(deviceInfo);
-        
-        // Check if device is mounted (safety check)
-        QProcess *mountProcess = new QProcess(this);
-        mountProcess->start("findmnt", QStringList() << "-n" << "-o" << "TARGET" << devicePath);
-        mountProcess->waitForFinished();
-        QString mountPoint = mountProcess->readAllStandardOutput().trimmed();
-        
-        if (!mountPoint.isEmpty()) {
-            listEntry += QString(" [MOUNTED at %1]").arg(mountPoint);
-        }
-        
-        QListWidgetItem *deviceItem = new QListWidgetItem(listEntry);
+        QListWidgetItem *deviceItem = new QListWidgetItem(QString("💾 %1").arg(devicePath));
         deviceItem->setData(Qt::UserRole, devicePath);
-        
-        // Mark mounted devices with different color
-        if (!mountPoint.isEmpty()) {
-            deviceItem->setForeground(QBrush(QColor(255, 0, 0)));
-        }
-        
         deviceList->addItem(deviceItem);
+        
+        ProcessRunner::run("lsblk", QStringList() << "-n" << "-o" << "SIZE,MODEL" << devicePath, deviceList,
+                           [deviceList, deviceItem, devicePath](const ProcessResult &info) {
+            QString deviceInfo = info.output().trimmed();
+            if (!deviceInfo.isEmpty()) {
+                deviceItem->setText(QString("💾 %1 - %2").arg(devicePath).arg(deviceInfo));
+            }
+            
+            // Check if device is mounted (safety check)
+            ProcessRunner::run("findmnt", QStringList() << "-n" << "-o" << "TARGET" << devicePath, deviceList,
+                               [deviceItem](const ProcessResult &mount) {
+                QString mountPoint = mount.output().trimmed();
+                if (!mountPoint.isEmpty()) {
+                    // Mark mounted devices with different color
+                    deviceItem->setText(deviceItem->text() + QString(" [MOUNTED at %1]").arg(mountPoint));
+                    deviceItem->setForeground(QBrush(QColor(255, 0, 0)));
+                }
+            }, kDeviceQueryTimeoutMs);
+        }, kDeviceQueryTimeoutMs);
     }
     
     deviceLayout->addWidget(deviceList);
@@ -970,12 +1042,14 @@ void KernelManager::onInstallKernelToDevice()
                 QMessageBox::Yes | QMessageBox::No);
                 
             if (confirm == QMessageBox::Yes) {
-                // Create progress dialog
-                QProgressDialog progress("Installing kernel to device...", "Cancel", 0, 100, this);
-                progress.setWindowModality(Qt::WindowModal);
-                progress.setWindowTitle("Kernel Installation Progress");
-                progress.setAutoClose(true);
-                progress.setValue(0);
+                // Create progress dialog; it outlives this function and is
+                // deleted once the installation finishes
+                QProgressDialog *progress = new QProgressDialog("Installing kernel to device...", "Cancel", 0, 100, this);
+                progress->setWindowModality(Qt::WindowModal);
+                progress->setWindowTitle("Kernel Installation Progress");
+                progress->setAutoClose(true);
+                progress->setMinimumDuration(0);
+                progress->setValue(0);
                 
                 // Perform the installation
                 QString customMountPoint = customMountPointEdit->text().trimmed();
@@ -985,7 +1059,8 @@ void KernelManager::onInstallKernelToDevice()
                                         copyModulesCheckbox->isChecked(),
                                         customMountPoint,
                                         isInstalledKernel,
-                                        &progress);
+                                        progress);
+                return;
             }
         }
     }
@@ -1003,228 +1078,123 @@ void KernelManager::performKernelInstallation(const QString &kernelVersion,
                                              QProgressDialog *progress)
 {
     QString mountPoint = customMountPoint.isEmpty() ? "/mnt/kernel-install-target" : customMountPoint;
-    bool success = true;
-    QString errorMessage;
     bool shouldUnmount = mountRoot && customMountPoint.isEmpty();
     
+    QString sourceDir = "/boot";
+    if (!isInstalledKernel) {
+        // Copy from tweaker directory
+        sourceDir = m_kernelDirectoryEdit->text().trimmed();
+        if (sourceDir.isEmpty()) {
+            sourceDir = m_kernelDirectory;
+        }
+    }
+    
     // Step 1: Create mount point (only if not using custom mount point)
     progress->setLabelText("Preparing mount point...");
-    progress->setValue(10);
     if (customMountPoint.isEmpty()) {
-        QProcess::execute("mkdir", QStringList() << "-p" << mountPoint);
+        QDir().mkpath(mountPoint);
     }
     
-    if (mountRoot) {
-        // Step 2: Find and mount root partition
-        progress->setLabelText("Finding root partition...");
-        progress->setValue(20);
-        
-        // Try to find root partition (simplified - real implementation would be more sophisticated)
-        QString rootPartition;
-        QProcess *partitionsProcess = new QProcess(this);
-        partitionsProcess->start("lsblk", QStringList() << "-n" << "-o" << "NAME,FSTYPE" << devicePath);
-        partitionsProcess->waitForFinished();
-        
-        QStringList partitions = QString(partitionsProcess->readAllStandardOutput()).split('\n');
-        for (const QString &partition : partitions) {
-            if (partition.contains("ext4") || partition.contains("btrfs")) {
-                rootPartition = devicePath + partition.split(' ').first().trimmed().mid(2);
-                break;
-            }
-        }
-        
-        if (rootPartition.isEmpty()) {
-            // Try first partition as fallback
-            rootPartition = devicePath + "1";
-        }
-        
-        // Mount the partition
-        progress->setLabelText(QString("Mounting %1...").arg(rootPartition));
-        progress->setValue(30);
-        
-        QProcess *mountProcess = new QProcess(this);
-        mountProcess->start("mount", QStringList() << rootPartition << mountPoint);
-        mountProcess->waitForFinished();
-        
-        if (mountProcess->exitCode() != 0) {
-            errorMessage = "Failed to mount root partition: " + mountProcess->readAllStandardError();
-            success = false;
-        }
-    }
+    m_statusLabel->setText(QString("Installing kernel %1 to %2...").arg(kernelVersion).arg(devicePath));
     
-    if (success) {
-        // Step 3: Copy kernel files
-        progress->setLabelText("Copying kernel files...");
-        progress->setValue(40);
+    // rootPartition is empty when the target is already mounted
+    auto install = [=](const QString &rootPartition) {
+        ProcessSequence *sequence = new ProcessSequence(this);
         
-        QString kernelSource;
-        if (isInstalledKernel) {
-            // Copy from live system locations
-            kernelSource = QString("/boot/vmlinuz-%1").arg(kernelVersion);
-        } else {
-            // Copy from tweaker directory
-            QString kernelDir = m_kernelDirectoryEdit->text().trimmed();
-            if (kernelDir.isEmpty()) {
-                kernelDir = m_kernelDirectory;
-            }
-            kernelSource = QString("%1/vmlinuz-%2").arg(kernelDir).arg(kernelVersion);
+        if (!rootPartition.isEmpty()) {
+            // Step 2: Mount root partition
+            sequence->addStep(QString("Mounting %1").arg(rootPartition), "mount",
+                              QStringList() << rootPartition << mountPoint);
         }
-        QString kernelDest = QString("%1/boot/vmlinuz-%2").arg(mountPoint).arg(kernelVersion);
-        
-        // Ensure /boot exists on target
-        QProcess::execute("mkdir", QStringList() << "-p" << mountPoint + "/boot");
         
-        // Copy kernel file using rsync (handles bind mounts and same-file scenarios)
-        QProcess *copyKernelProcess = new QProcess(this);
-        copyKernelProcess->start("rsync", QStringList() << "-av" << "--update" << kernelSource << kernelDest);
-        copyKernelProcess->waitForFinished();
-        
-        if (copyKernelProcess->exitCode() != 0) {
-            errorMessage = "Failed to copy kernel: " + QString(copyKernelProcess->readAllStandardError());
-            success = false;
+        // Step 3: Copy kernel files using rsync (handles bind mounts and same-file scenarios)
+        QString bootDir = mountPoint + "/boot";
+        sequence->addStep("Preparing /boot", "mkdir", QStringList() << "-p" << bootDir, ProcessSequence::Optional);
+        sequence->addStep("Copying kernel", "rsync",
+                          QStringList() << "-av" << "--update"
+                                        << QString("%1/vmlinuz-%2").arg(sourceDir).arg(kernelVersion)
+                                        << QString("%1/vmlinuz-%2").arg(bootDir).arg(kernelVersion));
+        sequence->addStep("Copying initramfs", "rsync",
+                          QStringList() << "-av" << "--update"
+                                        << QString("%1/initrd.img-%2").arg(sourceDir).arg(kernelVersion)
+                                        << QString("%1/initrd.img-%2").arg(bootDir).arg(kernelVersion),
+                          ProcessSequence::Optional);
+        // Generate initramfs if copy failed
+        sequence->addStep("Generating initramfs", "chroot",
+                          QStringList() << mountPoint << "update-initramfs" << "-c" << "-k" << kernelVersion,
+                          ProcessSequence::Fallback | ProcessSequence::Optional);
+        sequence->addStep("Copying kernel config", "rsync",
+                          QStringList() << "-av" << "--update"
+                                        << QString("%1/config-%2").arg(sourceDir).arg(kernelVersion)
+                                        << QString("%1/config-%2").arg(bootDir).arg(kernelVersion),
+                          ProcessSequence::Optional);
+        sequence->addStep("Copying System.map", "rsync",
+                          QStringList() << "-av" << "--update"
+                                        << QString("%1/System.map-%2").arg(sourceDir).arg(kernelVersion)
+                                        << QString("%1/System.map-%2").arg(bootDir).arg(kernelVersion),
+                          ProcessSequence::Optional);
+        
+        if (copyModules) {
+            // Step 4: Copy kernel modules (rsync handles bind mounts and overwrites)
+            sequence->addStep("Preparing /lib/modules", "mkdir",
+                              QStringList() << "-p" << QString("%1/lib/modules/").arg(mountPoint),
+                              ProcessSequence::Optional);
+            sequence->addStep("Copying kernel modules", "rsync",
+                              QStringList() << "-av" << "--update" << "--delete"
+                                            << QString("/lib/modules/%1/").arg(kernelVersion)
+                                            << QString("%1/lib/modules/%2/").arg(mountPoint).arg(kernelVersion));
         }
         
-        // Copy initramfs
-        if (success) {
-            progress->setLabelText("Copying initramfs...");
-            progress->setValue(50);
-            
-            QString initramfsSource;
-            if (isInstalledKernel) {
-                initramfsSource = QString("/boot/initrd.img-%1").arg(kernelVersion);
-            } else {
-                QString kernelDir = m_kernelDirectoryEdit->text().trimmed();
-                if (kernelDir.isEmpty()) {
-                    kernelDir = m_kernelDirectory;
-                }
-                initramfsSource = QString("%1/initrd.img-%2").arg(kernelDir).arg(kernelVersion);
-            }
-            QString initramfsDest = QString("%1/boot/initrd.img-%2").arg(mountPoint).arg(kernelVersion);
-            
-            // Copy initramfs using rsync
-            QProcess *copyInitramfsProcess = new QProcess(this);
-            copyInitramfsProcess->start("rsync", QStringList() << "-av" << "--update" << initramfsSource << initramfsDest);
-            copyInitramfsProcess->waitForFinished();
-            
-            if (copyInitramfsProcess->exitCode() != 0) {
-                // Try to generate initramfs if copy failed
-                progress->setLabelText("Generating initramfs...");
-                QProcess *mkinitramfsProcess = new QProcess(this);
-                mkinitramfsProcess->start("chroot", QStringList() << mountPoint << "update-initramfs" << "-c" << "-k" << kernelVersion);
-                mkinitramfsProcess->waitForFinished();
-            }
+        if (updateGrub) {
+            // Step 5: Update GRUB configuration, with grub-mkconfig as fallback
+            addChrootMountSteps(sequence, mountPoint);
+            sequence->addStep("Updating GRUB configuration", "chroot",
+                              QStringList() << mountPoint << "update-grub",
+                              ProcessSequence::Optional);
+            sequence->addStep("Running grub-mkconfig", "chroot",
+                              QStringList() << mountPoint << "grub-mkconfig" << "-o" << "/boot/grub/grub.cfg",
+                              ProcessSequence::Fallback | ProcessSequence::Optional);
+            addChrootUnmountSteps(sequence, mountPoint);
         }
         
-        // Copy kernel config
-        if (success) {
-            QString configSource;
-            if (isInstalledKernel) {
-                configSource = QString("/boot/config-%1").arg(kernelVersion);
-            } else {
-                QString kernelDir = m_kernelDirectoryEdit->text().trimmed();
-                if (kernelDir.isEmpty()) {
-                    kernelDir = m_kernelDirectory;
-                }
-                configSource = QString("%1/config-%2").arg(kernelDir).arg(kernelVersion);
-            }
-            QString configDest = QString("%1/boot/config-%2").arg(mountPoint).arg(kernelVersion);
-            
-            // Copy config using rsync
-            QProcess::execute("rsync", QStringList() << "-av" << "--update" << configSource << configDest);
+        // Step 6: Cleanup
+        if (shouldUnmount) {
+            sequence->addStep(QString("Unmounting %1").arg(mountPoint), "umount", QStringList() << mountPoint,
+                              ProcessSequence::Cleanup | ProcessSequence::Optional);
         }
         
-        // Copy System.map
-        if (success) {
-            QString sysmapSource;
-            if (isInstalledKernel) {
-                sysmapSource = QString("/boot/System.map-%1").arg(kernelVersion);
+        // Nothing else may touch the target while it is being written; the
+        // running system's kernel and modules are only read
+        QVector<JobResource> resources;
+        resources << JobResource::exclusive(SystemManager::deviceResource(devicePath))
+                  << JobResource::exclusive(SystemManager::deviceResource(mountPoint))
+                  << JobResource::shared(SystemManager::BootResource)
+                  << JobResource::shared(SystemManager::ModulesResource);
+        runWithProgress(QString("Install kernel %1 to %2").arg(kernelVersion, devicePath), resources,
+                        sequence, progress, [this, kernelVersion, devicePath](bool success, const QString &error) {
+            // Show result
+            if (success) {
+                QMessageBox::information(this, "Installation Complete",
+                    QString("Successfully installed kernel %1 to device %2\n\n"
+                           "The target system should now be able to boot with the new kernel.")
+                    .arg(kernelVersion).arg(devicePath));
+                
+                m_statusLabel->setText(QString("Kernel %1 installed to %2").arg(kernelVersion).arg(devicePath));
             } else {
-                QString kernelDir = m_kernelDirectoryEdit->text().trimmed();
-                if (kernelDir.isEmpty()) {
-                    kernelDir = m_kernelDirectory;
-                }
-                sysmapSource = QString("%1/System.map-%2").arg(kernelDir).arg(kernelVersion);
+                QMessageBox::critical(this, "Installation Failed",
+                    QString("Failed to install kernel to device.\n\nError: %1").arg(error));
+                
+                m_statusLabel->setText("Kernel installation failed");
             }
-            QString sysmapDest = QString("%1/boot/System.map-%2").arg(mountPoint).arg(kernelVersion);
-            
-            // Copy System.map using rsync
-            QProcess::execute("rsync", QStringList() << "-av" << "--update" << sysmapSource << sysmapDest);
-        }
-    }
-    
-    if (success && copyModules) {
-        // Step 4: Copy kernel modules
-        progress->setLabelText("Copying kernel modules...");
-        progress->setValue(60);
-        
-        QString modulesSource = QString("/lib/modules/%1").arg(kernelVersion);
-        QString modulesDest = QString("%1/lib/modules/%2").arg(mountPoint).arg(kernelVersion);
-        
-        // Ensure modules directory exists
-        QProcess::execute("mkdir", QStringList() << "-p" << QString("%1/lib/modules/").arg(mountPoint));
-        
-        // Copy modules using rsync (handles bind mounts and overwrites)
-        QProcess *copyModulesProcess = new QProcess(this);
-        copyModulesProcess->start("rsync", QStringList() << "-av" << "--update" << "--delete" << modulesSource + "/" << QString("%1/lib/modules/%2/").arg(mountPoint).arg(kernelVersion));
-        copyModulesProcess->waitForFinished();
-        
-        if (copyModulesProcess->exitCode() != 0) {
-            errorMessage = "Failed to copy kernel modules: " + QString(copyModulesProcess->readAllStandardError());
-            success = false;
-        }
-    }
-    
-    if (success && updateGrub) {
-        // Step 5: Update GRUB configuration
-        progress->setLabelText("Updating GRUB configuration...");
-        progress->setValue(80);
-        
-        // Mount necessary filesystems for chroot
-        QProcess::execute("mount", QStringList() << "--bind" << "/dev" << mountPoint + "/dev");
-        QProcess::execute("mount", QStringList() << "--bind" << "/proc" << mountPoint + "/proc");
-        QProcess::execute("mount", QStringList() << "--bind" << "/sys" << mountPoint + "/sys");
-        
-        // Update GRUB in chroot
-        QProcess *grubProcess = new QProcess(this);
-        grubProcess->start("chroot", QStringList() << mountPoint << "update-grub");
-        grubProcess->waitForFinished();
-        
-        if (grubProcess->exitCode() != 0) {
-            // Try grub-mkconfig as fallback
-            QProcess *grubMkconfigProcess = new QProcess(this);
-            grubMkconfigProcess->start("chroot", QStringList() << mountPoint << "grub-mkconfig" << "-o" << "/boot/grub/grub.cfg");
-            grubMkconfigProcess->waitForFinished();
-        }
-        
-        // Unmount bind mounts
-        QProcess::execute("umount", QStringList() << mountPoint + "/sys");
-        QProcess::execute("umount", QStringList() << mountPoint + "/proc");
-        QProcess::execute("umount", QStringList() << mountPoint + "/dev");
-    }
-    
-    // Step 6: Cleanup
-    progress->setLabelText("Cleaning up...");
-    progress->setValue(90);
-    
-    if (shouldUnmount) {
-        QProcess::execute("umount", QStringList() << mountPoint);
-    }
-    
-    progress->setValue(100);
+        });
+    };
     
-    // Show result
-    if (success) {
-        QMessageBox::information(this, "Installation Complete",
-            QString("Successfully installed kernel %1 to device %2\n\n"
-                   "The target system should now be able to boot with the new kernel.")
-            .arg(kernelVersion).arg(devicePath));
-        
-        m_statusLabel->setText(QString("Kernel %1 installed to %2").arg(kernelVersion).arg(devicePath));
+    if (mountRoot) {
+        // Step 2: Find root partition
+        progress->setLabelText("Finding root partition...");
+        findRootPartition(devicePath, install);
     } else {
-        QMessageBox::critical(this, "Installation Failed",
-            QString("Failed to install kernel to device.\n\nError: %1").arg(errorMessage));
-        
-        m_statusLabel->setText("Kernel installation failed");
+        install(QString());
     }
 }
 
@@ -1377,15 +1347,16 @@ void KernelManager::onUpdateGrubOnDevice()
             
         if (confirm == QMessageBox::Yes) {
             // Create progress dialog
-            QProgressDialog progress("Updating GRUB...", "Cancel", 0, 100, this);
-            progress.setWindowModality(Qt::WindowModal);
-            progress.setWindowTitle("GRUB Update Progress");
-            progress.setAutoClose(true);
-            progress.setValue(0);
+            QProgressDialog *progress = new QProgressDialog("Updating GRUB...", "Cancel", 0, 100, this);
+            progress->setWindowModality(Qt::WindowModal);
+            progress->setWindowTitle("GRUB Update Progress");
+            progress->setAutoClose(true);
+            progress->setMinimumDuration(0);
+            progress->setValue(0);
             
             // Perform the GRUB update
             performGrubUpdate(mountPoint, devicePath, needsMount, 
-                            updateInitramfsCheckbox->isChecked(), &progress);
+                            updateInitramfsCheckbox->isChecked(), progress);
         }
     }
 }
@@ -1396,122 +1367,72 @@ void KernelManager::performGrubUpdate(const QString &mountPoint,
                                      bool updateInitramfs,
                                      QProgressDialog *progress)
 {
-    bool success = true;
-    QString errorMessage;
-    QString actualMountPoint = mountPoint;
-    
-    // Step 1: Mount if needed
+    // Step 1: Create mount point if needed
     if (needsMount) {
         progress->setLabelText("Creating mount point...");
-        progress->setValue(10);
-        QProcess::execute("mkdir", QStringList() << "-p" << mountPoint);
-        
-        progress->setLabelText("Finding root partition...");
-        progress->setValue(20);
-        
-        // Try to find root partition
-        QString rootPartition;
-        QProcess *partitionsProcess = new QProcess(this);
-        partitionsProcess->start("lsblk", QStringList() << "-n" << "-o" << "NAME,FSTYPE" << devicePath);
-        partitionsProcess->waitForFinished();
-        
-        QStringList partitions = QString(partitionsProcess->readAllStandardOutput()).split('\n');
-        for (const QString &partition : partitions) {
-            if (partition.contains("ext4") || partition.contains("btrfs")) {
-                rootPartition = devicePath + partition.split(' ').first().trimmed().mid(2);
-                break;
-            }
-        }
+        QDir().mkpath(mountPoint);
+    }
+    
+    m_statusLabel->setText("Updating GRUB...");
+    
+    // rootPartition is empty when the target is already mounted
+    auto update = [=](const QString &rootPartition) {
+        ProcessSequence *sequence = new ProcessSequence(this);
         
-        if (rootPartition.isEmpty()) {
-            rootPartition = devicePath + "1";
+        if (!rootPartition.isEmpty()) {
+            sequence->addStep(QString("Mounting %1").arg(rootPartition), "mount",
+                              QStringList() << rootPartition << mountPoint);
         }
         
-        progress->setLabelText(QString("Mounting %1...").arg(rootPartition));
-        progress->setValue(30);
-        
-        QProcess *mountProcess = new QProcess(this);
-        mountProcess->start("mount", QStringList() << rootPartition << mountPoint);
-        mountProcess->waitForFinished();
-        
-        if (mountProcess->exitCode() != 0) {
-            errorMessage = "Failed to mount root partition: " + mountProcess->readAllStandardError();
-            success = false;
-        }
-    } else {
-        progress->setValue(30);
-    }
-    
-    if (success) {
         // Step 2: Mount necessary filesystems for chroot
-        progress->setLabelText("Mounting system filesystems...");
-        progress->setValue(40);
-        
-        QProcess::execute("mount", QStringList() << "--bind" << "/dev" << actualMountPoint + "/dev");
-        QProcess::execute("mount", QStringList() << "--bind" << "/proc" << actualMountPoint + "/proc");
-        QProcess::execute("mount", QStringList() << "--bind" << "/sys" << actualMountPoint + "/sys");
+        addChrootMountSteps(sequence, mountPoint);
         
         // Step 3: Update initramfs if requested
         if (updateInitramfs) {
-            progress->setLabelText("Updating initramfs...");
-            progress->setValue(60);
-            
-            QProcess *initramfsProcess = new QProcess(this);
-            initramfsProcess->start("chroot", QStringList() << actualMountPoint << "update-initramfs" << "-u" << "-k" << "all");
-            initramfsProcess->waitForFinished();
-            
-            if (initramfsProcess->exitCode() != 0) {
-                m_statusLabel->setText("Warning: initramfs update had issues");
-            }
+            sequence->addStep("Updating initramfs", "chroot",
+                              QStringList() << mountPoint << "update-initramfs" << "-u" << "-k" << "all",
+                              ProcessSequence::Optional);
         }
         
-        // Step 4: Update GRUB
-        progress->setLabelText("Updating GRUB configuration...");
-        progress->setValue(80);
-        
-        QProcess *grubProcess = new QProcess(this);
-        grubProcess->start("chroot", QStringList() << actualMountPoint << "update-grub");
-        grubProcess->waitForFinished();
-        
-        if (grubProcess->exitCode() != 0) {
-            // Try grub-mkconfig as fallback
-            QProcess *grubMkconfigProcess = new QProcess(this);
-            grubMkconfigProcess->start("chroot", QStringList() << actualMountPoint << "grub-mkconfig" << "-o" << "/boot/grub/grub.cfg");
-            grubMkconfigProcess->waitForFinished();
-            
-            if (grubMkconfigProcess->exitCode() != 0) {
-                errorMessage = "Failed to update GRUB: " + grubProcess->readAllStandardError();
-                success = false;
-            }
-        }
+        // Step 4: Update GRUB, with grub-mkconfig as fallback
+        sequence->addStep("Updating GRUB configuration", "chroot", QStringList() << mountPoint << "update-grub");
+        sequence->addStep("Running grub-mkconfig", "chroot",
+                          QStringList() << mountPoint << "grub-mkconfig" << "-o" << "/boot/grub/grub.cfg",
+                          ProcessSequence::Fallback);
         
         // Step 5: Cleanup
-        progress->setLabelText("Cleaning up...");
-        progress->setValue(90);
-        
-        QProcess::execute("umount", QStringList() << actualMountPoint + "/sys");
-        QProcess::execute("umount", QStringList() << actualMountPoint + "/proc");
-        QProcess::execute("umount", QStringList() << actualMountPoint + "/dev");
-        
+        addChrootUnmountSteps(sequence, mountPoint);
         if (needsMount) {
-            QProcess::execute("umount", QStringList() << actualMountPoint);
+            sequence->addStep(QString("Unmounting %1").arg(mountPoint), "umount", QStringList() << mountPoint,
+                              ProcessSequence::Cleanup | ProcessSequence::Optional);
         }
-    }
-    
-    progress->setValue(100);
-    
-    // Show result
-    if (success) {
-        QMessageBox::information(this, "GRUB Update Complete",
-            "Successfully updated GRUB configuration.\n\n"
-            "The target system should now show all available kernels in the boot menu.");
         
-        m_statusLabel->setText("GRUB updated successfully");
+        QVector<JobResource> resources;
+        resources << JobResource::exclusive(SystemManager::deviceResource(devicePath))
+                  << JobResource::exclusive(SystemManager::deviceResource(mountPoint));
+        runWithProgress(QString("Update GRUB on %1").arg(devicePath), resources,
+                        sequence, progress, [this](bool success, const QString &error) {
+            // Show result
+            if (success) {
+                QMessageBox::information(this, "GRUB Update Complete",
+                    "Successfully updated GRUB configuration.\n\n"
+                    "The target system should now show all available kernels in the boot menu.");
+                
+                m_statusLabel->setText("GRUB updated successfully");
+            } else {
+                QMessageBox::critical(this, "GRUB Update Failed",
+                    QString("Failed to update GRUB.\n\nError: %1").arg(error));
+                
+                m_statusLabel->setText("GRUB update failed");
+            }
+        });
+    };
+    
+    if (needsMount) {
+        progress->setLabelText("Finding root partition...");
+        findRootPartition(devicePath, update);
     } else {
-        QMessageBox::critical(this, "GRUB Update Failed",
-            QString("Failed to update GRUB.\n\nError: %1").arg(errorMessage));
-        
-        m_statusLabel->setText("GRUB update failed");
+        update(QString());
     }
 }
 
@@ -1524,8 +1445,25 @@ void KernelManager::onApplyKernelParameter() { /* Implementation */ }
 void KernelManager::onUpdateBootParameters() { /* Implementation */ }
 void KernelManager::onEditKernelConfig() { /* Implementation */ }
 void KernelManager::onSaveKernelConfig() { /* Implementation */ }
-void KernelManager::onLoadModule() { /* Implementation */ }
-void KernelManager::onUnloadModule() { /* Implementation */ }
+void KernelManager::onLoadModule()
+{
+    QListWidgetItem *item = m_availableModulesList->currentItem();
+    if (!item) {
+        QMessageBox::warning(this, "No Module Selected", "Please select a module from the available modules list.");
+        return;
+    }
+    m_systemManager->loadKernelModule(item->text().section(' ', -1));
+}
+
+void KernelManager::onUnloadModule()
+{
+    QListWidgetItem *item = m_loadedModulesList->currentItem();
+    if (!item) {
+        QMessageBox::warning(this, "No Module Selected", "Please select a module from the loaded modules list.");
+        return;
+    }
+    m_systemManager->unloadKernelModule(item->text().section(' ', -1));
+}
 void KernelManager::onBlacklistModule() { /* Implementation */ }
 
 void KernelManager::onBrowseKernelDirectory()
@@ -1540,11 +1478,12 @@ void KernelManager::onBrowseKernelDirectory()
 
 void KernelManager::onCopyCurrentKernel()
 {
-    // Get current kernel version first
-    QProcess currentProcess;
-    currentProcess.start("uname", QStringList() << "-r");
-    currentProcess.waitForFinished();
-    QString currentKernel = currentProcess.readAllStandardOutput().trimmed();
+    // Get current kernel version first (what uname -r prints)
+    QString currentKernel;
+    QFile releaseFile("/proc/sys/kernel/osrelease");
+    if (releaseFile.open(QIODevice::ReadOnly)) {
+        currentKernel = QString::fromUtf8(releaseFile.readAll()).trimmed();
+    }
     
     if (currentKernel.isEmpty()) {
         QMessageBox::warning(this, "Error", "Could not determine current kernel version.");
@@ -1652,15 +1591,6 @@ void KernelManager::onCopyCurrentKernel()
             return;
         }
         
-        // Create progress dialog
-        QProgressDialog progress("Copying kernel files...", "Cancel", 0, 100, this);
-        progress.setWindowModality(Qt::WindowModal);
-        progress.setWindowTitle("Copy Kernel Progress");
-        progress.setValue(0);
-        
-        bool success = true;
-        QString errorMessage;
-        
         // Prepare Ubuntu kernel file locations
         struct KernelFile {
             QString sourcePath;
@@ -1711,100 +1641,67 @@ void KernelManager::onCopyCurrentKernel()
             }
         }
         
-        // Create destination directories
+        // Check sources up front, so a missing kernel image fails before
+        // anything is copied
+        ProcessSequence *sequence = new ProcessSequence(this);
         for (const auto &file : kernelFiles) {
-            QDir().mkpath(file.destPath);
-        }
-        
-        int totalFiles = kernelFiles.size();
-        int completedFiles = 0;
-        
-        for (const auto &file : kernelFiles) {
-            if (progress.wasCanceled()) {
-                return;
-            }
-            
-            progress.setLabelText(QString("Copying %1...").arg(file.description));
-            progress.setValue((completedFiles * 100) / totalFiles);
-            
             QFileInfo sourceInfo(file.sourcePath);
-            
-            if (sourceInfo.exists()) {
-                QString destFile;
-                
-                if (sourceInfo.isDir()) {
-                    // Copy directory recursively
-                    QString dirName = sourceInfo.fileName();
-                    destFile = file.destPath + dirName;
-                    
-                    // Remove existing directory if present
-                    if (QDir(destFile).exists()) {
-                        QDir(destFile).removeRecursively();
-                    }
-                    
-                    // Use cp -r for directory copying
-                    QProcess copyProcess;
-                    copyProcess.start("cp", QStringList() << "-r" << file.sourcePath << file.destPath);
-                    copyProcess.waitForFinished(30000); // 30 second timeout
-                    
-                    if (copyProcess.exitCode() != 0) {
-                        QString error = QString("Failed to copy %1: %2").arg(file.description).arg(QString(copyProcess.readAllStandardError()));
-                        if (file.required) {
-                            errorMessage = error;
-                            success = false;
-                            break;
-                        } else {
-                            m_statusLabel->setText(QString("Warning: %1").arg(error));
-                        }
-                    }
-                } else {
-                    // Copy single file
-                    QString fileName = sourceInfo.fileName();
-                    destFile = file.destPath + fileName;
-                    
-                    if (QFile::exists(destFile)) {
-                        QFile::remove(destFile);
-                    }
-                    
-                    if (!QFile::copy(file.sourcePath, destFile)) {
-                        QString error = QString("Failed to copy %1").arg(file.description);
-                        if (file.required) {
-                            errorMessage = error;
-                            success = false;
-                            break;
-                        } else {
-                            m_statusLabel->setText(QString("Warning: %1").arg(error));
-                        }
-                    }
-                }
-            } else {
+            if (!sourceInfo.exists()) {
                 QString error = QString("%1 not found at %2").arg(file.description).arg(file.sourcePath);
                 if (file.required) {
-                    errorMessage = error;
-                    success = false;
-                    break;
-                } else {
-                    m_statusLabel->setText(QString("Warning: %1").arg(error));
+                    delete sequence;
+                    QMessageBox::critical(this, "Error", error);
+                    return;
+                }
+                m_statusLabel->setText(QString("Warning: %1").arg(error));
+                continue;
+            }
+            
+            // Create destination directory and remove what is already there
+            QDir().mkpath(file.destPath);
+            QString destFile = file.destPath + sourceInfo.fileName();
+            QStringList arguments;
+            if (sourceInfo.isDir()) {
+                if (QDir(destFile).exists()) {
+                    QDir(destFile).removeRecursively();
                 }
+                arguments << "-r";
+            } else if (QFile::exists(destFile)) {
+                QFile::remove(destFile);
             }
+            arguments << file.sourcePath << file.destPath;
             
-            completedFiles++;
+            // No timeout: headers and modules can take minutes on an SD card
+            sequence->addStep(QString("Copying %1").arg(file.description), "cp", arguments,
+                              file.required ? ProcessSequence::Required : ProcessSequence::Optional);
         }
         
-        progress.setValue(100);
-        
-        if (success) {
-            QString message = QString("Successfully copied kernel %1 to %2").arg(currentKernel).arg(destPath);
-            if (isDeviceInstall) {
-                message += "\n\nNote: You may need to update GRUB on the target device.";
-            }
-            QMessageBox::information(this, "Success", message);
-            if (!isDeviceInstall) {
-                onRefreshKernels(); // Refresh kernel list if copied to tweaker dir
+        // Create progress dialog
+        QProgressDialog *progress = new QProgressDialog("Copying kernel files...", "Cancel", 0, 100, this);
+        progress->setWindowModality(Qt::WindowModal);
+        progress->setWindowTitle("Copy Kernel Progress");
+        progress->setMinimumDuration(0);
+        progress->setValue(0);
+        
+        QVector<JobResource> resources;
+        resources << JobResource::exclusive(SystemManager::deviceResource(destPath))
+                  << JobResource::shared(SystemManager::BootResource)
+                  << JobResource::shared(SystemManager::ModulesResource);
+        runWithProgress(QString("Copy kernel %1 to %2").arg(currentKernel, destPath), resources,
+                        sequence, progress, [this, currentKernel, destPath, isDeviceInstall](bool success, const QString &error) {
+            if (success) {
+                QString message = QString("Successfully copied kernel %1 to %2").arg(currentKernel).arg(destPath);
+                if (isDeviceInstall) {
+                    message += "\n\nNote: You may need to update GRUB on the target device.";
+                }
+                QMessageBox::information(this, "Success", message);
+                if (!isDeviceInstall) {
+                    onRefreshKernels(); // Refresh kernel list if copied to tweaker dir
+                }
+            } else {
+                QMessageBox::critical(this, "Error", error);
             }
-        } else {
-            QMessageBox::critical(this, "Error", errorMessage);
-        }
+        });
     }
 }
 
@@ -1938,12 +1835,6 @@ void KernelManager::onBackupKernel()
         
         QString fullArchivePath = backupDir + "/" + archiveName;
         
-        // Create progress dialog
-        QProgressDialog progress("Creating kernel backup...", "Cancel", 0, 100, this);
-        progress.setWindowModality(Qt::WindowModal);
-        progress.setWindowTitle("Backup Progress");
-        progress.setValue(0);
-        
         // Prepare files to backup
         QStringList filesToBackup;
         QStringList backupSources;
@@ -1982,40 +1873,127 @@ void KernelManager::onBackupKernel()
             return;
         }
         
-        progress.setLabelText("Creating tar archive...");
-        progress.setValue(25);
+        // Create progress dialog; tar gives no progress, so it just shows
+        // that something is happening
+        QProgressDialog *progress = new QProgressDialog("Creating kernel backup...", "Cancel", 0, 0, this);
+        progress->setWindowModality(Qt::WindowModal);
+        progress->setWindowTitle("Backup Progress");
+        progress->setMinimumDuration(0);
         
-        // Create tar command
-        QProcess tarProcess;
+        // Create tar command; no timeout, headers alone can take minutes
         QStringList tarArgs;
         tarArgs << "-czf" << fullArchivePath;
         tarArgs.append(backupSources);
         
-        progress.setValue(50);
-        
-        tarProcess.start("tar", tarArgs);
-        tarProcess.waitForFinished(60000); // 60 second timeout
-        
-        progress.setValue(100);
+        ProcessSequence *sequence = new ProcessSequence(this);
+        sequence->addStep("Creating tar archive", "tar", tarArgs);
+        
+        int fileCount = backupSources.size();
+        QVector<JobResource> resources;
+        resources << JobResource::shared(SystemManager::BootResource)
+                  << JobResource::shared(SystemManager::ModulesResource);
+        runWithProgress(QString("Back up kernel to %1").arg(fullArchivePath), resources,
+                        sequence, progress, [this, fullArchivePath, fileCount](bool success, const QString &error) {
+            if (success) {
+                QFileInfo archiveInfo(fullArchivePath);
+                QString sizeStr = QString("%1 MB").arg(archiveInfo.size() / (1024.0 * 1024.0), 0, 'f', 1);
+                
+                QMessageBox::information(this, "Backup Complete", 
+                    QString("Kernel backup created successfully!\n\n"
+                           "Location: %1\n"
+                           "Size: %2\n"
+                           "Files backed up: %3")
+                           .arg(fullArchivePath)
+                           .arg(sizeStr)
+                           .arg(fileCount));
+            } else {
+                // Don't leave a truncated archive behind
+                QFile::remove(fullArchivePath);
+                QMessageBox::critical(this, "Backup Failed", 
+                    QString("Failed to create backup archive.\n\nError: %1").arg(error));
+            }
+        });
+    }
+}
+
+void KernelManager::findRootPartition(const QString &devicePath,
+                                      const std::function<void(const QString &)> &onFound)
+{
+    ProcessRunner::run("lsblk", QStringList() << "-n" << "-o" << "NAME,FSTYPE" << devicePath, this,
+                       [devicePath, onFound](const ProcessResult &result) {
+        // Try to find root partition (simplified - real implementation would be more sophisticated)
+        QString rootPartition;
+        QStringList partitions = result.output().split('\n');
+        for (const QString &partition : partitions) {
+            if (partition.contains("ext4") || partition.contains("btrfs")) {
+                rootPartition = devicePath + partition.split(' ').first().trimmed().mid(2);
+                break;
+            }
+        }
         
-        if (tarProcess.exitCode() == 0) {
-            QFileInfo archiveInfo(fullArchivePath);
-            QString sizeStr = QString("%1 MB").arg(archiveInfo.size() / (1024.0 * 1024.0), 0, 'f', 1);
-            
-            QMessageBox::information(this, "Backup Complete", 
-                QString("Kernel backup created successfully!\n\n"
-                       "Location: %1\n"
-                       "Size: %2\n"
-                       "Files backed up: %3")
-                       .arg(fullArchivePath)
-                       .arg(sizeStr)
-                       .arg(backupSources.size()));
-        } else {
-            QString error = QString(tarProcess.readAllStandardError());
-            QMessageBox::critical(this, "Backup Failed", 
-                QString("Failed to create backup archive.\n\nError: %1").arg(error));
+        if (rootPartition.isEmpty()) {
+            // Try first partition as fallback
+            rootPartition = devicePath + "1";
         }
+        
+        onFound(rootPartition);
+    }, kDeviceQueryTimeoutMs);
+}
+
+void KernelManager::runWithProgress(const QString &description, const QVector<JobResource> &resources,
+                                    ProcessSequence *sequence, QProgressDialog *progress,
+                                    const std::function<void(bool, const QString &)> &onFinished)
+{
+    if (progress->wasCanceled()) {
+        // Cancelled while the steps were still being worked out
+        sequence->deleteLater();
+        progress->deleteLater();
+        onFinished(false, "Cancelled");
+        return;
     }
+    
+    JobScheduler *scheduler = m_systemManager->scheduler();
+    
+    connect(sequence, &ProcessSequence::stepStarted, progress, [progress](const QString &label, int percent) {
+        progress->setLabelText(label + "...");
+        if (progress->maximum() > 0) {
+            progress->setValue(percent);
+        }
+    });
+    connect(sequence, &ProcessSequence::warning, this, [this](const QString &message) {
+        m_statusLabel->setText(QString("Warning: %1").arg(message));
+    });
+    
+    // The sequence runs once nothing else holds the device or the files it
+    // reads; until then the dialog says what it is waiting for
+    progress->setLabelText("Waiting for other jobs to finish...");
+    int job = scheduler->submit(description, resources, [scheduler, sequence](int job) {
+        connect(sequence, &ProcessSequence::finished, scheduler, [scheduler, job](bool success, const QString &error) {
+            scheduler->finish(job, success, error);
+        });
+        sequence->start();
+    });
+    
+    // A queued job just leaves the queue; a running one goes through the
+    // scheduler too, so the job list sees the same cancel
+    connect(progress, &QProgressDialog::canceled, scheduler, [scheduler, job]() {
+        scheduler->cancel(job);
+    });
+    connect(scheduler, &JobScheduler::cancelRequested, sequence, [sequence, job](int cancelled) {
+        if (cancelled == job) {
+            sequence->cancel();
+        }
+    });
+    connect(scheduler, &JobScheduler::jobFinished, progress,
+            [sequence, progress, job, onFinished](int finished, bool success, const QString &error) {
+        if (finished != job) {
+            return;
+        }
+        progress->setValue(progress->maximum());
+        progress->deleteLater();
+        sequence->deleteLater();
+        onFinished(success, error);
+    });
 }
 
 QString KernelManager::cleanKernelVersion(const QString &rawVersion) const
@@ -2035,4 +2013,13 @@ QString KernelManager::cleanKernelVersion(const QString &rawVersion) const
     return cleaned.trimmed();
 }
 
-void KernelManager::onModuleSelectionChanged() { /* Implementation */ }
\ No newline at end of file
+void KernelManager::onModuleSelectionChanged(QListWidgetItem *current)
+{
+    if (!current) return;
+    
+    // "✅ snd_soc_core" or "📦 snd_soc_core"
+    QString moduleName = current->text().section(' ', -1);
+    m_systemManager->getModuleInfo(moduleName, [this](const QString &info) {
+        m_moduleInfoText->setPlainText(info);
+    });
+}
\ No newline at end of file
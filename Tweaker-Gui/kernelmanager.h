@@ -14,7 +14,15 @@
 #include <QCheckBox>
 #include <QSpinBox>
 #include <QLineEdit>
+#include <QVector>
 
+#include <functional>
+
+#include "moduleindex.h"
+
+class LoadedModuleMonitor;
+class ProcessSequence;
+struct JobResource;
 class SystemManager;
 class QProgressDialog;
 
@@ -89,7 +97,8 @@ private slots:
     void onUnloadModule();
     void onBlacklistModule();
     void onRefreshModules();
-    void onModuleSelectionChanged();
+    void onModuleSelectionChanged(QListWidgetItem *current);
+    void showAvailableModules();
 
 private:
     void setupUI();
@@ -113,6 +122,16 @@ private:
                           bool updateInitramfs,
                           QProgressDialog *progress);
     
+    // Looks up devicePath's root partition with lsblk and passes it on
+    void findRootPartition(const QString &devicePath,
+                           const std::function<void(const QString &)> &onFound);
+    // Queues sequence as a job claiming resources, then runs it with progress
+    // showing its steps and cancelling it; both are deleted once the job
+    // ends, right before onFinished
+    void runWithProgress(const QString &description, const QVector<JobResource> &resources,
+                         ProcessSequence *sequence, QProgressDialog *progress,
+                         const std::function<void(bool, const QString &)> &onFinished);
+    
     // Helper functions
     QString cleanKernelVersion(const QString &rawVersion) const;
     
@@ -180,14 +199,16 @@ private:
     QPushButton *m_unloadModuleButton;
     QPushButton *m_blacklistModuleButton;
     QPushButton *m_refreshModulesButton;
+    QCheckBox *m_watchModulesCheckbox;
     QLineEdit *m_moduleSearchEdit;
     
     // Backend
     SystemManager *m_systemManager;
     QStringList m_installedKernels;
     QStringList m_availableKernels;
-    QStringList m_loadedModules;
+    LoadedModuleMonitor *m_loadedModuleMonitor;
     QStringList m_availableModules;
+    ModuleIndex m_moduleIndex;      // The running kernel's, from depmod's files
     QStringList m_appliedPatches;
     QString m_currentKernel;
     QString m_defaultKernel;
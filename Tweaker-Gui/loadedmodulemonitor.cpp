@@ -0,0 +1,168 @@
+#include "loadedmodulemonitor.h"
+#include <QFile>
+#include <QTimer>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const char kProcModules[] = "/proc/modules";
+
+bool readProcModules(QByteArray &text, QString &error)
+{
+    QFile file(kProcModules);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = QString("Cannot read %1: %2").arg(kProcModules, file.errorString());
+        return false;
+    }
+    // procfs reports no size, so this reads to the end
+    text = file.readAll();
+    return true;
+}
+
+bool lessByName(const LoadedModule &a, const LoadedModule &b)
+{
+    return a.name < b.name;
+}
+
+bool sameState(const LoadedModule &a, const LoadedModule &b)
+{
+    return a.size == b.size && a.refcount == b.refcount && a.state == b.state && a.users == b.users;
+}
+
+} // namespace
+
+LoadedModuleMonitor::LoadedModuleMonitor(QObject *parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+{
+    connect(m_timer, &QTimer::timeout, this, &LoadedModuleMonitor::refresh);
+}
+
+bool LoadedModuleMonitor::read(QVector<LoadedModule> &modules, QString &error)
+{
+    QByteArray text;
+    if (!readProcModules(text, error)) return false;
+    modules = parse(text);
+    return true;
+}
+
+QVector<LoadedModule> LoadedModuleMonitor::parse(const QByteArray &text)
+{
+    // "nf_tables 290816 583 nft_compat,nft_chain_nat, Live 0x0000000000000000 (E)"
+    // Users are "-" when there are none, refcount too without module unloading.
+    QVector<LoadedModule> modules;
+    const char *line = text.constData();
+    const char *end = line + text.size();
+    while (line < end) {
+        const char *lineEnd = static_cast<const char *>(memchr(line, '\n', end - line));
+        if (!lineEnd) lineEnd = end;
+
+        const char *fields[5];
+        int lengths[5];
+        int count = 0;
+        const char *c = line;
+        while (count < 5 && c < lineEnd) {
+            const char *fieldEnd = static_cast<const char *>(memchr(c, ' ', lineEnd - c));
+            if (!fieldEnd) fieldEnd = lineEnd;
+            fields[count] = c;
+            lengths[count] = int(fieldEnd - c);
+            ++count;
+            c = fieldEnd + 1;
+        }
+
+        if (count == 5) {
+            LoadedModule module;
+            module.name = QString::fromLatin1(fields[0], lengths[0]);
+            module.size = QByteArray::fromRawData(fields[1], lengths[1]).toLongLong();
+            bool ok = false;
+            module.refcount = QByteArray::fromRawData(fields[2], lengths[2]).toInt(&ok);
+            if (!ok) module.refcount = -1;
+            if (lengths[3] != 1 || fields[3][0] != '-') {
+                module.users = QString::fromLatin1(fields[3], lengths[3]).split(',', QString::SkipEmptyParts);
+            }
+            module.state = QString::fromLatin1(fields[4], lengths[4]);
+            modules.append(module);
+        }
+        line = lineEnd + 1;
+    }
+
+    // The kernel lists the most recently loaded first
+    std::sort(modules.begin(), modules.end(), lessByName);
+    return modules;
+}
+
+const LoadedModule *LoadedModuleMonitor::find(const QString &name) const
+{
+    LoadedModule key;
+    key.name = name;
+    auto it = std::lower_bound(m_modules.begin(), m_modules.end(), key, lessByName);
+    return (it != m_modules.end() && it->name == name) ? &*it : nullptr;
+}
+
+void LoadedModuleMonitor::start(int intervalMs)
+{
+    refresh();
+    m_timer->start(intervalMs);
+}
+
+void LoadedModuleMonitor::stop()
+{
+    m_timer->stop();
+}
+
+bool LoadedModuleMonitor::isRunning() const
+{
+    return m_timer->isActive();
+}
+
+bool LoadedModuleMonitor::update(const QByteArray &text)
+{
+    if (text == m_snapshot) return false;
+    m_snapshot = text;
+
+    // Slots see the new list through modules() while the changes come in
+    QVector<LoadedModule> previous = m_modules;
+    m_modules = parse(text);
+
+    // Both lists are sorted, so one merge pass finds every change; index
+    // is where the view is, with the changes so far applied
+    bool changed = false;
+    int index = 0;
+    int oldPos = 0;
+    int newPos = 0;
+    while (oldPos < previous.size() || newPos < m_modules.size()) {
+        if (newPos == m_modules.size()
+            || (oldPos < previous.size() && previous.at(oldPos).name < m_modules.at(newPos).name)) {
+            emit moduleRemoved(index, previous.at(oldPos).name);
+            ++oldPos;
+            changed = true;
+        } else if (oldPos == previous.size() || m_modules.at(newPos).name < previous.at(oldPos).name) {
+            emit moduleInserted(index, m_modules.at(newPos));
+            ++newPos;
+            ++index;
+            changed = true;
+        } else {
+            if (!sameState(previous.at(oldPos), m_modules.at(newPos))) {
+                emit moduleChanged(index, m_modules.at(newPos));
+                changed = true;
+            }
+            ++oldPos;
+            ++newPos;
+            ++index;
+        }
+    }
+    return changed;
+}
+
+void LoadedModuleMonitor::refresh()
+{
+    QByteArray text;
+    QString error;
+    if (!readProcModules(text, error)) {
+        emit readFailed(error);
+        return;
+    }
+    update(text);
+}
@@ -0,0 +1,66 @@
+#ifndef LOADEDMODULEMONITOR_H
+#define LOADEDMODULEMONITOR_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class QTimer;
+
+struct LoadedModule {
+    QString name;
+    qint64 size;            // Bytes of kernel memory
+    int refcount;           // -1 if the kernel can't unload modules
+    QStringList users;      // Modules that depend on this one
+    QString state;          // "Live", "Loading" or "Unloading"
+};
+
+// The modules the kernel has loaded, from /proc/modules, which is what
+// lsmod prints too. Each refresh() reads the file once; if it is byte for
+// byte what the last one read nothing else happens, otherwise the new list
+// is merged against the old and only what changed is signalled, at its
+// position in the name-sorted list, so a view mirroring modules() can be
+// kept in step without being rebuilt. Cheap enough to poll every second.
+class LoadedModuleMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LoadedModuleMonitor(QObject *parent = nullptr);
+
+    // /proc/modules as it is now, sorted by name
+    static bool read(QVector<LoadedModule> &modules, QString &error);
+    static QVector<LoadedModule> parse(const QByteArray &text);
+
+    // Sorted by name, as of the last refresh
+    const QVector<LoadedModule> &modules() const { return m_modules; }
+    const LoadedModule *find(const QString &name) const;
+
+    // Polls every intervalMs until stop()
+    void start(int intervalMs);
+    void stop();
+    bool isRunning() const;
+
+    // Applies a snapshot, signalling the differences; false if there were none
+    bool update(const QByteArray &text);
+
+public slots:
+    void refresh();
+
+signals:
+    // In the order they apply: indexes count the removals and insertions
+    // signalled before them in the same update
+    void moduleRemoved(int index, const QString &name);
+    void moduleInserted(int index, const LoadedModule &module);
+    void moduleChanged(int index, const LoadedModule &module);
+    void readFailed(const QString &error);
+
+private:
+    QTimer *m_timer;
+    QByteArray m_snapshot;      // The file as last read
+    QVector<LoadedModule> m_modules;
+};
+
+#endif // LOADEDMODULEMONITOR_H
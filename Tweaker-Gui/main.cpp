@@ -2,9 +2,37 @@
 #include <QStyleFactory>
 #include <QDir>
 #include "mainwindow.h"
+#include "devicebenchmark.h"
+#include "moduleloader.h"
+#include "telemetryrecorder.h"
 
 int main(int argc, char *argv[])
 {
+    // Headless: --benchmark-devices [iterations]
+    if (argc > 1 && qstrcmp(argv[1], "--benchmark-devices") == 0) {
+        QCoreApplication app(argc, argv);
+        int iterations = argc > 2 ? QString(argv[2]).toInt() : 100;
+        return runDeviceBenchmark(qMax(1, iterations));
+    }
+    
+    // Headless: --record-telemetry <file> [rate-hz] [seconds]
+    if (argc > 2 && qstrcmp(argv[1], "--record-telemetry") == 0) {
+        QCoreApplication app(argc, argv);
+        int rateHz = argc > 3 ? QString(argv[3]).toInt() : 20;
+        int seconds = argc > 4 ? QString(argv[4]).toInt() : 0;
+        return runTelemetryRecorder(QString::fromLocal8Bit(argv[2]), qBound(1, rateHz, 1000), qMax(0, seconds));
+    }
+    
+    // Headless, as root: --load-modules / --unload-modules <module>...
+    if (argc > 2 && (qstrcmp(argv[1], "--load-modules") == 0 || qstrcmp(argv[1], "--unload-modules") == 0)) {
+        QCoreApplication app(argc, argv);
+        QStringList modules;
+        for (int i = 2; i < argc; ++i) {
+            modules << QString::fromLocal8Bit(argv[i]);
+        }
+        return runModuleLoader(qstrcmp(argv[1], "--unload-modules") == 0, modules);
+    }
+    
     QApplication app(argc, argv);
     
     // Set application properties
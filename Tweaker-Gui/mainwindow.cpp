@@ -1,6 +1,7 @@
 #include "mainwindow.h"
 #include "upgradewidget.h"
 #include "systemmanager.h"
+#include "jobscheduler.h"
 #include "gpumanager.h"
 #include "kernelmanager.h"
 #include "storagemanager.h"
@@ -148,14 +149,21 @@ void MainWindow::setupUpgradeTab()
     connect(m_upgradeWidget, &UpgradeWidget::runUpgradeRequested, this, &MainWindow::onRunUpgrade);
     connect(m_upgradeWidget, &UpgradeWidget::patchSystemRequested, this, &MainWindow::onPatchSystem);
     connect(m_upgradeWidget, &UpgradeWidget::rollbackRequested, this, &MainWindow::onRollbackUpgrade);
+    connect(m_upgradeWidget, &UpgradeWidget::cancelJobRequested, m_systemManager, &SystemManager::cancelJob);
     
     // Connect system manager signals to upgrade widget
     connect(m_systemManager, &SystemManager::progressUpdated, m_upgradeWidget, &UpgradeWidget::updateProgress);
     connect(m_systemManager, &SystemManager::statusUpdated, m_upgradeWidget, &UpgradeWidget::updateStatus);
     connect(m_systemManager, &SystemManager::operationCompleted, [this](bool success, const QString &message) {
-        m_upgradeWidget->setButtonsEnabled(true);
         statusBar()->showMessage(success ? "Operation completed successfully" : "Operation failed");
     });
+    
+    // Every job is listed, including the kernel manager's device installs
+    JobScheduler *scheduler = m_systemManager->scheduler();
+    connect(scheduler, &JobScheduler::jobQueued, m_upgradeWidget, &UpgradeWidget::addJob);
+    connect(scheduler, &JobScheduler::jobStarted, m_upgradeWidget, &UpgradeWidget::markJobStarted);
+    connect(scheduler, &JobScheduler::jobProgress, m_upgradeWidget, &UpgradeWidget::updateJobProgress);
+    connect(scheduler, &JobScheduler::jobFinished, m_upgradeWidget, &UpgradeWidget::markJobFinished);
 }
 
 void MainWindow::setupImageEditorTab()
@@ -236,21 +244,18 @@ void MainWindow::setupStatusTab()
 void MainWindow::onExtractDrivers()
 {
     statusBar()->showMessage("Extracting Orange Pi 5+ drivers and kernel...");
-    m_upgradeWidget->setButtonsEnabled(false);
     m_systemManager->extractDrivers();
 }
 
 void MainWindow::onRunUpgrade()
 {
     statusBar()->showMessage("Running Ubuntu upgrade to 24.10...");
-    m_upgradeWidget->setButtonsEnabled(false);
     m_systemManager->runUbuntuUpgrade();
 }
 
 void MainWindow::onPatchSystem()
 {
     statusBar()->showMessage("Patching system with Orange Pi 5+ support...");
-    m_upgradeWidget->setButtonsEnabled(false);
     m_systemManager->patchSystem();
 }
 
@@ -266,7 +271,6 @@ void MainWindow::onRollbackUpgrade()
     
     if (reply == QMessageBox::Yes) {
         statusBar()->showMessage("Rolling back upgrade...");
-        m_upgradeWidget->setButtonsEnabled(false);
         m_systemManager->rollbackUpgrade();
     }
 }
@@ -0,0 +1,235 @@
+#include "moduleindex.h"
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <cstring>
+#include <fnmatch.h>
+
+namespace {
+
+// A whole file mapped read-only; data() is null if it can't be
+class MappedFile
+{
+public:
+    explicit MappedFile(const QString &path)
+        : m_file(path)
+        , m_data(nullptr)
+        , m_size(0)
+    {
+        if (m_file.open(QIODevice::ReadOnly) && m_file.size() > 0) {
+            m_size = m_file.size();
+            m_data = m_file.map(0, m_size);
+        }
+    }
+
+    ~MappedFile()
+    {
+        if (m_data) m_file.unmap(m_data);
+    }
+
+    const char *data() const { return reinterpret_cast<const char *>(m_data); }
+    const char *end() const { return data() + m_size; }
+
+private:
+    QFile m_file;
+    uchar *m_data;
+    qint64 m_size;
+};
+
+// Calls handleLine(begin, end) for each line between begin and end, without
+// the newline
+template<typename HandleLine>
+void forEachLine(const char *begin, const char *end, HandleLine handleLine)
+{
+    while (begin < end) {
+        const char *newline = static_cast<const char *>(memchr(begin, '\n', end - begin));
+        const char *lineEnd = newline ? newline : end;
+        handleLine(begin, lineEnd);
+        begin = lineEnd + 1;
+    }
+}
+
+// "kernel/drivers/gpu/drm/panfrost/panfrost.ko.zst" -> "panfrost"
+QString nameFromPath(const char *begin, const char *end)
+{
+    const char *slash = begin;
+    for (const char *c = begin; c < end; ++c) {
+        if (*c == '/') slash = c + 1;
+    }
+    const char *nameEnd = slash;
+    while (nameEnd < end && *nameEnd != '.') ++nameEnd;
+
+    QString name = QString::fromLatin1(slash, int(nameEnd - slash));
+    name.replace('-', '_');
+    return name;
+}
+
+bool isWildcard(const QByteArray &alias)
+{
+    return alias.contains('*') || alias.contains('?') || alias.contains('[');
+}
+
+} // namespace
+
+ModuleIndex::ModuleIndex()
+{
+}
+
+bool ModuleIndex::load(const QString &release, QString &error)
+{
+    return loadDirectory(QString("/lib/modules/%1").arg(release), error);
+}
+
+bool ModuleIndex::loadDirectory(const QString &directory, QString &error)
+{
+    m_directory = directory;
+    m_modules.clear();
+    m_byName.clear();
+    m_byAlias.clear();
+    m_wildcardAliases.clear();
+
+    // Taken before the read, so a rewrite while reading shows as a change
+    m_modified = QFileInfo(directory + "/modules.dep").lastModified();
+    MappedFile dep(directory + "/modules.dep");
+    if (!dep.data()) {
+        error = QString("Cannot read %1/modules.dep - has depmod run?").arg(directory);
+        return false;
+    }
+
+    // "kernel/a/foo.ko: kernel/b/bar.ko kernel/c/baz.ko"
+    QHash<QString, int> byName;
+    forEachLine(dep.data(), dep.end(), [&](const char *begin, const char *end) {
+        const char *colon = static_cast<const char *>(memchr(begin, ':', end - begin));
+        if (!colon) return;
+
+        KernelModule module;
+        module.name = nameFromPath(begin, colon);
+        module.path = QString::fromLatin1(begin, int(colon - begin));
+        module.builtin = false;
+        const char *token = colon + 1;
+        while (token < end) {
+            while (token < end && *token == ' ') ++token;
+            const char *tokenEnd = token;
+            while (tokenEnd < end && *tokenEnd != ' ') ++tokenEnd;
+            if (tokenEnd > token) {
+                module.dependencies.append(nameFromPath(token, tokenEnd));
+            }
+            token = tokenEnd;
+        }
+        byName.insert(module.name, m_modules.size());
+        m_modules.append(module);
+    });
+
+    MappedFile builtin(directory + "/modules.builtin");
+    if (builtin.data()) {
+        forEachLine(builtin.data(), builtin.end(), [&](const char *begin, const char *end) {
+            if (begin == end) return;
+            KernelModule module;
+            module.name = nameFromPath(begin, end);
+            module.builtin = true;
+            if (!byName.contains(module.name)) {
+                byName.insert(module.name, m_modules.size());
+                m_modules.append(module);
+            }
+        });
+    }
+
+    // "alias fs-vfat vfat"
+    MappedFile alias(directory + "/modules.alias");
+    if (alias.data()) {
+        forEachLine(alias.data(), alias.end(), [&](const char *begin, const char *end) {
+            if (end - begin < 6 || memcmp(begin, "alias ", 6) != 0) return;
+            const char *pattern = begin + 6;
+            const char *space = static_cast<const char *>(memchr(pattern, ' ', end - pattern));
+            if (!space) return;
+            int index = byName.value(nameFromPath(space + 1, end), -1);
+            if (index >= 0) {
+                m_modules[index].aliases.append(QString::fromLatin1(pattern, int(space - pattern)));
+            }
+        });
+    }
+
+    // Built-in modules' aliases: "vfat.alias=fs-vfat", NUL-separated
+    MappedFile builtinInfo(directory + "/modules.builtin.modinfo");
+    if (builtinInfo.data()) {
+        const char *entry = builtinInfo.data();
+        while (entry < builtinInfo.end()) {
+            const char *entryEnd = static_cast<const char *>(memchr(entry, '\0', builtinInfo.end() - entry));
+            if (!entryEnd) entryEnd = builtinInfo.end();
+            const char *key = static_cast<const char *>(memchr(entry, '.', entryEnd - entry));
+            if (key && entryEnd - key > 7 && memcmp(key, ".alias=", 7) == 0) {
+                QString name = QString::fromLatin1(entry, int(key - entry)).replace('-', '_');
+                int index = byName.value(name, -1);
+                if (index >= 0) {
+                    m_modules[index].aliases.append(QString::fromLatin1(key + 7, int(entryEnd - key - 7)));
+                }
+            }
+            entry = entryEnd + 1;
+        }
+    }
+
+    std::sort(m_modules.begin(), m_modules.end(), [](const KernelModule &a, const KernelModule &b) {
+        return a.name < b.name;
+    });
+
+    m_byName.reserve(m_modules.size());
+    for (int i = 0; i < m_modules.size(); ++i) {
+        m_byName.insert(m_modules.at(i).name, i);
+        for (const QString &moduleAlias : m_modules.at(i).aliases) {
+            QByteArray pattern = moduleAlias.toLatin1();
+            if (isWildcard(pattern)) {
+                m_wildcardAliases.append(qMakePair(pattern, i));
+            } else if (!m_byAlias.contains(moduleAlias)) {
+                m_byAlias.insert(moduleAlias, i);
+            }
+        }
+    }
+    return true;
+}
+
+const KernelModule *ModuleIndex::find(const QString &name) const
+{
+    int index = m_byName.value(normalizedName(name), -1);
+    return index >= 0 ? &m_modules.at(index) : nullptr;
+}
+
+const KernelModule *ModuleIndex::findByAlias(const QString &alias) const
+{
+    int index = m_byAlias.value(alias, -1);
+    if (index >= 0) return &m_modules.at(index);
+
+    QByteArray name = alias.toLatin1();
+    for (const QPair<QByteArray, int> &pattern : m_wildcardAliases) {
+        if (fnmatch(pattern.first.constData(), name.constData(), 0) == 0) {
+            return &m_modules.at(pattern.second);
+        }
+    }
+    return nullptr;
+}
+
+QVector<const KernelModule *> ModuleIndex::search(const QString &prefix) const
+{
+    QString normalized = normalizedName(prefix);
+    auto it = std::lower_bound(m_modules.begin(), m_modules.end(), normalized,
+                               [](const KernelModule &module, const QString &key) { return module.name < key; });
+
+    QVector<const KernelModule *> matches;
+    for (; it != m_modules.end() && it->name.startsWith(normalized); ++it) {
+        matches.append(&*it);
+    }
+    return matches;
+}
+
+QString ModuleIndex::absolutePath(const KernelModule &module) const
+{
+    if (module.builtin) return QString();
+    return module.path.startsWith('/') ? module.path : m_directory + "/" + module.path;
+}
+
+QString ModuleIndex::normalizedName(const QString &name)
+{
+    QString normalized = name;
+    normalized.replace('-', '_');
+    return normalized;
+}
@@ -0,0 +1,65 @@
+#ifndef MODULEINDEX_H
+#define MODULEINDEX_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+struct KernelModule {
+    QString name;               // As the kernel knows it: "drm_kms_helper", never with '-'
+    QString path;               // Relative to the modules directory; empty if built in
+    QStringList dependencies;   // Every module it needs, direct or not, as depmod lists them
+    QStringList aliases;        // "of:N*T*Carm,mali-valhallC*", "fs-ext4"
+    bool builtin;
+};
+
+// What depmod wrote about one kernel's modules: modules.dep for the
+// loadable ones and what they depend on, modules.builtin and
+// modules.builtin.modinfo for the ones compiled in, modules.alias for the
+// names udev and modprobe load them by. The files are mapped and parsed in
+// place, so indexing a few thousand modules takes milliseconds rather than
+// a walk over /lib/modules; lookups after that are hash lookups.
+class ModuleIndex
+{
+public:
+    ModuleIndex();
+
+    // Reads /lib/modules/<release>. Only modules.dep is required; without
+    // the other files there are no built-in modules or aliases.
+    bool load(const QString &release, QString &error);
+    bool loadDirectory(const QString &directory, QString &error);
+
+    QString directory() const { return m_directory; }
+    // When depmod last wrote modules.dep, as of load()
+    QDateTime modified() const { return m_modified; }
+    bool isEmpty() const { return m_modules.isEmpty(); }
+    // Every module, sorted by name
+    const QVector<KernelModule> &modules() const { return m_modules; }
+
+    // By name, with '-' and '_' the same as for modprobe; nullptr if unknown
+    const KernelModule *find(const QString &name) const;
+    // The module an alias such as "fs-vfat" or a modalias from sysfs
+    // resolves to, wildcard aliases included; nullptr if none
+    const KernelModule *findByAlias(const QString &alias) const;
+    // Modules whose name starts with prefix, sorted; all of them for ""
+    QVector<const KernelModule *> search(const QString &prefix) const;
+    // Where a loadable module's file is
+    QString absolutePath(const KernelModule &module) const;
+
+    // "snd-soc-core" -> "snd_soc_core"
+    static QString normalizedName(const QString &name);
+
+private:
+    QString m_directory;
+    QDateTime m_modified;
+    QVector<KernelModule> m_modules;
+    QHash<QString, int> m_byName;
+    QHash<QString, int> m_byAlias;                  // Aliases without wildcards
+    QVector<QPair<QByteArray, int>> m_wildcardAliases;
+};
+
+#endif // MODULEINDEX_H
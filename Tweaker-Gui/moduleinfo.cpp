@@ -0,0 +1,244 @@
+#include "moduleinfo.h"
+#include "imagedecompressor.h"
+#include <QFile>
+#include <QtEndian>
+
+#include <cstring>
+
+namespace {
+
+const int kElfClass = 4;
+const int kElfData = 5;
+const char kElfClass32 = 1;
+const char kElfClass64 = 2;
+const char kElfDataLittle = 1;
+const char kElfDataBig = 2;
+const qint64 kReadChunk = 1024 * 1024;
+
+// The ELF header and section header fields used here, which only differ
+// between ELF32 and ELF64 in where they are and how wide
+class ElfReader
+{
+public:
+    explicit ElfReader(const QByteArray &image)
+        : m_data(reinterpret_cast<const uchar *>(image.constData()))
+        , m_size(quint64(image.size()))
+        , m_is64(image.size() > kElfClass && image.at(kElfClass) == kElfClass64)
+        , m_bigEndian(image.size() > kElfData && image.at(kElfData) == kElfDataBig)
+    {
+    }
+
+    bool is64() const { return m_is64; }
+    quint64 size() const { return m_size; }
+    const char *at(quint64 offset) const { return reinterpret_cast<const char *>(m_data + offset); }
+
+    // Bounds are the caller's to check
+    template <typename T>
+    T field(quint64 offset) const
+    {
+        return m_bigEndian ? qFromBigEndian<T>(m_data + offset) : qFromLittleEndian<T>(m_data + offset);
+    }
+
+    // Address-sized: 4 bytes in ELF32, 8 in ELF64
+    quint64 word(quint64 offset) const
+    {
+        return m_is64 ? field<quint64>(offset) : field<quint32>(offset);
+    }
+
+private:
+    const uchar *m_data;
+    quint64 m_size;
+    bool m_is64;
+    bool m_bigEndian;
+};
+
+// Finds the .modinfo section; false if the image is not an ELF file
+// or has none
+bool findModinfo(const QByteArray &image, const char *&begin, const char *&end, QString &error)
+{
+    if (image.size() < 52 || memcmp(image.constData(), "\x7F" "ELF", 4) != 0) {
+        error = "Not an ELF file";
+        return false;
+    }
+    char elfClass = image.at(kElfClass);
+    char elfData = image.at(kElfData);
+    if ((elfClass != kElfClass32 && elfClass != kElfClass64) || (elfData != kElfDataLittle && elfData != kElfDataBig)) {
+        error = "Unknown ELF class or byte order";
+        return false;
+    }
+
+    ElfReader elf(image);
+    if (elf.is64() && elf.size() < 64) {
+        error = "Truncated ELF header";
+        return false;
+    }
+    quint64 sectionOffset = elf.word(elf.is64() ? 0x28 : 0x20);
+    quint16 sectionSize = elf.field<quint16>(elf.is64() ? 0x3A : 0x2E);
+    quint16 sectionCount = elf.field<quint16>(elf.is64() ? 0x3C : 0x30);
+    quint16 namesIndex = elf.field<quint16>(elf.is64() ? 0x3E : 0x32);
+    quint64 minimumSize = elf.is64() ? 64 : 40;
+    if (sectionSize < minimumSize || namesIndex >= sectionCount || sectionOffset > elf.size()
+        || quint64(sectionCount) * sectionSize > elf.size() - sectionOffset) {
+        error = "Bad section header table";
+        return false;
+    }
+
+    // sh_name, sh_offset and sh_size of section index
+    auto header = [&](int index, quint32 &name, quint64 &offset, quint64 &size) {
+        quint64 base = sectionOffset + quint64(index) * sectionSize;
+        name = elf.field<quint32>(base);
+        offset = elf.word(base + (elf.is64() ? 0x18 : 0x10));
+        size = elf.word(base + (elf.is64() ? 0x20 : 0x14));
+        return offset <= elf.size() && size <= elf.size() - offset;
+    };
+
+    quint32 unused;
+    quint64 namesOffset;
+    quint64 namesSize;
+    if (!header(namesIndex, unused, namesOffset, namesSize)) {
+        error = "Bad section name table";
+        return false;
+    }
+
+    static const char kModinfo[] = ".modinfo";
+    for (int i = 0; i < sectionCount; ++i) {
+        quint32 name;
+        quint64 offset;
+        quint64 size;
+        if (!header(i, name, offset, size) || name >= namesSize) continue;
+        if (namesSize - name < sizeof(kModinfo) || memcmp(elf.at(namesOffset + name), kModinfo, sizeof(kModinfo)) != 0) {
+            continue;
+        }
+        begin = elf.at(offset);
+        end = begin + size;
+        return true;
+    }
+    error = "No .modinfo section";
+    return false;
+}
+
+// The parameter called name, added if not seen yet; parm= and parmtype=
+// come as separate entries
+ModuleParameter &parameter(QVector<ModuleParameter> &parameters, const QString &name)
+{
+    for (ModuleParameter &existing : parameters) {
+        if (existing.name == name) return existing;
+    }
+    parameters.append(ModuleParameter{ name, QString(), QString() });
+    return parameters.last();
+}
+
+} // namespace
+
+bool ModuleInfo::parse(const QByteArray &image, ModuleInfo &info, QString &error)
+{
+    const char *entry = nullptr;
+    const char *end = nullptr;
+    if (!findModinfo(image, entry, end, error)) return false;
+
+    // "license=GPL\0parm=debug:Enable debug output\0..." with padding NULs
+    while (entry < end) {
+        const char *entryEnd = static_cast<const char *>(memchr(entry, '\0', end - entry));
+        if (!entryEnd) entryEnd = end;
+        const char *equals = static_cast<const char *>(memchr(entry, '=', entryEnd - entry));
+        if (equals) {
+            QByteArray key(entry, int(equals - entry));
+            QString value = QString::fromUtf8(equals + 1, int(entryEnd - equals - 1));
+            if (key == "description") {
+                info.description = value;
+            } else if (key == "author") {
+                info.authors.append(value);
+            } else if (key == "license") {
+                info.license = value;
+            } else if (key == "version") {
+                info.version = value;
+            } else if (key == "srcversion") {
+                info.srcversion = value;
+            } else if (key == "vermagic") {
+                info.vermagic = value;
+            } else if (key == "depends") {
+                info.depends = value.split(',', QString::SkipEmptyParts);
+            } else if (key == "alias") {
+                info.aliases.append(value);
+            } else if (key == "firmware") {
+                info.firmware.append(value);
+            } else if (key == "parm" || key == "parmtype") {
+                // "name:text"
+                int colon = value.indexOf(':');
+                ModuleParameter &target = parameter(info.parameters, value.left(colon));
+                QString text = colon < 0 ? QString() : value.mid(colon + 1);
+                if (key == "parm") target.description = text;
+                else target.type = text;
+            }
+        }
+        entry = entryEnd + 1;
+    }
+    return true;
+}
+
+bool ModuleInfo::readImage(const QString &path, QByteArray &image, QString &error)
+{
+    ImageDecompressor::Format format = ImageDecompressor::detectFormat(path);
+    if (format == ImageDecompressor::Uncompressed) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            error = QString("Cannot open %1: %2").arg(path, file.errorString());
+            return false;
+        }
+        image = file.readAll();
+        return true;
+    }
+
+    ImageDecompressor decompressor;
+    if (!decompressor.open(path, error)) return false;
+    image.clear();
+    if (decompressor.uncompressedSize() > 0) {
+        image.reserve(int(decompressor.uncompressedSize()));
+    }
+    while (true) {
+        int used = image.size();
+        image.resize(used + int(kReadChunk));
+        qint64 n = decompressor.read(image.data() + used, kReadChunk, error);
+        if (n < 0) return false;
+        image.resize(used + int(n));
+        if (n < kReadChunk) return true;
+    }
+}
+
+bool ModuleInfo::read(const QString &path, ModuleInfo &info, QString &error)
+{
+    QByteArray image;
+    if (!readImage(path, image, error)) return false;
+    info.filename = path;
+    if (!parse(image, info, error)) {
+        error = QString("%1: %2").arg(path, error);
+        return false;
+    }
+    return true;
+}
+
+QString ModuleInfo::text() const
+{
+    QStringList lines;
+    auto add = [&lines](const QString &key, const QString &value) {
+        if (!value.isEmpty()) lines << QString("%1%2").arg(key + ":", -16).arg(value);
+    };
+
+    add("filename", filename);
+    add("version", version);
+    add("description", description);
+    for (const QString &author : authors) add("author", author);
+    add("license", license);
+    add("srcversion", srcversion);
+    for (const QString &alias : aliases) add("alias", alias);
+    for (const QString &file : firmware) add("firmware", file);
+    // depends is printed even when empty, like modinfo does
+    lines << QString("%1%2").arg(QString("depends:"), -16).arg(depends.join(","));
+    add("vermagic", vermagic);
+    for (const ModuleParameter &parm : parameters) {
+        QString value = parm.name + ":" + parm.description;
+        if (!parm.type.isEmpty()) value += QString(" (%1)").arg(parm.type);
+        add("parm", value);
+    }
+    return lines.join("\n");
+}
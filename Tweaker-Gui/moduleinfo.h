@@ -0,0 +1,43 @@
+#ifndef MODULEINFO_H
+#define MODULEINFO_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+struct ModuleParameter {
+    QString name;
+    QString description;    // From parm=, may be empty
+    QString type;           // From parmtype=: "int", "charp", "array of uint"
+};
+
+// What modinfo prints about a module, read from the .modinfo section of
+// its .ko: NUL-separated key=value strings the kernel build puts there.
+// Reading it here rather than forking modinfo costs a file read (and a
+// decompression for .ko.xz / .ko.zst) and a walk over the section headers.
+struct ModuleInfo {
+    QString filename;
+    QString description;
+    QStringList authors;
+    QString license;
+    QString version;
+    QString srcversion;
+    QString vermagic;
+    QStringList depends;
+    QStringList aliases;
+    QStringList firmware;
+    QVector<ModuleParameter> parameters;
+
+    // Parses the ELF image of a module, 32 or 64 bit in either byte order
+    static bool parse(const QByteArray &image, ModuleInfo &info, QString &error);
+    // Reads path, decompressing it first if it is compressed
+    static bool read(const QString &path, ModuleInfo &info, QString &error);
+    // The module file at path as the kernel wants it, decompressed
+    static bool readImage(const QString &path, QByteArray &image, QString &error);
+
+    // Laid out as modinfo does, one "key: value" per line
+    QString text() const;
+};
+
+#endif // MODULEINFO_H
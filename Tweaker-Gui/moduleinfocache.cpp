@@ -0,0 +1,142 @@
+#include "moduleinfocache.h"
+#include "moduleindex.h"
+#include <QMutexLocker>
+#include <QThread>
+
+ModuleInfoCache::ModuleInfoCache(QObject *parent)
+    : QObject(parent)
+    , m_generation(0)
+{
+}
+
+ModuleInfoCache::~ModuleInfoCache()
+{
+    stopWorkers();
+}
+
+void ModuleInfoCache::setIndex(const ModuleIndex &index)
+{
+    if (hasIndex() && index.directory() == m_directory && index.modified() == m_modified) {
+        return;
+    }
+    stopWorkers();
+    m_directory = index.directory();
+    m_modified = index.modified();
+
+    QMutexLocker locker(&m_mutex);
+    m_modules.clear();
+    m_byName.clear();
+    m_cache.clear();
+    m_errors.clear();
+    for (const KernelModule &module : index.modules()) {
+        if (module.builtin) continue;
+        m_byName.insert(module.name, m_modules.size());
+        m_modules.append(qMakePair(module.name, index.absolutePath(module)));
+    }
+}
+
+bool ModuleInfoCache::info(const QString &name, ModuleInfo &info, QString &error)
+{
+    QString normalized = ModuleIndex::normalizedName(name);
+    QString path;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto cached = m_cache.constFind(normalized);
+        if (cached != m_cache.constEnd()) {
+            info = cached.value();
+            return true;
+        }
+        auto failed = m_errors.constFind(normalized);
+        if (failed != m_errors.constEnd()) {
+            error = failed.value();
+            return false;
+        }
+        int index = m_byName.value(normalized, -1);
+        if (index < 0) {
+            error = QString("%1 is not a loadable module of this kernel").arg(name);
+            return false;
+        }
+        path = m_modules.at(index).second;
+    }
+
+    // Outside the lock, so the workers carry on meanwhile
+    bool ok = ModuleInfo::read(path, info, error);
+    QMutexLocker locker(&m_mutex);
+    if (ok) m_cache.insert(normalized, info);
+    else m_errors.insert(normalized, error);
+    return ok;
+}
+
+bool ModuleInfoCache::contains(const QString &name) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.contains(ModuleIndex::normalizedName(name));
+}
+
+int ModuleInfoCache::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.size();
+}
+
+void ModuleInfoCache::precompute()
+{
+    if (!m_workers.isEmpty()) return;
+
+    m_next.store(0);
+    m_stopping.store(0);
+    m_precomputeTimer.start();
+
+    // Workers take the next unread module until none are left; reading is
+    // mostly decompression, so one per core
+    int count = qBound(1, QThread::idealThreadCount(), qMax(1, m_modules.size()));
+    int generation = m_generation;
+    for (int i = 0; i < count; ++i) {
+        QThread *worker = QThread::create([this]() {
+            while (!m_stopping.loadAcquire()) {
+                int index = m_next.fetchAndAddRelaxed(1);
+                if (index >= m_modules.size()) break;
+                const QPair<QString, QString> &module = m_modules.at(index);
+                {
+                    QMutexLocker locker(&m_mutex);
+                    if (m_cache.contains(module.first) || m_errors.contains(module.first)) continue;
+                }
+
+                ModuleInfo info;
+                QString error;
+                bool ok = ModuleInfo::read(module.second, info, error);
+                QMutexLocker locker(&m_mutex);
+                if (ok) m_cache.insert(module.first, info);
+                else m_errors.insert(module.first, error);
+            }
+        });
+        connect(worker, &QThread::finished, this, [this, worker, generation]() {
+            onWorkerFinished(worker, generation);
+        });
+        m_workers.append(worker);
+        worker->start(QThread::LowPriority);
+    }
+}
+
+void ModuleInfoCache::onWorkerFinished(QThread *worker, int generation)
+{
+    if (generation != m_generation) return;
+    m_workers.removeOne(worker);
+    worker->deleteLater();
+    if (m_workers.isEmpty()) {
+        emit precomputed(size(), m_precomputeTimer.elapsed());
+    }
+}
+
+void ModuleInfoCache::stopWorkers()
+{
+    if (m_workers.isEmpty()) return;
+
+    m_stopping.storeRelease(1);
+    for (QThread *worker : m_workers) {
+        worker->wait();
+        delete worker;
+    }
+    m_workers.clear();
+    ++m_generation;
+}
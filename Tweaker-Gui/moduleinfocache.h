@@ -0,0 +1,67 @@
+#ifndef MODULEINFOCACHE_H
+#define MODULEINFOCACHE_H
+
+#include "moduleinfo.h"
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QPair>
+#include <QVector>
+
+class ModuleIndex;
+class QThread;
+
+// ModuleInfo by module name, each .ko read at most once. info() reads on
+// a miss, which is quick enough for one module on a click; precompute()
+// reads the rest of the index on worker threads in the background so
+// browsing the module list never waits on a decompression.
+class ModuleInfoCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ModuleInfoCache(QObject *parent = nullptr);
+    ~ModuleInfoCache() override;
+
+    // Drops everything cached and takes the loadable modules of index,
+    // unless it is the index already taken: same directory, and depmod
+    // hasn't rewritten it since
+    void setIndex(const ModuleIndex &index);
+
+    bool info(const QString &name, ModuleInfo &info, QString &error);
+    bool hasIndex() const { return !m_modules.isEmpty(); }
+    bool contains(const QString &name) const;
+    int size() const;
+
+    // Starts reading every module not cached yet; precomputed() follows
+    void precompute();
+    bool isPrecomputing() const { return !m_workers.isEmpty(); }
+
+signals:
+    void precomputed(int modules, qint64 elapsedMs);
+
+private:
+    void onWorkerFinished(QThread *worker, int generation);
+    void stopWorkers();
+
+    // Read by the workers; stopWorkers() joins them before any of it changes
+    QVector<QPair<QString, QString>> m_modules;     // Name, absolute path
+    QHash<QString, ModuleInfo> m_cache;
+    QHash<QString, QString> m_errors;
+    QHash<QString, int> m_byName;
+    mutable QMutex m_mutex;
+    QAtomicInt m_next;
+    QAtomicInt m_stopping;
+
+    QString m_directory;        // Of the index taken, and when it was written
+    QDateTime m_modified;
+
+    QVector<QThread *> m_workers;
+    int m_generation;           // Tells finished() of stopped workers apart
+    QElapsedTimer m_precomputeTimer;
+};
+
+#endif // MODULEINFOCACHE_H
@@ -0,0 +1,396 @@
+#include "moduleloader.h"
+#include "imagedecompressor.h"
+#include "loadedmodulemonitor.h"
+#include "moduleindex.h"
+#include "moduleinfo.h"
+#include <QAtomicInt>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QSet>
+#include <QTextStream>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+namespace {
+
+// Searched in this order; a file name seen once is not read again
+const char *const kModprobeDirectories[] = { "/etc/modprobe.d", "/run/modprobe.d", "/lib/modprobe.d" };
+
+// finit_module() flag for a compressed file, Linux 5.17 and later
+const int kInitCompressedFile = 4;
+
+// Cleared the first time the kernel turns a compressed file down, after
+// which compressed modules are decompressed here
+QAtomicInt g_kernelDecompresses(1);
+
+// "options snd_hda_intel power_save=1 probe_mask=1", by module name
+QHash<QString, QByteArray> readModprobeOptions()
+{
+    QHash<QString, QByteArray> options;
+    QSet<QString> seen;
+    for (const char *directory : kModprobeDirectories) {
+        QDir dir(directory);
+        for (const QString &entry : dir.entryList(QStringList() << "*.conf", QDir::Files, QDir::Name)) {
+            if (seen.contains(entry)) continue;
+            seen.insert(entry);
+
+            QFile file(dir.filePath(entry));
+            if (!file.open(QIODevice::ReadOnly)) continue;
+            for (const QByteArray &line : file.readAll().split('\n')) {
+                QList<QByteArray> fields = line.simplified().split(' ');
+                if (fields.size() < 3 || fields.first() != "options") continue;
+
+                QString name = ModuleIndex::normalizedName(QString::fromLatin1(fields.at(1)));
+                QByteArray &moduleOptions = options[name];
+                for (int i = 2; i < fields.size(); ++i) {
+                    if (!moduleOptions.isEmpty()) moduleOptions.append(' ');
+                    moduleOptions.append(fields.at(i));
+                }
+            }
+        }
+    }
+    return options;
+}
+
+QString errnoMessage(int error)
+{
+    switch (error) {
+    case EPERM:
+        return "Not permitted: loading modules needs root";
+    case ENOEXEC:
+        return "Invalid module format (built for another kernel?)";
+    case ENOENT:
+        return "Unknown symbol in module, see dmesg";
+    case EKEYREJECTED:
+        return "Signature rejected";
+    default:
+        return QString::fromLocal8Bit(strerror(error));
+    }
+}
+
+qint64 elapsedUs(const QElapsedTimer &timer)
+{
+    return timer.nsecsElapsed() / 1000;
+}
+
+} // namespace
+
+ModuleLoader::ModuleLoader(const ModuleIndex &index)
+    : m_index(index)
+    , m_options(readModprobeOptions())
+    , m_maxConcurrent(qMax(1, QThread::idealThreadCount()))
+{
+}
+
+bool ModuleLoader::load(const QStringList &modules, QString &error)
+{
+    m_timings.clear();
+
+    QVector<LoadedModule> current;
+    if (!LoadedModuleMonitor::read(current, error)) return false;
+    QSet<QString> loaded;
+    for (const LoadedModule &module : current) {
+        loaded.insert(module.name);
+    }
+
+    // What has to be loaded, requested modules and their dependencies alike
+    QVector<const KernelModule *> nodes;
+    QHash<QString, int> nodeIndex;
+    auto add = [&](const KernelModule *module) {
+        if (module->builtin || loaded.contains(module->name) || nodeIndex.contains(module->name)) return;
+        nodeIndex.insert(module->name, nodes.size());
+        nodes.append(module);
+    };
+    for (const QString &name : modules) {
+        const KernelModule *module = m_index.find(name);
+        if (!module) module = m_index.findByAlias(name);
+        if (!module) {
+            error = QString("Module %1 not found in %2").arg(name, m_index.directory());
+            return false;
+        }
+        if (module->builtin || loaded.contains(module->name)) {
+            report(ModuleLoadTiming{ module->name, 0, true, module->builtin ? "built in" : "already loaded" });
+            continue;
+        }
+        add(module);
+        // modules.dep lists indirect dependencies too
+        for (const QString &dependency : module->dependencies) {
+            const KernelModule *required = m_index.find(dependency);
+            if (required) add(required);
+        }
+    }
+    if (nodes.isEmpty()) return true;
+
+    // Each module waits for the dependencies being loaded with it. The
+    // lists are transitive, which orders nothing differently from waiting
+    // on direct dependencies only.
+    struct Node {
+        int waiting;
+        QVector<int> dependents;
+        QString failedDependency;
+    };
+    QVector<Node> graph(nodes.size());
+    QQueue<int> ready;
+    for (int i = 0; i < nodes.size(); ++i) {
+        graph[i].waiting = 0;
+        for (const QString &dependency : nodes.at(i)->dependencies) {
+            int j = nodeIndex.value(dependency, -1);
+            if (j >= 0) {
+                ++graph[i].waiting;
+                graph[j].dependents.append(i);
+            }
+        }
+        if (graph.at(i).waiting == 0) ready.enqueue(i);
+    }
+
+    QMutex mutex;
+    QWaitCondition changed;
+    int remaining = nodes.size();
+    int inFlight = 0;
+    bool circular = false;
+
+    // Called with mutex held
+    auto complete = [&](int i, bool ok) {
+        --remaining;
+        for (int dependent : graph.at(i).dependents) {
+            if (!ok && graph.at(dependent).failedDependency.isEmpty()) {
+                graph[dependent].failedDependency = nodes.at(i)->name;
+            }
+            if (--graph[dependent].waiting == 0) ready.enqueue(dependent);
+        }
+        changed.wakeAll();
+    };
+
+    auto work = [&]() {
+        QMutexLocker locker(&mutex);
+        while (remaining > 0) {
+            if (ready.isEmpty()) {
+                // Nothing ready and nothing running would be a cycle
+                if (inFlight == 0) {
+                    circular = true;
+                    remaining = 0;
+                    changed.wakeAll();
+                    break;
+                }
+                changed.wait(&mutex);
+                continue;
+            }
+
+            int i = ready.dequeue();
+            const KernelModule *module = nodes.at(i);
+            if (!graph.at(i).failedDependency.isEmpty()) {
+                report(ModuleLoadTiming{ module->name, 0, false,
+                                         QString("Not loaded: %1 failed").arg(graph.at(i).failedDependency) });
+                complete(i, false);
+                continue;
+            }
+
+            ++inFlight;
+            QString path = m_index.absolutePath(*module);
+            QByteArray parameters = m_options.value(module->name);
+            locker.unlock();
+
+            QElapsedTimer timer;
+            timer.start();
+            QString loadError;
+            bool ok = loadModule(path, parameters, loadError);
+            qint64 elapsed = elapsedUs(timer);
+
+            locker.relock();
+            --inFlight;
+            report(ModuleLoadTiming{ module->name, elapsed, ok, loadError });
+            complete(i, ok);
+        }
+    };
+
+    int threadCount = qMin(m_maxConcurrent, nodes.size());
+    QVector<QThread *> workers;
+    for (int i = 1; i < threadCount; ++i) {
+        QThread *worker = QThread::create(work);
+        workers.append(worker);
+        worker->start();
+    }
+    work();
+    for (QThread *worker : workers) {
+        worker->wait();
+        delete worker;
+    }
+
+    if (circular) {
+        error = "Circular module dependencies in modules.dep";
+        return false;
+    }
+    for (const ModuleLoadTiming &timing : m_timings) {
+        if (!timing.succeeded) {
+            error = QString("%1: %2").arg(timing.name, timing.message);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ModuleLoader::unload(const QStringList &modules, QString &error)
+{
+    m_timings.clear();
+
+    QStringList dependencies;
+    bool ok = true;
+    for (const QString &name : modules) {
+        const KernelModule *module = m_index.find(name);
+        QString moduleName = module ? module->name : ModuleIndex::normalizedName(name);
+        if (module) dependencies << module->dependencies;
+
+        QString unloadError;
+        if (!unloadModule(moduleName, unloadError)) {
+            error = QString("%1: %2").arg(moduleName, unloadError);
+            ok = false;
+        }
+    }
+
+    // Dependencies nobody uses any more go too. Removing one can free
+    // another, so this goes round until a pass removes nothing.
+    bool removed = ok;
+    while (removed) {
+        removed = false;
+        QVector<LoadedModule> current;
+        QString readError;
+        if (!LoadedModuleMonitor::read(current, readError)) break;
+
+        for (const LoadedModule &module : current) {
+            if (module.refcount != 0 || !module.users.isEmpty() || !dependencies.contains(module.name)) continue;
+            dependencies.removeAll(module.name);
+            QString unloadError;
+            if (unloadModule(module.name, unloadError)) removed = true;
+        }
+    }
+    return ok;
+}
+
+bool ModuleLoader::loadModule(const QString &path, const QByteArray &parameters, QString &error)
+{
+    int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = QString("Cannot open %1: %2").arg(path, QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+
+    // The kernel reads the file itself, decompressing it if it can
+    bool compressed = ImageDecompressor::detectFormat(path) != ImageDecompressor::Uncompressed;
+    long result = -1;
+    int loadErrno = 0;
+    if (!compressed || g_kernelDecompresses.loadAcquire()) {
+        result = syscall(SYS_finit_module, fd, parameters.constData(), compressed ? kInitCompressedFile : 0);
+        loadErrno = errno;
+        if (result != 0 && compressed && (loadErrno == EINVAL || loadErrno == EOPNOTSUPP)) {
+            g_kernelDecompresses.storeRelease(0);
+        }
+    }
+    ::close(fd);
+
+    if (result != 0 && compressed && !g_kernelDecompresses.loadAcquire()) {
+        QByteArray image;
+        if (!ModuleInfo::readImage(path, image, error)) return false;
+        result = syscall(SYS_init_module, image.constData(), static_cast<unsigned long>(image.size()),
+                         parameters.constData());
+        loadErrno = errno;
+    }
+
+    // Loaded meanwhile by udev or another job
+    if (result == 0 || loadErrno == EEXIST) return true;
+    error = errnoMessage(loadErrno);
+    return false;
+}
+
+bool ModuleLoader::unloadModule(const QString &name, QString &error)
+{
+    QElapsedTimer timer;
+    timer.start();
+    // Refuse instead of waiting for the module to become unused
+    long result = syscall(SYS_delete_module, name.toLatin1().constData(), O_NONBLOCK);
+    int unloadErrno = errno;
+    qint64 elapsed = elapsedUs(timer);
+
+    if (result != 0) {
+        if (unloadErrno == EWOULDBLOCK || unloadErrno == EBUSY) {
+            error = "In use";
+            QVector<LoadedModule> current;
+            QString readError;
+            if (LoadedModuleMonitor::read(current, readError)) {
+                for (const LoadedModule &module : current) {
+                    if (module.name == name && !module.users.isEmpty()) {
+                        error = QString("In use by %1").arg(module.users.join(", "));
+                    }
+                }
+            }
+        } else if (unloadErrno == ENOENT) {
+            error = "Not loaded";
+        } else {
+            error = errnoMessage(unloadErrno);
+        }
+    }
+    report(ModuleLoadTiming{ name, elapsed, result == 0, result == 0 ? QString() : error });
+    return result == 0;
+}
+
+void ModuleLoader::report(const ModuleLoadTiming &timing)
+{
+    m_timings.append(timing);
+    if (m_reporter) m_reporter(timing);
+}
+
+int runModuleLoader(bool unload, const QStringList &modules)
+{
+    QTextStream out(stdout);
+
+    struct utsname system;
+    if (uname(&system) != 0) {
+        out << "Cannot tell which kernel is running\n";
+        return 1;
+    }
+    ModuleIndex index;
+    QString error;
+    if (!index.load(QString::fromLatin1(system.release), error)) {
+        out << error << "\n";
+        return 1;
+    }
+
+    // One line per module as it finishes, so a caller can show them live
+    ModuleLoader loader(index);
+    loader.setReporter([&out](const ModuleLoadTiming &timing) {
+        out << (timing.succeeded ? "✅ " : "❌ ") << timing.name;
+        if (timing.elapsedUs > 0) {
+            out << QString(" %1 ms").arg(timing.elapsedUs / 1000.0, 0, 'f', 1);
+        }
+        if (!timing.message.isEmpty()) {
+            out << " (" << timing.message << ")";
+        }
+        out << "\n";
+        out.flush();
+    });
+
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = unload ? loader.unload(modules, error) : loader.load(modules, error);
+
+    int done = 0;
+    for (const ModuleLoadTiming &timing : loader.timings()) {
+        if (timing.succeeded && timing.elapsedUs > 0) ++done;
+    }
+    out << QString("%1 %2 modules in %3 ms")
+               .arg(unload ? "Unloaded" : "Loaded").arg(done).arg(timer.elapsed()) << "\n";
+    if (!ok) {
+        out << error << "\n";
+    }
+    return ok ? 0 : 1;
+}
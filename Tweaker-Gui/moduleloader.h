@@ -0,0 +1,65 @@
+#ifndef MODULELOADER_H
+#define MODULELOADER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <functional>
+
+class ModuleIndex;
+
+struct ModuleLoadTiming {
+    QString name;
+    qint64 elapsedUs;       // Reading, decompressing and the syscall
+    bool succeeded;
+    QString message;        // Why it failed, or why nothing was done
+};
+
+// Loads modules with finit_module() and unloads them with delete_module(),
+// the calls modprobe makes, without a process per module. A load takes the
+// requested modules and everything modules.dep says they need that isn't
+// loaded yet; each module waits only for its own dependencies, so
+// independent branches load side by side on a few threads. Options come
+// from modprobe.d like they would for modprobe; install and softdep rules
+// are not followed. Compressed modules go to the kernel as they are on
+// Linux 5.17 and later and are decompressed here before that. Needs
+// CAP_SYS_MODULE.
+class ModuleLoader
+{
+public:
+    explicit ModuleLoader(const ModuleIndex &index);
+
+    // Called as each module finishes, from the thread that loaded it, one
+    // call at a time
+    void setReporter(const std::function<void(const ModuleLoadTiming &)> &reporter) { m_reporter = reporter; }
+    // Modules in flight at once; 1 loads them one after another
+    void setMaxConcurrent(int count) { m_maxConcurrent = qMax(1, count); }
+
+    // By name or alias; false if any module failed
+    bool load(const QStringList &modules, QString &error);
+    // Then, like modprobe -r, the dependencies nothing uses any more
+    bool unload(const QStringList &modules, QString &error);
+
+    // Every module touched by the last load() or unload(), in finishing order
+    const QVector<ModuleLoadTiming> &timings() const { return m_timings; }
+
+private:
+    bool loadModule(const QString &path, const QByteArray &parameters, QString &error);
+    bool unloadModule(const QString &name, QString &error);
+    void report(const ModuleLoadTiming &timing);
+
+    const ModuleIndex &m_index;
+    QHash<QString, QByteArray> m_options;   // By module name, from modprobe.d
+    std::function<void(const ModuleLoadTiming &)> m_reporter;
+    int m_maxConcurrent;
+    QVector<ModuleLoadTiming> m_timings;
+};
+
+// Headless: --load-modules / --unload-modules <module>..., run as root.
+// Prints a line per module with its time and returns the exit code.
+int runModuleLoader(bool unload, const QStringList &modules);
+
+#endif // MODULELOADER_H
@@ -0,0 +1,279 @@
+#include "partitiontable.h"
+#include <QtEndian>
+
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+const char kGptSignature[] = "EFI PART";
+const int kMbrEntryOffset = 446;
+const int kGptHeaderMinSize = 92;
+
+// Sector I/O goes through 4 KiB aligned memory so it also works on O_DIRECT descriptors
+class SectorBuffer
+{
+public:
+    explicit SectorBuffer(qint64 size)
+        : m_data(nullptr)
+        , m_size(size)
+    {
+        void *memory = nullptr;
+        if (posix_memalign(&memory, 4096, size) == 0) {
+            m_data = static_cast<unsigned char *>(memory);
+            memset(m_data, 0, size);
+        }
+    }
+    ~SectorBuffer() { free(m_data); }
+
+    unsigned char *data() const { return m_data; }
+    qint64 size() const { return m_size; }
+    bool isValid() const { return m_data != nullptr; }
+
+private:
+    unsigned char *m_data;
+    qint64 m_size;
+};
+
+bool readAt(int fd, SectorBuffer &buffer, qint64 offset)
+{
+    qint64 done = 0;
+    while (done < buffer.size()) {
+        ssize_t n = ::pread(fd, buffer.data() + done, buffer.size() - done, offset + done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+bool writeAt(int fd, const SectorBuffer &buffer, qint64 offset)
+{
+    qint64 done = 0;
+    while (done < buffer.size()) {
+        ssize_t n = ::pwrite(fd, buffer.data() + done, buffer.size() - done, offset + done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+QString guidToString(const unsigned char *guid)
+{
+    // Mixed-endian: first three fields little endian, rest big endian
+    return QString("%1-%2-%3-%4-%5")
+        .arg(qFromLittleEndian<quint32>(guid), 8, 16, QChar('0'))
+        .arg(qFromLittleEndian<quint16>(guid + 4), 4, 16, QChar('0'))
+        .arg(qFromLittleEndian<quint16>(guid + 6), 4, 16, QChar('0'))
+        .arg(QString(QByteArray(reinterpret_cast<const char *>(guid + 8), 2).toHex()))
+        .arg(QString(QByteArray(reinterpret_cast<const char *>(guid + 10), 6).toHex()))
+        .toUpper();
+}
+
+bool isExtendedMbrType(quint8 type)
+{
+    return type == 0x05 || type == 0x0F || type == 0x85;
+}
+
+void updateHeaderCrc(unsigned char *header)
+{
+    quint32 headerSize = qFromLittleEndian<quint32>(header + 12);
+    qToLittleEndian<quint32>(0, header + 16);
+    qToLittleEndian<quint32>(PartitionTable::crc32(header, headerSize), header + 16);
+}
+
+} // namespace
+
+PartitionTable::PartitionTable()
+    : m_isGpt(false)
+    , m_sectorSize(512)
+    , m_diskSize(0)
+    , m_gptEntryBytes(0)
+{
+}
+
+quint32 PartitionTable::crc32(const unsigned char *data, qint64 length)
+{
+    static quint32 table[256];
+    static bool tableReady = false;
+    if (!tableReady) {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+
+    quint32 crc = 0xFFFFFFFFu;
+    for (qint64 i = 0; i < length; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+bool PartitionTable::read(int fd, qint64 diskSize, int sectorSize)
+{
+    m_isGpt = false;
+    m_sectorSize = sectorSize;
+    m_diskSize = diskSize;
+    m_gptEntryBytes = 0;
+    m_partitions.clear();
+    m_error.clear();
+
+    SectorBuffer mbr(qMax(sectorSize, 512));
+    if (!mbr.isValid() || !readAt(fd, mbr, 0)) {
+        m_error = "Failed to read partition table";
+        return false;
+    }
+    if (mbr.data()[510] != 0x55 || mbr.data()[511] != 0xAA) {
+        m_error = "No MBR or GPT partition table found";
+        return false;
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        const unsigned char *entry = mbr.data() + kMbrEntryOffset + i * 16;
+        quint8 type = entry[4];
+        if (type == 0xEE) {
+            return readGpt(fd);
+        }
+        quint32 startLba = qFromLittleEndian<quint32>(entry + 8);
+        quint32 sectors = qFromLittleEndian<quint32>(entry + 12);
+        if (type == 0 || sectors == 0) continue;
+
+        // Logical partitions inside an extended one are not parsed; the
+        // extended partition is reported as a whole
+        PartitionEntry partition;
+        partition.number = i + 1;
+        partition.offset = qint64(startLba) * sectorSize;
+        partition.size = qint64(sectors) * sectorSize;
+        partition.type = QString("0x%1%2").arg(type, 2, 16, QChar('0'))
+                             .arg(isExtendedMbrType(type) ? " (extended)" : "");
+        m_partitions.append(partition);
+    }
+    return true;
+}
+
+bool PartitionTable::readGpt(int fd)
+{
+    SectorBuffer header(m_sectorSize);
+    if (!header.isValid() || !readAt(fd, header, m_sectorSize)) {
+        m_error = "Failed to read GPT header";
+        return false;
+    }
+    const unsigned char *h = header.data();
+    if (memcmp(h, kGptSignature, 8) != 0) {
+        m_error = "Protective MBR found but GPT header is missing";
+        return false;
+    }
+
+    quint64 entryLba = qFromLittleEndian<quint64>(h + 72);
+    quint32 entryCount = qFromLittleEndian<quint32>(h + 80);
+    quint32 entrySize = qFromLittleEndian<quint32>(h + 84);
+    if (entrySize < 128 || entryCount == 0 || entryCount > 1024) {
+        m_error = "Invalid GPT partition entry array";
+        return false;
+    }
+
+    m_gptEntryBytes = qint64(entryCount) * entrySize;
+    qint64 entryBytes = ((m_gptEntryBytes + m_sectorSize - 1) / m_sectorSize) * m_sectorSize;
+    SectorBuffer entries(entryBytes);
+    if (!entries.isValid() || !readAt(fd, entries, qint64(entryLba) * m_sectorSize)) {
+        m_error = "Failed to read GPT partition entries";
+        return false;
+    }
+
+    for (quint32 i = 0; i < entryCount; ++i) {
+        const unsigned char *entry = entries.data() + qint64(i) * entrySize;
+        bool empty = true;
+        for (int k = 0; k < 16 && empty; ++k) {
+            empty = (entry[k] == 0);
+        }
+        if (empty) continue;
+
+        quint64 firstLba = qFromLittleEndian<quint64>(entry + 32);
+        quint64 lastLba = qFromLittleEndian<quint64>(entry + 40);
+        if (lastLba < firstLba) continue;
+
+        PartitionEntry partition;
+        partition.number = int(i) + 1;
+        partition.offset = qint64(firstLba) * m_sectorSize;
+        partition.size = qint64(lastLba - firstLba + 1) * m_sectorSize;
+        partition.type = guidToString(entry);
+        m_partitions.append(partition);
+    }
+
+    m_isGpt = true;
+    return true;
+}
+
+qint64 PartitionTable::backupGptSize() const
+{
+    if (!m_isGpt) return 0;
+    qint64 entrySectors = (m_gptEntryBytes + m_sectorSize - 1) / m_sectorSize;
+    return (entrySectors + 1) * m_sectorSize;
+}
+
+bool PartitionTable::relocateBackupGpt(int fd, qint64 deviceSize, int sectorSize, QString &error)
+{
+    SectorBuffer header(sectorSize);
+    if (!header.isValid() || !readAt(fd, header, sectorSize)) {
+        error = "Failed to read GPT header from target";
+        return false;
+    }
+    unsigned char *h = header.data();
+    if (memcmp(h, kGptSignature, 8) != 0 || qFromLittleEndian<quint32>(h + 12) < quint32(kGptHeaderMinSize)) {
+        error = "Target has no valid GPT header";
+        return false;
+    }
+
+    quint64 entryLba = qFromLittleEndian<quint64>(h + 72);
+    qint64 entryArrayBytes = qint64(qFromLittleEndian<quint32>(h + 80)) * qFromLittleEndian<quint32>(h + 84);
+    qint64 entrySectors = (entryArrayBytes + sectorSize - 1) / sectorSize;
+
+    SectorBuffer entries(entrySectors * sectorSize);
+    if (!entries.isValid() || !readAt(fd, entries, qint64(entryLba) * sectorSize)) {
+        error = "Failed to read GPT partition entries from target";
+        return false;
+    }
+
+    quint64 lastLba = quint64(deviceSize / sectorSize) - 1;
+    quint64 backupEntryLba = lastLba - entrySectors;
+
+    // Primary header now points at the end of the new disk
+    qToLittleEndian<quint64>(lastLba, h + 32);
+    qToLittleEndian<quint64>(backupEntryLba - 1, h + 48);
+    updateHeaderCrc(h);
+    if (!writeAt(fd, header, sectorSize)) {
+        error = QString("Failed to write primary GPT header: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+
+    // Backup header mirrors it with my/alternate swapped
+    qToLittleEndian<quint64>(lastLba, h + 24);
+    qToLittleEndian<quint64>(1, h + 32);
+    qToLittleEndian<quint64>(backupEntryLba, h + 72);
+    updateHeaderCrc(h);
+    if (!writeAt(fd, entries, qint64(backupEntryLba) * sectorSize) ||
+        !writeAt(fd, header, qint64(lastLba) * sectorSize)) {
+        error = QString("Failed to write backup GPT: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+
+    // Protective MBR covers the whole disk (capped at 2 TiB)
+    SectorBuffer mbr(sectorSize);
+    if (mbr.isValid() && readAt(fd, mbr, 0) && mbr.data()[kMbrEntryOffset + 4] == 0xEE) {
+        quint32 sectors = quint32(qMin<quint64>(lastLba, 0xFFFFFFFFu));
+        qToLittleEndian<quint32>(sectors, mbr.data() + kMbrEntryOffset + 12);
+        if (!writeAt(fd, mbr, 0)) {
+            error = "Failed to update protective MBR";
+            return false;
+        }
+    }
+    return true;
+}
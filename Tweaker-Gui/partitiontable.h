@@ -0,0 +1,47 @@
+#ifndef PARTITIONTABLE_H
+#define PARTITIONTABLE_H
+
+#include <QString>
+#include <QVector>
+
+struct PartitionEntry {
+    int number;             // 1-based, as in /dev/sdaN
+    qint64 offset;          // Bytes from start of disk
+    qint64 size;            // Bytes
+    QString type;           // MBR type byte or GPT type GUID
+};
+
+// Reads the MBR / GPT partition table of a disk image or block device
+class PartitionTable
+{
+public:
+    PartitionTable();
+
+    bool read(int fd, qint64 diskSize, int sectorSize = 512);
+
+    bool isGpt() const { return m_isGpt; }
+    int sectorSize() const { return m_sectorSize; }
+    QVector<PartitionEntry> partitions() const { return m_partitions; }
+    QString errorString() const { return m_error; }
+
+    // Bytes taken by the backup GPT (entry array + header) at the end of the disk
+    qint64 backupGptSize() const;
+
+    // Rewrite the primary GPT header and the backup GPT so they describe a
+    // disk of deviceSize bytes (after cloning onto a differently sized disk)
+    static bool relocateBackupGpt(int fd, qint64 deviceSize, int sectorSize, QString &error);
+
+    static quint32 crc32(const unsigned char *data, qint64 length);
+
+private:
+    bool readGpt(int fd);
+
+    bool m_isGpt;
+    int m_sectorSize;
+    qint64 m_diskSize;
+    qint64 m_gptEntryBytes;
+    QVector<PartitionEntry> m_partitions;
+    QString m_error;
+};
+
+#endif // PARTITIONTABLE_H
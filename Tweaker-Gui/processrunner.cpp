@@ -0,0 +1,183 @@
+#include "processrunner.h"
+
+namespace {
+
+const int kKillGraceMs = 3000;      // SIGTERM to SIGKILL
+
+// Hands each complete line in buffer past start to emitLine and moves start
+// to the beginning of the first incomplete one; with flush, that too
+template<typename EmitLine>
+void streamLines(const QByteArray &buffer, int &start, bool flush, EmitLine emitLine)
+{
+    int end;
+    while ((end = buffer.indexOf('\n', start)) >= 0) {
+        int length = end - start;
+        if (length > 0 && buffer.at(end - 1) == '\r') --length;
+        emitLine(QString::fromUtf8(buffer.constData() + start, length));
+        start = end + 1;
+    }
+    if (flush && start < buffer.size()) {
+        emitLine(QString::fromUtf8(buffer.constData() + start, buffer.size() - start));
+        start = buffer.size();
+    }
+}
+
+} // namespace
+
+QString ProcessResult::errorMessage() const
+{
+    if (!started) return errorString.isEmpty() ? QString("Process failed to start") : errorString;
+    if (cancelled) return "Cancelled";
+    if (timedOut) return "Timed out";
+    if (crashed) return "Process crashed";
+
+    QString error = QString::fromUtf8(standardError).trimmed();
+    if (!error.isEmpty()) return error;
+    return QString("Exited with code %1").arg(exitCode);
+}
+
+ProcessRunner::ProcessRunner(QObject *parent)
+    : QObject(parent)
+    , m_process(new QProcess(this))
+    , m_timeoutMs(0)
+    , m_running(false)
+    , m_outputLineStart(0)
+    , m_errorLineStart(0)
+{
+    m_timeoutTimer.setSingleShot(true);
+    m_killTimer.setSingleShot(true);
+    m_killTimer.setInterval(kKillGraceMs);
+
+    connect(m_process, &QProcess::readyReadStandardOutput, this, &ProcessRunner::onReadyReadOutput);
+    connect(m_process, &QProcess::readyReadStandardError, this, &ProcessRunner::onReadyReadError);
+    connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &ProcessRunner::onProcessFinished);
+    // Queued so a program that can't be started still reports after start()
+    // has returned, like every other outcome
+    connect(m_process, &QProcess::errorOccurred, this, &ProcessRunner::onProcessError, Qt::QueuedConnection);
+    connect(&m_timeoutTimer, &QTimer::timeout, this, &ProcessRunner::onTimeout);
+    connect(&m_killTimer, &QTimer::timeout, m_process, &QProcess::kill);
+}
+
+ProcessRunner::~ProcessRunner()
+{
+    if (m_running) {
+        m_process->disconnect(this);
+        m_process->kill();
+        m_process->waitForFinished(kKillGraceMs);
+    }
+}
+
+void ProcessRunner::setProcessEnvironment(const QProcessEnvironment &environment)
+{
+    m_process->setProcessEnvironment(environment);
+}
+
+void ProcessRunner::setWorkingDirectory(const QString &directory)
+{
+    m_process->setWorkingDirectory(directory);
+}
+
+void ProcessRunner::start(const QString &program, const QStringList &arguments)
+{
+    if (m_running) return;
+
+    m_result = ProcessResult();
+    m_outputLineStart = 0;
+    m_errorLineStart = 0;
+    m_running = true;
+
+    if (m_timeoutMs > 0) {
+        m_timeoutTimer.start(m_timeoutMs);
+    }
+    m_process->start(program, arguments);
+}
+
+void ProcessRunner::cancel()
+{
+    if (!m_running || m_result.cancelled) return;
+    m_result.cancelled = true;
+    stop();
+}
+
+void ProcessRunner::onReadyReadOutput()
+{
+    m_result.standardOutput.append(m_process->readAllStandardOutput());
+    streamLines(m_result.standardOutput, m_outputLineStart, false,
+                [this](const QString &line) { emit outputLine(line); });
+}
+
+void ProcessRunner::onReadyReadError()
+{
+    m_result.standardError.append(m_process->readAllStandardError());
+    streamLines(m_result.standardError, m_errorLineStart, false,
+                [this](const QString &line) { emit errorLine(line); });
+}
+
+void ProcessRunner::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    if (!m_running) return;
+
+    // Anything still buffered arrives before the result
+    onReadyReadOutput();
+    onReadyReadError();
+
+    m_result.started = true;
+    m_result.exitCode = exitCode;
+    // Our own SIGTERM/SIGKILL is reported as what caused it, not a crash
+    m_result.crashed = exitStatus == QProcess::CrashExit && !m_result.cancelled && !m_result.timedOut;
+    finish();
+}
+
+void ProcessRunner::onProcessError(QProcess::ProcessError error)
+{
+    // Everything else ends in finished() as well
+    if (error != QProcess::FailedToStart || !m_running) return;
+
+    m_result.started = false;
+    m_result.errorString = m_process->errorString();
+    finish();
+}
+
+void ProcessRunner::onTimeout()
+{
+    if (!m_running) return;
+    m_result.timedOut = true;
+    stop();
+}
+
+void ProcessRunner::stop()
+{
+    m_timeoutTimer.stop();
+    if (m_process->state() == QProcess::NotRunning) return;
+    m_process->terminate();
+    m_killTimer.start();
+}
+
+void ProcessRunner::finish()
+{
+    m_timeoutTimer.stop();
+    m_killTimer.stop();
+
+    streamLines(m_result.standardOutput, m_outputLineStart, true,
+                [this](const QString &line) { emit outputLine(line); });
+    streamLines(m_result.standardError, m_errorLineStart, true,
+                [this](const QString &line) { emit errorLine(line); });
+
+    m_running = false;
+    emit finished();
+}
+
+ProcessRunner *ProcessRunner::run(const QString &program, const QStringList &arguments, QObject *context,
+                                  const std::function<void(const ProcessResult &)> &onFinished,
+                                  int timeoutMs)
+{
+    ProcessRunner *runner = new ProcessRunner(context);
+    runner->setTimeout(timeoutMs);
+    connect(runner, &ProcessRunner::finished, context, [runner, onFinished]() {
+        runner->deleteLater();
+        if (onFinished) onFinished(runner->result());
+    });
+    runner->start(program, arguments);
+    return runner;
+}
@@ -0,0 +1,95 @@
+#ifndef PROCESSRUNNER_H
+#define PROCESSRUNNER_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+#include <functional>
+
+// What a finished ProcessRunner command did
+struct ProcessResult {
+    bool started = false;       // False if the program could not be run at all
+    bool crashed = false;
+    bool timedOut = false;
+    bool cancelled = false;
+    int exitCode = -1;
+    QByteArray standardOutput;
+    QByteArray standardError;
+    QString errorString;        // Why it didn't start
+
+    bool succeeded() const { return started && !crashed && !timedOut && !cancelled && exitCode == 0; }
+    QString output() const { return QString::fromUtf8(standardOutput); }
+    // One line saying why the command failed: the reason it stopped, or
+    // its standard error, or its exit code
+    QString errorMessage() const;
+};
+
+// Runs one program without blocking the event loop. Output is kept for the
+// result and also streamed a line at a time as it arrives. A timeout or
+// cancel() stops the program with SIGTERM, then SIGKILL if it hasn't gone a
+// few seconds later; finished() is emitted exactly once either way.
+//
+// Most call sites want run(), which ties the command to a context object
+// and hands the result to a continuation.
+class ProcessRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ProcessRunner(QObject *parent = nullptr);
+    // Kills the program if it is still running, without emitting finished()
+    ~ProcessRunner() override;
+
+    // In ms; 0 (the default) waits as long as it takes
+    void setTimeout(int ms) { m_timeoutMs = ms; }
+    void setProcessEnvironment(const QProcessEnvironment &environment);
+    void setWorkingDirectory(const QString &directory);
+
+    void start(const QString &program, const QStringList &arguments);
+    void cancel();
+    bool isRunning() const { return m_running; }
+
+    const ProcessResult &result() const { return m_result; }
+
+    // Starts program and calls onFinished with the result once it exits.
+    // The runner belongs to context: destroying context kills the program
+    // and onFinished is never called. The runner deletes itself after
+    // onFinished returns; the pointer is only for cancel().
+    static ProcessRunner *run(const QString &program, const QStringList &arguments, QObject *context,
+                              const std::function<void(const ProcessResult &)> &onFinished,
+                              int timeoutMs = 0);
+
+signals:
+    // Without the line ending
+    void outputLine(const QString &line);
+    void errorLine(const QString &line);
+    void finished();
+
+private slots:
+    void onReadyReadOutput();
+    void onReadyReadError();
+    void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onProcessError(QProcess::ProcessError error);
+    void onTimeout();
+
+private:
+    void stop();
+    void finish();
+
+    QProcess *m_process;
+    QTimer m_timeoutTimer;
+    QTimer m_killTimer;
+    int m_timeoutMs;
+    bool m_running;
+    ProcessResult m_result;
+
+    // Start of the line not yet streamed, in each output buffer
+    int m_outputLineStart;
+    int m_errorLineStart;
+};
+
+#endif // PROCESSRUNNER_H
@@ -0,0 +1,101 @@
+#include "processsequence.h"
+#include "processrunner.h"
+
+ProcessSequence::ProcessSequence(QObject *parent)
+    : QObject(parent)
+    , m_next(0)
+    , m_running(false)
+    , m_failed(false)
+    , m_previousFailed(false)
+    , m_current(nullptr)
+{
+}
+
+void ProcessSequence::addStep(const QString &label, const QString &program, const QStringList &arguments,
+                              int flags, int timeoutMs)
+{
+    m_steps.append(Step{ label, program, arguments, flags, timeoutMs });
+}
+
+void ProcessSequence::start()
+{
+    if (m_running) return;
+    m_next = 0;
+    m_running = true;
+    m_failed = false;
+    m_previousFailed = false;
+    m_error.clear();
+    runNext();
+}
+
+void ProcessSequence::cancel()
+{
+    if (!m_running || m_failed) return;
+    m_failed = true;
+    m_error = "Cancelled";
+
+    // A cleanup step is left to finish; anything else stops now
+    if (m_current && !(m_steps.at(m_next - 1).flags & Cleanup)) {
+        m_current->cancel();
+    }
+}
+
+void ProcessSequence::runNext()
+{
+    while (m_next < m_steps.size()) {
+        const Step &step = m_steps.at(m_next);
+        bool runs;
+        if (m_failed) {
+            runs = step.flags & Cleanup;
+        } else if (step.flags & Fallback) {
+            runs = m_previousFailed;
+        } else {
+            runs = true;
+        }
+        if (runs) break;
+        m_previousFailed = false;
+        ++m_next;
+    }
+
+    if (m_next == m_steps.size()) {
+        m_running = false;
+        emit finished(!m_failed, m_error);
+        return;
+    }
+
+    const Step &step = m_steps.at(m_next);
+    emit stepStarted(step.label, m_next * 100 / m_steps.size());
+    ++m_next;
+
+    m_current = new ProcessRunner(this);
+    m_current->setTimeout(step.timeoutMs);
+    connect(m_current, &ProcessRunner::outputLine, this, &ProcessSequence::outputLine);
+    connect(m_current, &ProcessRunner::finished, this, &ProcessSequence::onStepFinished);
+    m_current->start(step.program, step.arguments);
+}
+
+void ProcessSequence::onStepFinished()
+{
+    ProcessResult result = m_current->result();
+    m_current->deleteLater();
+    m_current = nullptr;
+
+    const Step &step = m_steps.at(m_next - 1);
+    bool succeeded = result.succeeded();
+    m_previousFailed = !succeeded;
+
+    if (!succeeded && !m_failed) {
+        QString message = QString("%1 failed: %2").arg(step.label, result.errorMessage());
+        bool hasFallback = m_next < m_steps.size() && (m_steps.at(m_next).flags & Fallback);
+        if (hasFallback) {
+            // The next step gets its chance instead
+        } else if (step.flags & Optional) {
+            emit warning(message);
+        } else {
+            m_failed = true;
+            m_error = message;
+        }
+    }
+
+    runNext();
+}
@@ -0,0 +1,72 @@
+#ifndef PROCESSSEQUENCE_H
+#define PROCESSSEQUENCE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class ProcessRunner;
+
+// Runs a list of commands one after another on ProcessRunner, for the
+// multi-step jobs (mount, copy, chroot, unmount) that used to block the GUI
+// thread one waitForFinished() at a time. The first required step to fail
+// ends the sequence, but cleanup steps still run, so a failed or cancelled
+// install doesn't leave the target mounted.
+class ProcessSequence : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum StepFlag {
+        Required = 0,   // Failing ends the sequence
+        Optional = 1,   // Failing is reported through warning() and ignored
+        Fallback = 2,   // Runs only if the step before it failed, in its place
+        Cleanup = 4     // Runs even after a failure or cancel()
+    };
+
+    explicit ProcessSequence(QObject *parent = nullptr);
+
+    // label says what the step is doing ("Copying kernel modules"); a
+    // failure is reported as "<label> failed: <reason>". timeoutMs 0 waits
+    // as long as it takes.
+    void addStep(const QString &label, const QString &program, const QStringList &arguments,
+                 int flags = Required, int timeoutMs = 0);
+    int stepCount() const { return m_steps.size(); }
+
+    void start();
+    // Stops the running step unless it is a cleanup step, then runs only
+    // what is left of the cleanup
+    void cancel();
+    bool isRunning() const { return m_running; }
+
+signals:
+    // percent is the share of steps already done
+    void stepStarted(const QString &label, int percent);
+    void outputLine(const QString &line);
+    void warning(const QString &message);
+    // error is empty on success
+    void finished(bool success, const QString &error);
+
+private:
+    struct Step {
+        QString label;
+        QString program;
+        QStringList arguments;
+        int flags;
+        int timeoutMs;
+    };
+
+    void runNext();
+    void onStepFinished();
+
+    QVector<Step> m_steps;
+    int m_next;
+    bool m_running;
+    bool m_failed;
+    bool m_previousFailed;      // The step before m_next, for Fallback
+    QString m_error;
+    ProcessRunner *m_current;
+};
+
+#endif // PROCESSSEQUENCE_H
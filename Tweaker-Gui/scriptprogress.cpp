@@ -0,0 +1,108 @@
+#include "scriptprogress.h"
+#include "transferprogress.h"
+
+#include <QStringList>
+
+namespace {
+
+const char kStepPrefix[] = "@@PROGRESS ";
+const char kDownloadPrefix[] = "dlstatus:";
+const char kInstallPrefix[] = "pmstatus:";
+
+} // namespace
+
+ScriptProgress::ScriptProgress()
+    : m_stepStartMs(0)
+    , m_step(0)
+    , m_total(1)
+    , m_percent(0)
+{
+}
+
+void ScriptProgress::start()
+{
+    m_timer.start();
+    m_steps.clear();
+    m_label.clear();
+    m_stepStartMs = 0;
+    m_step = 0;
+    m_total = 1;
+    m_percent = 0;
+}
+
+bool ScriptProgress::parseLine(const QString &line)
+{
+    if (line.startsWith(QLatin1String(kStepPrefix))) {
+        // "3/7 Updating GRUB"
+        QString rest = line.mid(int(sizeof(kStepPrefix)) - 1);
+        int space = rest.indexOf(' ');
+        QStringList counts = rest.left(space).split('/');
+        bool stepOk = false;
+        bool totalOk = false;
+        int step = counts.value(0).toInt(&stepOk);
+        int total = counts.value(1).toInt(&totalOk);
+        if (counts.size() != 2 || !stepOk || !totalOk || step < 1 || step > total) {
+            return true;
+        }
+
+        closeStep();
+        m_step = step - 1;
+        m_total = total;
+        m_label = space < 0 ? QString() : rest.mid(space + 1).trimmed();
+        m_stepStartMs = m_timer.elapsed();
+        setStepFraction(0.0);
+        return true;
+    }
+
+    bool download = line.startsWith(QLatin1String(kDownloadPrefix));
+    if (download || line.startsWith(QLatin1String(kInstallPrefix))) {
+        // The description may hold colons of its own, the percent can't
+        QStringList fields = line.split(':');
+        bool ok = false;
+        double percent = fields.value(2).toDouble(&ok);
+        if (ok) {
+            setStepFraction(download ? percent / 200.0 : 0.5 + percent / 200.0);
+        }
+        return true;
+    }
+    return false;
+}
+
+void ScriptProgress::finish()
+{
+    closeStep();
+    m_label.clear();
+}
+
+QString ScriptProgress::timingSummary() const
+{
+    QStringList parts;
+    for (const Step &step : m_steps) {
+        QString duration = TransferProgress::formatDuration(step.elapsedMs / 1000);
+        parts << QString("%1 %2").arg(step.label, duration);
+    }
+    return parts.join(", ");
+}
+
+QString ScriptProgress::shellFunctions(int steps)
+{
+    return QString(
+        "PROGRESS_STEPS=%1\n"
+        "progress() {\n"
+        "    echo \"@@PROGRESS $1/$PROGRESS_STEPS $2\"\n"
+        "}\n"
+    ).arg(steps);
+}
+
+void ScriptProgress::closeStep()
+{
+    if (m_label.isEmpty()) return;
+    m_steps.append(Step{ m_label, m_timer.elapsed() - m_stepStartMs });
+}
+
+void ScriptProgress::setStepFraction(double fraction)
+{
+    fraction = qBound(0.0, fraction, 1.0);
+    int percent = int((m_step + fraction) * 100.0 / m_total);
+    m_percent = qBound(m_percent, percent, 99);
+}
@@ -0,0 +1,58 @@
+#ifndef SCRIPTPROGRESS_H
+#define SCRIPTPROGRESS_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+
+// Follows a generated script through its output. The script announces each
+// step with a line
+//     @@PROGRESS <step>/<total> <label>
+// (shellFunctions() defines a progress helper that prints it), and apt run
+// with -o APT::Status-Fd=1 adds
+//     dlstatus:<package>:<percent>:<description>
+//     pmstatus:<package>:<percent>:<description>
+// which move the bar within the running step: downloads fill its first
+// half, dpkg the second. Output with no step lines counts as one step.
+class ScriptProgress
+{
+public:
+    struct Step {
+        QString label;
+        qint64 elapsedMs;
+    };
+
+    ScriptProgress();
+
+    void start();
+    // Whether line was progress rather than output worth showing
+    bool parseLine(const QString &line);
+    // Closes the running step, so its time is counted
+    void finish();
+
+    // 0-99 and never goes back; showing completion is left to the caller
+    int percent() const { return m_percent; }
+    // The running step; empty before the first @@PROGRESS line
+    QString label() const { return m_label; }
+    // Finished steps in order, with how long each took
+    const QVector<Step> &steps() const { return m_steps; }
+    // "Updating initramfs 0:45, Updating GRUB 0:12"
+    QString timingSummary() const;
+
+    // Bash defining "progress <step> <label>" for a script of steps steps
+    static QString shellFunctions(int steps);
+
+private:
+    void closeStep();
+    void setStepFraction(double fraction);
+
+    QElapsedTimer m_timer;
+    QVector<Step> m_steps;
+    QString m_label;
+    qint64 m_stepStartMs;
+    int m_step;         // 0-based
+    int m_total;
+    int m_percent;
+};
+
+#endif // SCRIPTPROGRESS_H
@@ -0,0 +1,194 @@
+#include "sensorregistry.h"
+#include <QDir>
+#include <QFile>
+
+#include <algorithm>
+
+namespace {
+
+const char kThermalPath[] = "/sys/class/thermal";
+const char kDevfreqPath[] = "/sys/class/devfreq";
+const char kHwmonPath[] = "/sys/class/hwmon";
+
+const qint64 kMinTemperature = 10001;       // millidegrees; below is a disabled or bogus zone
+const qint64 kMaxTemperature = 150000;
+
+// Substrings of zone types, devfreq devices and hwmon chips, checked in
+// order so that "bigcore0-thermal" is a big core rather than a generic CPU
+struct RoleKeyword {
+    const char *keyword;
+    SensorRegistry::Role role;
+};
+const RoleKeyword kRoleKeywords[] = {
+    { "little", SensorRegistry::CpuLittle },
+    { "big", SensorRegistry::CpuBig },
+    { "gpu", SensorRegistry::Gpu },         // gpu-thermal, fb000000.gpu, amdgpu
+    { "mali", SensorRegistry::Gpu },
+    { "nouveau", SensorRegistry::Gpu },
+    { "radeon", SensorRegistry::Gpu },
+    { "npu", SensorRegistry::Npu },         // npu-thermal, fdab0000.npu
+    { "ddr", SensorRegistry::Ddr },
+    { "dmc", SensorRegistry::Ddr },         // Rockchip DDR controller
+    { "cpu", SensorRegistry::CpuBig },      // One cluster or not big.LITTLE
+    { "coretemp", SensorRegistry::CpuBig },
+    { "k10temp", SensorRegistry::CpuBig },
+    { "x86_pkg_temp", SensorRegistry::CpuBig },
+    { "soc", SensorRegistry::Soc },
+    { "center", SensorRegistry::Soc },      // RK3588 centre of the die
+    { "acpitz", SensorRegistry::Soc }
+};
+
+bool classify(const QString &name, SensorRegistry::Role &role)
+{
+    QString lower = name.toLower();
+    for (const RoleKeyword &keyword : kRoleKeywords) {
+        if (lower.contains(QLatin1String(keyword.keyword))) {
+            role = keyword.role;
+            return true;
+        }
+    }
+    return false;
+}
+
+QString readAttribute(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    return QString::fromLatin1(file.readAll().trimmed());
+}
+
+// The leading integer of an attribute; Rockchip's devfreq "load" reads
+// "37@800000000Hz"
+bool readValue(const QString &path, qint64 &value)
+{
+    QString text = readAttribute(path);
+    int end = 0;
+    if (end < text.size() && text.at(end) == QLatin1Char('-')) ++end;
+    while (end < text.size() && text.at(end).isDigit()) ++end;
+
+    bool ok = false;
+    value = text.left(end).toLongLong(&ok);
+    return ok;
+}
+
+bool isPlausible(SensorRegistry::Kind kind, qint64 value)
+{
+    switch (kind) {
+    case SensorRegistry::Temperature:
+        return value >= kMinTemperature && value <= kMaxTemperature;
+    case SensorRegistry::Frequency:
+        return value > 0;
+    case SensorRegistry::Load:
+        return value >= 0 && value <= 100;
+    }
+    return false;
+}
+
+// "thermal_zone10" after "thermal_zone9"
+QStringList entriesInNumericOrder(const QString &path, const QString &prefix)
+{
+    QStringList entries = QDir(path).entryList(QStringList() << prefix + "*", QDir::Dirs | QDir::NoDotAndDotDot);
+    std::sort(entries.begin(), entries.end(), [&prefix](const QString &a, const QString &b) {
+        return a.mid(prefix.size()).toInt() < b.mid(prefix.size()).toInt();
+    });
+    return entries;
+}
+
+} // namespace
+
+void SensorRegistry::probe()
+{
+    m_sensors.clear();
+
+    // Thermal zones come first, they are what the kernel throttles on;
+    // hwmon only fills in roles the zones don't cover
+    probeThermalZones();
+    probeDevfreq();
+    probeHwmon();
+}
+
+QStringList SensorRegistry::paths(Role role, Kind kind) const
+{
+    QStringList result;
+    for (const Sensor &sensor : m_sensors) {
+        if (sensor.role == role && sensor.kind == kind) {
+            result << sensor.path;
+        }
+    }
+    return result;
+}
+
+QString SensorRegistry::roleName(Role role)
+{
+    switch (role) {
+    case CpuBig: return "CPU (big)";
+    case CpuLittle: return "CPU (little)";
+    case Gpu: return "GPU";
+    case Npu: return "NPU";
+    case Ddr: return "DDR";
+    case Soc: return "SoC";
+    case RoleCount: break;
+    }
+    return QString();
+}
+
+void SensorRegistry::probeThermalZones()
+{
+    for (const QString &zone : entriesInNumericOrder(kThermalPath, "thermal_zone")) {
+        QString directory = QString("%1/%2").arg(kThermalPath, zone);
+        QString type = readAttribute(directory + "/type");
+        Role role;
+        if (classify(type, role)) {
+            add(role, Temperature, type, directory + "/temp");
+        }
+    }
+}
+
+void SensorRegistry::probeDevfreq()
+{
+    for (const QString &device : QDir(kDevfreqPath).entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        Role role;
+        if (!classify(device, role)) continue;
+
+        QString directory = QString("%1/%2").arg(kDevfreqPath, device);
+        add(role, Frequency, device, directory + "/cur_freq");
+        add(role, Load, device, directory + "/load");
+    }
+}
+
+void SensorRegistry::probeHwmon()
+{
+    for (const QString &chip : entriesInNumericOrder(kHwmonPath, "hwmon")) {
+        QString directory = QString("%1/%2").arg(kHwmonPath, chip);
+        QString name = readAttribute(directory + "/name");
+        Role role;
+        if (classify(name, role) && !has(role, Temperature)) {
+            add(role, Temperature, name, directory + "/temp1_input");
+        }
+    }
+}
+
+void SensorRegistry::add(Role role, Kind kind, const QString &name, const QString &path)
+{
+    qint64 value;
+    if (!readValue(path, value) || !isPlausible(kind, value)) {
+        return;
+    }
+
+    Sensor sensor;
+    sensor.role = role;
+    sensor.kind = kind;
+    sensor.name = name;
+    sensor.path = path;
+    m_sensors.append(sensor);
+}
+
+bool SensorRegistry::has(Role role, Kind kind) const
+{
+    for (const Sensor &sensor : m_sensors) {
+        if (sensor.role == role && sensor.kind == kind) return true;
+    }
+    return false;
+}
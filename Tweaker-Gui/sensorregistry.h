@@ -0,0 +1,60 @@
+#ifndef SENSORREGISTRY_H
+#define SENSORREGISTRY_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// The board's temperature, frequency and load sensors, found by walking
+// /sys/class/thermal, /sys/class/devfreq and /sys/class/hwmon once and
+// classifying each by what it measures. Thermal zone types and devfreq
+// device names differ between SoCs and kernels ("bigcore0-thermal" and
+// "fb000000.gpu" on the RK3588, "cpu-thermal" elsewhere), so nothing is
+// assumed about zone numbers or device addresses. Only sensors that read a
+// plausible value while probing are kept.
+class SensorRegistry
+{
+public:
+    enum Role {
+        CpuBig,         // Big cores, or the whole CPU when it isn't big.LITTLE
+        CpuLittle,
+        Gpu,
+        Npu,
+        Ddr,
+        Soc,
+        RoleCount
+    };
+
+    enum Kind {
+        Temperature,    // millidegrees Celsius
+        Frequency,      // Hz
+        Load            // %
+    };
+
+    struct Sensor {
+        Role role;
+        Kind kind;
+        QString name;   // Thermal zone type, devfreq device or hwmon chip
+        QString path;   // sysfs attribute holding the value
+    };
+
+    void probe();
+
+    const QList<Sensor> &sensors() const { return m_sensors; }
+
+    // Attributes for a role, preferred first; empty if the board has none
+    QStringList paths(Role role, Kind kind) const;
+
+    static QString roleName(Role role);
+
+private:
+    void probeThermalZones();
+    void probeDevfreq();
+    void probeHwmon();
+    void add(Role role, Kind kind, const QString &name, const QString &path);
+    bool has(Role role, Kind kind) const;
+
+    QList<Sensor> m_sensors;
+};
+
+#endif // SENSORREGISTRY_H
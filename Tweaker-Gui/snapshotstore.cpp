@@ -0,0 +1,203 @@
+#include "snapshotstore.h"
+#include "blockhash.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
+
+namespace {
+
+const char kManifestMagic[] = "# Tweaker snapshot manifest";
+const char kManifestSuffix[] = ".manifest";
+const int kManifestVersion = 1;
+
+QString deviceName(const QString &device)
+{
+    return QFileInfo(device).fileName();
+}
+
+} // namespace
+
+SnapshotStore::SnapshotStore(const QString &path)
+    : m_path(QDir(path).absolutePath())
+{
+}
+
+bool SnapshotStore::open(QString &error)
+{
+    if (!QDir().mkpath(m_path + "/chunks")) {
+        error = QString("Cannot create snapshot store in %1").arg(m_path);
+        return false;
+    }
+    return true;
+}
+
+QString SnapshotStore::chunkPath(const QByteArray &id) const
+{
+    // Fan out over 256 directories to keep them small
+    return QString("%1/chunks/%2/%3").arg(m_path, QString::fromLatin1(id.left(2)), QString::fromLatin1(id));
+}
+
+bool SnapshotStore::hasChunk(const QByteArray &id) const
+{
+    return QFile::exists(chunkPath(id));
+}
+
+bool SnapshotStore::writeChunk(const QByteArray &id, const char *data, qint64 length, QString &error)
+{
+    QString path = chunkPath(id);
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        error = QString("Cannot create %1").arg(QFileInfo(path).absolutePath());
+        return false;
+    }
+
+    // Written under a temporary name and renamed, so a chunk file is
+    // either complete or absent
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data, length) != length || !file.commit()) {
+        error = QString("Cannot write chunk %1: %2").arg(path, file.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool SnapshotStore::readChunk(const SnapshotChunk &chunk, char *data, qint64 length, QString &error) const
+{
+    QFile file(chunkPath(chunk.id));
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = QString("Missing chunk %1 in %2").arg(QString::fromLatin1(chunk.id), m_path);
+        return false;
+    }
+    if (file.size() != length || file.read(data, length) != length) {
+        error = QString("Chunk %1 is truncated").arg(QString::fromLatin1(chunk.id));
+        return false;
+    }
+    if (BlockHash::xxh64(data, length) != chunk.quickHash) {
+        error = QString("Chunk %1 is corrupt").arg(QString::fromLatin1(chunk.id));
+        return false;
+    }
+    return true;
+}
+
+QStringList SnapshotStore::manifests(const QString &device) const
+{
+    QString pattern = device.isEmpty() ? QString("*%1").arg(kManifestSuffix)
+                                       : QString("%1-*%2").arg(deviceName(device), kManifestSuffix);
+    // Names end in a timestamp, so name order is creation order per device
+    QStringList result;
+    QDir dir(m_path);
+    for (const QString &name : dir.entryList(QStringList() << pattern, QDir::Files, QDir::Name)) {
+        result << dir.absoluteFilePath(name);
+    }
+    return result;
+}
+
+QString SnapshotStore::manifestName(const QString &device, const QDateTime &created) const
+{
+    // Milliseconds, so two snapshots in the same second get their own names
+    return QString("%1-%2%3").arg(deviceName(device), created.toString("yyyyMMdd-HHmmss-zzz"), kManifestSuffix);
+}
+
+bool SnapshotStore::writeManifest(const QString &name, const SnapshotManifest &manifest, QString &error)
+{
+    QString path = QDir(m_path).absoluteFilePath(name);
+    if (QFile::exists(path)) {
+        error = QString("Manifest %1 already exists").arg(name);
+        return false;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        error = QString("Cannot write manifest %1: %2").arg(name, file.errorString());
+        return false;
+    }
+
+    QTextStream stream(&file);
+    stream << kManifestMagic << "\n"
+           << "version " << kManifestVersion << "\n"
+           << "device " << manifest.device << "\n"
+           << "created " << manifest.created.toString(Qt::ISODate) << "\n"
+           << "size " << manifest.size << "\n"
+           << "chunk-size " << manifest.chunkSize << "\n"
+           << "chunks " << manifest.chunks.size() << "\n";
+    for (const SnapshotChunk &chunk : manifest.chunks) {
+        if (chunk.isZero()) {
+            stream << "zero\n";
+        } else {
+            stream << chunk.id << " " << QString::number(chunk.quickHash, 16) << "\n";
+        }
+    }
+    stream.flush();
+
+    if (stream.status() != QTextStream::Ok || !file.commit()) {
+        error = QString("Cannot write manifest %1: %2").arg(name, file.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool SnapshotStore::readManifest(const QString &path, SnapshotManifest &manifest, QString &error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        error = QString("Cannot open %1: %2").arg(path, file.errorString());
+        return false;
+    }
+
+    QTextStream stream(&file);
+    if (stream.readLine() != kManifestMagic) {
+        error = QString("%1 is not a snapshot manifest").arg(path);
+        return false;
+    }
+
+    manifest = SnapshotManifest();
+    int chunkCount = -1;
+    while (chunkCount < 0 && !stream.atEnd()) {
+        QString line = stream.readLine();
+        QString key = line.section(' ', 0, 0);
+        QString value = line.section(' ', 1);
+        if (key == "version" && value.toInt() != kManifestVersion) {
+            error = QString("Unsupported manifest version %1 in %2").arg(value, path);
+            return false;
+        } else if (key == "device") {
+            manifest.device = value;
+        } else if (key == "created") {
+            manifest.created = QDateTime::fromString(value, Qt::ISODate);
+        } else if (key == "size") {
+            manifest.size = value.toLongLong();
+        } else if (key == "chunk-size") {
+            manifest.chunkSize = value.toLongLong();
+        } else if (key == "chunks") {
+            chunkCount = value.toInt();
+        }
+    }
+
+    if (manifest.size <= 0 || manifest.chunkSize <= 0 ||
+        chunkCount != (manifest.size + manifest.chunkSize - 1) / manifest.chunkSize) {
+        error = QString("Manifest %1 is incomplete").arg(path);
+        return false;
+    }
+
+    manifest.chunks.reserve(chunkCount);
+    while (manifest.chunks.size() < chunkCount && !stream.atEnd()) {
+        QString line = stream.readLine();
+        SnapshotChunk chunk;
+        if (line != "zero") {
+            bool ok = false;
+            chunk.id = line.section(' ', 0, 0).toLatin1();
+            chunk.quickHash = line.section(' ', 1, 1).toULongLong(&ok, 16);
+            if (!ok || chunk.id.size() != 64) {
+                error = QString("Malformed chunk entry %1 in %2").arg(manifest.chunks.size()).arg(path);
+                return false;
+            }
+        }
+        manifest.chunks.append(chunk);
+    }
+
+    if (manifest.chunks.size() != chunkCount) {
+        error = QString("Manifest %1 is truncated").arg(path);
+        return false;
+    }
+    return true;
+}
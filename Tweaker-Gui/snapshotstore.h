@@ -0,0 +1,60 @@
+#ifndef SNAPSHOTSTORE_H
+#define SNAPSHOTSTORE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// One fixed-size block of a snapshotted device
+struct SnapshotChunk {
+    QByteArray id;          // SHA-256 (hex) of the data, empty for an all-zero chunk
+    quint64 quickHash = 0;  // XXH64, checked against the previous snapshot first
+
+    bool isZero() const { return id.isEmpty(); }
+};
+
+struct SnapshotManifest {
+    QString device;
+    qint64 size = 0;
+    qint64 chunkSize = 0;
+    QDateTime created;
+    QVector<SnapshotChunk> chunks;
+
+    qint64 chunkLength(int index) const { return qMin(chunkSize, size - index * chunkSize); }
+};
+
+// Content-addressed chunk store for block-level snapshots. Every unique
+// chunk is stored once under chunks/<xx>/<sha256>; each snapshot is a small
+// text manifest in the store root listing its chunks in device order, so a
+// snapshot only adds the chunks that changed since the previous one.
+class SnapshotStore
+{
+public:
+    explicit SnapshotStore(const QString &path);
+
+    // Create the store layout if needed
+    bool open(QString &error);
+    QString path() const { return m_path; }
+
+    QString chunkPath(const QByteArray &id) const;
+    bool hasChunk(const QByteArray &id) const;
+    bool writeChunk(const QByteArray &id, const char *data, qint64 length, QString &error);
+    // Read a chunk back and check it against the manifest's quick hash
+    bool readChunk(const SnapshotChunk &chunk, char *data, qint64 length, QString &error) const;
+
+    // Manifest paths for device (all devices if empty), oldest first
+    QStringList manifests(const QString &device = QString()) const;
+    // "<device>-<yyyyMMdd-HHmmss-zzz>.manifest"
+    QString manifestName(const QString &device, const QDateTime &created) const;
+
+    // Never replaces an existing manifest
+    bool writeManifest(const QString &name, const SnapshotManifest &manifest, QString &error);
+    static bool readManifest(const QString &path, SnapshotManifest &manifest, QString &error);
+
+private:
+    QString m_path;
+};
+
+#endif // SNAPSHOTSTORE_H
@@ -0,0 +1,276 @@
+#include "snapshotwriter.h"
+#include "snapshotstore.h"
+#include "blockhash.h"
+#include "imagewriter.h"
+#include <QCryptographicHash>
+#include <QMutexLocker>
+#include <QVector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+const qint64 kDirectIoAlignment = 4096;
+const qint64 kDefaultChunkSize = 4 * 1024 * 1024;
+const qint64 kMinChunkSize = 64 * 1024;
+const int kMaxWorkers = 4;              // Beyond this the device is the bottleneck
+const qint64 kProgressIntervalMs = 100;
+
+qint64 alignUp(qint64 value, qint64 alignment)
+{
+    return ((value + alignment - 1) / alignment) * alignment;
+}
+
+// Read until the buffer is full or EOF; returns bytes read or -1
+qint64 readFully(int fd, char *data, qint64 length, qint64 offset)
+{
+    qint64 total = 0;
+    while (total < length) {
+        ssize_t n = ::pread(fd, data + total, length - total, offset + total);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break;
+        total += n;
+    }
+    return total;
+}
+
+QString systemError(const QString &context)
+{
+    return QString("%1: %2").arg(context, QString::fromLocal8Bit(strerror(errno)));
+}
+
+} // namespace
+
+SnapshotWriter::SnapshotWriter(const QString &sourceDevice, const QString &storePath, QObject *parent)
+    : QThread(parent)
+    , m_sourceDevice(sourceDevice)
+    , m_storePath(storePath)
+    , m_chunkSize(kDefaultChunkSize)
+    , m_lastReportBytes(0)
+    , m_lastReportTime(0)
+    , m_throughput(0.0)
+{
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+    requestInterruption();
+    wait();
+}
+
+void SnapshotWriter::setChunkSize(qint64 bytes)
+{
+    m_chunkSize = qMax(alignUp(bytes, kDirectIoAlignment), kMinChunkSize);
+}
+
+void SnapshotWriter::run()
+{
+    m_progressTimer.start();
+    m_lastReportBytes = 0;
+    m_lastReportTime = 0;
+    m_throughput = 0.0;
+
+    QString message;
+    bool success = createSnapshot(message);
+    emit snapshotFinished(success, message);
+}
+
+bool SnapshotWriter::createSnapshot(QString &message)
+{
+    QString &error = message;
+
+    SnapshotStore store(m_storePath);
+    if (!store.open(error)) {
+        return false;
+    }
+
+    // Direct reads keep a full-device pass from flushing the page cache
+    QByteArray nativePath = m_sourceDevice.toLocal8Bit();
+    bool direct = true;
+    int fd = ::open(nativePath.constData(), O_RDONLY | O_DIRECT | O_CLOEXEC);
+    if (fd < 0 && errno == EINVAL) {
+        direct = false;
+        fd = ::open(nativePath.constData(), O_RDONLY | O_CLOEXEC);
+    }
+    if (fd < 0) {
+        error = systemError(QString("Cannot open %1").arg(m_sourceDevice));
+        return false;
+    }
+
+    SnapshotManifest manifest;
+    manifest.device = m_sourceDevice;
+    manifest.created = QDateTime::currentDateTime();
+    manifest.size = ImageWriter::deviceSize(fd);
+    manifest.chunkSize = m_chunkSize;
+    if (manifest.size <= 0) {
+        error = systemError(QString("Cannot determine size of %1").arg(m_sourceDevice));
+        ::close(fd);
+        return false;
+    }
+    int chunkCount = int((manifest.size + m_chunkSize - 1) / m_chunkSize);
+    manifest.chunks.resize(chunkCount);
+
+    // The latest snapshot of the same device, if it was taken the same way,
+    // lets unchanged chunks through on their quick hash alone
+    SnapshotManifest previous;
+    QStringList earlier = store.manifests(m_sourceDevice);
+    if (!earlier.isEmpty()) {
+        QString readError;
+        if (!SnapshotStore::readManifest(earlier.last(), previous, readError)) {
+            emit statusMessage(QString("Ignoring previous snapshot: %1").arg(readError));
+            previous = SnapshotManifest();
+        } else if (previous.chunkSize != m_chunkSize) {
+            previous = SnapshotManifest();
+        } else {
+            emit statusMessage(QString("Incremental against %1").arg(earlier.last()));
+        }
+    }
+
+    int workerCount = qBound(1, QThread::idealThreadCount(), kMaxWorkers);
+    emit statusMessage(QString("Snapshotting %1 (%2 bytes) in %3 KiB chunks on %4 thread%5%6")
+                           .arg(m_sourceDevice).arg(manifest.size).arg(m_chunkSize / 1024)
+                           .arg(workerCount).arg(workerCount == 1 ? "" : "s")
+                           .arg(direct ? ", direct I/O" : ""));
+    emit progressChanged(0, manifest.size);
+
+    // Workers claim chunks in order and fill in their manifest entries
+    SnapshotChunk *chunks = manifest.chunks.data();
+    const SnapshotChunk *previousChunks = previous.chunks.constData();
+    int previousCount = previous.chunks.size();
+    QMutex mutex;
+    int nextChunk = 0;
+    bool failed = false;
+    qint64 bytesDone = 0;
+    qint64 bytesStored = 0;
+    int storedChunks = 0;
+    int zeroChunks = 0;
+
+    auto worker = [&]() {
+        void *memory = nullptr;
+        if (posix_memalign(&memory, kDirectIoAlignment, m_chunkSize) != 0) {
+            QMutexLocker locker(&mutex);
+            if (!failed) error = "Failed to allocate aligned chunk buffer";
+            failed = true;
+            return;
+        }
+        char *buffer = static_cast<char *>(memory);
+
+        for (;;) {
+            int index;
+            {
+                QMutexLocker locker(&mutex);
+                if (failed) break;
+                if (isInterruptionRequested()) {
+                    error = "Snapshot cancelled";
+                    failed = true;
+                    break;
+                }
+                if (nextChunk >= chunkCount) break;
+                index = nextChunk++;
+            }
+
+            qint64 offset = index * m_chunkSize;
+            qint64 length = manifest.chunkLength(index);
+            // Direct reads need aligned lengths; the device end still stops them
+            qint64 bytesRead = readFully(fd, buffer, direct ? alignUp(length, kDirectIoAlignment) : length, offset);
+            QString chunkError;
+            if (bytesRead < length) {
+                chunkError = (bytesRead < 0)
+                    ? systemError(QString("Read error at offset %1").arg(offset))
+                    : QString("%1 ended early at offset %2").arg(m_sourceDevice).arg(offset);
+            }
+
+            SnapshotChunk &chunk = chunks[index];
+            bool stored = false;
+            if (chunkError.isEmpty() && !ImageWriter::isZeroBlock(buffer, length)) {
+                chunk.quickHash = BlockHash::xxh64(buffer, length);
+                if (index < previousCount && !previousChunks[index].isZero() &&
+                    previousChunks[index].quickHash == chunk.quickHash &&
+                    store.hasChunk(previousChunks[index].id)) {
+                    chunk.id = previousChunks[index].id;
+                } else {
+                    chunk.id = QCryptographicHash::hash(QByteArray::fromRawData(buffer, int(length)),
+                                                        QCryptographicHash::Sha256).toHex();
+                    if (!store.hasChunk(chunk.id)) {
+                        stored = store.writeChunk(chunk.id, buffer, length, chunkError);
+                    }
+                }
+            }
+
+            QMutexLocker locker(&mutex);
+            if (!chunkError.isEmpty()) {
+                if (!failed) error = chunkError;
+                failed = true;
+                break;
+            }
+            if (chunk.isZero()) {
+                ++zeroChunks;
+            } else if (stored) {
+                ++storedChunks;
+                bytesStored += length;
+            }
+            bytesDone += length;
+            reportProgress(bytesDone, manifest.size, false);
+        }
+
+        free(buffer);
+    };
+
+    QVector<QThread *> workers;
+    for (int i = 0; i < workerCount; ++i) {
+        QThread *thread = QThread::create(worker);
+        thread->start();
+        workers.append(thread);
+    }
+    for (QThread *thread : workers) {
+        thread->wait();
+    }
+    qDeleteAll(workers);
+    ::close(fd);
+
+    if (failed) {
+        return false;
+    }
+
+    // Chunks are committed one by one, so the manifest never refers to a
+    // chunk that isn't on disk
+    QString name = store.manifestName(m_sourceDevice, manifest.created);
+    if (!store.writeManifest(name, manifest, error)) {
+        return false;
+    }
+    m_manifestPath = store.path() + "/" + name;
+    reportProgress(manifest.size, manifest.size, true);
+
+    message = QString("Snapshot %1 of %2: %3 MiB new in %4 chunks, %5 already stored, %6 empty")
+                  .arg(m_manifestPath, m_sourceDevice).arg(bytesStored / (1024 * 1024))
+                  .arg(storedChunks).arg(chunkCount - storedChunks - zeroChunks).arg(zeroChunks);
+    return true;
+}
+
+void SnapshotWriter::reportProgress(qint64 bytesDone, qint64 totalBytes, bool force)
+{
+    QMutexLocker locker(&m_progressMutex);
+    qint64 now = m_progressTimer.elapsed();
+    qint64 interval = now - m_lastReportTime;
+    if (!force && interval < kProgressIntervalMs) {
+        return;
+    }
+
+    if (interval > 0) {
+        // Exponential moving average smooths out per-chunk jitter
+        double instant = (bytesDone - m_lastReportBytes) * 1000.0 / interval;
+        m_throughput = (m_throughput > 0.0) ? 0.8 * m_throughput + 0.2 * instant : instant;
+        emit throughputChanged(m_throughput);
+    }
+
+    m_lastReportBytes = bytesDone;
+    m_lastReportTime = now;
+    emit progressChanged(bytesDone, totalBytes);
+}
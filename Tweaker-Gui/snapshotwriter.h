@@ -0,0 +1,58 @@
+#ifndef SNAPSHOTWRITER_H
+#define SNAPSHOTWRITER_H
+
+#include <QThread>
+#include <QString>
+#include <QElapsedTimer>
+#include <QMutex>
+
+// Takes an incremental block-level snapshot of a device into a
+// SnapshotStore. The device is split into fixed-size chunks that are read
+// and hashed on a few worker threads; a chunk whose quick hash matches the
+// same chunk of the previous snapshot is reused without being rehashed or
+// written, and new content is stored once however many snapshots refer to
+// it. Snapshots are restored by burning their manifest with ImageWriter.
+class SnapshotWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit SnapshotWriter(const QString &sourceDevice, const QString &storePath, QObject *parent = nullptr);
+    ~SnapshotWriter() override;
+
+    void setChunkSize(qint64 bytes);
+    qint64 chunkSize() const { return m_chunkSize; }
+
+    QString sourceDevice() const { return m_sourceDevice; }
+    QString storePath() const { return m_storePath; }
+
+    // Manifest of the finished snapshot
+    QString manifestPath() const { return m_manifestPath; }
+
+signals:
+    void progressChanged(qint64 bytesDone, qint64 totalBytes);
+    void throughputChanged(double bytesPerSecond);
+    void statusMessage(const QString &message);
+    void snapshotFinished(bool success, const QString &message);
+
+protected:
+    void run() override;
+
+private:
+    bool createSnapshot(QString &message);
+    void reportProgress(qint64 bytesDone, qint64 totalBytes, bool force);
+
+    QString m_sourceDevice;
+    QString m_storePath;
+    QString m_manifestPath;
+    qint64 m_chunkSize;
+
+    // Progress throttling; workers report under m_progressMutex
+    QMutex m_progressMutex;
+    QElapsedTimer m_progressTimer;
+    qint64 m_lastReportBytes;
+    qint64 m_lastReportTime;
+    double m_throughput;
+};
+
+#endif // SNAPSHOTWRITER_H
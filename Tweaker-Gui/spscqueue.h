@@ -0,0 +1,64 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <QVector>
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue between exactly one producer thread and one
+// consumer thread. Each side only ever writes its own index, so push() and
+// pop() are a few atomic loads and stores: no locks, no allocation, and
+// neither side can be held up by the other being descheduled.
+template <typename T>
+class SpscQueue
+{
+public:
+    // Capacity is rounded up to a power of two
+    explicit SpscQueue(int capacity)
+    {
+        size_t size = 1;
+        while (size < size_t(qMax(capacity, 1))) size <<= 1;
+        m_slots.resize(int(size));
+        m_buffer = m_slots.data();
+        m_mask = size - 1;
+    }
+
+    int capacity() const { return int(m_mask + 1); }
+
+    // Producer side; false when full
+    bool push(const T &value)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) > m_mask) {
+            return false;
+        }
+        m_buffer[tail & m_mask] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side; false when empty
+    bool pop(T &value)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = m_buffer[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    Q_DISABLE_COPY(SpscQueue)
+
+    QVector<T> m_slots;
+    T *m_buffer;            // m_slots' storage, so neither thread touches the QVector
+    size_t m_mask;
+
+    // On separate cache lines so the two threads don't contend
+    alignas(64) std::atomic<size_t> m_head{0};  // Next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> m_tail{0};  // Next slot to push, written by the producer
+};
+
+#endif // SPSCQUEUE_H
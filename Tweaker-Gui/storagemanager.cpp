@@ -1,5 +1,11 @@
 #include "storagemanager.h"
 #include "systemmanager.h"
+#include "imagewriter.h"
+#include "imagedecompressor.h"
+#include "snapshotwriter.h"
+#include "archivewriter.h"
+#include "imagecompressor.h"
+#include "devicemonitor.h"
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QProcess>
@@ -11,20 +17,62 @@
 #include <QDesktopServices>
 #include <QUrl>
 #include <QInputDialog>
+#include <QDialog>
+#include <QDialogButtonBox>
 #include <QDateTime>
+#include <QSharedPointer>
+#include <QPointer>
+#include <QThread>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mount.h>
+
+namespace {
+
+// Size from sysfs, which unlike opening the device needs no root
+qint64 blockDeviceSize(const QString &device)
+{
+    QFile file(QString("/sys/class/block/%1/size").arg(QFileInfo(device).fileName()));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    return file.readAll().trimmed().toLongLong() * 512;
+}
+
+} // namespace
 
 StorageManager::StorageManager(SystemManager *systemManager, QWidget *parent)
     : QWidget(parent)
     , m_systemManager(systemManager)
     , m_currentProcess(nullptr)
+    , m_imageWriter(nullptr)
+    , m_snapshotWriter(nullptr)
+    , m_archiveWriter(nullptr)
+    , m_deviceMonitor(nullptr)
+    , m_scanTimer(nullptr)
     , m_isLiveSystem(false)
+    , m_operationTotalBytes(0)
 {
     setupUI();
     
-    // Set up scan timer
-    m_scanTimer = new QTimer(this);
-    connect(m_scanTimer, &QTimer::timeout, this, &StorageManager::scanStorageDevices);
-    m_scanTimer->start(5000); // Scan every 5 seconds
+    // Follow hotplug and mount changes as the kernel reports them
+    m_deviceMonitor = new DeviceMonitor(this);
+    connect(m_deviceMonitor, &DeviceMonitor::deviceAdded, this, &StorageManager::updateDevice);
+    connect(m_deviceMonitor, &DeviceMonitor::deviceChanged, this, &StorageManager::updateDevice);
+    connect(m_deviceMonitor, &DeviceMonitor::deviceRemoved, this, &StorageManager::removeDevice);
+    connect(m_deviceMonitor, &DeviceMonitor::mountsChanged, this, &StorageManager::refreshMounts);
+    connect(m_deviceMonitor, &DeviceMonitor::eventsLost, this, &StorageManager::scanStorageDevices);
+    
+    QString monitorError;
+    if (!m_deviceMonitor->start(monitorError)) {
+        // No netlink (some containers); fall back to polling
+        m_logOutput->append(QString("%1, polling for device changes").arg(monitorError));
+        m_scanTimer = new QTimer(this);
+        connect(m_scanTimer, &QTimer::timeout, this, &StorageManager::scanStorageDevices);
+        m_scanTimer->start(5000); // Scan every 5 seconds
+    }
     
     // Initial scan
     QTimer::singleShot(100, this, [this]() {
@@ -191,6 +239,30 @@ void StorageManager::createActionsGroup()
     m_verifyCheck->setChecked(true);
     optionsLayout->addWidget(m_verifyCheck);
     
+    m_sparseCheck = new QCheckBox("Skip empty blocks");
+    m_sparseCheck->setStyleSheet("color: #000000; font-size: 9pt;");
+    m_sparseCheck->setToolTip("Don't write unallocated or all-zero regions of the source; discard them on the target where that leaves zeros, zero them out otherwise");
+    m_sparseCheck->setChecked(true);
+    optionsLayout->addWidget(m_sparseCheck);
+    
+    m_verifyZerosCheck = new QCheckBox("Verify empty blocks");
+    m_verifyZerosCheck->setStyleSheet("color: #000000; font-size: 9pt;");
+    m_verifyZerosCheck->setToolTip("Verify: also read back the empty blocks that weren't written and check they are zeros; on a sparse image this reads the whole card");
+    m_verifyZerosCheck->setChecked(false);
+    optionsLayout->addWidget(m_verifyZerosCheck);
+    
+    m_usedBlocksCheck = new QCheckBox("Used blocks only");
+    m_usedBlocksCheck->setStyleSheet("color: #000000; font-size: 9pt;");
+    m_usedBlocksCheck->setToolTip("Drive copy: only copy blocks allocated by ext2/3/4 and FAT filesystems, then fix up the partition table for the target size");
+    m_usedBlocksCheck->setChecked(false);
+    optionsLayout->addWidget(m_usedBlocksCheck);
+    
+    m_multiTargetCheck = new QCheckBox("Multiple cards");
+    m_multiTargetCheck->setStyleSheet("color: #000000; font-size: 9pt;");
+    m_multiTargetCheck->setToolTip("Burn: write the image to several SD cards at once, reading it only once");
+    m_multiTargetCheck->setChecked(false);
+    optionsLayout->addWidget(m_multiTargetCheck);
+    
     mainLayout->addLayout(optionsLayout);
     mainLayout->addSpacing(20);
     
@@ -257,6 +329,10 @@ void StorageManager::createProgressGroup()
     );
     layout->addWidget(m_progressBar);
     
+    m_targetProgressLayout = new QVBoxLayout();
+    m_targetProgressLayout->setSpacing(2);
+    layout->addLayout(m_targetProgressLayout);
+    
     m_logOutput = new QTextEdit();
     m_logOutput->setMaximumHeight(150);
     m_logOutput->setReadOnly(true);
@@ -270,6 +346,18 @@ void StorageManager::createProgressGroup()
             m_currentProcess->terminate();
             m_statusLabel->setText("Operation cancelled");
         }
+        if (m_imageWriter && m_imageWriter->isRunning()) {
+            m_imageWriter->requestInterruption();
+            m_statusLabel->setText("Cancelling write...");
+        }
+        if (m_snapshotWriter && m_snapshotWriter->isRunning()) {
+            m_snapshotWriter->requestInterruption();
+            m_statusLabel->setText("Cancelling snapshot...");
+        }
+        if (m_archiveWriter && m_archiveWriter->isRunning()) {
+            m_archiveWriter->requestInterruption();
+            m_statusLabel->setText("Cancelling snapshot...");
+        }
     });
     layout->addWidget(m_cancelButton);
 }
@@ -292,25 +380,10 @@ void StorageManager::detectSystemInstallation()
     }
     
     // Find root device
-    QProcess *dfProcess = new QProcess(this);
-    connect(dfProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [this, dfProcess](int, QProcess::ExitStatus) {
-        QString output = dfProcess->readAllStandardOutput();
-        QStringList lines = output.split('\n');
-        
-        for (const QString &line : lines) {
-            if (line.contains(" / ")) {
-                QStringList parts = line.split(QRegularExpression("\\s+"));
-                if (!parts.isEmpty()) {
-                    m_systemDevice = parts.first();
-                    m_systemLocationLabel->setText(QString("System Location: %1").arg(m_systemDevice));
-                    break;
-                }
-            }
-        }
-        dfProcess->deleteLater();
-    });
-    dfProcess->start("df", QStringList() << "-h");
+    m_systemDevice = BlockDevices::deviceForMountPoint("/");
+    if (!m_systemDevice.isEmpty()) {
+        m_systemLocationLabel->setText(QString("System Location: %1").arg(m_systemDevice));
+    }
     
     // Get boot device
     QFile fstabFile("/etc/fstab");
@@ -332,81 +405,117 @@ void StorageManager::detectSystemInstallation()
 
 void StorageManager::scanStorageDevices()
 {
-    m_devices.clear();
-    m_deviceList->clear();
-    
-    // Use lsblk to get device information
-    QProcess *lsblkProcess = new QProcess(this);
-    connect(lsblkProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [this, lsblkProcess](int, QProcess::ExitStatus) {
-        QString output = lsblkProcess->readAllStandardOutput();
-        QStringList lines = output.split('\n');
+    // statvfs on a stalled network mount can block, so keep it off the UI thread
+    QSharedPointer<QList<StorageDevice>> devices(new QList<StorageDevice>);
+    QThread *scanner = QThread::create([devices]() {
+        *devices = BlockDevices::enumerate();
+    });
+    connect(scanner, &QThread::finished, scanner, &QObject::deleteLater);
+    connect(scanner, &QThread::finished, this, [this, devices]() {
+        m_devices.clear();
+        m_deviceList->clear();
         
-        for (const QString &line : lines) {
-            if (line.isEmpty()) continue;
+        for (StorageDevice device : *devices) {
+            device.isSystemDrive = device.isSystemDrive || (device.device == m_systemDevice);
+            m_devices[device.device] = device;
             
-            // Parse KEY="value" format from lsblk -P
-            QRegularExpression rx("(\\w+)=\"([^\"]*)\"");
-            QRegularExpressionMatchIterator it = rx.globalMatch(line);
-            
-            QMap<QString, QString> deviceInfo;
-            while (it.hasNext()) {
-                QRegularExpressionMatch match = it.next();
-                deviceInfo[match.captured(1)] = match.captured(2);
-            }
-            
-            // Skip loop devices
-            if (deviceInfo["TYPE"] == "loop") continue;
-            
-            // Only process disk and partition entries
-            if (deviceInfo["TYPE"] == "disk" || deviceInfo["TYPE"] == "part") {
-                StorageDevice device;
-                device.device = "/dev/" + deviceInfo["NAME"];
-                device.size = deviceInfo["SIZE"];
-                device.filesystem = deviceInfo["FSTYPE"];
-                device.mountPoint = deviceInfo["MOUNTPOINT"];
-                device.label = deviceInfo["LABEL"];
-                device.isRemovable = (deviceInfo["RM"] == "1");
-                device.isMounted = !device.mountPoint.isEmpty();
-                device.isSystemDrive = (device.device == m_systemDevice) || 
-                                      (device.mountPoint == "/");
-                
-                // Get usage info if mounted
-                if (device.isMounted && !device.mountPoint.isEmpty()) {
-                    QStorageInfo storageInfo(device.mountPoint);
-                    device.used = formatSize(storageInfo.bytesTotal() - storageInfo.bytesAvailable());
-                    device.available = formatSize(storageInfo.bytesAvailable());
-                }
-                
-                m_devices[device.device] = device;
-                
-                // Add to list
-                QString icon = device.isRemovable ? "💾" : "💿";
-                if (device.isSystemDrive) icon = "🖥️";
-                QString status = device.isMounted ? " [Mounted]" : "";
-                
-                QListWidgetItem *item = new QListWidgetItem(
-                    QString("%1 %2 - %3%4").arg(icon, device.device, device.size, status)
-                );
-                item->setData(Qt::UserRole, device.device);
-                m_deviceList->addItem(item);
+            // Add to list
+            QListWidgetItem *item = new QListWidgetItem(deviceItemText(device));
+            item->setData(Qt::UserRole, device.device);
+            m_deviceList->addItem(item);
+            if (device.device == m_selectedDevice) {
+                m_deviceList->setCurrentItem(item);
             }
         }
         
-        lsblkProcess->deleteLater();
-        
-        // Update target device combo
-        m_targetDeviceCombo->clear();
-        for (const StorageDevice &device : m_devices) {
-            if (!device.isSystemDrive && device.size != "0B") {
-                m_targetDeviceCombo->addItem(device.device + " - " + device.size, device.device);
-            }
-        }
+        updateTargetCombo();
     });
+    scanner->start();
+}
+
+void StorageManager::updateDevice(const QString &name)
+{
+    StorageDevice device;
+    if (!BlockDevices::read(name, device)) {
+        removeDevice(name);
+        return;
+    }
+    device.isSystemDrive = device.isSystemDrive || (device.device == m_systemDevice);
+    m_devices[device.device] = device;
+    
+    // Update the entry in place, or insert it in natural device order so
+    // partitions follow their disk
+    int row = 0;
+    for (; row < m_deviceList->count(); ++row) {
+        QString listed = m_deviceList->item(row)->data(Qt::UserRole).toString();
+        if (listed == device.device) {
+            m_deviceList->item(row)->setText(deviceItemText(device));
+            break;
+        }
+        if (BlockDevices::lessThan(device.device, listed)) {
+            QListWidgetItem *item = new QListWidgetItem(deviceItemText(device));
+            item->setData(Qt::UserRole, device.device);
+            m_deviceList->insertItem(row, item);
+            break;
+        }
+    }
+    if (row == m_deviceList->count()) {
+        QListWidgetItem *item = new QListWidgetItem(deviceItemText(device));
+        item->setData(Qt::UserRole, device.device);
+        m_deviceList->addItem(item);
+    }
+    
+    updateTargetCombo();
+    if (device.device == m_selectedDevice) {
+        onDeviceSelectionChanged();
+    }
+}
+
+void StorageManager::removeDevice(const QString &name)
+{
+    QString devicePath = "/dev/" + name;
+    if (!m_devices.remove(devicePath)) return;
     
-    lsblkProcess->start("lsblk", QStringList() 
-        << "-o" << "NAME,FSTYPE,LABEL,SIZE,RM,TYPE,MOUNTPOINT"
-        << "-n" << "-P");
+    for (int row = 0; row < m_deviceList->count(); ++row) {
+        if (m_deviceList->item(row)->data(Qt::UserRole).toString() == devicePath) {
+            delete m_deviceList->takeItem(row);
+            break;
+        }
+    }
+    updateTargetCombo();
+}
+
+void StorageManager::refreshMounts()
+{
+    // Mount state and usage are all that can change; sysfs reads are cheap
+    const QStringList devicePaths = m_devices.keys();
+    for (const QString &devicePath : devicePaths) {
+        updateDevice(QFileInfo(devicePath).fileName());
+    }
+}
+
+QString StorageManager::deviceItemText(const StorageDevice &device) const
+{
+    QString icon = device.isRemovable ? "💾" : "💿";
+    if (device.isSystemDrive) icon = "🖥️";
+    QString status = device.isMounted ? " [Mounted]" : "";
+    return QString("%1 %2 - %3%4").arg(icon, device.device, device.size, status);
+}
+
+void StorageManager::updateTargetCombo()
+{
+    // Rebuilt on every change, so keep whatever was picked
+    QString selected = m_targetDeviceCombo->currentData().toString();
+    m_targetDeviceCombo->clear();
+    for (const StorageDevice &device : m_devices) {
+        if (!device.isSystemDrive && device.size != "0B") {
+            m_targetDeviceCombo->addItem(device.device + " - " + device.size, device.device);
+        }
+    }
+    int index = m_targetDeviceCombo->findData(selected);
+    if (index >= 0) {
+        m_targetDeviceCombo->setCurrentIndex(index);
+    }
 }
 
 void StorageManager::onDeviceSelectionChanged()
@@ -578,84 +687,182 @@ void StorageManager::onCopyLiveImage()
 
 void StorageManager::onBurnToSDCard()
 {
+    // Before any dialog, so nobody confirms a burn that can't start
+    if (isOperationRunning()) {
+        QMessageBox::warning(this, "Operation in Progress",
+            "Another operation is already running. Please wait or cancel it first.");
+        return;
+    }
+    
     QString imagePath = QFileDialog::getOpenFileName(this, "Select Image File",
-        QDir::homePath(), "Image Files (*.img *.iso *.raw);;All Files (*)");
+        QDir::homePath(), "Image Files (*.img *.iso *.raw *.xz *.gz *.zst);;Snapshots (*.manifest);;All Files (*)");
         
     if (imagePath.isEmpty()) return;
     
-    QString targetDevice = m_targetDeviceCombo->currentData().toString();
-    if (targetDevice.isEmpty()) {
+    QStringList targetDevices;
+    if (m_multiTargetCheck->isChecked()) {
+        targetDevices = selectBurnTargets();
+        if (targetDevices.isEmpty()) return;
+    } else {
+        targetDevices << m_targetDeviceCombo->currentData().toString();
+    }
+    if (targetDevices.first().isEmpty()) {
         QMessageBox::warning(this, "No Target Selected",
             "Please select a target SD card.");
         return;
     }
     
-    // Check if target is removable
-    if (m_devices.contains(targetDevice) && !m_devices[targetDevice].isRemovable) {
-        QMessageBox::StandardButton reply = QMessageBox::warning(this, "Non-Removable Device",
-            "The selected device appears to be a fixed drive.\n\n"
-            "Are you sure you want to continue?",
-            QMessageBox::Yes | QMessageBox::No);
-        if (reply != QMessageBox::Yes) return;
+    // Check if targets are removable
+    for (const QString &targetDevice : targetDevices) {
+        if (m_devices.contains(targetDevice) && !m_devices[targetDevice].isRemovable) {
+            QMessageBox::StandardButton reply = QMessageBox::warning(this, "Non-Removable Device",
+                QString("%1 appears to be a fixed drive.\n\n"
+                        "Are you sure you want to continue?").arg(targetDevice),
+                QMessageBox::Yes | QMessageBox::No);
+            if (reply != QMessageBox::Yes) return;
+        }
     }
     
     QMessageBox::StandardButton reply = QMessageBox::question(this, "Burn Image to SD Card",
         QString("This will write %1 to %2.\n\n"
-                "ALL DATA ON THE TARGET DEVICE WILL BE LOST!\n\n"
-                "Continue?").arg(QFileInfo(imagePath).fileName(), targetDevice),
+                "ALL DATA ON THE TARGET DEVICE%3 WILL BE LOST!\n\n"
+                "Continue?").arg(QFileInfo(imagePath).fileName(), targetDevices.join(", "),
+                                 targetDevices.size() > 1 ? "S" : ""),
         QMessageBox::Yes | QMessageBox::No);
         
     if (reply != QMessageBox::Yes) return;
     
-    m_currentOperation = "Burning image to SD card";
+    m_currentOperation = targetDevices.size() > 1
+        ? QString("Burning image to %1 SD cards").arg(targetDevices.size())
+        : QString("Burning image to SD card");
     m_progressGroup->setVisible(true);
     m_progressBar->setMaximum(100);
     m_progressBar->setValue(0);
     m_statusLabel->setText("Writing image to SD card...");
     m_logOutput->clear();
+    setupTargetProgress(QStringList());
+    
+    // Native writer needs direct access to the block device
+    if (geteuid() == 0) {
+        startImageWriter(imagePath, targetDevices);
+        return;
+    }
+    
+    // Fall back to dd through sudo when not running as root. The shell runs
+    // as root, so paths go in as positional parameters, never into the script.
+    m_logOutput->append("Not running as root - falling back to dd via sudo");
+    
+    ImageDecompressor::Format format = ImageDecompressor::detectFormat(imagePath);
+    QString targetDevice = targetDevices.first();
+    if (targetDevices.size() > 1) {
+        // tee writes the cards in lockstep, so the slowest one sets the pace
+        m_logOutput->append("Cards are written one block at a time each; the native writer needs root");
+        QString reader = (format == ImageDecompressor::Gzip) ? "gzip -dc"
+                       : (format == ImageDecompressor::Xz) ? "xz -dc -T0"
+                       : (format == ImageDecompressor::Zstd) ? "zstd -dc" : "cat";
+        m_progressBar->setMaximum(0);
+        executeCommand("sh", QStringList() << "-c"
+            << QString("image=\"$1\"; shift; %1 \"$image\" | tee \"$@\" > /dev/null && sync").arg(reader)
+            << "sh" << imagePath << targetDevices);
+        return;
+    }
+    if (format != ImageDecompressor::Uncompressed) {
+        // Decompressed size isn't known up front, so no percentage
+        QString decoder = (format == ImageDecompressor::Gzip) ? "gzip -dc"
+                        : (format == ImageDecompressor::Xz) ? "xz -dc -T0" : "zstd -dc";
+        m_progressBar->setMaximum(0);
+        executeCommand("sh", QStringList() << "-c"
+            << QString("%1 \"$1\" | dd of=\"$2\" bs=4M iflag=fullblock status=progress conv=fsync").arg(decoder)
+            << "sh" << imagePath << targetDevice);
+        return;
+    }
     
-    // Use dd with progress monitoring
-    QStringList args;
-    args << "dd" << QString("if=%1").arg(imagePath) << QString("of=%1").arg(targetDevice)
-         << "bs=4M" << "status=progress" << "conv=fsync";
+    m_operationTotalBytes = QFileInfo(imagePath).size();
+    QString ddCommand = "dd if=\"$1\" of=\"$2\" bs=4M status=progress conv=fsync";
+    if (m_verifyCheck->isChecked()) {
+        ddCommand += QString(" && echo 'Verifying copy...' && cmp -n %1 \"$1\" \"$2\"").arg(m_operationTotalBytes);
+    }
     
-    executeCommand("sh", QStringList() << "-c" << args.join(" "));
+    executeCommand("sh", QStringList() << "-c" << ddCommand << "sh" << imagePath << targetDevice);
 }
 
 void StorageManager::onCreateSnapshot()
 {
-    QString savePath = QFileDialog::getSaveFileName(this, "Save System Snapshot",
-        QDir::homePath() + "/system_snapshot_" + QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss") + ".img",
-        "Image Files (*.img);;All Files (*)");
-        
-    if (savePath.isEmpty()) return;
-    
+    // Block-level snapshots go into an incremental chunk store when the
+    // device can be read directly
+    if (!m_compressCheck->isChecked() && geteuid() == 0) {
+        startSnapshotWriter();
+        return;
+    }
+
     bool includeHome = m_includeHomeCheck->isChecked();
     bool compress = m_compressCheck->isChecked();
-    
+
+    // Compressed snapshots are tar archives; zstd writes and restores much
+    // faster than gzip, so it is the default where the build supports it
+    QString baseName = QDir::homePath() + "/system_snapshot_" + QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss");
+    bool zstdDefault = ImageCompressor::isFormatSupported(ImageDecompressor::Zstd) || geteuid() != 0;
+    QString savePath = compress
+        ? QFileDialog::getSaveFileName(this, "Save System Snapshot",
+              baseName + (zstdDefault ? ".tar.zst" : ".tar.gz"),
+              "Zstandard Archives (*.tar.zst);;Gzip Archives (*.tar.gz);;All Files (*)")
+        : QFileDialog::getSaveFileName(this, "Save System Snapshot",
+              baseName + ".img", "Image Files (*.img);;All Files (*)");
+
+    if (savePath.isEmpty()) return;
+
+    ImageDecompressor::Format format = (savePath.endsWith(".gz") || savePath.endsWith(".tgz"))
+        ? ImageDecompressor::Gzip : ImageDecompressor::Zstd;
+    QStringList excludes;
+    excludes << "/dev/*" << "/proc/*" << "/sys/*" << "/tmp/*" << "/run/*"
+             << "/mnt/*" << "/media/*" << "/lost+found";
+    if (!includeHome) {
+        excludes << "/home/*";
+    }
+
+    // Compress in-process on all big cores rather than in tar's single
+    // gzip child
+    if (compress && geteuid() == 0 && ImageCompressor::isFormatSupported(format)) {
+        startArchiveWriter(savePath, format, excludes);
+        return;
+    }
+
+    // Sized so the bar can show real progress: dd from the device size,
+    // tar from the used space of the filesystems it will walk, which is
+    // worked out on a thread once tar is running
+    m_operationTotalBytes = compress ? 0 : blockDeviceSize(m_systemDevice);
+
     m_currentOperation = "Creating system snapshot";
     m_progressGroup->setVisible(true);
-    m_progressBar->setMaximum(0); // Indeterminate
+    m_progressBar->setMaximum(m_operationTotalBytes > 0 ? 100 : 0);
+    m_progressBar->setValue(0);
     m_statusLabel->setText("Creating system snapshot...");
     m_logOutput->clear();
     
     // Create snapshot using tar or dd
     QString script = QString(
         "#!/bin/bash\n"
-        "set -e\n"
+        "set -e -o pipefail\n"
         "OUTPUT='%1'\n"
         "echo 'Creating system snapshot...'\n"
     ).arg(savePath);
     
     if (compress) {
-        // Use tar with compression
-        script += QString(
-            "tar --exclude='/dev/*' --exclude='/proc/*' --exclude='/sys/*' "
-            "--exclude='/tmp/*' --exclude='/run/*' --exclude='/mnt/*' "
-            "--exclude='/media/*' --exclude='/lost+found' "
-            "%1 "
-            "-czpf \"$OUTPUT\" /\n"
-        ).arg(includeHome ? "" : "--exclude='/home/*'");
+        // Multi-threaded compressors when available
+        QString compressor = (format == ImageDecompressor::Zstd)
+            ? QString("zstd -T0 -q")
+            : QString("$(command -v pigz || echo gzip)");
+        // Checkpoints report the bytes written every 1000 records (10 MB)
+        script += QString("tar --exclude='%1' --exclude=\"$OUTPUT\" --checkpoint=1000 "
+                          "--checkpoint-action=echo='%T' -cpf - / | %2 > \"$OUTPUT\" || STATUS=(\"${PIPESTATUS[@]}\")\n")
+                      .arg(excludes.join("' --exclude='"), compressor);
+        // A live root always has files changing under tar, which exits 1
+        // for that; anything else from tar or the compressor is a failure
+        script += "if [ \"${STATUS[0]:-0}\" -gt 1 ] || [ \"${STATUS[1]:-0}\" -ne 0 ]; then\n"
+                  "    echo \"Snapshot failed: tar exited ${STATUS[0]}, compressor exited ${STATUS[1]}\" >&2\n"
+                  "    exit 1\n"
+                  "fi\n"
+                  "[ \"${STATUS[0]:-0}\" -eq 1 ] && echo 'Some files changed while they were read'\n";
     } else {
         // Create disk image
         script += QString(
@@ -674,6 +881,97 @@ void StorageManager::onCreateSnapshot()
     }
     
     executeCommand("bash", QStringList() << "/tmp/create_snapshot.sh");
+    if (!compress || !m_currentProcess) return;
+
+    // Excluded directories on the root filesystem are walked for the
+    // estimate; the bar stays busy until it is known
+    QSharedPointer<qint64> estimate(new qint64(0));
+    QThread *estimator = QThread::create([estimate, excludes]() {
+        *estimate = ArchiveWriter::estimateSize("/", excludes);
+    });
+    QPointer<QProcess> process = m_currentProcess;
+    connect(estimator, &QThread::finished, estimator, &QObject::deleteLater);
+    connect(estimator, &QThread::finished, this, [this, estimate, process]() {
+        if (!process || process != m_currentProcess || *estimate <= 0) return;
+        m_operationTotalBytes = *estimate;
+        m_progressBar->setMaximum(100);
+    });
+    estimator->start();
+}
+
+void StorageManager::startSnapshotWriter()
+{
+    if (m_systemDevice.isEmpty()) {
+        QMessageBox::warning(this, "No System Device",
+            "The device the system runs from could not be determined.");
+        return;
+    }
+    if (isOperationRunning()) {
+        QMessageBox::warning(this, "Operation in Progress",
+            "Another operation is already running. Please wait or cancel it first.");
+        return;
+    }
+
+    QString storePath = QFileDialog::getExistingDirectory(this, "Select Snapshot Store",
+        QDir::homePath() + "/snapshots");
+    if (storePath.isEmpty()) return;
+
+    // A store on the snapshotted device changes it while it is being read.
+    // Compared by whole name, through the device number so /dev/root
+    // counts; another partition of the same disk is fine.
+    QStorageInfo store(storePath);
+    QString storeDevice = BlockDevices::deviceForMountPoint(store.rootPath());
+    if (storeDevice.isEmpty()) {
+        storeDevice = QString::fromLocal8Bit(store.device());
+    }
+    if (storeDevice == m_systemDevice) {
+        QMessageBox::StandardButton reply = QMessageBox::warning(this, "Store on System Device",
+            QString("%1 is on %2, the device being snapshotted.\n\n"
+                    "The snapshot will include the store itself and new chunks will "
+                    "change the device while it is read. Use a store on another drive?")
+                .arg(storePath, m_systemDevice),
+            QMessageBox::Ignore | QMessageBox::Cancel);
+        if (reply != QMessageBox::Ignore) return;
+    }
+
+    m_currentOperation = "Creating system snapshot";
+    m_progressGroup->setVisible(true);
+    m_progressBar->setMaximum(100);
+    m_progressBar->setValue(0);
+    m_statusLabel->setText("Creating system snapshot...");
+    m_logOutput->clear();
+    setupTargetProgress(QStringList());
+
+    m_snapshotWriter = new SnapshotWriter(m_systemDevice, storePath, this);
+    connect(m_snapshotWriter, &SnapshotWriter::progressChanged, this, &StorageManager::onWriterProgress);
+    connect(m_snapshotWriter, &SnapshotWriter::throughputChanged, this, &StorageManager::onWriterThroughput);
+    connect(m_snapshotWriter, &SnapshotWriter::statusMessage, m_logOutput, &QTextEdit::append);
+    connect(m_snapshotWriter, &SnapshotWriter::snapshotFinished, this, &StorageManager::onSnapshotFinished);
+    m_snapshotWriter->start();
+}
+
+void StorageManager::startArchiveWriter(const QString &archivePath, int format, const QStringList &excludes)
+{
+    if (isOperationRunning()) {
+        QMessageBox::warning(this, "Operation in Progress",
+            "Another operation is already running. Please wait or cancel it first.");
+        return;
+    }
+
+    m_currentOperation = "Creating system snapshot";
+    m_progressGroup->setVisible(true);
+    m_progressBar->setMaximum(0); // Indeterminate
+    m_statusLabel->setText("Creating system snapshot...");
+    m_logOutput->clear();
+    setupTargetProgress(QStringList());
+
+    m_archiveWriter = new ArchiveWriter(archivePath, ImageDecompressor::Format(format), this);
+    m_archiveWriter->setExcludes(excludes);
+    connect(m_archiveWriter, &ArchiveWriter::progressChanged, this, &StorageManager::onWriterProgress);
+    connect(m_archiveWriter, &ArchiveWriter::throughputChanged, this, &StorageManager::onWriterThroughput);
+    connect(m_archiveWriter, &ArchiveWriter::statusMessage, m_logOutput, &QTextEdit::append);
+    connect(m_archiveWriter, &ArchiveWriter::archiveFinished, this, &StorageManager::onSnapshotFinished);
+    m_archiveWriter->start();
 }
 
 void StorageManager::onDriveCopy()
@@ -727,6 +1025,16 @@ void StorageManager::onDriveCopy()
     m_progressBar->setValue(0);
     m_statusLabel->setText(QString("Copying %1 to %2...").arg(sourceDevice, targetDevice));
     m_logOutput->clear();
+    setupTargetProgress(QStringList());
+    
+    if (geteuid() == 0) {
+        startImageWriter(sourceDevice, QStringList(targetDevice), m_usedBlocksCheck->isChecked());
+        return;
+    }
+    
+    if (m_usedBlocksCheck->isChecked()) {
+        m_logOutput->append("Used-blocks copy needs root, copying the whole device instead");
+    }
     
     // Use dd with progress
     QString ddCommand = QString("dd if=%1 of=%2 bs=64M status=progress conv=sync,noerror")
@@ -742,7 +1050,7 @@ void StorageManager::onDriveCopy()
 
 void StorageManager::executeCommand(const QString &command, const QStringList &args)
 {
-    if (m_currentProcess && m_currentProcess->state() != QProcess::NotRunning) {
+    if (isOperationRunning()) {
         QMessageBox::warning(this, "Operation in Progress",
             "Another operation is already running. Please wait or cancel it first.");
         return;
@@ -771,22 +1079,26 @@ void StorageManager::onProcessOutput()
     QString output = m_currentProcess->readAllStandardOutput();
     QString error = m_currentProcess->readAllStandardError();
     
+    // dd reports progress on stderr, tar checkpoints as "W: <bytes> (...)"
+    QString progressText = output + error;
+    QRegularExpression rx("(\\d+) bytes .* copied|W: (\\d+) \\(");
+    QRegularExpressionMatchIterator matches = rx.globalMatch(progressText);
+    qint64 bytesCopied = -1;
+    while (matches.hasNext()) {
+        QRegularExpressionMatch match = matches.next();
+        bytesCopied = match.captured(match.lastCapturedIndex()).toLongLong();
+    }
+    if (bytesCopied >= 0 && m_operationTotalBytes > 0) {
+        updateTransferProgress(bytesCopied, m_operationTotalBytes);
+    }
+    // Checkpoints are progress, not errors
+    error.remove(QRegularExpression("^tar: W: .*$\\n?", QRegularExpression::MultilineOption));
+    
     if (!output.isEmpty()) {
         m_logOutput->append(output);
-        
-        // Parse dd progress
-        if (output.contains("bytes") && output.contains("copied")) {
-            QRegularExpression rx("(\\d+) bytes .* copied");
-            QRegularExpressionMatch match = rx.match(output);
-            if (match.hasMatch()) {
-                qint64 bytesCopied = match.captured(1).toLongLong();
-                // Update progress if we know the total size
-                // This is simplified - real implementation would track source size
-            }
-        }
     }
     
-    if (!error.isEmpty()) {
+    if (!error.trimmed().isEmpty()) {
         m_logOutput->append(QString("<span style='color: #FF0000;'>%1</span>").arg(error));
     }
 }
@@ -796,9 +1108,11 @@ void StorageManager::onProcessFinished(int exitCode, QProcess::ExitStatus exitSt
     if (!m_currentProcess) return;
     
     bool success = (exitCode == 0 && exitStatus == QProcess::NormalExit);
+    m_progressBar->setFormat("%p%");
     
     if (success) {
         m_statusLabel->setText(m_currentOperation + " completed successfully!");
+        m_progressBar->setMaximum(100);
         m_progressBar->setValue(100);
         emit operationCompleted(true, m_currentOperation + " completed");
     } else {
@@ -808,11 +1122,276 @@ void StorageManager::onProcessFinished(int exitCode, QProcess::ExitStatus exitSt
     
     m_currentProcess->deleteLater();
     m_currentProcess = nullptr;
+    m_operationTotalBytes = 0;
     
     // Refresh device list after operation
     QTimer::singleShot(2000, this, &StorageManager::scanStorageDevices);
 }
 
+void StorageManager::startImageWriter(const QString &sourcePath, const QStringList &targetDevices, bool usedBlocksOnly)
+{
+    // A card that can't be unmounted is left out; the rest still get written
+    QStringList targets;
+    for (const QString &targetDevice : targetDevices) {
+        if (unmountDevicePartitions(targetDevice)) {
+            targets << targetDevice;
+        }
+    }
+    if (targets.isEmpty() || (targetDevices.size() == 1 && targets.size() != 1)) {
+        m_statusLabel->setText(m_currentOperation + " failed!");
+        emit operationCompleted(false, QString("Could not unmount partitions of %1").arg(targetDevices.join(", ")));
+        return;
+    }
+    
+    m_imageWriter = new ImageWriter(sourcePath, targets, this);
+    m_imageWriter->setZeroBlockPolicy(ImageWriter::ZeroBlockPolicy(zeroBlockPolicy()));
+    m_imageWriter->setUsedBlocksOnly(usedBlocksOnly);
+    m_imageWriter->setVerifyWrites(m_verifyCheck->isChecked());
+    m_imageWriter->setVerifyZeroRanges(m_verifyCheck->isChecked() && m_verifyZerosCheck->isChecked());
+    connect(m_imageWriter, &ImageWriter::progressChanged, this, &StorageManager::onWriterProgress);
+    connect(m_imageWriter, &ImageWriter::throughputChanged, this, &StorageManager::onWriterThroughput);
+    connect(m_imageWriter, &ImageWriter::statusMessage, m_logOutput, &QTextEdit::append);
+    connect(m_imageWriter, &ImageWriter::writeFinished, this, &StorageManager::onWriterFinished);
+    if (targets.size() > 1) {
+        setupTargetProgress(targets);
+        connect(m_imageWriter, &ImageWriter::targetProgressChanged, this, &StorageManager::onTargetProgress);
+        connect(m_imageWriter, &ImageWriter::targetThroughputChanged, this, &StorageManager::onTargetThroughput);
+        connect(m_imageWriter, &ImageWriter::targetFinished, this, &StorageManager::onTargetFinished);
+    }
+    
+    emit operationStarted(m_currentOperation);
+    m_imageWriter->start();
+}
+
+QStringList StorageManager::selectBurnTargets()
+{
+    QDialog dialog(this);
+    dialog.setWindowTitle("Select SD Cards");
+    dialog.setStyleSheet("background-color: #DCDCDC;");
+    
+    QVBoxLayout *dialogLayout = new QVBoxLayout(&dialog);
+    
+    QLabel *infoLabel = new QLabel("Select the cards to burn. The image is read once and written to all of them in parallel.");
+    infoLabel->setWordWrap(true);
+    infoLabel->setStyleSheet("color: #000000; margin: 5px;");
+    dialogLayout->addWidget(infoLabel);
+    
+    QListWidget *deviceList = new QListWidget();
+    deviceList->setStyleSheet(
+        "QListWidget { background-color: #F0F0F0; color: #000000; border: 1px solid #000000; }"
+    );
+    for (const StorageDevice &device : m_devices) {
+        if (!device.isDisk || device.isSystemDrive || device.size == "0B") continue;
+        
+        QString icon = device.isRemovable ? "💾" : "💿";
+        QString status = device.isMounted ? " [Mounted]" : "";
+        QListWidgetItem *item = new QListWidgetItem(
+            QString("%1 %2 - %3%4").arg(icon, device.device, device.size, status));
+        item->setData(Qt::UserRole, device.device);
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        // Fixed drives must be picked explicitly
+        item->setCheckState(device.isRemovable ? Qt::Checked : Qt::Unchecked);
+        deviceList->addItem(item);
+    }
+    dialogLayout->addWidget(deviceList);
+    
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    dialogLayout->addWidget(buttonBox);
+    
+    QStringList targets;
+    if (dialog.exec() != QDialog::Accepted) {
+        return targets;
+    }
+    for (int i = 0; i < deviceList->count(); ++i) {
+        QListWidgetItem *item = deviceList->item(i);
+        if (item->checkState() == Qt::Checked) {
+            targets << item->data(Qt::UserRole).toString();
+        }
+    }
+    if (targets.isEmpty()) {
+        QMessageBox::warning(this, "No Target Selected",
+            "Please select at least one SD card.");
+    }
+    return targets;
+}
+
+void StorageManager::setupTargetProgress(const QStringList &targetDevices)
+{
+    qDeleteAll(m_targetLabels);
+    qDeleteAll(m_targetProgressBars);
+    m_targetLabels.clear();
+    m_targetProgressBars.clear();
+    
+    for (const QString &targetDevice : targetDevices) {
+        QLabel *label = new QLabel(targetDevice);
+        label->setStyleSheet("color: #000000; font-size: 9pt;");
+        m_targetProgressLayout->addWidget(label);
+        m_targetLabels << label;
+        
+        QProgressBar *progressBar = new QProgressBar();
+        progressBar->setMaximumHeight(14);
+        progressBar->setStyleSheet(
+            "QProgressBar { border: 1px solid #000000; border-radius: 3px; background-color: #F0F0F0; font-size: 8pt; }"
+            "QProgressBar::chunk { background-color: #000000; }"
+        );
+        m_targetProgressLayout->addWidget(progressBar);
+        m_targetProgressBars << progressBar;
+    }
+}
+
+int StorageManager::zeroBlockPolicy() const
+{
+    if (!m_sparseCheck->isChecked()) {
+        return ImageWriter::WriteZeroBlocks;
+    }
+    // Discarded where the card then reads zeros, zeroed out otherwise
+    return ImageWriter::DiscardZeroBlocks;
+}
+
+bool StorageManager::unmountDevicePartitions(const QString &device)
+{
+    bool success = true;
+    for (const StorageDevice &entry : m_devices) {
+        if (!entry.isMounted) continue;
+        if (entry.device != device &&
+            !(entry.device.startsWith(device) &&
+              QRegularExpression("^p?\\d+$").match(entry.device.mid(device.length())).hasMatch())) {
+            continue;
+        }
+        
+        m_logOutput->append(QString("Unmounting %1 from %2").arg(entry.device, entry.mountPoint));
+        if (umount2(entry.mountPoint.toLocal8Bit().constData(), 0) != 0) {
+            m_logOutput->append(QString("<span style='color: #FF0000;'>Failed to unmount %1: %2</span>")
+                                .arg(entry.mountPoint, QString::fromLocal8Bit(strerror(errno))));
+            success = false;
+        }
+    }
+    return success;
+}
+
+bool StorageManager::isOperationRunning() const
+{
+    return (m_currentProcess && m_currentProcess->state() != QProcess::NotRunning) ||
+           (m_imageWriter && m_imageWriter->isRunning()) ||
+           (m_snapshotWriter && m_snapshotWriter->isRunning()) ||
+           (m_archiveWriter && m_archiveWriter->isRunning());
+}
+
+void StorageManager::onWriterProgress(qint64 bytesWritten, qint64 totalBytes)
+{
+    if (totalBytes <= 0) return;
+    
+    updateTransferProgress(bytesWritten, totalBytes);
+}
+
+void StorageManager::updateTransferProgress(qint64 bytesDone, qint64 totalBytes)
+{
+    // A new total or a step back is a new phase (another operation, or
+    // verification after writing): restart the rate window
+    if (totalBytes != m_transferProgress.totalBytes() || bytesDone < m_transferProgress.bytesDone()) {
+        m_transferProgress.start(totalBytes);
+    }
+    m_transferProgress.update(bytesDone);
+
+    int percent = m_transferProgress.percent();
+    if (m_progressBar->maximum() == 0) {
+        m_progressBar->setMaximum(100);
+    }
+    m_progressBar->setValue(percent);
+    QString remaining = TransferProgress::formatDuration(m_transferProgress.secondsRemaining());
+    m_progressBar->setFormat(remaining.isEmpty() ? QString("%p%") : QString("%p% - %1 left").arg(remaining));
+    emit progressUpdated(percent);
+}
+
+void StorageManager::onWriterThroughput(double bytesPerSecond)
+{
+    m_statusLabel->setText(QString("%1 - %2/s")
+                           .arg(m_currentOperation, formatSize(qint64(bytesPerSecond))));
+}
+
+void StorageManager::onTargetProgress(int target, qint64 bytesWritten, qint64 totalBytes)
+{
+    if (target >= m_targetProgressBars.size() || totalBytes <= 0) return;
+    
+    m_targetProgressBars[target]->setValue(int(bytesWritten * 100 / totalBytes));
+}
+
+void StorageManager::onTargetThroughput(int target, double bytesPerSecond)
+{
+    if (target >= m_targetLabels.size() || !m_imageWriter) return;
+    
+    m_targetLabels[target]->setText(QString("%1 - %2/s")
+                                    .arg(m_imageWriter->targetDevices().value(target),
+                                         formatSize(qint64(bytesPerSecond))));
+}
+
+void StorageManager::onTargetFinished(int target, bool success, const QString &message)
+{
+    if (target >= m_targetLabels.size() || !m_imageWriter) return;
+    
+    QString targetDevice = m_imageWriter->targetDevices().value(target);
+    if (success) {
+        m_targetProgressBars[target]->setValue(100);
+        m_targetLabels[target]->setText(targetDevice + " - done");
+        m_logOutput->append(message);
+    } else {
+        m_targetLabels[target]->setText(targetDevice + " - failed");
+        m_targetLabels[target]->setStyleSheet("color: #FF0000; font-size: 9pt;");
+        m_logOutput->append(QString("<span style='color: #FF0000;'>%1</span>").arg(message));
+    }
+}
+
+void StorageManager::onWriterFinished(bool success, const QString &message)
+{
+    m_progressBar->setFormat("%p%");
+    if (success) {
+        m_statusLabel->setText(m_currentOperation + " completed successfully!");
+        m_progressBar->setValue(100);
+        m_logOutput->append(message);
+        emit operationCompleted(true, m_currentOperation + " completed");
+    } else {
+        m_statusLabel->setText(m_currentOperation + " failed!");
+        m_logOutput->append(QString("<span style='color: #FF0000;'>%1</span>").arg(message));
+        emit operationCompleted(false, m_currentOperation + " failed: " + message);
+    }
+    
+    m_imageWriter->deleteLater();
+    m_imageWriter = nullptr;
+    
+    // Refresh device list after operation
+    QTimer::singleShot(2000, this, &StorageManager::scanStorageDevices);
+}
+
+void StorageManager::onSnapshotFinished(bool success, const QString &message)
+{
+    m_progressBar->setFormat("%p%");
+    if (success) {
+        m_statusLabel->setText(m_currentOperation + " completed successfully!");
+        m_progressBar->setMaximum(100);
+        m_progressBar->setValue(100);
+        m_logOutput->append(message);
+        if (m_snapshotWriter) {
+            m_logOutput->append("Restore it by burning the manifest to a card");
+        }
+        emit operationCompleted(true, m_currentOperation + " completed");
+    } else {
+        m_statusLabel->setText(m_currentOperation + " failed!");
+        m_logOutput->append(QString("<span style='color: #FF0000;'>%1</span>").arg(message));
+        emit operationCompleted(false, m_currentOperation + " failed: " + message);
+    }
+
+    if (m_snapshotWriter) {
+        m_snapshotWriter->deleteLater();
+        m_snapshotWriter = nullptr;
+    }
+    if (m_archiveWriter) {
+        m_archiveWriter->deleteLater();
+        m_archiveWriter = nullptr;
+    }
+}
+
 QString StorageManager::formatSize(qint64 bytes)
 {
     const qint64 kb = 1024;
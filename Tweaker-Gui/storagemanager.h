@@ -15,21 +15,14 @@
 #include <QTimer>
 #include <QProcess>
 #include <QMap>
+#include "blockdevices.h"
+#include "transferprogress.h"
 
 class SystemManager;
-
-struct StorageDevice {
-    QString device;          // e.g., /dev/sda
-    QString mountPoint;      // e.g., /mnt/sda1
-    QString filesystem;      // e.g., ext4, ntfs
-    QString label;          // Volume label
-    QString size;           // Total size
-    QString used;           // Used space
-    QString available;      // Available space
-    bool isRemovable;       // USB, SD card, etc.
-    bool isMounted;         // Currently mounted
-    bool isSystemDrive;     // Contains the OS
-};
+class ImageWriter;
+class SnapshotWriter;
+class ArchiveWriter;
+class DeviceMonitor;
 
 class StorageManager : public QWidget
 {
@@ -45,6 +38,9 @@ signals:
 
 private slots:
     void scanStorageDevices();
+    void updateDevice(const QString &name);
+    void removeDevice(const QString &name);
+    void refreshMounts();
     void onDeviceSelectionChanged();
     void onMountDevice();
     void onUnmountDevice();
@@ -55,6 +51,13 @@ private slots:
     void updateDeviceInfo();
     void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
     void onProcessOutput();
+    void onWriterProgress(qint64 bytesWritten, qint64 totalBytes);
+    void onWriterThroughput(double bytesPerSecond);
+    void onWriterFinished(bool success, const QString &message);
+    void onTargetProgress(int target, qint64 bytesWritten, qint64 totalBytes);
+    void onTargetThroughput(int target, double bytesPerSecond);
+    void onTargetFinished(int target, bool success, const QString &message);
+    void onSnapshotFinished(bool success, const QString &message);
 
 private:
     void setupUI();
@@ -65,8 +68,19 @@ private:
     
     void detectSystemInstallation();
     QString formatSize(qint64 bytes);
+    QString deviceItemText(const StorageDevice &device) const;
+    void updateTargetCombo();
     bool isLiveSystem();
     void executeCommand(const QString &command, const QStringList &args);
+    void startImageWriter(const QString &sourcePath, const QStringList &targetDevices, bool usedBlocksOnly = false);
+    void startSnapshotWriter();
+    void updateTransferProgress(qint64 bytesDone, qint64 totalBytes);
+    void startArchiveWriter(const QString &archivePath, int format, const QStringList &excludes);
+    QStringList selectBurnTargets();
+    void setupTargetProgress(const QStringList &targetDevices);
+    int zeroBlockPolicy() const;
+    bool unmountDevicePartitions(const QString &device);
+    bool isOperationRunning() const;
     
     // UI Components
     QGroupBox *m_systemInfoGroup;
@@ -97,6 +111,10 @@ private:
     QCheckBox *m_includeHomeCheck;
     QCheckBox *m_compressCheck;
     QCheckBox *m_verifyCheck;
+    QCheckBox *m_sparseCheck;
+    QCheckBox *m_verifyZerosCheck;
+    QCheckBox *m_usedBlocksCheck;
+    QCheckBox *m_multiTargetCheck;
     
     // Progress
     QProgressBar *m_progressBar;
@@ -104,17 +122,28 @@ private:
     QTextEdit *m_logOutput;
     QPushButton *m_cancelButton;
     
+    // Per-card progress rows of a multi-target burn
+    QVBoxLayout *m_targetProgressLayout;
+    QList<QLabel *> m_targetLabels;
+    QList<QProgressBar *> m_targetProgressBars;
+    
     // Backend
     SystemManager *m_systemManager;
     QMap<QString, StorageDevice> m_devices;
     QString m_selectedDevice;
     QProcess *m_currentProcess;
-    QTimer *m_scanTimer;
+    ImageWriter *m_imageWriter;
+    SnapshotWriter *m_snapshotWriter;
+    ArchiveWriter *m_archiveWriter;
+    DeviceMonitor *m_deviceMonitor;
+    QTimer *m_scanTimer;    // Polling fallback when uevents are unavailable
     
     // State
     bool m_isLiveSystem;
     QString m_systemDevice;
     QString m_currentOperation;
+    qint64 m_operationTotalBytes;
+    TransferProgress m_transferProgress;
 };
 
 #endif // STORAGEMANAGER_H
\ No newline at end of file
@@ -1,40 +1,113 @@
 #include "systemmanager.h"
+#include "loadedmodulemonitor.h"
+#include "moduleindex.h"
+#include "moduleinfocache.h"
+#include "processrunner.h"
+#include "processsequence.h"
+#include "scriptprogress.h"
+#include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
 #include <QDirIterator>
+#include <QSet>
 #include <QStandardPaths>
 #include <QDateTime>
 
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+namespace {
+
+QString readTextFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return QString();
+    }
+    return QString::fromUtf8(file.readAll());
+}
+
+// A KEY=value field of /etc/os-release, unquoted ("22.04" for VERSION_ID)
+QString osReleaseValue(const QString &key)
+{
+    const QStringList lines = readTextFile("/etc/os-release").split('\n');
+    for (const QString &line : lines) {
+        if (line.startsWith(key + "=")) {
+            QString value = line.mid(key.length() + 1).trimmed();
+            value.remove('"');
+            return value;
+        }
+    }
+    return QString();
+}
+
+// dpkg keeps a file list for every installed package, with an architecture
+// suffix for multi-arch ones
+bool isPackageInstalled(const QString &package)
+{
+    QDir info("/var/lib/dpkg/info");
+    return !info.entryList(QStringList() << package + ".list" << package + ":*.list", QDir::Files).isEmpty();
+}
+
+// This program's --load-modules / --unload-modules mode, which makes the
+// module syscalls itself and needs root for them: one privileged process
+// for a whole stack of modules rather than a modprobe per module
+void startModuleLoader(ProcessRunner *process, const QStringList &arguments)
+{
+    QString self = QCoreApplication::applicationFilePath();
+    if (geteuid() == 0) {
+        process->start(self, arguments);
+    } else {
+        process->start("sudo", QStringList() << self << arguments);
+    }
+}
+
+} // namespace
+
+const char *const SystemManager::AptResource = "apt";
+const char *const SystemManager::BootResource = "boot";
+const char *const SystemManager::ModulesResource = "modules";
+const char *const SystemManager::GraphicsResource = "graphics";
+const char *const SystemManager::WorkspaceResource = "workspace";
+
+QString SystemManager::deviceResource(const QString &path)
+{
+    return "device:" + QDir::cleanPath(path);
+}
+
 SystemManager::SystemManager(QObject *parent)
     : QObject(parent)
-    , m_currentProcess(nullptr)
-    , m_currentOperation("")
-    , m_progressTimer(new QTimer(this))
-    , m_simulatedProgress(0)
-{
-    connect(m_progressTimer, &QTimer::timeout, [this]() {
-        m_simulatedProgress += 2;
-        if (m_simulatedProgress <= 95) {
-            emit progressUpdated(m_simulatedProgress);
-        }
+    , m_scheduler(new JobScheduler(this))
+    , m_moduleInfoCache(new ModuleInfoCache(this))
+{
+    connect(m_scheduler, &JobScheduler::cancelRequested, this, &SystemManager::onCancelRequested);
+    connect(m_scheduler, &JobScheduler::jobFinished, this, [this](int, bool success, const QString &message) {
+        emit operationCompleted(success, message);
     });
 }
 
 void SystemManager::extractDrivers()
 {
-    if (m_currentProcess && m_currentProcess->state() != QProcess::NotRunning) {
-        emit statusUpdated("Another operation is already running");
-        return;
-    }
-    
-    m_currentOperation = "extract_drivers";
-    emit statusUpdated("Starting Orange Pi 5+ driver extraction...");
-    
-    if (!checkPrerequisites()) {
-        emit operationCompleted(false, "Prerequisites check failed");
-        return;
-    }
+    // Reads the live /boot and modules, writes only the extraction tree
+    QVector<JobResource> resources;
+    resources << JobResource::shared(BootResource) << JobResource::shared(ModulesResource)
+              << JobResource::exclusive(WorkspaceResource);
     
+    scheduleOperation("extract_drivers", "Extract Orange Pi 5+ drivers", resources, [this](int job) {
+        emit statusUpdated("Starting Orange Pi 5+ driver extraction...");
+        
+        checkPrerequisites(job, [this, job](bool ok) {
+            if (!ok) {
+                finishOperation(job, false, "Prerequisites check failed");
+                return;
+            }
+            startDriverExtraction(job);
+        });
+    });
+}
+
+void SystemManager::startDriverExtraction(int job)
+{
     // Detect GPU drivers in /gpu directory
     QString gpuPath = detectGpuDrivers();
     
@@ -58,7 +131,7 @@ void SystemManager::extractDrivers()
                       .arg(kernelFiles.size()).arg(dtFiles.size()).arg(moduleFiles.size()));
     
     if (kernelFiles.isEmpty() && dtFiles.isEmpty() && moduleFiles.isEmpty() && gpuPath.isEmpty()) {
-        emit operationCompleted(false, 
+        finishOperation(job, false, 
             "No extractable files found in /gpu or /upgrade directories. "
             "Please ensure upgrade.img is extracted or kernel files are present.");
         return;
@@ -74,16 +147,10 @@ void SystemManager::extractDrivers()
     QDir().mkpath(destPath + "/gpu");
     
     // Start extraction process
-    m_currentProcess = new QProcess(this);
-    connect(m_currentProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &SystemManager::onProcessFinished);
-    connect(m_currentProcess, &QProcess::errorOccurred, this, &SystemManager::onProcessError);
-    connect(m_currentProcess, &QProcess::readyReadStandardOutput, this, &SystemManager::onProcessOutput);
-    connect(m_currentProcess, &QProcess::readyReadStandardError, this, &SystemManager::onProcessOutput);
+    ProcessRunner *process = createOperationProcess(job);
     
     // Create comprehensive extraction script
-    QString script = QString(
-        "#!/bin/bash\n"
+    QString script = "#!/bin/bash\n" + ScriptProgress::shellFunctions(6) + QString(
         "set -e\n"
         "UPGRADE_BASE='%1'\n"
         "GPU_PATH='%2'\n"
@@ -125,6 +192,7 @@ void SystemManager::extractDrivers()
         "log_copy \"🔍 Starting comprehensive Orange Pi 5+ extraction...\"\n"
         "\n"
         "# Extract GPU drivers from /gpu directory\n"
+        "progress 1 \"Extracting GPU drivers\"\n"
         "if [ -n \"$GPU_PATH\" ] && [ -d \"$GPU_PATH\" ]; then\n"
         "    log_copy \"📱 Extracting GPU drivers from $GPU_PATH...\"\n"
         "    \n"
@@ -142,6 +210,7 @@ void SystemManager::extractDrivers()
         "fi\n"
         "\n"
         "# Extract kernel and system files from upgrade directory\n"
+        "progress 2 \"Extracting kernel files\"\n"
         "if [ -d \"$UPGRADE_BASE\" ]; then\n"
         "    log_copy \"🐧 Extracting kernel files from $UPGRADE_BASE...\"\n"
         "    \n"
@@ -163,12 +232,14 @@ void SystemManager::extractDrivers()
         "    done\n"
         "    \n"
         "    # Find and copy device tree files\n"
+        "    progress 3 \"Extracting device tree files\"\n"
         "    log_copy \"🌳 Extracting device tree files...\"\n"
         "    find \"$UPGRADE_BASE\" -name '*.dtb' -o -name '*.dts' | while read dt_file; do\n"
         "        safe_copy_file \"$dt_file\" \"$DEST/boot/dtb\" \"device tree file\"\n"
         "    done\n"
         "    \n"
         "    # Find and copy module directories\n"
+        "    progress 4 \"Extracting kernel modules\"\n"
         "    log_copy \"🔧 Extracting kernel modules...\"\n"
         "    find \"$UPGRADE_BASE\" -path '*/lib/modules/*' -type d -name '[0-9]*' | while read module_dir; do\n"
         "        module_version=$(basename \"$module_dir\")\n"
@@ -176,6 +247,7 @@ void SystemManager::extractDrivers()
         "    done\n"
         "    \n"
         "    # Find and copy firmware\n"
+        "    progress 5 \"Extracting firmware\"\n"
         "    log_copy \"💾 Extracting firmware...\"\n"
         "    find \"$UPGRADE_BASE\" -path '*/lib/firmware' -type d | while read fw_dir; do\n"
         "        safe_copy_dir \"$fw_dir\" \"$DEST/lib/firmware\" \"firmware files\"\n"
@@ -183,6 +255,7 @@ void SystemManager::extractDrivers()
         "fi\n"
         "\n"
         "# Create extraction manifest\n"
+        "progress 6 \"Writing extraction manifest\"\n"
         "MANIFEST=\"$DEST/extraction_manifest.txt\"\n"
         "echo \"# Arm-Pi Tweaker Extraction Manifest\" > \"$MANIFEST\"\n"
         "echo \"Extraction Date: $(date)\" >> \"$MANIFEST\"\n"
@@ -207,97 +280,108 @@ void SystemManager::extractDrivers()
         scriptFile.close();
         
         // Make script executable
-        QProcess::execute("chmod", QStringList() << "+x" << scriptPath);
+        QFile::setPermissions(scriptPath, QFile::permissions(scriptPath) | QFile::ExeOwner);
         
         // Start extraction with progress tracking
-        m_simulatedProgress = 0;
-        m_progressTimer->start(1000);
-        emit progressUpdated(0);
+        startProgress(job);
         
-        m_currentProcess->start("bash", QStringList() << scriptPath);
+        process->start("bash", QStringList() << scriptPath);
     } else {
-        emit operationCompleted(false, "Failed to create extraction script");
+        finishOperation(job, false, "Failed to create extraction script");
     }
 }
 
 void SystemManager::runUbuntuUpgrade()
 {
-    if (m_currentProcess && m_currentProcess->state() != QProcess::NotRunning) {
-        emit statusUpdated("Another operation is already running");
-        return;
-    }
-    
-    m_currentOperation = "ubuntu_upgrade";
-    emit statusUpdated("Preparing Ubuntu upgrade to 24.10...");
-    
-    // Check prerequisites first
-    if (!checkUpgradePrerequisites()) {
-        emit operationCompleted(false, "Prerequisites check failed for Ubuntu upgrade");
-        return;
-    }
-    
-    // Prepare system for upgrade
-    if (!prepareSystemForUpgrade()) {
-        emit operationCompleted(false, "Failed to prepare system for upgrade");
-        return;
-    }
+    // A release upgrade replaces everything there is
+    QVector<JobResource> resources;
+    resources << JobResource::exclusive(AptResource) << JobResource::exclusive(BootResource)
+              << JobResource::exclusive(ModulesResource) << JobResource::exclusive(GraphicsResource);
     
+    scheduleOperation("ubuntu_upgrade", "Ubuntu upgrade to 24.10", resources, [this](int job) {
+        emit statusUpdated("Preparing Ubuntu upgrade to 24.10...");
+        
+        // Check prerequisites first, then prepare the system
+        checkUpgradePrerequisites(job, [this, job](bool ok) {
+            if (!ok) {
+                finishOperation(job, false, "Prerequisites check failed for Ubuntu upgrade");
+                return;
+            }
+            prepareSystemForUpgrade(job, [this, job](bool ok) {
+                if (!ok) {
+                    finishOperation(job, false, "Failed to prepare system for upgrade");
+                    return;
+                }
+                startUbuntuUpgrade(job);
+            });
+        });
+    });
+}
+
+void SystemManager::startUbuntuUpgrade(int job)
+{
     emit statusUpdated("Starting Ubuntu upgrade to 24.10...");
     
-    m_currentProcess = new QProcess(this);
-    connect(m_currentProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &SystemManager::onProcessFinished);
-    connect(m_currentProcess, &QProcess::errorOccurred, this, &SystemManager::onProcessError);
-    connect(m_currentProcess, &QProcess::readyReadStandardOutput, this, &SystemManager::onProcessOutput);
-    connect(m_currentProcess, &QProcess::readyReadStandardError, this, &SystemManager::onProcessOutput);
-    
-    m_simulatedProgress = 0;
-    m_progressTimer->start(2000); // Slower progress for long upgrade
-    emit progressUpdated(0);
+    ProcessRunner *process = createOperationProcess(job);
+    startProgress(job);
     
     // Set environment for non-interactive upgrade
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
     env.insert("DEBIAN_FRONTEND", "noninteractive");
     env.insert("DEBIAN_PRIORITY", "critical");
-    m_currentProcess->setProcessEnvironment(env);
+    process->setProcessEnvironment(env);
     
-    // Run the actual Ubuntu upgrade
-    m_currentProcess->start("bash", QStringList() << "-c" << 
+    // Run the actual Ubuntu upgrade; do-release-upgrade has no status fd of
+    // its own, so it is one step, timed like the rest
+    process->start("bash", QStringList() << "-c" << ScriptProgress::shellFunctions(1) +
+        "progress 1 \"Running do-release-upgrade\"\n"
         "sudo DEBIAN_FRONTEND=noninteractive do-release-upgrade -f DistUpgradeViewNonInteractive -d");
 }
 
 void SystemManager::patchSystem()
 {
-    if (m_currentProcess && m_currentProcess->state() != QProcess::NotRunning) {
-        emit statusUpdated("Another operation is already running");
+    QString description = "Patch system with Orange Pi 5+ support";
+    if (isScheduled(description)) {
         return;
     }
     
-    m_currentOperation = "patch_system";
     emit statusUpdated("Preparing to patch system with Orange Pi 5+ support...");
     
     // Verify upgrade files exist
     QString upgradeDir = "/home/snake/Arm-Pi-Tweaker/upgrade";
     if (!QDir(upgradeDir).exists()) {
+        emit statusUpdated("❌ Upgrade directory not found - run driver extraction first");
         emit operationCompleted(false, "Upgrade directory not found - run driver extraction first");
         return;
     }
     
-    // Create backup before patching
-    createBackup();
+    // Create backup before patching; the patch waits for it and is dropped
+    // if it fails or is cancelled
+    QVector<JobResource> backupResources;
+    backupResources << JobResource::shared(BootResource) << JobResource::shared(ModulesResource)
+                    << JobResource::exclusive(WorkspaceResource);
+    int backup = scheduleOperation("backup", "Back up /boot and /lib", backupResources,
+                                   [this](int job) { createBackup(job); });
+    if (backup < 0) {
+        return;
+    }
     
+    QVector<JobResource> resources;
+    resources << JobResource::exclusive(BootResource) << JobResource::exclusive(ModulesResource)
+              << JobResource::exclusive(GraphicsResource) << JobResource::shared(WorkspaceResource);
+    scheduleOperation("patch_system", description, resources, [this, upgradeDir](int job) {
+        startSystemPatch(job, upgradeDir);
+    }, QList<int>() << backup);
+}
+
+void SystemManager::startSystemPatch(int job, const QString &upgradeDir)
+{
     emit statusUpdated("Patching system with Orange Pi 5+ support...");
     
-    m_currentProcess = new QProcess(this);
-    connect(m_currentProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &SystemManager::onProcessFinished);
-    connect(m_currentProcess, &QProcess::errorOccurred, this, &SystemManager::onProcessError);
-    connect(m_currentProcess, &QProcess::readyReadStandardOutput, this, &SystemManager::onProcessOutput);
-    connect(m_currentProcess, &QProcess::readyReadStandardError, this, &SystemManager::onProcessOutput);
+    ProcessRunner *process = createOperationProcess(job);
     
     // Create comprehensive patching script
-    QString script = QString(
-        "#!/bin/bash\n"
+    QString script = "#!/bin/bash\n" + ScriptProgress::shellFunctions(10) + QString(
         "set -e\n"
         "UPGRADE_DIR='%1'\n"
         "PATCHED_COUNT=0\n"
@@ -342,6 +426,7 @@ void SystemManager::patchSystem()
         "log_patch \"🚀 Starting Orange Pi 5+ system patching...\"\n"
         "\n"
         "# Install kernel files\n"
+        "progress 1 \"Installing kernel files\"\n"
         "log_patch \"📦 Installing kernel files...\"\n"
         "safe_patch_glob \"$UPGRADE_DIR/boot/vmlinuz*\" \"/boot/\" \"kernel image\"\n"
         "safe_patch_glob \"$UPGRADE_DIR/boot/initrd*\" \"/boot/\" \"initrd image\"\n"
@@ -349,6 +434,7 @@ void SystemManager::patchSystem()
         "safe_patch_glob \"$UPGRADE_DIR/boot/System.map-*\" \"/boot/\" \"kernel symbols\"\n"
         "\n"
         "# Install device tree files\n"
+        "progress 2 \"Installing device tree files\"\n"
         "log_patch \"🌳 Installing device tree files...\"\n"
         "if [ -d \"$UPGRADE_DIR/boot/dtbs\" ]; then\n"
         "    safe_patch \"$UPGRADE_DIR/boot/dtbs\" \"/boot/\" \"device tree files\"\n"
@@ -358,6 +444,7 @@ void SystemManager::patchSystem()
         "fi\n"
         "\n"
         "# Install kernel modules\n"
+        "progress 3 \"Installing kernel modules\"\n"
         "log_patch \"🔧 Installing kernel modules...\"\n"
         "if [ -d \"$UPGRADE_DIR/lib/modules\" ]; then\n"
         "    for module_dir in \"$UPGRADE_DIR\"/lib/modules/*; do\n"
@@ -369,6 +456,7 @@ void SystemManager::patchSystem()
         "fi\n"
         "\n"
         "# Install firmware\n"
+        "progress 4 \"Installing firmware\"\n"
         "log_patch \"💾 Installing firmware...\"\n"
         "if [ -d \"$UPGRADE_DIR/lib/firmware\" ]; then\n"
         "    # Create firmware directory if it doesn't exist\n"
@@ -377,6 +465,7 @@ void SystemManager::patchSystem()
         "fi\n"
         "\n"
         "# Install GPU drivers\n"
+        "progress 5 \"Installing GPU drivers\"\n"
         "log_patch \"🎮 Installing GPU drivers...\"\n"
         "if [ -d \"$UPGRADE_DIR/usr/lib/aarch64-linux-gnu\" ]; then\n"
         "    sudo mkdir -p /usr/lib/aarch64-linux-gnu\n"
@@ -390,6 +479,7 @@ void SystemManager::patchSystem()
         "fi\n"
         "\n"
         "# Install X11 configuration\n"
+        "progress 6 \"Installing X11 configuration\"\n"
         "log_patch \"🖥️ Installing X11 configuration...\"\n"
         "if [ -d \"$UPGRADE_DIR/etc/X11\" ]; then\n"
         "    sudo mkdir -p /etc/X11\n"
@@ -405,6 +495,7 @@ void SystemManager::patchSystem()
         "log_patch \"⚙️ Updating system configuration...\"\n"
         "\n"
         "# Update initramfs for all installed kernels\n"
+        "progress 7 \"Updating initramfs\"\n"
         "log_patch \"🔄 Updating initramfs...\"\n"
         "if sudo update-initramfs -u -k all; then\n"
         "    log_patch \"✅ Initramfs updated successfully\"\n"
@@ -416,6 +507,7 @@ void SystemManager::patchSystem()
         "fi\n"
         "\n"
         "# Update GRUB bootloader\n"
+        "progress 8 \"Updating GRUB\"\n"
         "log_patch \"🥾 Updating GRUB bootloader...\"\n"
         "if sudo update-grub; then\n"
         "    log_patch \"✅ GRUB updated successfully\"\n"
@@ -424,10 +516,12 @@ void SystemManager::patchSystem()
         "fi\n"
         "\n"
         "# Update library cache\n"
+        "progress 9 \"Updating library cache\"\n"
         "log_patch \"📚 Updating library cache...\"\n"
         "sudo ldconfig\n"
         "\n"
         "# Create patch manifest\n"
+        "progress 10 \"Writing patch manifest\"\n"
         "MANIFEST_FILE=\"/home/snake/Arm-Pi-Tweaker/patch_manifest_$(date +%%Y%%m%%d_%%H%%M%%S).txt\"\n"
         "echo \"# Orange Pi 5+ System Patch Manifest\" > \"$MANIFEST_FILE\"\n"
         "echo \"Patch Date: $(date)\" >> \"$MANIFEST_FILE\"\n"
@@ -453,51 +547,50 @@ void SystemManager::patchSystem()
         out << script;
         scriptFile.close();
         
-        QProcess::execute("chmod", QStringList() << "+x" << scriptPath);
+        QFile::setPermissions(scriptPath, QFile::permissions(scriptPath) | QFile::ExeOwner);
         
-        m_simulatedProgress = 0;
-        m_progressTimer->start(1000);
-        emit progressUpdated(0);
+        startProgress(job);
         
-        m_currentProcess->start("bash", QStringList() << scriptPath);
+        process->start("bash", QStringList() << scriptPath);
     } else {
-        emit operationCompleted(false, "Failed to create patching script");
+        finishOperation(job, false, "Failed to create patching script");
     }
 }
 
 void SystemManager::rollbackUpgrade()
 {
-    if (m_currentProcess && m_currentProcess->state() != QProcess::NotRunning) {
-        emit statusUpdated("Another operation is already running");
-        return;
-    }
+    QVector<JobResource> resources;
+    resources << JobResource::exclusive(BootResource) << JobResource::exclusive(ModulesResource)
+              << JobResource::shared(WorkspaceResource);
     
-    m_currentOperation = "rollback";
+    scheduleOperation("rollback", "Roll back upgrade", resources, [this](int job) {
+        startRollback(job);
+    });
+}
+
+void SystemManager::startRollback(int job)
+{
     emit statusUpdated("Rolling back upgrade...");
     
     QString backupDir = "/home/snake/Arm-Pi-Tweaker/backup";
     if (!QDir(backupDir).exists()) {
-        emit operationCompleted(false, "No backup found to rollback to");
+        finishOperation(job, false, "No backup found to rollback to");
         return;
     }
     
-    m_currentProcess = new QProcess(this);
-    connect(m_currentProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &SystemManager::onProcessFinished);
-    connect(m_currentProcess, &QProcess::errorOccurred, this, &SystemManager::onProcessError);
-    connect(m_currentProcess, &QProcess::readyReadStandardOutput, this, &SystemManager::onProcessOutput);
+    ProcessRunner *process = createOperationProcess(job);
     
     // Create rollback script
-    QString script = QString(
-        "#!/bin/bash\n"
+    QString script = "#!/bin/bash\n" + ScriptProgress::shellFunctions(4) + QString(
         "set -e\n"
         "BACKUP_DIR='%1'\n"
-        "echo 'Restoring from backup...'\n"
+        "progress 1 \"Restoring /boot from backup\"\n"
         "sudo cp -rv \"$BACKUP_DIR\"/boot/* /boot/\n"
+        "progress 2 \"Restoring /lib from backup\"\n"
         "sudo cp -rv \"$BACKUP_DIR\"/lib/* /lib/\n"
-        "echo 'Updating initramfs...'\n"
+        "progress 3 \"Updating initramfs\"\n"
         "sudo update-initramfs -u\n"
-        "echo 'Updating GRUB...'\n"
+        "progress 4 \"Updating GRUB\"\n"
         "sudo update-grub\n"
         "echo 'Rollback completed successfully'\n"
     ).arg(backupDir);
@@ -509,32 +602,38 @@ void SystemManager::rollbackUpgrade()
         out << script;
         scriptFile.close();
         
-        QProcess::execute("chmod", QStringList() << "+x" << scriptPath);
+        QFile::setPermissions(scriptPath, QFile::permissions(scriptPath) | QFile::ExeOwner);
         
-        m_simulatedProgress = 0;
-        m_progressTimer->start(500);
-        emit progressUpdated(0);
+        startProgress(job);
         
-        m_currentProcess->start("bash", QStringList() << scriptPath);
+        process->start("bash", QStringList() << scriptPath);
     } else {
-        emit operationCompleted(false, "Failed to create rollback script");
+        finishOperation(job, false, "Failed to create rollback script");
     }
 }
 
-void SystemManager::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+void SystemManager::onProcessFinished(int job)
 {
-    m_progressTimer->stop();
-    emit progressUpdated(100);
+    ProcessRunner *process = m_operations[job].process;
+    ProcessResult result = process->result();
+    process->deleteLater();
+    m_operations[job].process = nullptr;
     
-    QString operation = m_currentOperation;
-    m_currentOperation.clear();
+    if (result.started) {
+        emit progressUpdated(100);
+        m_scheduler->setProgress(job, 100);
+    }
     
-    if (m_currentProcess) {
-        m_currentProcess->deleteLater();
-        m_currentProcess = nullptr;
+    // Where the time went, step by step
+    ScriptProgress &progress = m_operations[job].progress;
+    progress.finish();
+    if (!progress.steps().isEmpty()) {
+        emit statusUpdated(QString("⏱️ Step times: %1").arg(progress.timingSummary()));
     }
     
-    if (exitCode == 0 && exitStatus == QProcess::NormalExit) {
+    QString operation = m_operations.value(job).name;
+    
+    if (result.succeeded()) {
         QString message;
         if (operation == "extract_drivers") {
             message = "✅ Orange Pi 5+ drivers extracted successfully";
@@ -544,79 +643,164 @@ void SystemManager::onProcessFinished(int exitCode, QProcess::ExitStatus exitSta
             message = "✅ Orange Pi 5+ support patched successfully";
         } else if (operation == "rollback") {
             message = "✅ Rollback completed successfully";
+        } else if (operation == "load_module") {
+            message = "✅ Kernel module loaded";
+        } else if (operation == "unload_module") {
+            message = "✅ Kernel module unloaded";
         } else {
             message = "✅ Operation completed successfully";
         }
         
         emit statusUpdated(message);
-        emit operationCompleted(true, message);
+        finishOperation(job, true, message);
     } else {
-        QString message = QString("❌ Operation failed with exit code %1").arg(exitCode);
+        QString message;
+        if (result.started && !result.crashed && !result.timedOut && !result.cancelled) {
+            message = QString("❌ Operation failed with exit code %1").arg(result.exitCode);
+        } else {
+            message = QString("❌ %1").arg(result.errorMessage());
+        }
         emit statusUpdated(message);
-        emit operationCompleted(false, message);
+        finishOperation(job, false, message);
+    }
+}
+
+void SystemManager::onProcessOutput(int job, const QString &line)
+{
+    if (m_operations.contains(job)) {
+        ScriptProgress &progress = m_operations[job].progress;
+        int percent = progress.percent();
+        QString label = progress.label();
+        if (progress.parseLine(line)) {
+            if (progress.label() != label && !progress.label().isEmpty()) {
+                emit statusUpdated(progress.label() + "...");
+            }
+            if (progress.percent() != percent) {
+                emit progressUpdated(progress.percent());
+                m_scheduler->setProgress(job, progress.percent());
+            }
+            return;
+        }
     }
+    
+    QString output = line.trimmed();
+    if (!output.isEmpty()) {
+        emit statusUpdated(output);
+    }
+}
+
+bool SystemManager::isBusy() const
+{
+    return !m_scheduler->isIdle();
+}
+
+void SystemManager::cancelJob(int job)
+{
+    m_scheduler->cancel(job);
 }
 
-void SystemManager::onProcessError(QProcess::ProcessError error)
-{
-    m_progressTimer->stop();
-    
-    QString errorMessage;
-    switch (error) {
-        case QProcess::FailedToStart:
-            errorMessage = "Process failed to start";
-            break;
-        case QProcess::Crashed:
-            errorMessage = "Process crashed";
-            break;
-        case QProcess::Timedout:
-            errorMessage = "Process timed out";
-            break;
-        default:
-            errorMessage = "Unknown process error";
-            break;
+void SystemManager::onCancelRequested(int job)
+{
+    // Jobs submitted by other classes handle their own
+    if (!m_operations.contains(job)) {
+        return;
     }
     
-    emit statusUpdated(QString("❌ %1").arg(errorMessage));
-    emit operationCompleted(false, errorMessage);
+    const Operation &operation = m_operations[job];
+    if (operation.step) {
+        operation.step->cancel();
+    }
+    if (operation.sequence) {
+        operation.sequence->cancel();
+    }
+    if (operation.process) {
+        operation.process->cancel();
+    }
+}
+
+int SystemManager::scheduleOperation(const QString &name, const QString &description,
+                                     const QVector<JobResource> &resources,
+                                     const std::function<void(int job)> &start,
+                                     const QList<int> &dependencies)
+{
+    if (isScheduled(description)) {
+        return -1;
+    }
     
-    if (m_currentProcess) {
-        m_currentProcess->deleteLater();
-        m_currentProcess = nullptr;
+    return m_scheduler->submit(description, resources, [this, name, start](int job) {
+        Operation operation;
+        operation.name = name;
+        m_operations.insert(job, operation);
+        start(job);
+    }, dependencies);
+}
+
+bool SystemManager::isScheduled(const QString &description)
+{
+    if (!m_scheduler->hasJob(description)) {
+        return false;
     }
+    emit statusUpdated(QString("%1 is already queued").arg(description));
+    return true;
 }
 
-void SystemManager::onProcessOutput()
+void SystemManager::finishOperation(int job, bool success, const QString &message)
 {
-    if (m_currentProcess) {
-        QByteArray data = m_currentProcess->readAllStandardOutput();
-        QString output = QString::fromUtf8(data).trimmed();
-        if (!output.isEmpty()) {
-            emit statusUpdated(output);
-        }
+    Operation operation = m_operations.take(job);
+    if (operation.process) {
+        operation.process->deleteLater();
     }
+    m_scheduler->finish(job, success, message);
 }
 
-bool SystemManager::checkPrerequisites()
+void SystemManager::startProgress(int job)
 {
-    // Check if running as root or can sudo
-    QProcess process;
-    process.start("id", QStringList() << "-u");
-    process.waitForFinished();
+    m_operations[job].progress.start();
     
-    if (process.readAllStandardOutput().trimmed() != "0") {
-        // Not root, check if sudo is available
-        QProcess sudoCheck;
-        sudoCheck.start("sudo", QStringList() << "-n" << "true");
-        sudoCheck.waitForFinished();
-        
-        if (sudoCheck.exitCode() != 0) {
-            emit statusUpdated("⚠️ Root privileges required. Please run with sudo or configure passwordless sudo.");
-            return false;
+    emit progressUpdated(0);
+    m_scheduler->setProgress(job, 0);
+}
+
+ProcessRunner *SystemManager::createOperationProcess(int job)
+{
+    ProcessRunner *process = new ProcessRunner(this);
+    connect(process, &ProcessRunner::finished, this, [this, job]() { onProcessFinished(job); });
+    connect(process, &ProcessRunner::outputLine, this, [this, job](const QString &line) { onProcessOutput(job, line); });
+    connect(process, &ProcessRunner::errorLine, this, [this, job](const QString &line) { onProcessOutput(job, line); });
+    m_operations[job].process = process;
+    return process;
+}
+
+void SystemManager::runStep(int job, const QString &program, const QStringList &arguments, int timeoutMs,
+                            const std::function<void(const ProcessResult &)> &onFinished, bool showOutput)
+{
+    ProcessRunner *step = ProcessRunner::run(program, arguments, this, [this, job, onFinished](const ProcessResult &result) {
+        if (m_operations.contains(job)) {
+            m_operations[job].step = nullptr;
         }
+        onFinished(result);
+    }, timeoutMs);
+    m_operations[job].step = step;
+    
+    if (showOutput) {
+        connect(step, &ProcessRunner::outputLine, this, [this, job](const QString &line) { onProcessOutput(job, line); });
+    }
+}
+
+void SystemManager::checkPrerequisites(int job, const std::function<void(bool)> &onChecked)
+{
+    // Root needs nothing more; otherwise sudo has to work without a password
+    if (geteuid() == 0) {
+        onChecked(true);
+        return;
     }
     
-    return true;
+    runStep(job, "sudo", QStringList() << "-n" << "true", 10000, [this, onChecked](const ProcessResult &result) {
+        if (!result.succeeded()) {
+            emit statusUpdated("⚠️ Root privileges required. Please run with sudo or configure passwordless sudo.");
+        }
+        onChecked(result.succeeded());
+    });
 }
 
 QString SystemManager::getUpgradeSourcePath()
@@ -690,155 +874,160 @@ QStringList SystemManager::findFilesInDirectory(const QString &directory, const
     return foundFiles;
 }
 
-bool SystemManager::checkUpgradePrerequisites()
+void SystemManager::checkUpgradePrerequisites(int job, const std::function<void(bool)> &onChecked)
 {
     emit statusUpdated("Checking upgrade prerequisites...");
     
     // Check disk space (need at least 10GB free)
     if (!checkDiskSpace()) {
         emit statusUpdated("❌ Insufficient disk space for upgrade");
-        return false;
-    }
-    
-    // Check internet connectivity
-    QProcess networkCheck;
-    networkCheck.start("ping", QStringList() << "-c" << "1" << "archive.ubuntu.com");
-    networkCheck.waitForFinished(5000);
-    
-    if (networkCheck.exitCode() != 0) {
-        emit statusUpdated("❌ No internet connection to Ubuntu repositories");
-        return false;
+        onChecked(false);
+        return;
     }
     
     // Check current Ubuntu version
-    QProcess versionCheck;
-    versionCheck.start("lsb_release", QStringList() << "-r" << "-s");
-    versionCheck.waitForFinished(2000);
-    
-    QString currentVersion = versionCheck.readAllStandardOutput().trimmed();
+    QString currentVersion = osReleaseValue("VERSION_ID");
     if (!currentVersion.startsWith("22.04")) {
         emit statusUpdated(QString("❌ Current version %1 is not supported for upgrade").arg(currentVersion));
-        return false;
+        onChecked(false);
+        return;
     }
     
-    emit statusUpdated("✅ Prerequisites check passed");
-    return true;
+    // Check internet connectivity
+    runStep(job, "ping", QStringList() << "-c" << "1" << "archive.ubuntu.com", 5000,
+            [this, onChecked](const ProcessResult &result) {
+        if (!result.succeeded()) {
+            emit statusUpdated("❌ No internet connection to Ubuntu repositories");
+            onChecked(false);
+            return;
+        }
+        
+        emit statusUpdated("✅ Prerequisites check passed");
+        onChecked(true);
+    });
 }
 
-bool SystemManager::prepareSystemForUpgrade()
+void SystemManager::prepareSystemForUpgrade(int job, const std::function<void(bool)> &onPrepared)
 {
     emit statusUpdated("Preparing system for upgrade...");
     
-    // Update package lists
-    if (!updatePackageLists()) {
-        return false;
-    }
-    
-    // Fix any broken packages
-    if (!fixBrokenPackages()) {
-        return false;
+    // Update package lists, fix any broken packages, then set up the upgrader
+    updatePackageLists(job, [this, job, onPrepared](bool ok) {
+        if (!ok) {
+            onPrepared(false);
+            return;
+        }
+        fixBrokenPackages(job, [this, job, onPrepared](bool ok) {
+            if (!ok) {
+                onPrepared(false);
+                return;
+            }
+            installUpdateManager(job, onPrepared);
+        });
+    });
+}
+
+void SystemManager::installUpdateManager(int job, const std::function<void(bool)> &onInstalled)
+{
+    // Install update-manager-core if not present
+    if (isPackageInstalled("update-manager-core")) {
+        enableReleaseUpgrades(job, onInstalled);
+        return;
     }
     
-    // Install update-manager-core if not present
-    QProcess checkManager;
-    checkManager.start("dpkg", QStringList() << "-l" << "update-manager-core");
-    checkManager.waitForFinished(3000);
-    
-    if (checkManager.exitCode() != 0) {
-        emit statusUpdated("Installing update-manager-core...");
-        QProcess installManager;
-        installManager.start("sudo", QStringList() << "apt" << "install" << "-y" << "update-manager-core");
-        installManager.waitForFinished(60000);
-        
-        if (installManager.exitCode() != 0) {
+    emit statusUpdated("Installing update-manager-core...");
+    runStep(job, "sudo", QStringList() << "apt" << "install" << "-y" << "update-manager-core", 60000,
+            [this, job, onInstalled](const ProcessResult &result) {
+        if (!result.succeeded()) {
             emit statusUpdated("❌ Failed to install update-manager-core");
-            return false;
+            onInstalled(false);
+            return;
         }
-    }
-    
+        enableReleaseUpgrades(job, onInstalled);
+    }, true);
+}
+
+void SystemManager::enableReleaseUpgrades(int job, const std::function<void(bool)> &onEnabled)
+{
     // Enable development release upgrades
-    QProcess enableDevel;
-    enableDevel.start("sudo", QStringList() << "sed" << "-i" << "s/Prompt=lts/Prompt=normal/" << "/etc/update-manager/release-upgrades");
-    enableDevel.waitForFinished(3000);
-    
-    emit statusUpdated("✅ System prepared for upgrade");
-    return true;
+    runStep(job, "sudo", QStringList() << "sed" << "-i" << "s/Prompt=lts/Prompt=normal/" << "/etc/update-manager/release-upgrades", 3000,
+            [this, onEnabled](const ProcessResult &result) {
+        if (result.cancelled) {
+            onEnabled(false);
+            return;
+        }
+        emit statusUpdated("✅ System prepared for upgrade");
+        onEnabled(true);
+    });
 }
 
 bool SystemManager::checkDiskSpace()
 {
-    QProcess dfCheck;
-    dfCheck.start("df", QStringList() << "/" << "--output=avail" << "-B1G");
-    dfCheck.waitForFinished(3000);
-    
-    QString output = dfCheck.readAllStandardOutput();
-    QStringList lines = output.split('\n');
-    if (lines.size() >= 2) {
-        bool ok;
-        int availableGB = lines[1].trimmed().toInt(&ok);
-        if (ok && availableGB >= 10) {
-            emit statusUpdated(QString("✅ Sufficient disk space: %1GB available").arg(availableGB));
-            return true;
-        } else {
-            emit statusUpdated(QString("❌ Insufficient disk space: %1GB available, need 10GB").arg(availableGB));
-            return false;
-        }
+    struct statvfs root;
+    if (statvfs("/", &root) != 0) {
+        emit statusUpdated("⚠️ Could not determine disk space, proceeding anyway");
+        return true;
     }
     
-    emit statusUpdated("⚠️ Could not determine disk space, proceeding anyway");
-    return true;
+    qint64 availableGB = qint64(root.f_bavail) * root.f_frsize / (1024 * 1024 * 1024);
+    if (availableGB >= 10) {
+        emit statusUpdated(QString("✅ Sufficient disk space: %1GB available").arg(availableGB));
+        return true;
+    }
+    
+    emit statusUpdated(QString("❌ Insufficient disk space: %1GB available, need 10GB").arg(availableGB));
+    return false;
 }
 
-bool SystemManager::updatePackageLists()
+void SystemManager::updatePackageLists(int job, const std::function<void(bool)> &onUpdated)
 {
     emit statusUpdated("Updating package lists...");
     
-    QProcess aptUpdate;
-    aptUpdate.start("sudo", QStringList() << "apt" << "update");
-    aptUpdate.waitForFinished(120000); // 2 minutes timeout
-    
-    if (aptUpdate.exitCode() != 0) {
-        QString error = aptUpdate.readAllStandardError();
-        emit statusUpdated(QString("❌ Failed to update package lists: %1").arg(error));
-        return false;
-    }
-    
-    emit statusUpdated("✅ Package lists updated");
-    return true;
+    runStep(job, "sudo", QStringList() << "apt" << "update", 120000, [this, onUpdated](const ProcessResult &result) {
+        if (!result.succeeded()) {
+            emit statusUpdated(QString("❌ Failed to update package lists: %1").arg(result.errorMessage()));
+            onUpdated(false);
+            return;
+        }
+        
+        emit statusUpdated("✅ Package lists updated");
+        onUpdated(true);
+    }, true); // 2 minutes timeout
 }
 
-bool SystemManager::fixBrokenPackages()
+void SystemManager::fixBrokenPackages(int job, const std::function<void(bool)> &onFixed)
 {
     emit statusUpdated("Checking and fixing broken packages...");
     
     // First check if there are broken packages
-    QProcess checkBroken;
-    checkBroken.start("apt", QStringList() << "list" << "--broken");
-    checkBroken.waitForFinished(10000);
-    
-    QString brokenOutput = checkBroken.readAllStandardOutput();
-    if (brokenOutput.contains("WARNING: apt does not have a stable CLI interface")) {
-        // No broken packages found (just the warning)
-        emit statusUpdated("✅ No broken packages found");
-        return true;
-    }
-    
-    // Fix broken packages
-    QProcess fixBroken;
-    fixBroken.start("sudo", QStringList() << "apt" << "--fix-broken" << "install" << "-y");
-    fixBroken.waitForFinished(300000); // 5 minutes timeout
-    
-    if (fixBroken.exitCode() != 0) {
-        QString error = fixBroken.readAllStandardError();
-        emit statusUpdated(QString("❌ Failed to fix broken packages: %1").arg(error));
-        return false;
-    }
-    
-    emit statusUpdated("✅ Broken packages fixed");
-    return true;
+    runStep(job, "apt", QStringList() << "list" << "--broken", 10000, [this, job, onFixed](const ProcessResult &result) {
+        if (result.cancelled) {
+            onFixed(false);
+            return;
+        }
+        if (result.output().contains("WARNING: apt does not have a stable CLI interface")) {
+            // No broken packages found (just the warning)
+            emit statusUpdated("✅ No broken packages found");
+            onFixed(true);
+            return;
+        }
+        
+        // Fix broken packages
+        runStep(job, "sudo", QStringList() << "apt" << "--fix-broken" << "install" << "-y", 300000,
+                [this, onFixed](const ProcessResult &result) {
+            if (!result.succeeded()) {
+                emit statusUpdated(QString("❌ Failed to fix broken packages: %1").arg(result.errorMessage()));
+                onFixed(false);
+                return;
+            }
+            
+            emit statusUpdated("✅ Broken packages fixed");
+            onFixed(true);
+        }, true); // 5 minutes timeout
+    });
 }
 
-void SystemManager::createBackup()
+void SystemManager::createBackup(int job)
 {
     QString backupDir = QString("/home/snake/Arm-Pi-Tweaker/backup_%1")
                            .arg(QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss"));
@@ -849,52 +1038,64 @@ void SystemManager::createBackup()
     QDir().mkpath(backupDir + "/boot");
     QDir().mkpath(backupDir + "/lib");
     
-    // Create backup of important system files
-    QProcess bootBackup;
-    bootBackup.start("sudo", QStringList() << "cp" << "-r" << "/boot/." << backupDir + "/boot/");
-    bootBackup.waitForFinished(60000);
-    
-    QProcess modulesBackup;
-    modulesBackup.start("sudo", QStringList() << "cp" << "-r" << "/lib/modules" << backupDir + "/lib/");
-    modulesBackup.waitForFinished(60000);
-    
-    QProcess firmwareBackup;
-    firmwareBackup.start("sudo", QStringList() << "cp" << "-r" << "/lib/firmware" << backupDir + "/lib/");
-    firmwareBackup.waitForFinished(60000);
+    // Create backup of important system files. The patch depends on /boot
+    // and /lib/modules being saved, so those fail the job; copies take as
+    // long as the card needs.
+    ProcessSequence *backup = new ProcessSequence(this);
+    backup->addStep("Backing up /boot", "sudo", QStringList() << "cp" << "-r" << "/boot/." << backupDir + "/boot/");
+    backup->addStep("Backing up /lib/modules", "sudo", QStringList() << "cp" << "-r" << "/lib/modules" << backupDir + "/lib/");
+    backup->addStep("Backing up /lib/firmware", "sudo", QStringList() << "cp" << "-r" << "/lib/firmware" << backupDir + "/lib/",
+                    ProcessSequence::Optional);
     
     // Backup sources.list
-    QProcess sourcesBackup;
-    sourcesBackup.start("sudo", QStringList() << "cp" << "/etc/apt/sources.list" << backupDir + "/sources.list");
-    sourcesBackup.waitForFinished(5000);
+    backup->addStep("Backing up sources.list", "sudo", QStringList() << "cp" << "/etc/apt/sources.list" << backupDir + "/sources.list",
+                    ProcessSequence::Optional);
+    
+    connect(backup, &ProcessSequence::stepStarted, this, [this, job](const QString &, int percent) {
+        m_scheduler->setProgress(job, percent);
+    });
+    connect(backup, &ProcessSequence::warning, this, &SystemManager::statusUpdated);
+    connect(backup, &ProcessSequence::finished, this, [this, job, backup, backupDir](bool success, const QString &error) {
+        backup->deleteLater();
+        m_operations[job].sequence = nullptr;
+        if (success) {
+            QString message = QString("💾 Backup created: %1").arg(backupDir);
+            emit statusUpdated(message);
+            finishOperation(job, true, message);
+        } else {
+            finishOperation(job, false, QString("Backup failed: %1").arg(error));
+        }
+    });
     
-    emit statusUpdated(QString("💾 Backup created: %1").arg(backupDir));
+    m_operations[job].sequence = backup;
+    backup->start();
 }
 
 // GPU Management Implementation
 void SystemManager::installGpuDriver(const QString &driverPath)
 {
-    if (m_currentProcess && m_currentProcess->state() != QProcess::NotRunning) {
-        emit statusUpdated("Another operation is already running");
-        return;
-    }
+    // dpkg -i, then the GL libraries and X config
+    QVector<JobResource> resources;
+    resources << JobResource::exclusive(AptResource) << JobResource::exclusive(GraphicsResource);
     
-    m_currentOperation = "install_gpu_driver";
+    scheduleOperation("install_gpu_driver", QString("Install GPU driver %1").arg(QFileInfo(driverPath).fileName()), resources, [this, driverPath](int job) {
+        startGpuDriverInstall(job, driverPath);
+    });
+}
+
+void SystemManager::startGpuDriverInstall(int job, const QString &driverPath)
+{
     emit statusUpdated(QString("Installing GPU driver: %1").arg(QFileInfo(driverPath).fileName()));
     
     if (!QFile::exists(driverPath)) {
-        emit operationCompleted(false, "Driver file not found");
+        finishOperation(job, false, "Driver file not found");
         return;
     }
     
-    m_currentProcess = new QProcess(this);
-    connect(m_currentProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &SystemManager::onProcessFinished);
-    connect(m_currentProcess, &QProcess::errorOccurred, this, &SystemManager::onProcessError);
-    connect(m_currentProcess, &QProcess::readyReadStandardOutput, this, &SystemManager::onProcessOutput);
+    ProcessRunner *process = createOperationProcess(job);
     
     // Create GPU driver installation script
-    QString script = QString(
-        "#!/bin/bash\n"
+    QString script = "#!/bin/bash\n" + ScriptProgress::shellFunctions(4) + QString(
         "set -e\n"
         "DRIVER_PATH='%1'\n"
         "DRIVER_NAME=$(basename \"$DRIVER_PATH\")\n"
@@ -906,15 +1107,17 @@ void SystemManager::installGpuDriver(const QString &driverPath)
         "log_gpu \"🎮 Installing GPU driver: $DRIVER_NAME\"\n"
         "\n"
         "# Stop display manager if running\n"
+        "progress 1 \"Stopping display manager\"\n"
         "if systemctl is-active --quiet display-manager; then\n"
         "    log_gpu \"Stopping display manager...\"\n"
         "    sudo systemctl stop display-manager\n"
         "fi\n"
         "\n"
         "# Install .deb package\n"
+        "progress 2 \"Installing driver\"\n"
         "if [[ \"$DRIVER_PATH\" == *.deb ]]; then\n"
         "    log_gpu \"Installing .deb package...\"\n"
-        "    sudo dpkg -i \"$DRIVER_PATH\" || sudo apt-get install -f -y\n"
+        "    sudo dpkg -i \"$DRIVER_PATH\" || sudo apt-get -o APT::Status-Fd=1 install -f -y\n"
         "elif [[ \"$DRIVER_PATH\" == *.tar.* ]]; then\n"
         "    log_gpu \"Extracting and installing from archive...\"\n"
         "    TEMP_DIR=$(mktemp -d)\n"
@@ -937,6 +1140,7 @@ void SystemManager::installGpuDriver(const QString &driverPath)
         "fi\n"
         "\n"
         "# Update library cache\n"
+        "progress 3 \"Updating library cache\"\n"
         "log_gpu \"Updating library cache...\"\n"
         "sudo ldconfig\n"
         "\n"
@@ -945,6 +1149,7 @@ void SystemManager::installGpuDriver(const QString &driverPath)
         "sudo mkdir -p /etc/X11/xorg.conf.d\n"
         "\n"
         "# Restart display manager\n"
+        "progress 4 \"Restarting display manager\"\n"
         "if systemctl list-unit-files | grep -q display-manager; then\n"
         "    log_gpu \"Restarting display manager...\"\n"
         "    sudo systemctl start display-manager\n"
@@ -961,37 +1166,34 @@ void SystemManager::installGpuDriver(const QString &driverPath)
         out << script;
         scriptFile.close();
         
-        QProcess::execute("chmod", QStringList() << "+x" << scriptPath);
+        QFile::setPermissions(scriptPath, QFile::permissions(scriptPath) | QFile::ExeOwner);
         
-        m_simulatedProgress = 0;
-        m_progressTimer->start(1000);
-        emit progressUpdated(0);
+        startProgress(job);
         
-        m_currentProcess->start("bash", QStringList() << scriptPath);
+        process->start("bash", QStringList() << scriptPath);
     } else {
-        emit operationCompleted(false, "Failed to create installation script");
+        finishOperation(job, false, "Failed to create installation script");
     }
 }
 
 void SystemManager::removeGpuDriver(const QString &driverName)
 {
-    if (m_currentProcess && m_currentProcess->state() != QProcess::NotRunning) {
-        emit statusUpdated("Another operation is already running");
-        return;
-    }
+    QVector<JobResource> resources;
+    resources << JobResource::exclusive(AptResource) << JobResource::exclusive(GraphicsResource);
     
-    m_currentOperation = "remove_gpu_driver";
+    scheduleOperation("remove_gpu_driver", QString("Remove GPU driver %1").arg(driverName), resources, [this, driverName](int job) {
+        startGpuDriverRemoval(job, driverName);
+    });
+}
+
+void SystemManager::startGpuDriverRemoval(int job, const QString &driverName)
+{
     emit statusUpdated(QString("Removing GPU driver: %1").arg(driverName));
     
-    m_currentProcess = new QProcess(this);
-    connect(m_currentProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &SystemManager::onProcessFinished);
-    connect(m_currentProcess, &QProcess::errorOccurred, this, &SystemManager::onProcessError);
-    connect(m_currentProcess, &QProcess::readyReadStandardOutput, this, &SystemManager::onProcessOutput);
+    ProcessRunner *process = createOperationProcess(job);
     
     // Create GPU driver removal script
-    QString script = QString(
-        "#!/bin/bash\n"
+    QString script = "#!/bin/bash\n" + ScriptProgress::shellFunctions(5) + QString(
         "set -e\n"
         "DRIVER_NAME='%1'\n"
         "\n"
@@ -1002,27 +1204,30 @@ void SystemManager::removeGpuDriver(const QString &driverName)
         "log_gpu \"🗑️ Removing GPU driver: $DRIVER_NAME\"\n"
         "\n"
         "# Stop display manager\n"
+        "progress 1 \"Stopping display manager\"\n"
         "if systemctl is-active --quiet display-manager; then\n"
         "    log_gpu \"Stopping display manager...\"\n"
         "    sudo systemctl stop display-manager\n"
         "fi\n"
         "\n"
         "# Remove packages\n"
+        "progress 2 \"Removing packages\"\n"
         "if dpkg -l | grep -q \"$DRIVER_NAME\"; then\n"
         "    log_gpu \"Removing package: $DRIVER_NAME\"\n"
-        "    sudo apt-get remove --purge -y \"$DRIVER_NAME\"\n"
-        "    sudo apt-get autoremove -y\n"
+        "    sudo apt-get -o APT::Status-Fd=1 remove --purge -y \"$DRIVER_NAME\"\n"
+        "    sudo apt-get -o APT::Status-Fd=1 autoremove -y\n"
         "fi\n"
         "\n"
         "# Remove Mali-specific packages\n"
         "for pkg in libmali mali-driver; do\n"
         "    if dpkg -l | grep -q \"$pkg\"; then\n"
         "        log_gpu \"Removing $pkg packages...\"\n"
-        "        sudo apt-get remove --purge -y \"$pkg\"*\n"
+        "        sudo apt-get -o APT::Status-Fd=1 remove --purge -y \"$pkg\"*\n"
         "    fi\n"
         "done\n"
         "\n"
         "# Clean up library files\n"
+        "progress 3 \"Removing driver files\"\n"
         "log_gpu \"Cleaning up driver files...\"\n"
         "sudo rm -f /usr/lib/aarch64-linux-gnu/libmali*\n"
         "sudo rm -f /usr/lib/aarch64-linux-gnu/libEGL*mali*\n"
@@ -1033,10 +1238,12 @@ void SystemManager::removeGpuDriver(const QString &driverName)
         "sudo rm -f /etc/X11/xorg.conf.d/*gpu*\n"
         "\n"
         "# Update library cache\n"
+        "progress 4 \"Updating library cache\"\n"
         "log_gpu \"Updating library cache...\"\n"
         "sudo ldconfig\n"
         "\n"
         "# Restart display manager\n"
+        "progress 5 \"Restarting display manager\"\n"
         "if systemctl list-unit-files | grep -q display-manager; then\n"
         "    log_gpu \"Restarting display manager...\"\n"
         "    sudo systemctl start display-manager\n"
@@ -1052,36 +1259,33 @@ void SystemManager::removeGpuDriver(const QString &driverName)
         out << script;
         scriptFile.close();
         
-        QProcess::execute("chmod", QStringList() << "+x" << scriptPath);
+        QFile::setPermissions(scriptPath, QFile::permissions(scriptPath) | QFile::ExeOwner);
         
-        m_simulatedProgress = 0;
-        m_progressTimer->start(1000);
-        emit progressUpdated(0);
+        startProgress(job);
         
-        m_currentProcess->start("bash", QStringList() << scriptPath);
+        process->start("bash", QStringList() << scriptPath);
     } else {
-        emit operationCompleted(false, "Failed to create removal script");
+        finishOperation(job, false, "Failed to create removal script");
     }
 }
 
 void SystemManager::switchGpuDriver(const QString &driverType)
 {
-    if (m_currentProcess && m_currentProcess->state() != QProcess::NotRunning) {
-        emit statusUpdated("Another operation is already running");
-        return;
-    }
+    QVector<JobResource> resources;
+    resources << JobResource::exclusive(AptResource) << JobResource::exclusive(GraphicsResource);
     
-    m_currentOperation = "switch_gpu_driver";
+    scheduleOperation("switch_gpu_driver", QString("Switch GPU driver to %1").arg(driverType), resources, [this, driverType](int job) {
+        startGpuDriverSwitch(job, driverType);
+    });
+}
+
+void SystemManager::startGpuDriverSwitch(int job, const QString &driverType)
+{
     emit statusUpdated(QString("Switching to GPU driver: %1").arg(driverType));
     
-    m_currentProcess = new QProcess(this);
-    connect(m_currentProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &SystemManager::onProcessFinished);
-    connect(m_currentProcess, &QProcess::errorOccurred, this, &SystemManager::onProcessError);
-    connect(m_currentProcess, &QProcess::readyReadStandardOutput, this, &SystemManager::onProcessOutput);
+    ProcessRunner *process = createOperationProcess(job);
     
-    QString script = QString(
-        "#!/bin/bash\n"
+    QString script = "#!/bin/bash\n" + ScriptProgress::shellFunctions(4) + QString(
         "set -e\n"
         "DRIVER_TYPE='%1'\n"
         "\n"
@@ -1092,30 +1296,32 @@ void SystemManager::switchGpuDriver(const QString &driverType)
         "log_gpu \"🔄 Switching to GPU driver: $DRIVER_TYPE\"\n"
         "\n"
         "# Stop display manager\n"
+        "progress 1 \"Stopping display manager\"\n"
         "if systemctl is-active --quiet display-manager; then\n"
         "    sudo systemctl stop display-manager\n"
         "fi\n"
         "\n"
         "case \"$DRIVER_TYPE\" in\n"
+        "progress 2 \"Installing $DRIVER_TYPE\"\n"
         "    *Mali*Proprietary*)\n"
         "        log_gpu \"Installing Mali proprietary driver...\"\n"
         "        # Install Mali proprietary packages\n"
         "        if [ -f \"/home/snake/Arm-Pi-Tweaker/gpu/proprietary/libmali-valhall-g610-g13p0-wayland-gbm_1.9-1_arm64.deb\" ]; then\n"
         "            sudo dpkg -i /home/snake/Arm-Pi-Tweaker/gpu/proprietary/libmali-valhall-g610-*_arm64.deb || true\n"
-        "            sudo apt-get install -f -y\n"
+        "            sudo apt-get -o APT::Status-Fd=1 install -f -y\n"
         "        fi\n"
         "        ;;\n"
         "    *Mesa*|*Panfrost*)\n"
         "        log_gpu \"Installing Mesa/Panfrost driver...\"\n"
-        "        sudo apt-get update\n"
-        "        sudo apt-get install -y mesa-utils mesa-vulkan-drivers\n"
+        "        sudo apt-get -o APT::Status-Fd=1 update\n"
+        "        sudo apt-get -o APT::Status-Fd=1 install -y mesa-utils mesa-vulkan-drivers\n"
         "        # Remove Mali proprietary if present\n"
-        "        sudo apt-get remove --purge -y libmali* || true\n"
+        "        sudo apt-get -o APT::Status-Fd=1 remove --purge -y libmali* || true\n"
         "        ;;\n"
         "    *Software*)\n"
         "        log_gpu \"Switching to software rendering...\"\n"
         "        # Disable hardware acceleration\n"
-        "        sudo apt-get remove --purge -y libmali* mesa-vulkan-drivers || true\n"
+        "        sudo apt-get -o APT::Status-Fd=1 remove --purge -y libmali* mesa-vulkan-drivers || true\n"
         "        ;;\n"
         "    *)\n"
         "        log_gpu \"❌ Unknown driver type: $DRIVER_TYPE\"\n"
@@ -1124,9 +1330,11 @@ void SystemManager::switchGpuDriver(const QString &driverType)
         "esac\n"
         "\n"
         "# Update library cache\n"
+        "progress 3 \"Updating library cache\"\n"
         "sudo ldconfig\n"
         "\n"
         "# Restart display manager\n"
+        "progress 4 \"Restarting display manager\"\n"
         "if systemctl list-unit-files | grep -q display-manager; then\n"
         "    sudo systemctl start display-manager\n"
         "fi\n"
@@ -1141,33 +1349,32 @@ void SystemManager::switchGpuDriver(const QString &driverType)
         out << script;
         scriptFile.close();
         
-        QProcess::execute("chmod", QStringList() << "+x" << scriptPath);
+        QFile::setPermissions(scriptPath, QFile::permissions(scriptPath) | QFile::ExeOwner);
         
-        m_simulatedProgress = 0;
-        m_progressTimer->start(1000);
-        emit progressUpdated(0);
+        startProgress(job);
         
-        m_currentProcess->start("bash", QStringList() << scriptPath);
+        process->start("bash", QStringList() << scriptPath);
     } else {
-        emit operationCompleted(false, "Failed to create switch script");
+        finishOperation(job, false, "Failed to create switch script");
     }
 }
 
 void SystemManager::testGpuDriver()
 {
-    if (m_currentProcess && m_currentProcess->state() != QProcess::NotRunning) {
-        emit statusUpdated("Another operation is already running");
-        return;
-    }
+    // Only reads, so it runs alongside anything but a driver change
+    QVector<JobResource> resources;
+    resources << JobResource::shared(GraphicsResource) << JobResource::shared(ModulesResource);
     
-    m_currentOperation = "test_gpu_driver";
+    scheduleOperation("test_gpu_driver", "Test GPU driver", resources, [this](int job) {
+        startGpuDriverTest(job);
+    });
+}
+
+void SystemManager::startGpuDriverTest(int job)
+{
     emit statusUpdated("Testing GPU driver functionality...");
     
-    m_currentProcess = new QProcess(this);
-    connect(m_currentProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &SystemManager::onProcessFinished);
-    connect(m_currentProcess, &QProcess::errorOccurred, this, &SystemManager::onProcessError);
-    connect(m_currentProcess, &QProcess::readyReadStandardOutput, this, &SystemManager::onProcessOutput);
+    ProcessRunner *process = createOperationProcess(job);
     
     QString script = 
         "#!/bin/bash\n"
@@ -1196,20 +1403,17 @@ void SystemManager::testGpuDriver()
         out << script;
         scriptFile.close();
         
-        QProcess::execute("chmod", QStringList() << "+x" << scriptPath);
-        m_currentProcess->start("bash", QStringList() << scriptPath);
+        QFile::setPermissions(scriptPath, QFile::permissions(scriptPath) | QFile::ExeOwner);
+        process->start("bash", QStringList() << scriptPath);
     } else {
-        emit operationCompleted(false, "Failed to create test script");
+        finishOperation(job, false, "Failed to create test script");
     }
 }
 
 QString SystemManager::detectCurrentGpuDriver()
 {
-    QProcess process;
-    process.start("lsmod", QStringList());
-    process.waitForFinished(3000);
-    
-    QString output = process.readAllStandardOutput();
+    // What lsmod prints, without running it
+    QString output = readTextFile("/proc/modules");
     
     if (output.contains("mali_kbase")) {
         return "Mali Proprietary Driver";
@@ -1250,16 +1454,12 @@ QStringList SystemManager::scanAvailableGpuDrivers()
         }
     }
     
-    // Check for system packages
-    QProcess dpkgProcess;
-    dpkgProcess.start("dpkg", QStringList() << "-l" << "*mali*" << "*mesa*" << "*panfrost*");
-    dpkgProcess.waitForFinished(5000);
-    
-    QString dpkgOutput = dpkgProcess.readAllStandardOutput();
-    if (dpkgOutput.contains("libmali")) {
+    // Check for system packages; dpkg keeps a file list per installed package
+    QDir dpkgInfo("/var/lib/dpkg/info");
+    if (!dpkgInfo.entryList(QStringList() << "libmali*.list", QDir::Files).isEmpty()) {
         drivers.append("System: Mali driver package");
     }
-    if (dpkgOutput.contains("mesa")) {
+    if (!dpkgInfo.entryList(QStringList() << "*mesa*.list", QDir::Files).isEmpty()) {
         drivers.append("System: Mesa driver package");
     }
     
@@ -1269,66 +1469,65 @@ QStringList SystemManager::scanAvailableGpuDrivers()
 // Kernel Management Implementation
 void SystemManager::installKernel(const QString &kernelPackage)
 {
-    if (m_currentProcess && m_currentProcess->state() != QProcess::NotRunning) {
-        emit statusUpdated("Another operation is already running");
-        return;
-    }
+    QVector<JobResource> resources;
+    resources << JobResource::exclusive(AptResource) << JobResource::exclusive(BootResource)
+              << JobResource::exclusive(ModulesResource);
     
-    m_currentOperation = "install_kernel";
-    emit statusUpdated(QString("Installing kernel: %1").arg(kernelPackage));
-    
-    m_currentProcess = new QProcess(this);
-    connect(m_currentProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &SystemManager::onProcessFinished);
-    connect(m_currentProcess, &QProcess::errorOccurred, this, &SystemManager::onProcessError);
-    connect(m_currentProcess, &QProcess::readyReadStandardOutput, this, &SystemManager::onProcessOutput);
-    
-    QStringList args;
-    args << "install" << "-y" << kernelPackage;
-    
-    m_simulatedProgress = 0;
-    m_progressTimer->start(2000);
-    emit progressUpdated(0);
-    
-    m_currentProcess->start("sudo", QStringList() << "apt-get" << args);
+    scheduleOperation("install_kernel", QString("Install kernel %1").arg(kernelPackage), resources,
+                      [this, kernelPackage](int job) {
+        emit statusUpdated(QString("Installing kernel: %1").arg(kernelPackage));
+        
+        ProcessRunner *process = createOperationProcess(job);
+        
+        QStringList args;
+        args << "-o" << "APT::Status-Fd=1" << "install" << "-y" << kernelPackage;
+        
+        startProgress(job);
+        
+        process->start("sudo", QStringList() << "apt-get" << args);
+    });
 }
 
 void SystemManager::removeKernel(const QString &kernelVersion)
 {
-    if (m_currentProcess && m_currentProcess->state() != QProcess::NotRunning) {
-        emit statusUpdated("Another operation is already running");
-        return;
-    }
+    QVector<JobResource> resources;
+    resources << JobResource::exclusive(AptResource) << JobResource::exclusive(BootResource)
+              << JobResource::exclusive(ModulesResource);
     
-    m_currentOperation = "remove_kernel";
+    scheduleOperation("remove_kernel", QString("Remove kernel %1").arg(kernelVersion), resources, [this, kernelVersion](int job) {
+        startKernelRemoval(job, kernelVersion);
+    });
+}
+
+void SystemManager::startKernelRemoval(int job, const QString &kernelVersion)
+{
     emit statusUpdated(QString("Removing kernel: %1").arg(kernelVersion));
     
-    m_currentProcess = new QProcess(this);
-    connect(m_currentProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &SystemManager::onProcessFinished);
-    connect(m_currentProcess, &QProcess::errorOccurred, this, &SystemManager::onProcessError);
-    connect(m_currentProcess, &QProcess::readyReadStandardOutput, this, &SystemManager::onProcessOutput);
+    ProcessRunner *process = createOperationProcess(job);
     
-    QString script = QString(
-        "#!/bin/bash\n"
+    QString script = "#!/bin/bash\n" + ScriptProgress::shellFunctions(4) + QString(
         "set -e\n"
         "KERNEL_VERSION='%1'\n"
         "\n"
         "echo \"Removing kernel $KERNEL_VERSION...\"\n"
         "\n"
         "# Remove kernel image\n"
+        "progress 1 \"Removing kernel image\"\n"
         "sudo rm -f /boot/vmlinuz-$KERNEL_VERSION\n"
         "sudo rm -f /boot/initrd.img-$KERNEL_VERSION\n"
         "sudo rm -f /boot/config-$KERNEL_VERSION\n"
         "sudo rm -f /boot/System.map-$KERNEL_VERSION\n"
         "\n"
         "# Remove kernel modules\n"
+        "progress 2 \"Removing kernel modules\"\n"
         "sudo rm -rf /lib/modules/$KERNEL_VERSION\n"
         "\n"
         "# Remove kernel packages\n"
-        "sudo apt-get remove --purge -y linux-image-$KERNEL_VERSION linux-headers-$KERNEL_VERSION || true\n"
+        "progress 3 \"Removing kernel packages\"\n"
+        "sudo apt-get -o APT::Status-Fd=1 remove --purge -y linux-image-$KERNEL_VERSION linux-headers-$KERNEL_VERSION || true\n"
         "\n"
         "# Update GRUB\n"
+        "progress 4 \"Updating GRUB\"\n"
         "sudo update-grub\n"
         "\n"
         "echo \"Kernel $KERNEL_VERSION removed successfully\"\n"
@@ -1341,33 +1540,31 @@ void SystemManager::removeKernel(const QString &kernelVersion)
         out << script;
         scriptFile.close();
         
-        QProcess::execute("chmod", QStringList() << "+x" << scriptPath);
+        QFile::setPermissions(scriptPath, QFile::permissions(scriptPath) | QFile::ExeOwner);
         
-        m_simulatedProgress = 0;
-        m_progressTimer->start(1000);
-        emit progressUpdated(0);
+        startProgress(job);
         
-        m_currentProcess->start("bash", QStringList() << scriptPath);
+        process->start("bash", QStringList() << scriptPath);
     } else {
-        emit operationCompleted(false, "Failed to create removal script");
+        finishOperation(job, false, "Failed to create removal script");
     }
 }
 
 void SystemManager::setDefaultKernel(const QString &kernelVersion)
 {
-    if (m_currentProcess && m_currentProcess->state() != QProcess::NotRunning) {
-        emit statusUpdated("Another operation is already running");
-        return;
-    }
+    QVector<JobResource> resources;
+    resources << JobResource::exclusive(BootResource);
     
-    m_currentOperation = "set_default_kernel";
+    scheduleOperation("set_default_kernel", QString("Set default kernel %1").arg(kernelVersion), resources, [this, kernelVersion](int job) {
+        startDefaultKernelChange(job, kernelVersion);
+    });
+}
+
+void SystemManager::startDefaultKernelChange(int job, const QString &kernelVersion)
+{
     emit statusUpdated(QString("Setting default kernel: %1").arg(kernelVersion));
     
-    m_currentProcess = new QProcess(this);
-    connect(m_currentProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &SystemManager::onProcessFinished);
-    connect(m_currentProcess, &QProcess::errorOccurred, this, &SystemManager::onProcessError);
-    connect(m_currentProcess, &QProcess::readyReadStandardOutput, this, &SystemManager::onProcessOutput);
+    ProcessRunner *process = createOperationProcess(job);
     
     QString script = QString(
         "#!/bin/bash\n"
@@ -1396,56 +1593,47 @@ void SystemManager::setDefaultKernel(const QString &kernelVersion)
         out << script;
         scriptFile.close();
         
-        QProcess::execute("chmod", QStringList() << "+x" << scriptPath);
-        m_currentProcess->start("bash", QStringList() << scriptPath);
+        QFile::setPermissions(scriptPath, QFile::permissions(scriptPath) | QFile::ExeOwner);
+        process->start("bash", QStringList() << scriptPath);
     } else {
-        emit operationCompleted(false, "Failed to create script");
+        finishOperation(job, false, "Failed to create script");
     }
 }
 
 void SystemManager::updateInitramfs(const QString &kernelVersion)
 {
-    if (m_currentProcess && m_currentProcess->state() != QProcess::NotRunning) {
-        emit statusUpdated("Another operation is already running");
-        return;
-    }
-    
-    m_currentOperation = "update_initramfs";
-    emit statusUpdated(QString("Updating initramfs for kernel: %1").arg(kernelVersion));
-    
-    m_currentProcess = new QProcess(this);
-    connect(m_currentProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &SystemManager::onProcessFinished);
-    connect(m_currentProcess, &QProcess::errorOccurred, this, &SystemManager::onProcessError);
-    connect(m_currentProcess, &QProcess::readyReadStandardOutput, this, &SystemManager::onProcessOutput);
-    
-    QStringList args;
-    if (kernelVersion == "all") {
-        args << "update-initramfs" << "-u" << "-k" << "all";
-    } else {
-        args << "update-initramfs" << "-u" << "-k" << kernelVersion;
-    }
+    QVector<JobResource> resources;
+    resources << JobResource::exclusive(BootResource) << JobResource::shared(ModulesResource);
     
-    m_currentProcess->start("sudo", args);
+    scheduleOperation("update_initramfs", QString("Update initramfs for %1").arg(kernelVersion), resources,
+                      [this, kernelVersion](int job) {
+        emit statusUpdated(QString("Updating initramfs for kernel: %1").arg(kernelVersion));
+        
+        ProcessRunner *process = createOperationProcess(job);
+        
+        QStringList args;
+        if (kernelVersion == "all") {
+            args << "update-initramfs" << "-u" << "-k" << "all";
+        } else {
+            args << "update-initramfs" << "-u" << "-k" << kernelVersion;
+        }
+        
+        process->start("sudo", args);
+    });
 }
 
 void SystemManager::updateGrub()
 {
-    if (m_currentProcess && m_currentProcess->state() != QProcess::NotRunning) {
-        emit statusUpdated("Another operation is already running");
-        return;
-    }
-    
-    m_currentOperation = "update_grub";
-    emit statusUpdated("Updating GRUB bootloader configuration...");
+    QVector<JobResource> resources;
+    resources << JobResource::exclusive(BootResource);
     
-    m_currentProcess = new QProcess(this);
-    connect(m_currentProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &SystemManager::onProcessFinished);
-    connect(m_currentProcess, &QProcess::errorOccurred, this, &SystemManager::onProcessError);
-    connect(m_currentProcess, &QProcess::readyReadStandardOutput, this, &SystemManager::onProcessOutput);
-    
-    m_currentProcess->start("sudo", QStringList() << "update-grub");
+    scheduleOperation("update_grub", "Update GRUB", resources, [this](int job) {
+        emit statusUpdated("Updating GRUB bootloader configuration...");
+        
+        ProcessRunner *process = createOperationProcess(job);
+        
+        process->start("sudo", QStringList() << "update-grub");
+    });
 }
 
 QStringList SystemManager::getInstalledKernels()
@@ -1464,10 +1652,8 @@ QStringList SystemManager::getInstalledKernels()
 
 QString SystemManager::getCurrentKernel()
 {
-    QProcess process;
-    process.start("uname", QStringList() << "-r");
-    process.waitForFinished(2000);
-    return process.readAllStandardOutput().trimmed();
+    // Same as uname -r
+    return readTextFile("/proc/sys/kernel/osrelease").trimmed();
 }
 
 QString SystemManager::getDefaultKernel()
@@ -1495,40 +1681,33 @@ QString SystemManager::getDefaultKernel()
 // Module Management Implementation
 void SystemManager::loadKernelModule(const QString &moduleName)
 {
-    if (m_currentProcess && m_currentProcess->state() != QProcess::NotRunning) {
-        emit statusUpdated("Another operation is already running");
-        return;
-    }
-    
-    m_currentOperation = "load_module";
-    emit statusUpdated(QString("Loading kernel module: %1").arg(moduleName));
+    // Loading one module doesn't get in the way of loading another
+    QVector<JobResource> resources;
+    resources << JobResource::shared(ModulesResource) << JobResource::exclusive("module:" + moduleName);
     
-    m_currentProcess = new QProcess(this);
-    connect(m_currentProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &SystemManager::onProcessFinished);
-    connect(m_currentProcess, &QProcess::errorOccurred, this, &SystemManager::onProcessError);
-    connect(m_currentProcess, &QProcess::readyReadStandardOutput, this, &SystemManager::onProcessOutput);
-    
-    m_currentProcess->start("sudo", QStringList() << "modprobe" << moduleName);
+    scheduleOperation("load_module", QString("Load module %1").arg(moduleName), resources, [this, moduleName](int job) {
+        emit statusUpdated(QString("Loading kernel module: %1").arg(moduleName));
+        
+        ProcessRunner *process = createOperationProcess(job);
+        
+        startModuleLoader(process, QStringList() << "--load-modules" << moduleName);
+    });
 }
 
 void SystemManager::unloadKernelModule(const QString &moduleName)
 {
-    if (m_currentProcess && m_currentProcess->state() != QProcess::NotRunning) {
-        emit statusUpdated("Another operation is already running");
-        return;
-    }
-    
-    m_currentOperation = "unload_module";
-    emit statusUpdated(QString("Unloading kernel module: %1").arg(moduleName));
-    
-    m_currentProcess = new QProcess(this);
-    connect(m_currentProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &SystemManager::onProcessFinished);
-    connect(m_currentProcess, &QProcess::errorOccurred, this, &SystemManager::onProcessError);
-    connect(m_currentProcess, &QProcess::readyReadStandardOutput, this, &SystemManager::onProcessOutput);
+    // Dependencies nothing uses any more go too, and a load running
+    // alongside may be about to need one of them
+    QVector<JobResource> resources;
+    resources << JobResource::exclusive(ModulesResource);
     
-    m_currentProcess->start("sudo", QStringList() << "modprobe" << "-r" << moduleName);
+    scheduleOperation("unload_module", QString("Unload module %1").arg(moduleName), resources, [this, moduleName](int job) {
+        emit statusUpdated(QString("Unloading kernel module: %1").arg(moduleName));
+        
+        ProcessRunner *process = createOperationProcess(job);
+        
+        startModuleLoader(process, QStringList() << "--unload-modules" << moduleName);
+    });
 }
 
 void SystemManager::blacklistKernelModule(const QString &moduleName)
@@ -1551,33 +1730,26 @@ void SystemManager::blacklistKernelModule(const QString &moduleName)
     }
     
     // Add to blacklist
-    QProcess process;
-    process.start("sudo", QStringList() << "bash" << "-c" 
-        << QString("echo 'blacklist %1' >> %2").arg(moduleName, blacklistFile));
-    process.waitForFinished(3000);
-    
-    if (process.exitCode() == 0) {
-        emit statusUpdated(QString("Module %1 blacklisted successfully").arg(moduleName));
-    } else {
-        emit statusUpdated(QString("Failed to blacklist module %1").arg(moduleName));
-    }
+    ProcessRunner::run("sudo", QStringList() << "bash" << "-c"
+        << QString("echo 'blacklist %1' >> %2").arg(moduleName, blacklistFile), this,
+        [this, moduleName](const ProcessResult &result) {
+        if (result.succeeded()) {
+            emit statusUpdated(QString("Module %1 blacklisted successfully").arg(moduleName));
+        } else {
+            emit statusUpdated(QString("Failed to blacklist module %1").arg(moduleName));
+        }
+    }, 3000);
 }
 
 QStringList SystemManager::getLoadedModules()
 {
+    // Sorted by name
     QStringList modules;
-    QProcess process;
-    process.start("lsmod", QStringList());
-    process.waitForFinished(3000);
-    
-    QString output = process.readAllStandardOutput();
-    QStringList lines = output.split('\n');
-    
-    for (int i = 1; i < lines.size(); ++i) { // Skip header
-        QString line = lines[i].trimmed();
-        if (!line.isEmpty()) {
-            QString moduleName = line.split(' ').first();
-            modules.append(moduleName);
+    QVector<LoadedModule> loaded;
+    QString error;
+    if (LoadedModuleMonitor::read(loaded, error)) {
+        for (const LoadedModule &module : loaded) {
+            modules.append(module.name);
         }
     }
     
@@ -1587,52 +1759,56 @@ QStringList SystemManager::getLoadedModules()
 QStringList SystemManager::getAvailableModules()
 {
     QStringList modules;
-    QString currentKernel = getCurrentKernel();
-    QString modulesPath = QString("/lib/modules/%1").arg(currentKernel);
-    
-    QProcess process;
-    process.start("find", QStringList() << modulesPath << "-name" << "*.ko" << "-type" << "f");
-    process.waitForFinished(5000);
-    
-    QString output = process.readAllStandardOutput();
-    QStringList files = output.split('\n');
-    
-    for (const QString &file : files) {
-        if (!file.isEmpty()) {
-            QFileInfo info(file);
-            QString moduleName = info.baseName();
-            if (!modules.contains(moduleName)) {
-                modules.append(moduleName);
+    ModuleIndex index;
+    QString error;
+    if (index.load(getCurrentKernel(), error)) {
+        // Sorted already; built-in modules can't be loaded
+        for (const KernelModule &module : index.modules()) {
+            if (!module.builtin) {
+                modules.append(module.name);
             }
         }
+        return modules;
+    }
+    
+    // No modules.dep: look for the files themselves, compressed ones too
+    QSet<QString> seen;
+    QString modulesPath = QString("/lib/modules/%1").arg(getCurrentKernel());
+    QDirIterator it(modulesPath, QStringList() << "*.ko" << "*.ko.*", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QString moduleName = ModuleIndex::normalizedName(QFileInfo(it.next()).baseName());
+        if (!seen.contains(moduleName)) {
+            seen.insert(moduleName);
+            modules.append(moduleName);
+        }
     }
     
     modules.sort();
     return modules;
 }
 
-QString SystemManager::getModuleInfo(const QString &moduleName)
+void SystemManager::getModuleInfo(const QString &moduleName, const std::function<void(const QString &)> &onInfo)
 {
-    QProcess process;
-    process.start("modinfo", QStringList() << moduleName);
-    process.waitForFinished(3000);
+    if (!m_moduleInfoCache->hasIndex()) {
+        ModuleIndex index;
+        QString indexError;
+        if (index.load(getCurrentKernel(), indexError)) {
+            m_moduleInfoCache->setIndex(index);
+        }
+    }
     
-    if (process.exitCode() == 0) {
-        return process.readAllStandardOutput();
+    ModuleInfo info;
+    QString error;
+    if (m_moduleInfoCache->info(moduleName, info, error)) {
+        onInfo(info.text());
     } else {
-        return QString("Module information not available for: %1").arg(moduleName);
+        onInfo(QString("Module information not available for %1: %2").arg(moduleName, error));
     }
 }
 
 // Kernel Patching Implementation (simplified)
 void SystemManager::applyKernelPatch(const QString &patchFile)
 {
-    if (m_currentProcess && m_currentProcess->state() != QProcess::NotRunning) {
-        emit statusUpdated("Another operation is already running");
-        return;
-    }
-    
-    m_currentOperation = "apply_patch";
     emit statusUpdated(QString("Applying kernel patch: %1").arg(QFileInfo(patchFile).fileName()));
     
     // This is a simplified implementation
@@ -1651,28 +1827,30 @@ void SystemManager::createKernelPatch(const QString &originalFile, const QString
 {
     emit statusUpdated("Creating patch between files...");
     
-    QProcess process;
     QString patchName = QString("armpi_patch_%1.patch").arg(QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss"));
     QString patchPath = QString("/home/snake/Arm-Pi-Tweaker/patches/%1").arg(patchName);
     
     QDir().mkpath("/home/snake/Arm-Pi-Tweaker/patches");
     
-    process.start("diff", QStringList() << "-u" << originalFile << modifiedFile);
-    process.waitForFinished(5000);
-    
-    QString patchContent = process.readAllStandardOutput();
-    
-    QFile patchFile(patchPath);
-    if (patchFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QTextStream stream(&patchFile);
-        stream << patchContent;
-        patchFile.close();
+    ProcessRunner::run("diff", QStringList() << "-u" << originalFile << modifiedFile, this,
+                       [this, patchPath](const ProcessResult &result) {
+        // diff exits with 1 when the files differ, which is the point
+        if (!result.started || result.crashed || result.timedOut || result.exitCode > 1) {
+            emit operationCompleted(false, QString("Failed to compare files: %1").arg(result.errorMessage()));
+            return;
+        }
         
-        emit statusUpdated(QString("Patch created: %1").arg(patchPath));
-        emit operationCompleted(true, QString("Patch saved to: %1").arg(patchPath));
-    } else {
-        emit operationCompleted(false, "Failed to save patch file");
-    }
+        QFile patchFile(patchPath);
+        if (patchFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            patchFile.write(result.standardOutput);
+            patchFile.close();
+            
+            emit statusUpdated(QString("Patch created: %1").arg(patchPath));
+            emit operationCompleted(true, QString("Patch saved to: %1").arg(patchPath));
+        } else {
+            emit operationCompleted(false, "Failed to save patch file");
+        }
+    }, 5000);
 }
 
 QStringList SystemManager::getAppliedPatches()
@@ -1699,16 +1877,15 @@ void SystemManager::applyKernelParameter(const QString &parameter, const QString
     paramPath.replace('.', '/');
     QString command = QString("echo '%1' | sudo tee /proc/sys/%2").arg(value, paramPath);
     
-    QProcess process;
-    process.start("bash", QStringList() << "-c" << command);
-    process.waitForFinished(3000);
-    
-    if (process.exitCode() == 0) {
-        emit statusUpdated(QString("Kernel parameter %1 applied successfully").arg(parameter));
-        emit operationCompleted(true, QString("Parameter %1 set to %2").arg(parameter, value));
-    } else {
-        emit operationCompleted(false, QString("Failed to apply parameter %1").arg(parameter));
-    }
+    ProcessRunner::run("bash", QStringList() << "-c" << command, this,
+                       [this, parameter, value](const ProcessResult &result) {
+        if (result.succeeded()) {
+            emit statusUpdated(QString("Kernel parameter %1 applied successfully").arg(parameter));
+            emit operationCompleted(true, QString("Parameter %1 set to %2").arg(parameter, value));
+        } else {
+            emit operationCompleted(false, QString("Failed to apply parameter %1").arg(parameter));
+        }
+    }, 3000);
 }
 
 void SystemManager::updateBootParameters(const QStringList &parameters)
@@ -1719,17 +1896,15 @@ void SystemManager::updateBootParameters(const QStringList &parameters)
     QString newCmdline = parameters.join(" ");
     QString command = QString("sudo sed -i 's/GRUB_CMDLINE_LINUX_DEFAULT=.*/GRUB_CMDLINE_LINUX_DEFAULT=\"%1\"/' /etc/default/grub").arg(newCmdline);
     
-    QProcess process;
-    process.start("bash", QStringList() << "-c" << command);
-    process.waitForFinished(3000);
-    
-    if (process.exitCode() == 0) {
-        // Update GRUB
-        updateGrub();
-        emit statusUpdated("Boot parameters updated successfully");
-    } else {
-        emit operationCompleted(false, "Failed to update boot parameters");
-    }
+    ProcessRunner::run("bash", QStringList() << "-c" << command, this, [this](const ProcessResult &result) {
+        if (result.succeeded()) {
+            // Update GRUB
+            updateGrub();
+            emit statusUpdated("Boot parameters updated successfully");
+        } else {
+            emit operationCompleted(false, "Failed to update boot parameters");
+        }
+    }, 3000);
 }
 
 void SystemManager::updateKernelConfig(const QString &configOption, const QString &value)
@@ -1,12 +1,28 @@
 #ifndef SYSTEMMANAGER_H
 #define SYSTEMMANAGER_H
 
+#include <QHash>
 #include <QObject>
-#include <QProcess>
 #include <QTimer>
 #include <QString>
 #include <QStringList>
+#include <QVector>
 
+#include <functional>
+
+#include "jobscheduler.h"
+#include "scriptprogress.h"
+
+class ModuleInfoCache;
+class ProcessRunner;
+class ProcessSequence;
+struct ProcessResult;
+
+// Runs the system-changing operations (upgrades, driver and kernel
+// installs). Every command runs on ProcessRunner, so nothing here waits on
+// a process. Each operation is a job on the scheduler, claiming the parts
+// of the system it touches: a kernel install and a GPU driver test run side
+// by side, two things that write /boot take turns.
 class SystemManager : public QObject
 {
     Q_OBJECT
@@ -14,6 +30,22 @@ class SystemManager : public QObject
 public:
     explicit SystemManager(QObject *parent = nullptr);
     
+    // Resource classes for JobScheduler claims
+    static const char *const AptResource;         // dpkg database and the apt lock
+    static const char *const BootResource;        // /boot, initramfs and GRUB
+    static const char *const ModulesResource;     // /lib/modules, firmware, modprobe.d
+    static const char *const GraphicsResource;    // GPU userspace drivers and X config
+    static const char *const WorkspaceResource;   // The upgrade, extraction and backup trees
+    // A block device or mount point a job writes through
+    static QString deviceResource(const QString &path);
+    
+    // Shared with the tabs that run jobs of their own, such as kernel
+    // installs to another device
+    JobScheduler *scheduler() const { return m_scheduler; }
+    // Module details, precomputed for whichever index the module tab loaded
+    ModuleInfoCache *moduleInfoCache() const { return m_moduleInfoCache; }
+    bool isBusy() const;
+    
     void extractDrivers();
     void runUbuntuUpgrade();
     void patchSystem();
@@ -49,40 +81,94 @@ public:
     void updateKernelConfig(const QString &configOption, const QString &value);
     
     // Module Management
+    // Loading brings in the module's dependencies too, unloading drops the
+    // ones nothing else uses; both report each module's time as status
     void loadKernelModule(const QString &moduleName);
     void unloadKernelModule(const QString &moduleName);
     void blacklistKernelModule(const QString &moduleName);
     QStringList getLoadedModules();
     QStringList getAvailableModules();
-    QString getModuleInfo(const QString &moduleName);
+    // modinfo-style details, read from the module file itself and passed
+    // to onInfo. Read-only queries like this one don't go through the
+    // scheduler.
+    void getModuleInfo(const QString &moduleName, const std::function<void(const QString &)> &onInfo);
+
+public slots:
+    // Takes a queued job off the queue, or stops the command a running one
+    // is on; either way it completes as failed
+    void cancelJob(int job);
 
 signals:
+    // Of whichever operation reported last; per job through the scheduler
     void progressUpdated(int percentage);
     void statusUpdated(const QString &message);
+    // Once for every job, including ones cancelled before they started
     void operationCompleted(bool success, const QString &message);
 
 private slots:
-    void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
-    void onProcessError(QProcess::ProcessError error);
-    void onProcessOutput();
+    void onCancelRequested(int job);
 
 private:
-    bool runCommand(const QString &command, const QStringList &arguments = QStringList());
-    bool checkPrerequisites();
-    bool checkUpgradePrerequisites();
-    bool prepareSystemForUpgrade();
-    QString getUpgradeSourcePath();
-    void createBackup();
+    // What one running operation has going
+    struct Operation {
+        QString name;                       // "install_kernel", for the result message
+        ProcessRunner *process = nullptr;   // The main command
+        ProcessRunner *step = nullptr;      // A command on the way to it
+        ProcessSequence *sequence = nullptr;
+        ScriptProgress progress;            // Read from the main command's output
+    };
+    
+    // Queues start as a job unless one with the same description is already
+    // waiting or running; returns the job, or -1
+    int scheduleOperation(const QString &name, const QString &description,
+                          const QVector<JobResource> &resources,
+                          const std::function<void(int job)> &start,
+                          const QList<int> &dependencies = QList<int>());
+    bool isScheduled(const QString &description);
+    void finishOperation(int job, bool success, const QString &message);
+    // Has the main command's @@PROGRESS and apt status lines drive the
+    // job's progress
+    void startProgress(int job);
+    // The operation's main command; finishing it finishes the operation
+    ProcessRunner *createOperationProcess(int job);
+    void onProcessFinished(int job);
+    // Progress lines move the job's progress; the rest become status updates
+    void onProcessOutput(int job, const QString &line);
+    // A command the operation runs on the way; showOutput passes its
+    // output lines on as status updates
+    void runStep(int job, const QString &program, const QStringList &arguments, int timeoutMs,
+                 const std::function<void(const ProcessResult &)> &onFinished, bool showOutput = false);
+    
+    // The public operations, once the scheduler has started their job
+    void startDriverExtraction(int job);
+    void startUbuntuUpgrade(int job);
+    void startSystemPatch(int job, const QString &upgradeDir);
+    void startRollback(int job);
+    void startGpuDriverInstall(int job, const QString &driverPath);
+    void startGpuDriverRemoval(int job, const QString &driverName);
+    void startGpuDriverSwitch(int job, const QString &driverType);
+    void startGpuDriverTest(int job);
+    void startKernelRemoval(int job, const QString &kernelVersion);
+    void startDefaultKernelChange(int job, const QString &kernelVersion);
+    
+    // Each calls back with whether it succeeded
+    void checkPrerequisites(int job, const std::function<void(bool)> &onChecked);
+    void checkUpgradePrerequisites(int job, const std::function<void(bool)> &onChecked);
+    void prepareSystemForUpgrade(int job, const std::function<void(bool)> &onPrepared);
+    void installUpdateManager(int job, const std::function<void(bool)> &onInstalled);
+    void enableReleaseUpgrades(int job, const std::function<void(bool)> &onEnabled);
+    void updatePackageLists(int job, const std::function<void(bool)> &onUpdated);
+    void fixBrokenPackages(int job, const std::function<void(bool)> &onFixed);
+    // A job of its own, which patching waits for
+    void createBackup(int job);
     bool checkDiskSpace();
-    bool updatePackageLists();
-    bool fixBrokenPackages();
+    QString getUpgradeSourcePath();
     QString detectGpuDrivers();
     QStringList findFilesInDirectory(const QString &directory, const QStringList &patterns);
     
-    QProcess *m_currentProcess;
-    QString m_currentOperation;
-    QTimer *m_progressTimer;
-    int m_simulatedProgress;
+    JobScheduler *m_scheduler;
+    ModuleInfoCache *m_moduleInfoCache;
+    QHash<int, Operation> m_operations;     // Running jobs of this class
 };
 
 #endif // SYSTEMMANAGER_H
\ No newline at end of file
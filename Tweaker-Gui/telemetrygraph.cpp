@@ -0,0 +1,288 @@
+#include "telemetrygraph.h"
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPolygonF>
+#include <QWheelEvent>
+
+#include <cmath>
+
+namespace {
+
+const int kGridLines = 10;
+const int kPenWidth = 2;
+const int kMinViewSamples = 20;     // Deepest zoom into a recording
+const double kZoomStep = 1.25;      // Per wheel notch
+
+// "4:05" or "1:02:05"
+QString formatDuration(qint64 ms)
+{
+    qint64 seconds = ms / 1000;
+    if (seconds >= 3600) {
+        return QString("%1:%2:%3").arg(seconds / 3600)
+            .arg((seconds / 60) % 60, 2, 10, QChar('0'))
+            .arg(seconds % 60, 2, 10, QChar('0'));
+    }
+    return QString("%1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'));
+}
+
+} // namespace
+
+TelemetryGraph::TelemetryGraph(QWidget *parent)
+    : QWidget(parent)
+    , m_samplesPerColumn(1)
+    , m_pendingCount(0)
+    , m_showingRecording(false)
+    , m_viewStart(0)
+    , m_viewLength(0)
+    , m_dragX(0)
+    , m_dragViewStart(0)
+{
+}
+
+int TelemetryGraph::addSeries(const QColor &color, double fullScale)
+{
+    Series series;
+    series.color = color;
+    series.fullScale = fullScale;
+    m_series.append(series);
+
+    // The channel layout changes, so whatever was kept is dropped
+    m_samples = TelemetryHistory<float>(m_series.size(), m_samples.capacity());
+    rebuildColumns();
+    return m_series.size() - 1;
+}
+
+void TelemetryGraph::setCapacity(int samples)
+{
+    if (samples == m_samples.capacity()) return;
+    m_samples.setCapacity(samples);
+    rebuildColumns();
+    update();
+}
+
+void TelemetryGraph::append(const float *values)
+{
+    m_samples.append(values);
+    addToColumns(values);
+}
+
+void TelemetryGraph::clear()
+{
+    m_samples.clear();
+    rebuildColumns();
+    update();
+}
+
+void TelemetryGraph::showRecording(const TelemetryHistory<float> &samples, const QVector<qint64> &timestamps)
+{
+    m_recording = samples;
+    m_recordingTimes = timestamps;
+    m_showingRecording = true;
+    setView(0, m_recording.size());
+}
+
+void TelemetryGraph::showLive()
+{
+    m_showingRecording = false;
+    m_recording = TelemetryHistory<float>();
+    m_recordingTimes.clear();
+    update();
+}
+
+void TelemetryGraph::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    int width = this->width();
+    int height = this->height();
+
+    // Draw background
+    painter.fillRect(0, 0, width, height, Qt::white);
+
+    // Draw grid
+    painter.setPen(QPen(Qt::lightGray, 1));
+    for (int i = 0; i <= kGridLines; i++) {
+        int y = height * i / kGridLines;
+        painter.drawLine(0, y, width, y);
+    }
+
+    int columns = m_showingRecording ? recordingColumns(width) : liveColumns();
+    if (columns < 2) return;
+
+    // Until the history fills up, what there is is stretched across the width
+    double xStep = double(width) / (columns - 1);
+    int channels = m_series.size() * 2;
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    QPolygonF polyline;
+    polyline.reserve(columns * 2);
+    for (int series = 0; series < m_series.size(); ++series) {
+        double scale = height / m_series.at(series).fullScale;
+        polyline.clear();
+
+        for (int column = 0; column < columns; ++column) {
+            const float *pair = m_paintColumns.constData() + column * channels + 2 * series;
+            float minimum = pair[0];
+            float maximum = pair[1];
+
+            double x = column * xStep;
+            double yMinimum = height - minimum * scale;
+            double yMaximum = height - maximum * scale;
+            if (minimum == maximum) {
+                polyline << QPointF(x, yMinimum);
+            } else if (!polyline.isEmpty() && polyline.last().y() < yMaximum) {
+                // Coming from above: visit the top of the column first
+                polyline << QPointF(x, yMaximum) << QPointF(x, yMinimum);
+            } else {
+                polyline << QPointF(x, yMinimum) << QPointF(x, yMaximum);
+            }
+        }
+
+        painter.setPen(QPen(m_series.at(series).color, kPenWidth));
+        painter.drawPolyline(polyline);
+    }
+
+    if (m_showingRecording && !m_recordingTimes.isEmpty()) {
+        QString range = QString("%1 - %2 of %3")
+            .arg(formatDuration(m_recordingTimes.at(m_viewStart)))
+            .arg(formatDuration(m_recordingTimes.at(m_viewStart + m_viewLength - 1)))
+            .arg(formatDuration(m_recordingTimes.last()));
+        painter.setPen(QPen(Qt::black, 1));
+        painter.drawText(4, 12, range);
+    }
+}
+
+void TelemetryGraph::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    rebuildColumns();
+}
+
+void TelemetryGraph::wheelEvent(QWheelEvent *event)
+{
+    if (!m_showingRecording) {
+        QWidget::wheelEvent(event);
+        return;
+    }
+
+    // Zoom so the sample under the cursor stays where it is
+    double fraction = qBound(0.0, double(event->pos().x()) / qMax(width(), 1), 1.0);
+    double notches = event->angleDelta().y() / 120.0;
+    int length = int(m_viewLength * std::pow(kZoomStep, -notches));
+    int anchor = m_viewStart + int(fraction * m_viewLength);
+    setView(anchor - int(fraction * length), length);
+    event->accept();
+}
+
+void TelemetryGraph::mousePressEvent(QMouseEvent *event)
+{
+    if (!m_showingRecording || event->button() != Qt::LeftButton) {
+        QWidget::mousePressEvent(event);
+        return;
+    }
+    m_dragX = event->x();
+    m_dragViewStart = m_viewStart;
+}
+
+void TelemetryGraph::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!m_showingRecording || !(event->buttons() & Qt::LeftButton)) {
+        QWidget::mouseMoveEvent(event);
+        return;
+    }
+    // Drag the recording along under the cursor
+    int shift = int(qint64(m_dragX - event->x()) * m_viewLength / qMax(width(), 1));
+    setView(m_dragViewStart + shift, m_viewLength);
+}
+
+void TelemetryGraph::rebuildColumns()
+{
+    // Enough samples per column that the full history fits the width
+    int width = qMax(this->width(), 1);
+    m_samplesPerColumn = qMax(1, (m_samples.capacity() + width - 1) / width);
+
+    int channels = qMax(m_series.size(), 1) * 2;
+    m_columns = TelemetryHistory<float>(channels, (m_samples.capacity() + m_samplesPerColumn - 1) / m_samplesPerColumn);
+    m_pending.fill(0.0f, channels);
+    m_pendingCount = 0;
+
+    QVector<float> values(m_series.size());
+    for (int i = 0; i < m_samples.size(); ++i) {
+        for (int series = 0; series < m_series.size(); ++series) {
+            values[series] = m_samples.at(series, i);
+        }
+        addToColumns(values.constData());
+    }
+}
+
+void TelemetryGraph::addToColumns(const float *values)
+{
+    for (int series = 0; series < m_series.size(); ++series) {
+        float &minimum = m_pending[2 * series];
+        float &maximum = m_pending[2 * series + 1];
+        if (m_pendingCount == 0) {
+            minimum = maximum = values[series];
+        } else {
+            minimum = qMin(minimum, values[series]);
+            maximum = qMax(maximum, values[series]);
+        }
+    }
+
+    if (++m_pendingCount == m_samplesPerColumn) {
+        m_columns.append(m_pending.constData());
+        m_pendingCount = 0;
+    }
+}
+
+int TelemetryGraph::liveColumns()
+{
+    int channels = m_series.size() * 2;
+    int columns = m_columns.size() + (m_pendingCount > 0 ? 1 : 0);
+    m_paintColumns.resize(columns * channels);
+
+    float *out = m_paintColumns.data();
+    for (int column = 0; column < m_columns.size(); ++column) {
+        for (int channel = 0; channel < channels; ++channel) {
+            *out++ = m_columns.at(channel, column);
+        }
+    }
+    if (m_pendingCount > 0) {
+        for (int channel = 0; channel < channels; ++channel) {
+            *out++ = m_pending.at(channel);
+        }
+    }
+    return columns;
+}
+
+int TelemetryGraph::recordingColumns(int width)
+{
+    // At most one column per pixel, each covering an equal share of the view
+    int channels = m_series.size() * 2;
+    int columns = qMin(m_viewLength, qMax(width, 1));
+    m_paintColumns.resize(columns * channels);
+
+    float *out = m_paintColumns.data();
+    for (int column = 0; column < columns; ++column) {
+        int first = m_viewStart + int(qint64(column) * m_viewLength / columns);
+        int last = m_viewStart + int(qint64(column + 1) * m_viewLength / columns);
+        for (int series = 0; series < m_series.size(); ++series) {
+            float minimum = m_recording.at(series, first);
+            float maximum = minimum;
+            for (int i = first + 1; i < last; ++i) {
+                float value = m_recording.at(series, i);
+                minimum = qMin(minimum, value);
+                maximum = qMax(maximum, value);
+            }
+            *out++ = minimum;
+            *out++ = maximum;
+        }
+    }
+    return columns;
+}
+
+void TelemetryGraph::setView(int start, int length)
+{
+    int size = m_recording.size();
+    m_viewLength = qBound(qMin(kMinViewSamples, size), length, size);
+    m_viewStart = qBound(0, start, size - m_viewLength);
+    update();
+}
@@ -0,0 +1,91 @@
+#ifndef TELEMETRYGRAPH_H
+#define TELEMETRYGRAPH_H
+
+#include <QColor>
+#include <QVector>
+#include <QWidget>
+#include "telemetryhistory.h"
+
+// Scrolling line graph of several telemetry series. Samples are folded into
+// per-pixel-column minimum and maximum values as they arrive, and each
+// series is drawn as one polyline through those, so a repaint costs the
+// same for a 100 second history as for a 4 hour one: two points per column
+// per series and one draw call per series. Peaks narrower than a column
+// still show, as the column's vertical extent.
+//
+// The graph can also show a recording in place of the live samples; the
+// mouse wheel then zooms around the cursor and dragging scrubs through it.
+class TelemetryGraph : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TelemetryGraph(QWidget *parent = nullptr);
+
+    // Add every series before the first append(). The top edge of the
+    // graph is fullScale. Returns the series index.
+    int addSeries(const QColor &color, double fullScale);
+    int seriesCount() const { return m_series.size(); }
+
+    // Samples kept; the newest that still fit survive a change
+    void setCapacity(int samples);
+    int capacity() const { return m_samples.capacity(); }
+
+    // One value per series, in the order they were added. Call update()
+    // once a batch has been appended.
+    void append(const float *values);
+    void clear();
+
+    // samples has one channel per series; timestamps are ms from the start
+    // of the recording, one per sample. Live samples are still collected
+    // while a recording is shown.
+    void showRecording(const TelemetryHistory<float> &samples, const QVector<qint64> &timestamps);
+    void showLive();
+    bool isShowingRecording() const { return m_showingRecording; }
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+private:
+    struct Series {
+        QColor color;
+        double fullScale;
+    };
+
+    void rebuildColumns();
+    void addToColumns(const float *values);
+
+    // Fill m_paintColumns with a min/max pair per series for each column
+    // to draw; return the column count
+    int liveColumns();
+    int recordingColumns(int width);
+    void setView(int start, int length);
+
+    QVector<Series> m_series;
+    TelemetryHistory<float> m_samples;  // Every sample, one channel per series
+
+    // Completed columns: channel 2*s is series s's minimum, 2*s+1 its maximum
+    TelemetryHistory<float> m_columns;
+    int m_samplesPerColumn;
+
+    // The column still being filled
+    QVector<float> m_pending;           // Same layout as a m_columns entry
+    int m_pendingCount;
+
+    QVector<float> m_paintColumns;
+
+    // Recording being shown and the part of it in view, in samples
+    bool m_showingRecording;
+    TelemetryHistory<float> m_recording;
+    QVector<qint64> m_recordingTimes;
+    int m_viewStart;
+    int m_viewLength;
+    int m_dragX;
+    int m_dragViewStart;
+};
+
+#endif // TELEMETRYGRAPH_H
@@ -0,0 +1,92 @@
+#ifndef TELEMETRYHISTORY_H
+#define TELEMETRYHISTORY_H
+
+#include <QVector>
+#include <QtGlobal>
+
+// Fixed-capacity history of parallel series, e.g. one value per sensor per
+// sample. The storage is a single block laid out channel by
+// channel (struct of arrays), so walking one series for drawing reads
+// memory sequentially. append() is O(1) and never allocates: when the
+// history is full it overwrites the oldest sample.
+template <typename T>
+class TelemetryHistory
+{
+public:
+    explicit TelemetryHistory(int channels = 1, int capacity = 0)
+        : m_channels(qMax(channels, 1))
+        , m_capacity(0)
+        , m_start(0)
+        , m_size(0)
+    {
+        setCapacity(capacity);
+    }
+
+    int channels() const { return m_channels; }
+    int capacity() const { return m_capacity; }
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+
+    // Reallocates; keeps the newest samples that still fit
+    void setCapacity(int capacity)
+    {
+        capacity = qMax(capacity, 0);
+        if (capacity == m_capacity) return;
+
+        int keep = qMin(m_size, capacity);
+        QVector<T> data(capacity * m_channels);
+        for (int channel = 0; channel < m_channels; ++channel) {
+            for (int i = 0; i < keep; ++i) {
+                data[channel * capacity + i] = at(channel, m_size - keep + i);
+            }
+        }
+        m_data.swap(data);
+        m_capacity = capacity;
+        m_start = 0;
+        m_size = keep;
+    }
+
+    void clear()
+    {
+        m_start = 0;
+        m_size = 0;
+    }
+
+    // One value per channel
+    void append(const T *values)
+    {
+        if (m_capacity == 0) return;
+
+        int slot = m_start + m_size;
+        if (slot >= m_capacity) slot -= m_capacity;
+        T *data = m_data.data();
+        for (int channel = 0; channel < m_channels; ++channel) {
+            data[channel * m_capacity + slot] = values[channel];
+        }
+
+        if (m_size < m_capacity) {
+            ++m_size;
+        } else if (++m_start == m_capacity) {
+            m_start = 0;
+        }
+    }
+
+    // Index 0 is the oldest sample
+    T at(int channel, int index) const
+    {
+        int slot = m_start + index;
+        if (slot >= m_capacity) slot -= m_capacity;
+        return m_data.at(channel * m_capacity + slot);
+    }
+
+    T latest(int channel) const { return at(channel, m_size - 1); }
+
+private:
+    QVector<T> m_data;
+    int m_channels;
+    int m_capacity;
+    int m_start;    // Slot of the oldest sample
+    int m_size;
+};
+
+#endif // TELEMETRYHISTORY_H
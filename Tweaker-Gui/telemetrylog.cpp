@@ -0,0 +1,303 @@
+#include "telemetrylog.h"
+#include <QDateTime>
+
+#include <cmath>
+
+namespace {
+
+const char kMagic[] = "TWKTLOG1";
+const int kMagicLength = 8;
+const char kBlockTag = 'B';
+
+// Blocks end at whichever comes first; a crash loses at most one block
+const int kBlockSamples = 200;
+const qint64 kBlockMs = 10000;
+
+void putVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(char(value | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+// Small negative deltas become small unsigned numbers: 0, -1, 1, -2, ...
+void putSigned(QByteArray &out, qint64 value)
+{
+    putVarint(out, (quint64(value) << 1) ^ quint64(value >> 63));
+}
+
+bool getVarint(const char *&p, const char *end, quint64 &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        quint8 byte = quint8(*p++);
+        value |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+bool getSigned(const char *&p, const char *end, qint64 &value)
+{
+    quint64 raw;
+    if (!getVarint(p, end, raw)) return false;
+    value = qint64(raw >> 1) ^ -qint64(raw & 1);
+    return true;
+}
+
+} // namespace
+
+TelemetryLogWriter::TelemetryLogWriter()
+    : m_channels(0)
+    , m_bytesWritten(0)
+    , m_blockSamples(0)
+    , m_blockStart(0)
+    , m_previousTimestamp(0)
+{
+}
+
+TelemetryLogWriter::~TelemetryLogWriter()
+{
+    QString error;
+    close(error);
+}
+
+bool TelemetryLogWriter::open(const QString &path, const QList<TelemetryLogChannel> &channels, QString &error)
+{
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        error = QString("Cannot create %1: %2").arg(path, m_file.errorString());
+        return false;
+    }
+
+    QByteArray header(kMagic, kMagicLength);
+    putVarint(header, quint64(QDateTime::currentMSecsSinceEpoch()));
+    putVarint(header, quint64(channels.size()));
+    for (const TelemetryLogChannel &channel : channels) {
+        QByteArray name = channel.name.toUtf8();
+        putVarint(header, quint64(name.size()));
+        header.append(name);
+        putVarint(header, quint64(qMax(channel.scale, 1)));
+    }
+
+    m_channels = channels.size();
+    m_scales.clear();
+    for (const TelemetryLogChannel &channel : channels) {
+        m_scales.append(qMax(channel.scale, 1));
+    }
+    m_bytesWritten = 0;
+    m_blockSamples = 0;
+    m_previous.fill(0, m_channels);
+    m_minimum.fill(0, m_channels);
+    m_maximum.fill(0, m_channels);
+
+    if (m_file.write(header) != header.size() || !m_file.flush()) {
+        error = QString("Cannot write %1: %2").arg(path, m_file.errorString());
+        m_file.close();
+        return false;
+    }
+    m_bytesWritten = header.size();
+    return true;
+}
+
+bool TelemetryLogWriter::close(QString &error)
+{
+    if (!m_file.isOpen()) return true;
+    bool ok = writeBlock(error);
+    m_file.close();
+    return ok;
+}
+
+bool TelemetryLogWriter::append(qint64 timestamp, const double *values, QString &error)
+{
+    if (!m_file.isOpen()) {
+        error = "Recording is not open";
+        return false;
+    }
+
+    if (m_blockSamples == 0) {
+        // Blocks decode on their own: the first sample is relative to zero
+        m_blockStart = timestamp;
+        m_previousTimestamp = timestamp;
+        m_previous.fill(0);
+    }
+
+    putVarint(m_payload, quint64(qMax<qint64>(timestamp - m_previousTimestamp, 0)));
+    m_previousTimestamp = qMax(timestamp, m_previousTimestamp);
+    for (int channel = 0; channel < m_channels; ++channel) {
+        qint64 value = qint64(std::llround(values[channel] * m_scales.at(channel)));
+        putSigned(m_payload, value - m_previous.at(channel));
+        m_previous[channel] = value;
+
+        if (m_blockSamples == 0) {
+            m_minimum[channel] = m_maximum[channel] = value;
+        } else {
+            m_minimum[channel] = qMin(m_minimum.at(channel), value);
+            m_maximum[channel] = qMax(m_maximum.at(channel), value);
+        }
+    }
+    ++m_blockSamples;
+
+    if (m_blockSamples >= kBlockSamples || m_previousTimestamp - m_blockStart >= kBlockMs) {
+        return writeBlock(error);
+    }
+    return true;
+}
+
+bool TelemetryLogWriter::writeBlock(QString &error)
+{
+    if (m_blockSamples == 0) return true;
+
+    // The index entry goes in front so readers can skip the payload
+    QByteArray block;
+    block.append(kBlockTag);
+    putVarint(block, quint64(m_payload.size()));
+    putVarint(block, quint64(m_blockSamples));
+    putVarint(block, quint64(m_blockStart));
+    putVarint(block, quint64(m_previousTimestamp - m_blockStart));
+    for (int channel = 0; channel < m_channels; ++channel) {
+        putSigned(block, m_minimum.at(channel));
+        putVarint(block, quint64(m_maximum.at(channel) - m_minimum.at(channel)));
+    }
+    block.append(m_payload);
+
+    m_payload.clear();
+    m_blockSamples = 0;
+
+    if (m_file.write(block) != block.size() || !m_file.flush()) {
+        error = QString("Cannot write %1: %2").arg(m_file.fileName(), m_file.errorString());
+        return false;
+    }
+    m_bytesWritten += block.size();
+    return true;
+}
+
+bool TelemetryLogReader::open(const QString &path, QString &error)
+{
+    m_channels.clear();
+    m_blocks.clear();
+    m_sampleCount = 0;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = QString("Cannot open %1: %2").arg(path, file.errorString());
+        return false;
+    }
+    m_data = file.readAll();
+
+    const char *p = m_data.constData();
+    const char *end = p + m_data.size();
+    if (m_data.size() < kMagicLength || !m_data.startsWith(QByteArray(kMagic, kMagicLength))) {
+        error = QString("%1 is not a telemetry recording").arg(path);
+        return false;
+    }
+    p += kMagicLength;
+
+    quint64 startTime;
+    quint64 channelCount;
+    if (!getVarint(p, end, startTime) || !getVarint(p, end, channelCount) || channelCount > 1024) {
+        error = QString("%1 has a damaged header").arg(path);
+        return false;
+    }
+    m_startTime = qint64(startTime);
+    for (quint64 i = 0; i < channelCount; ++i) {
+        quint64 length;
+        quint64 scale;
+        if (!getVarint(p, end, length) || length > quint64(end - p)) {
+            error = QString("%1 has a damaged header").arg(path);
+            return false;
+        }
+        TelemetryLogChannel channel;
+        channel.name = QString::fromUtf8(p, int(length));
+        p += length;
+        if (!getVarint(p, end, scale) || scale == 0) {
+            error = QString("%1 has a damaged header").arg(path);
+            return false;
+        }
+        channel.scale = int(scale);
+        m_channels.append(channel);
+    }
+
+    // Walk the index entries; a block cut short at the end is left out
+    while (p < end && *p == kBlockTag) {
+        ++p;
+        Block block;
+        quint64 length;
+        quint64 samples;
+        quint64 first;
+        quint64 span;
+        if (!getVarint(p, end, length) || !getVarint(p, end, samples) ||
+            !getVarint(p, end, first) || !getVarint(p, end, span)) {
+            break;
+        }
+        block.samples = int(samples);
+        block.firstTimestamp = qint64(first);
+        block.lastTimestamp = qint64(first + span);
+
+        // Per-channel min/max, for tools that summarise without decoding
+        bool complete = true;
+        for (int channel = 0; channel < m_channels.size() && complete; ++channel) {
+            qint64 minimum;
+            quint64 extent;
+            complete = getSigned(p, end, minimum) && getVarint(p, end, extent);
+        }
+        if (!complete || length > quint64(end - p)) break;
+
+        block.offset = int(p - m_data.constData());
+        block.length = int(length);
+        p += length;
+        m_blocks.append(block);
+        m_sampleCount += block.samples;
+    }
+    return true;
+}
+
+int TelemetryLogReader::channelIndex(const QString &name) const
+{
+    for (int i = 0; i < m_channels.size(); ++i) {
+        if (m_channels.at(i).name == name) return i;
+    }
+    return -1;
+}
+
+qint64 TelemetryLogReader::duration() const
+{
+    if (m_blocks.isEmpty()) return 0;
+    return m_blocks.last().lastTimestamp - m_blocks.first().firstTimestamp;
+}
+
+void TelemetryLogReader::read(qint64 from, qint64 to, QVector<qint64> &timestamps, QVector<double> &values) const
+{
+    timestamps.clear();
+    values.clear();
+
+    int channels = m_channels.size();
+    QVector<qint64> current(channels);
+    for (const Block &block : m_blocks) {
+        if (block.lastTimestamp < from || block.firstTimestamp > to) continue;
+
+        const char *p = m_data.constData() + block.offset;
+        const char *end = p + block.length;
+        qint64 timestamp = block.firstTimestamp;
+        current.fill(0);
+        for (int sample = 0; sample < block.samples; ++sample) {
+            quint64 step;
+            if (!getVarint(p, end, step)) return;
+            timestamp += qint64(step);
+
+            for (int channel = 0; channel < channels; ++channel) {
+                qint64 delta;
+                if (!getSigned(p, end, delta)) return;
+                current[channel] += delta;
+            }
+
+            if (timestamp < from || timestamp > to) continue;
+            timestamps.append(timestamp);
+            for (int channel = 0; channel < channels; ++channel) {
+                values.append(double(current.at(channel)) / m_channels.at(channel).scale);
+            }
+        }
+    }
+}
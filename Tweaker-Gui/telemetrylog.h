@@ -0,0 +1,96 @@
+#ifndef TELEMETRYLOG_H
+#define TELEMETRYLOG_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+// Compact append-only telemetry recording.
+//
+// The file starts with a header naming the channels, then holds blocks of
+// up to a few seconds of samples. Each block opens with an index entry --
+// its byte length, sample count, time span and per-channel min/max -- so a
+// reader can skip to any time, and summarise a block, without decoding
+// samples. Inside a block, values are stored as fixed-point integers,
+// delta-encoded against the previous sample and written as zigzag varints;
+// sensor readings barely change between samples at 20 Hz, so most take one
+// byte. A block is only written once complete, so a recording cut short
+// by a crash or power loss is readable up to its last full block.
+struct TelemetryLogChannel {
+    QString name;       // e.g. "gpu.temperature"
+    int scale;          // Stored as round(value * scale)
+};
+
+class TelemetryLogWriter
+{
+public:
+    TelemetryLogWriter();
+    ~TelemetryLogWriter();
+
+    bool open(const QString &path, const QList<TelemetryLogChannel> &channels, QString &error);
+    // Writes the last partial block
+    bool close(QString &error);
+    bool isOpen() const { return m_file.isOpen(); }
+
+    // timestamp is ms since the recording started; one value per channel
+    bool append(qint64 timestamp, const double *values, QString &error);
+
+    qint64 bytesWritten() const { return m_bytesWritten; }
+
+private:
+    Q_DISABLE_COPY(TelemetryLogWriter)
+
+    bool writeBlock(QString &error);
+
+    QFile m_file;
+    int m_channels;
+    QVector<int> m_scales;
+    qint64 m_bytesWritten;
+
+    // The block being built
+    QByteArray m_payload;
+    int m_blockSamples;
+    qint64 m_blockStart;
+    qint64 m_previousTimestamp;
+    QVector<qint64> m_previous;     // Previous sample's stored values
+    QVector<qint64> m_minimum;
+    QVector<qint64> m_maximum;
+};
+
+class TelemetryLogReader
+{
+public:
+    // Loads the file (a few MB for hours of data) and reads the header and
+    // the block index; samples are decoded on demand
+    bool open(const QString &path, QString &error);
+
+    const QList<TelemetryLogChannel> &channels() const { return m_channels; }
+    int channelIndex(const QString &name) const;
+
+    qint64 startTime() const { return m_startTime; }    // ms since the epoch
+    qint64 duration() const;                            // ms
+    int sampleCount() const { return m_sampleCount; }
+
+    // Samples timed from..to (ms since the start), oldest first. values
+    // holds channels().size() values per sample.
+    void read(qint64 from, qint64 to, QVector<qint64> &timestamps, QVector<double> &values) const;
+
+private:
+    struct Block {
+        int offset;         // Of the payload within m_data
+        int length;
+        int samples;
+        qint64 firstTimestamp;
+        qint64 lastTimestamp;
+    };
+
+    QByteArray m_data;
+    QList<TelemetryLogChannel> m_channels;
+    QVector<Block> m_blocks;
+    qint64 m_startTime = 0;
+    int m_sampleCount = 0;
+};
+
+#endif // TELEMETRYLOG_H
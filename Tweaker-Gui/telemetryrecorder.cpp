@@ -0,0 +1,127 @@
+#include "telemetryrecorder.h"
+#include "telemetrylog.h"
+#include "telemetrythread.h"
+#include <QTextStream>
+#include <QVector>
+
+#include <signal.h>
+
+namespace {
+
+const int kDrainIntervalMs = 200;
+const int kStatusIntervalMs = 60000;
+
+volatile sig_atomic_t g_stopRequested = 0;
+
+void requestStop(int)
+{
+    g_stopRequested = 1;
+}
+
+// Fixed point keeps a tenth of a degree and of a percent
+QList<TelemetryLogChannel> channelsFor(const TelemetrySample &sample)
+{
+    QList<TelemetryLogChannel> channels;
+    channels << TelemetryLogChannel{ "gpu.frequency", 1 }
+             << TelemetryLogChannel{ "gpu.temperature", 10 }
+             << TelemetryLogChannel{ "gpu.usage", 1 }
+             << TelemetryLogChannel{ "cpu.frequency", 1 }
+             << TelemetryLogChannel{ "cpu.big.frequency", 1 }
+             << TelemetryLogChannel{ "cpu.temperature", 10 }
+             << TelemetryLogChannel{ "cpu.usage", 10 };
+    for (int i = 0; i < sample.clusterCount; ++i) {
+        QString prefix = QString("cpu%1.").arg(sample.clusters[i].firstCpu);
+        channels << TelemetryLogChannel{ prefix + "frequency", 1 }
+                 << TelemetryLogChannel{ prefix + "limit", 1 }
+                 << TelemetryLogChannel{ prefix + "usage", 10 };
+    }
+    return channels;
+}
+
+// In channelsFor() order
+void valuesOf(const TelemetrySample &sample, QVector<double> &values)
+{
+    values.clear();
+    values << sample.gpuFrequency << sample.gpuTemperature << sample.gpuUsage
+           << sample.cpuFrequency << sample.bigCoreFrequency()
+           << sample.cpuTemperature << sample.cpuUsage;
+    for (int i = 0; i < sample.clusterCount; ++i) {
+        const CpuClusterSample &cluster = sample.clusters[i];
+        values << cluster.frequency << cluster.limitFrequency << cluster.usage;
+    }
+}
+
+} // namespace
+
+int runTelemetryRecorder(const QString &path, int rateHz, int seconds)
+{
+    QTextStream out(stdout);
+
+    TelemetryThread sampler;
+    sampler.setInterval(qMax(1, 1000 / rateHz));
+    sampler.start();
+
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+
+    // The first sample says how many CPU clusters there are to record
+    TelemetrySample sample;
+    while (!sampler.takeSample(sample)) {
+        QThread::msleep(10);
+    }
+
+    QString error;
+    TelemetryLogWriter writer;
+    if (!writer.open(path, channelsFor(sample), error)) {
+        out << error << "\n";
+        return 1;
+    }
+    out << QString("Recording telemetry at %1 Hz to %2").arg(rateHz).arg(path)
+        << (seconds > 0 ? QString(" for %1 s").arg(seconds) : QString(", Ctrl+C to stop")) << "\n";
+    out.flush();
+
+    qint64 origin = sample.timestamp;
+    qint64 limit = qint64(seconds) * 1000;
+    qint64 nextStatus = kStatusIntervalMs;
+    int samples = 0;
+    QVector<double> values;
+    bool ok = true;
+    for (;;) {
+        qint64 elapsed = sample.timestamp - origin;
+        if (limit > 0 && elapsed >= limit) break;
+
+        valuesOf(sample, values);
+        if (!writer.append(elapsed, values.constData(), error)) {
+            ok = false;
+            break;
+        }
+        ++samples;
+
+        if (elapsed >= nextStatus) {
+            out << QString("%1 min, %2 samples, %3 KB\n")
+                       .arg(elapsed / 60000).arg(samples).arg(writer.bytesWritten() / 1024);
+            out.flush();
+            nextStatus += kStatusIntervalMs;
+        }
+
+        bool received;
+        while (!(received = sampler.takeSample(sample)) && !g_stopRequested) {
+            QThread::msleep(kDrainIntervalMs);
+        }
+        if (!received) break;
+    }
+
+    sampler.requestInterruption();
+    sampler.wait();
+
+    if (!writer.close(error)) ok = false;
+    if (!ok) {
+        out << error << "\n";
+        return 1;
+    }
+
+    int dropped = sampler.droppedSamples();
+    out << QString("Recorded %1 samples, %2 KB").arg(samples).arg(writer.bytesWritten() / 1024)
+        << (dropped > 0 ? QString(", %1 dropped").arg(dropped) : QString()) << "\n";
+    return 0;
+}
@@ -0,0 +1,13 @@
+#ifndef TELEMETRYRECORDER_H
+#define TELEMETRYRECORDER_H
+
+#include <QString>
+
+// Records telemetry to a TelemetryLog file without the GUI, for long runs
+// on boards with no display. Started with
+// --record-telemetry <file> [rate-hz] [seconds]; runs until the time is up,
+// or until interrupted when seconds is 0. Prints to stdout and returns the
+// exit code.
+int runTelemetryRecorder(const QString &path, int rateHz, int seconds);
+
+#endif // TELEMETRYRECORDER_H
@@ -0,0 +1,389 @@
+#include "telemetrysampler.h"
+#include "sensorregistry.h"
+
+#include <QDir>
+#include <QFile>
+#include <algorithm>
+#include <limits>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+const char kProcStatPath[] = "/proc/stat";
+const char kCpuInfoPath[] = "/proc/cpuinfo";
+const char kCpufreqPath[] = "/sys/devices/system/cpu/cpufreq";
+
+// MIDR part numbers of Arm-designed cores
+struct CorePart {
+    int part;
+    const char *name;
+};
+const CorePart kArmCoreParts[] = {
+    { 0xd03, "Cortex-A53" }, { 0xd04, "Cortex-A35" }, { 0xd05, "Cortex-A55" },
+    { 0xd07, "Cortex-A57" }, { 0xd08, "Cortex-A72" }, { 0xd09, "Cortex-A73" },
+    { 0xd0a, "Cortex-A75" }, { 0xd0b, "Cortex-A76" }, { 0xd0d, "Cortex-A77" },
+    { 0xd41, "Cortex-A78" }, { 0xd44, "Cortex-X1" },  { 0xd46, "Cortex-A510" },
+    { 0xd47, "Cortex-A710" }, { 0xd48, "Cortex-X2" }, { 0xd4d, "Cortex-A715" },
+    { 0xd4e, "Cortex-X3" },  { 0xd80, "Cortex-A520" }, { 0xd81, "Cortex-A720" },
+    { 0xd82, "Cortex-X4" }
+};
+const int kArmImplementer = 0x41;
+
+const qint64 kMinTemperature = 10001;           // millidegrees; below is a bogus zone
+const qint64 kMaxValue = std::numeric_limits<qint64>::max();
+
+// sysfs and procfs regenerate a file on every read from offset 0, so one
+// descriptor can be read over and over. NUL-terminates; returns the length.
+int readFile(int fd, char *buffer, int size)
+{
+    ssize_t length = fd >= 0 ? pread(fd, buffer, size - 1, 0) : 0;
+    if (length < 0) length = 0;
+    buffer[length] = '\0';
+    return int(length);
+}
+
+// Parses a decimal integer at p, skipping leading blanks; advances p
+bool parseInteger(const char *&p, qint64 &value)
+{
+    while (*p == ' ' || *p == '\t') ++p;
+    bool negative = (*p == '-');
+    if (negative) ++p;
+    if (*p < '0' || *p > '9') return false;
+
+    value = 0;
+    while (*p >= '0' && *p <= '9') {
+        value = value * 10 + (*p++ - '0');
+    }
+    if (negative) value = -value;
+    return true;
+}
+
+bool readInteger(int fd, qint64 &value)
+{
+    char buffer[64];
+    if (readFile(fd, buffer, sizeof(buffer)) == 0) return false;
+    const char *p = buffer;
+    return parseInteger(p, value);
+}
+
+// Reads the single integer in a file that is only needed once
+bool readIntegerAt(const QString &path, qint64 &value)
+{
+    int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    bool ok = readInteger(fd, value);
+    if (fd >= 0) ::close(fd);
+    return ok;
+}
+
+// Busy percentage from the "user nice system idle iowait irq softirq steal"
+// fields of a /proc/stat line, relative to the previous totals
+double usageSince(const quint64 (&fields)[8], quint64 &lastIdle, quint64 &lastTotal)
+{
+    quint64 idle = fields[3] + fields[4];
+    quint64 total = 0;
+    for (quint64 field : fields) {
+        total += field;
+    }
+
+    double usage = 0.0;
+    if (lastTotal > 0 && total > lastTotal) {
+        quint64 totalDiff = total - lastTotal;
+        quint64 idleDiff = qMin(idle > lastIdle ? idle - lastIdle : 0, totalDiff);
+        usage = qBound(0.0, 100.0 * (totalDiff - idleDiff) / totalDiff, 100.0);
+    }
+    lastIdle = idle;
+    lastTotal = total;
+    return usage;
+}
+
+} // namespace
+
+double TelemetrySample::bigCoreFrequency() const
+{
+    double fastest = 0.0;
+    for (int i = 0; i < clusterCount; ++i) {
+        fastest = qMax(fastest, clusters[i].maxFrequency);
+    }
+
+    double total = 0.0;
+    int cores = 0;
+    for (int i = 0; i < clusterCount; ++i) {
+        const CpuClusterSample &cluster = clusters[i];
+        if (cluster.maxFrequency == fastest && cluster.frequency > 0) {
+            total += cluster.frequency * cluster.cpuCount;
+            cores += cluster.cpuCount;
+        }
+    }
+    return cores > 0 ? total / cores : cpuFrequency;
+}
+
+TelemetrySampler::TelemetrySampler()
+    : m_cpuCount(0)
+    , m_statFd(-1)
+{
+    std::fill(m_cpuPolicy, m_cpuPolicy + kMaxTelemetryCpus, -1);
+    std::fill(m_lastIdle, m_lastIdle + kMaxTelemetryCpus + 1, 0);
+    std::fill(m_lastTotal, m_lastTotal + kMaxTelemetryCpus + 1, 0);
+}
+
+TelemetrySampler::~TelemetrySampler()
+{
+    close();
+}
+
+void TelemetrySampler::open()
+{
+    close();
+
+    // Which files to read is settled once here; sample() never searches
+    SensorRegistry registry;
+    registry.probe();
+
+    m_gpuFrequency = openChannel(registry.paths(SensorRegistry::Gpu, SensorRegistry::Frequency), 1, kMaxValue, 1000000.0);
+    m_gpuTemperature = openChannel(registry.paths(SensorRegistry::Gpu, SensorRegistry::Temperature), kMinTemperature, kMaxValue, 1000.0);
+    m_gpuUsage = openChannel(registry.paths(SensorRegistry::Gpu, SensorRegistry::Load), 0, 100, 1.0);
+
+    // The big cores run hottest; boards without per-cluster zones fall back
+    // to the whole SoC
+    QStringList cpuTemperaturePaths = registry.paths(SensorRegistry::CpuBig, SensorRegistry::Temperature);
+    cpuTemperaturePaths << registry.paths(SensorRegistry::CpuLittle, SensorRegistry::Temperature);
+    cpuTemperaturePaths << registry.paths(SensorRegistry::Soc, SensorRegistry::Temperature);
+    m_cpuTemperature = openChannel(cpuTemperaturePaths, kMinTemperature, kMaxValue, 1000.0);
+
+    m_cpuCount = int(qBound(1L, sysconf(_SC_NPROCESSORS_CONF), long(kMaxTelemetryCpus)));
+    openPolicies();
+
+    m_statFd = ::open(kProcStatPath, O_RDONLY | O_CLOEXEC);
+    std::fill(m_lastIdle, m_lastIdle + kMaxTelemetryCpus + 1, 0);
+    std::fill(m_lastTotal, m_lastTotal + kMaxTelemetryCpus + 1, 0);
+}
+
+void TelemetrySampler::openPolicies()
+{
+    // Which core design each CPU is; cpuinfo lists "CPU implementer" and
+    // "CPU part" after each "processor" line
+    int cpuPart[kMaxTelemetryCpus] = {};
+    QFile cpuinfo(kCpuInfoPath);
+    if (cpuinfo.open(QIODevice::ReadOnly)) {
+        int cpu = -1;
+        int implementer = 0;
+        for (const QByteArray &line : cpuinfo.readAll().split('\n')) {
+            int colon = line.indexOf(':');
+            if (colon < 0) continue;
+            QByteArray value = line.mid(colon + 1).trimmed();
+            if (line.startsWith("processor")) {
+                cpu = value.toInt();
+                implementer = 0;
+            } else if (line.startsWith("CPU implementer")) {
+                implementer = value.toInt(nullptr, 0);
+            } else if (line.startsWith("CPU part") && cpu >= 0 && cpu < kMaxTelemetryCpus) {
+                cpuPart[cpu] = implementer == kArmImplementer ? value.toInt(nullptr, 0) : 0;
+            }
+        }
+    }
+
+    QDir cpufreq(kCpufreqPath);
+    for (const QString &entry : cpufreq.entryList(QStringList() << "policy*", QDir::Dirs)) {
+        QString directory = cpufreq.filePath(entry);
+
+        // related_cpus includes offline cores, e.g. "4 5"
+        char buffer[128];
+        int fd = ::open(QFile::encodeName(directory + "/related_cpus").constData(), O_RDONLY | O_CLOEXEC);
+        readFile(fd, buffer, sizeof(buffer));
+        if (fd >= 0) ::close(fd);
+
+        Policy policy;
+        policy.firstCpu = kMaxTelemetryCpus;
+        const char *p = buffer;
+        qint64 cpu;
+        while (parseInteger(p, cpu)) {
+            if (cpu >= 0 && cpu < m_cpuCount) {
+                policy.firstCpu = qMin(policy.firstCpu, int(cpu));
+                policy.cpuMask |= 1u << cpu;
+                ++policy.cpuCount;
+            }
+        }
+        if (policy.cpuCount == 0) continue;
+
+        policy.corePart = cpuPart[policy.firstCpu];
+        readIntegerAt(directory + "/cpuinfo_max_freq", policy.maxFrequency);
+        policy.currentFd = ::open(QFile::encodeName(directory + "/scaling_cur_freq").constData(), O_RDONLY | O_CLOEXEC);
+        policy.limitFd = ::open(QFile::encodeName(directory + "/scaling_max_freq").constData(), O_RDONLY | O_CLOEXEC);
+        m_policies.append(policy);
+    }
+
+    std::sort(m_policies.begin(), m_policies.end(), [](const Policy &a, const Policy &b) {
+        return a.firstCpu < b.firstCpu;
+    });
+    while (m_policies.size() > kMaxTelemetryClusters) {
+        const Policy &policy = m_policies.last();
+        if (policy.currentFd >= 0) ::close(policy.currentFd);
+        if (policy.limitFd >= 0) ::close(policy.limitFd);
+        m_policies.removeLast();
+    }
+
+    for (int i = 0; i < m_policies.size(); ++i) {
+        for (int cpu = 0; cpu < m_cpuCount; ++cpu) {
+            if (m_policies.at(i).cpuMask & (1u << cpu)) m_cpuPolicy[cpu] = i;
+        }
+    }
+}
+
+void TelemetrySampler::close()
+{
+    Channel *channels[] = { &m_gpuFrequency, &m_gpuTemperature, &m_gpuUsage, &m_cpuTemperature };
+    for (Channel *channel : channels) {
+        if (channel->fd >= 0) ::close(channel->fd);
+        *channel = Channel();
+    }
+    for (const Policy &policy : m_policies) {
+        if (policy.currentFd >= 0) ::close(policy.currentFd);
+        if (policy.limitFd >= 0) ::close(policy.limitFd);
+    }
+    m_policies.clear();
+    std::fill(m_cpuPolicy, m_cpuPolicy + kMaxTelemetryCpus, -1);
+    m_cpuCount = 0;
+    if (m_statFd >= 0) {
+        ::close(m_statFd);
+        m_statFd = -1;
+    }
+}
+
+void TelemetrySampler::sample(TelemetrySample &sample)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    sample.timestamp = qint64(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+    sample.gpuFrequency = readChannel(m_gpuFrequency);
+    sample.gpuTemperature = readChannel(m_gpuTemperature);
+    sample.gpuUsage = readChannel(m_gpuUsage);
+    sample.cpuTemperature = readChannel(m_cpuTemperature);
+    sample.cpuCount = m_cpuCount;
+    readCpuFrequencies(sample);
+    readCpuUsage(sample);
+
+    // Cluster usage is the mean over its cores, offline ones counting as idle
+    for (int cpu = 0; cpu < m_cpuCount; ++cpu) {
+        if (m_cpuPolicy[cpu] >= 0) sample.clusters[m_cpuPolicy[cpu]].usage += sample.coreUsage[cpu];
+    }
+    for (int i = 0; i < sample.clusterCount; ++i) {
+        sample.clusters[i].usage /= sample.clusters[i].cpuCount;
+    }
+}
+
+const char *TelemetrySampler::coreName(int part)
+{
+    for (const CorePart &corePart : kArmCoreParts) {
+        if (corePart.part == part) return corePart.name;
+    }
+    return nullptr;
+}
+
+TelemetrySampler::Channel TelemetrySampler::openChannel(const QStringList &paths, qint64 minimum, qint64 maximum,
+                                                        double divisor)
+{
+    Channel channel;
+    channel.minimum = minimum;
+    channel.maximum = maximum;
+    channel.divisor = divisor;
+
+    // First file that currently reads a plausible value
+    for (const QString &path : paths) {
+        int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        qint64 value;
+        if (readInteger(fd, value) && value >= minimum && value <= maximum) {
+            channel.fd = fd;
+            break;
+        }
+        ::close(fd);
+    }
+    return channel;
+}
+
+double TelemetrySampler::readChannel(const Channel &channel)
+{
+    qint64 value;
+    if (!readInteger(channel.fd, value) || value < channel.minimum || value > channel.maximum) {
+        return 0.0;
+    }
+    return value / channel.divisor;
+}
+
+void TelemetrySampler::readCpuFrequencies(TelemetrySample &sample) const
+{
+    // All cores of a policy share one clock, so one read covers the cluster
+    qint64 total = 0;
+    int cores = 0;
+    sample.clusterCount = m_policies.size();
+    for (int i = 0; i < m_policies.size(); ++i) {
+        const Policy &policy = m_policies.at(i);
+        qint64 frequency;
+        qint64 limit;
+        if (!readInteger(policy.currentFd, frequency) || frequency < 0) frequency = 0;
+        if (!readInteger(policy.limitFd, limit) || limit < 0) limit = 0;
+
+        CpuClusterSample &cluster = sample.clusters[i];
+        cluster.firstCpu = policy.firstCpu;
+        cluster.cpuCount = policy.cpuCount;
+        cluster.corePart = policy.corePart;
+        cluster.frequency = frequency / 1000.0;     // kHz to MHz
+        cluster.limitFrequency = limit / 1000.0;
+        cluster.maxFrequency = policy.maxFrequency / 1000.0;
+        cluster.usage = 0.0;
+
+        if (frequency > 0) {
+            total += frequency * policy.cpuCount;
+            cores += policy.cpuCount;
+        }
+    }
+
+    for (int cpu = 0; cpu < m_cpuCount; ++cpu) {
+        int policy = m_cpuPolicy[cpu];
+        sample.coreFrequency[cpu] = policy >= 0 ? sample.clusters[policy].frequency : 0.0;
+    }
+    sample.cpuFrequency = cores > 0 ? total / 1000.0 / cores : 0.0;
+}
+
+void TelemetrySampler::readCpuUsage(TelemetrySample &sample)
+{
+    sample.cpuUsage = 0.0;
+    std::fill(sample.coreUsage, sample.coreUsage + kMaxTelemetryCpus, 0.0);
+
+    // The aggregate "cpu  user nice system ..." line comes first, then one
+    // "cpuN ..." line per online core; the interrupt counters after them
+    // may not fit in the buffer and aren't needed
+    char buffer[4096];
+    int length = readFile(m_statFd, buffer, sizeof(buffer));
+    const char *p = buffer;
+    const char *end = buffer + length;
+    while (end - p > 3 && p[0] == 'c' && p[1] == 'p' && p[2] == 'u') {
+        const char *newline = static_cast<const char *>(memchr(p, '\n', end - p));
+        if (!newline) break;    // Cut off by the buffer
+
+        p += 3;
+        int slot = 0;           // Index into m_lastIdle/m_lastTotal
+        if (*p != ' ') {
+            qint64 cpu;
+            if (!parseInteger(p, cpu)) break;
+            slot = (cpu >= 0 && cpu < m_cpuCount) ? int(cpu) + 1 : -1;
+        }
+
+        quint64 fields[8] = {};
+        for (int i = 0; i < 8; ++i) {
+            qint64 value;
+            if (!parseInteger(p, value)) break;
+            fields[i] = quint64(value);
+        }
+
+        if (slot == 0) {
+            sample.cpuUsage = usageSince(fields, m_lastIdle[0], m_lastTotal[0]);
+        } else if (slot > 0) {
+            sample.coreUsage[slot - 1] = usageSince(fields, m_lastIdle[slot], m_lastTotal[slot]);
+        }
+        p = newline + 1;
+    }
+}
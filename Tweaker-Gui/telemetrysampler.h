@@ -0,0 +1,111 @@
+#ifndef TELEMETRYSAMPLER_H
+#define TELEMETRYSAMPLER_H
+
+#include <QStringList>
+#include <QVector>
+#include <QtGlobal>
+
+// Fixed bounds keep a sample a plain value that can be queued between threads
+const int kMaxTelemetryCpus = 16;
+const int kMaxTelemetryClusters = 4;
+
+// The cores sharing one cpufreq policy, i.e. one clock
+struct CpuClusterSample {
+    int firstCpu;
+    int cpuCount;
+    int corePart;               // MIDR part number, 0 when unknown
+    double frequency;           // MHz
+    double limitFrequency;      // MHz, scaling_max_freq; thermal capping lowers it
+    double maxFrequency;        // MHz, cpuinfo_max_freq
+    double usage;               // %, average over the cluster's cores
+
+    bool isThrottled() const { return limitFrequency > 0 && limitFrequency < maxFrequency; }
+};
+
+// One reading of every channel; 0 where a sensor isn't available
+struct TelemetrySample {
+    qint64 timestamp;       // ms on the monotonic clock
+    double gpuFrequency;    // MHz
+    double gpuTemperature;  // °C
+    double gpuUsage;        // %
+    double cpuFrequency;    // MHz, average over all cores
+    double cpuTemperature;  // °C
+    double cpuUsage;        // %, since the previous sample
+
+    int cpuCount;
+    double coreFrequency[kMaxTelemetryCpus];    // MHz, of the core's cluster
+    double coreUsage[kMaxTelemetryCpus];        // %, 0 while offline
+
+    int clusterCount;                           // Ordered by first CPU
+    CpuClusterSample clusters[kMaxTelemetryClusters];
+
+    // Mean clock of the cores in the fastest clusters; on big.LITTLE this
+    // is the one that drops when the big cores are thermally capped
+    double bigCoreFrequency() const;
+};
+
+// Reads GPU and CPU telemetry from sysfs and procfs. open() finds the
+// sensors through SensorRegistry and opens them once; sample() re-reads
+// them with pread into stack buffers and parses the numbers by hand, so a
+// sample is a few syscalls with no heap allocation or string handling --
+// cheap enough to run at tens of Hz on a little core. CPU clocks are read
+// once per cpufreq policy (a big.LITTLE SoC such as the RK3588 has one per
+// cluster) and per-core usage comes from a single read of /proc/stat.
+class TelemetrySampler
+{
+public:
+    TelemetrySampler();
+    ~TelemetrySampler();
+
+    // Picks the first working file for each channel
+    void open();
+    void close();
+
+    void sample(TelemetrySample &sample);
+
+    // "Cortex-A76" for a CpuClusterSample::corePart, nullptr when unknown
+    static const char *coreName(int part);
+
+private:
+    Q_DISABLE_COPY(TelemetrySampler)
+
+    // A sysfs attribute holding one integer
+    struct Channel {
+        int fd = -1;
+        qint64 minimum = 0;     // Readings outside [minimum, maximum] count as 0
+        qint64 maximum = 0;
+        double divisor = 1.0;   // Raw value to reported unit
+    };
+
+    // A cpufreq policy directory
+    struct Policy {
+        int currentFd = -1;     // scaling_cur_freq
+        int limitFd = -1;       // scaling_max_freq
+        int firstCpu = 0;
+        int cpuCount = 0;
+        quint32 cpuMask = 0;
+        int corePart = 0;
+        qint64 maxFrequency = 0;    // kHz
+    };
+
+    static Channel openChannel(const QStringList &paths, qint64 minimum, qint64 maximum, double divisor);
+    static double readChannel(const Channel &channel);
+    void openPolicies();
+    void readCpuFrequencies(TelemetrySample &sample) const;
+    void readCpuUsage(TelemetrySample &sample);
+
+    Channel m_gpuFrequency;
+    Channel m_gpuTemperature;
+    Channel m_gpuUsage;
+    Channel m_cpuTemperature;
+    QVector<Policy> m_policies;         // Ordered by first CPU
+    int m_cpuPolicy[kMaxTelemetryCpus]; // Index into m_policies, -1 for none
+    int m_cpuCount;
+    int m_statFd;
+
+    // /proc/stat totals at the previous sample: the aggregate line, then one per CPU
+    quint64 m_lastIdle[kMaxTelemetryCpus + 1];
+    quint64 m_lastTotal[kMaxTelemetryCpus + 1];
+};
+
+#endif // TELEMETRYSAMPLER_H
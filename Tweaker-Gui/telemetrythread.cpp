@@ -0,0 +1,75 @@
+#include "telemetrythread.h"
+
+#include <errno.h>
+#include <time.h>
+
+namespace {
+
+const int kDefaultIntervalMs = 100;
+const int kQueueCapacity = 1024;    // Over a minute at 10 Hz before the GUI must drain
+
+void addMilliseconds(struct timespec &time, int milliseconds)
+{
+    time.tv_sec += milliseconds / 1000;
+    time.tv_nsec += long(milliseconds % 1000) * 1000000L;
+    if (time.tv_nsec >= 1000000000L) {
+        time.tv_nsec -= 1000000000L;
+        ++time.tv_sec;
+    }
+}
+
+bool isBefore(const struct timespec &a, const struct timespec &b)
+{
+    return a.tv_sec < b.tv_sec || (a.tv_sec == b.tv_sec && a.tv_nsec < b.tv_nsec);
+}
+
+} // namespace
+
+TelemetryThread::TelemetryThread(QObject *parent)
+    : QThread(parent)
+    , m_intervalMs(kDefaultIntervalMs)
+    , m_queue(kQueueCapacity)
+    , m_droppedSamples(0)
+{
+}
+
+TelemetryThread::~TelemetryThread()
+{
+    requestInterruption();
+    wait();
+}
+
+void TelemetryThread::run()
+{
+    // The descriptors belong to this thread for its lifetime
+    TelemetrySampler sampler;
+    sampler.open();
+
+    // Deadlines are absolute on the monotonic clock, so a slow read delays
+    // one sample rather than shifting every sample after it
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    while (!isInterruptionRequested()) {
+        TelemetrySample sample;
+        sampler.sample(sample);
+        if (!m_queue.push(sample)) {
+            m_droppedSamples.fetchAndAddRelaxed(1);
+        }
+
+        addMilliseconds(deadline, m_intervalMs);
+
+        // After a long stall (or a suspend) skip the missed ticks instead
+        // of catching up with a burst of samples
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        struct timespec late = deadline;
+        addMilliseconds(late, m_intervalMs);
+        if (isBefore(late, now)) {
+            deadline = now;
+        }
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef TELEMETRYTHREAD_H
+#define TELEMETRYTHREAD_H
+
+#include "spscqueue.h"
+#include "telemetrysampler.h"
+#include <QAtomicInt>
+#include <QThread>
+
+// Samples telemetry on its own thread at a fixed rate and hands the
+// samples to one consumer through a lock-free queue. A sensor read that
+// stalls (devfreq and thermal drivers sometimes do under load) only delays
+// this thread; the GUI drains the queue whenever it repaints, so sampling
+// jitter and UI latency don't affect each other.
+class TelemetryThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit TelemetryThread(QObject *parent = nullptr);
+    ~TelemetryThread() override;
+
+    // Set before start()
+    void setInterval(int milliseconds) { m_intervalMs = milliseconds; }
+    int interval() const { return m_intervalMs; }
+
+    // Consumer side: the oldest queued sample, false when none is waiting
+    bool takeSample(TelemetrySample &sample) { return m_queue.pop(sample); }
+
+    // Samples lost because the consumer fell too far behind
+    int droppedSamples() const { return m_droppedSamples.loadAcquire(); }
+
+protected:
+    void run() override;
+
+private:
+    int m_intervalMs;
+    SpscQueue<TelemetrySample> m_queue;
+    QAtomicInt m_droppedSamples;
+};
+
+#endif // TELEMETRYTHREAD_H
@@ -0,0 +1,78 @@
+#include "transferprogress.h"
+
+namespace {
+
+const qint64 kWindowMs = 20000;         // Rate is averaged over this much history
+const qint64 kMinWindowMs = 2000;       // No estimate before this much history
+const qint64 kSampleIntervalMs = 250;
+
+} // namespace
+
+TransferProgress::TransferProgress()
+    : m_totalBytes(0)
+    , m_bytesDone(0)
+{
+}
+
+void TransferProgress::start(qint64 totalBytes)
+{
+    m_timer.start();
+    m_samples.clear();
+    m_samples.enqueue(qMakePair(qint64(0), qint64(0)));
+    m_totalBytes = totalBytes;
+    m_bytesDone = 0;
+}
+
+void TransferProgress::update(qint64 bytesDone)
+{
+    m_bytesDone = bytesDone;
+
+    qint64 now = m_timer.elapsed();
+    if (!m_samples.isEmpty() && now - m_samples.last().first < kSampleIntervalMs) {
+        return;
+    }
+    m_samples.enqueue(qMakePair(now, bytesDone));
+    // Keep one sample older than the window so the window stays full
+    while (m_samples.size() > 2 && now - m_samples.at(1).first >= kWindowMs) {
+        m_samples.dequeue();
+    }
+}
+
+int TransferProgress::percent() const
+{
+    if (m_totalBytes <= 0) return -1;
+    return int(qBound<qint64>(0, m_bytesDone * 100 / m_totalBytes, 99));
+}
+
+double TransferProgress::bytesPerSecond() const
+{
+    if (m_samples.size() < 2) return 0.0;
+
+    const QPair<qint64, qint64> &oldest = m_samples.first();
+    const QPair<qint64, qint64> &newest = m_samples.last();
+    qint64 span = newest.first - oldest.first;
+    if (span < kMinWindowMs) return 0.0;
+    return (newest.second - oldest.second) * 1000.0 / span;
+}
+
+qint64 TransferProgress::secondsRemaining() const
+{
+    double rate = bytesPerSecond();
+    if (m_totalBytes <= 0 || rate <= 0.0) return -1;
+
+    // An estimated total can be overtaken; don't count down past zero
+    return qint64(qMax<qint64>(m_totalBytes - m_bytesDone, 0) / rate + 0.5);
+}
+
+QString TransferProgress::formatDuration(qint64 seconds)
+{
+    if (seconds < 0) return QString();
+
+    qint64 hours = seconds / 3600;
+    qint64 minutes = (seconds / 60) % 60;
+    qint64 secs = seconds % 60;
+    if (hours > 0) {
+        return QString("%1:%2:%3").arg(hours).arg(minutes, 2, 10, QChar('0')).arg(secs, 2, 10, QChar('0'));
+    }
+    return QString("%1:%2").arg(minutes).arg(secs, 2, 10, QChar('0'));
+}
@@ -0,0 +1,42 @@
+#ifndef TRANSFERPROGRESS_H
+#define TRANSFERPROGRESS_H
+
+#include <QElapsedTimer>
+#include <QPair>
+#include <QQueue>
+#include <QString>
+
+// Tracks a long-running transfer from (bytes done, total) updates and
+// estimates the time left from the average rate over the last few seconds,
+// which follows slowdowns (a full cache, a slow card) without jumping
+// around on every update. Totals may be estimates, so percent() stops at
+// 99 and showing completion is left to the caller.
+class TransferProgress
+{
+public:
+    TransferProgress();
+
+    void start(qint64 totalBytes);
+    void update(qint64 bytesDone);
+
+    qint64 totalBytes() const { return m_totalBytes; }
+    qint64 bytesDone() const { return m_bytesDone; }
+
+    // 0-99; -1 if the total isn't known
+    int percent() const;
+    // Moving average over the sample window, 0 until there is enough data
+    double bytesPerSecond() const;
+    // -1 while unknown
+    qint64 secondsRemaining() const;
+
+    // "1:05:12", "4:07"; empty while unknown
+    static QString formatDuration(qint64 seconds);
+
+private:
+    QElapsedTimer m_timer;
+    QQueue<QPair<qint64, qint64>> m_samples;    // (ms, bytes done)
+    qint64 m_totalBytes;
+    qint64 m_bytesDone;
+};
+
+#endif // TRANSFERPROGRESS_H
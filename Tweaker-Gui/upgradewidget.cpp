@@ -4,6 +4,15 @@
 #include <QFont>
 #include <QTime>
 
+namespace {
+
+const int kJobIdRole = Qt::UserRole;
+const int kJobDescriptionRole = Qt::UserRole + 1;
+const int kJobActiveRole = Qt::UserRole + 2;    // Queued or running
+const int kMaxFinishedJobs = 20;
+
+} // namespace
+
 UpgradeWidget::UpgradeWidget(QWidget *parent)
     : QWidget(parent)
     , m_extractGroup(nullptr)
@@ -15,8 +24,10 @@ UpgradeWidget::UpgradeWidget(QWidget *parent)
     , m_upgradeButton(nullptr)
     , m_patchButton(nullptr)
     , m_rollbackButton(nullptr)
+    , m_cancelButton(nullptr)
     , m_progressBar(nullptr)
     , m_statusLabel(nullptr)
+    , m_jobList(nullptr)
     , m_logOutput(nullptr)
 {
     setupUI();
@@ -141,6 +152,21 @@ void UpgradeWidget::setupUI()
     m_progressBar->setVisible(false);
     statusLayout->addWidget(m_progressBar);
     
+    // Operations run side by side when they don't get in each other's way,
+    // so each one is listed and cancelled on its own
+    m_jobList = new QListWidget();
+    m_jobList->setMaximumHeight(120);
+    m_jobList->setStyleSheet("background-color: #F0F0F0; color: #000000; border: 2px solid #000000;");
+    connect(m_jobList, &QListWidget::itemSelectionChanged, this, &UpgradeWidget::onJobSelectionChanged);
+    statusLayout->addWidget(m_jobList);
+    
+    // Only usable while a queued or running job is selected
+    m_cancelButton = new QPushButton("Cancel Selected Job");
+    m_cancelButton->setStyleSheet("QPushButton { background-color: #F0F0F0; color: #000000; border: 2px solid #000000; padding: 5px; } QPushButton:hover { background-color: #E0E0E0; }");
+    m_cancelButton->setEnabled(false);
+    connect(m_cancelButton, &QPushButton::clicked, this, &UpgradeWidget::onCancelJob);
+    statusLayout->addWidget(m_cancelButton);
+    
     m_logOutput = new QTextEdit();
     m_logOutput->setMaximumHeight(200);
     m_logOutput->setReadOnly(true);
@@ -215,10 +241,74 @@ void UpgradeWidget::updateStatus(const QString &message)
     m_logOutput->setTextCursor(cursor);
 }
 
-void UpgradeWidget::setButtonsEnabled(bool enabled)
+QListWidgetItem *UpgradeWidget::jobItem(int job) const
+{
+    for (int i = 0; i < m_jobList->count(); ++i) {
+        QListWidgetItem *item = m_jobList->item(i);
+        if (item->data(kJobIdRole).toInt() == job) {
+            return item;
+        }
+    }
+    return nullptr;
+}
+
+void UpgradeWidget::addJob(int job, const QString &description)
+{
+    QListWidgetItem *item = new QListWidgetItem(QString("⏳ Waiting: %1").arg(description));
+    item->setData(kJobIdRole, job);
+    item->setData(kJobDescriptionRole, description);
+    item->setData(kJobActiveRole, true);
+    m_jobList->addItem(item);
+}
+
+void UpgradeWidget::markJobStarted(int job)
+{
+    updateJobProgress(job, 0);
+}
+
+void UpgradeWidget::updateJobProgress(int job, int percent)
+{
+    QListWidgetItem *item = jobItem(job);
+    if (item) {
+        item->setText(QString("▶️ %1% %2").arg(percent).arg(item->data(kJobDescriptionRole).toString()));
+    }
+}
+
+void UpgradeWidget::markJobFinished(int job, bool success, const QString &message)
 {
-    m_extractButton->setEnabled(enabled);
-    m_upgradeButton->setEnabled(enabled);
-    m_patchButton->setEnabled(enabled);
-    m_rollbackButton->setEnabled(enabled);
-}
\ No newline at end of file
+    QListWidgetItem *item = jobItem(job);
+    if (!item) {
+        return;
+    }
+    
+    QString description = item->data(kJobDescriptionRole).toString();
+    if (success) {
+        item->setText(QString("✅ %1").arg(description));
+    } else {
+        item->setText(QString("❌ %1: %2").arg(description, message));
+    }
+    item->setData(kJobActiveRole, false);
+    onJobSelectionChanged();
+    
+    // Finished jobs stay listed for a while; the oldest go first
+    int finished = 0;
+    for (int i = m_jobList->count() - 1; i >= 0; --i) {
+        if (!m_jobList->item(i)->data(kJobActiveRole).toBool() && ++finished > kMaxFinishedJobs) {
+            delete m_jobList->takeItem(i);
+        }
+    }
+}
+
+void UpgradeWidget::onJobSelectionChanged()
+{
+    QListWidgetItem *item = m_jobList->currentItem();
+    m_cancelButton->setEnabled(item && item->isSelected() && item->data(kJobActiveRole).toBool());
+}
+
+void UpgradeWidget::onCancelJob()
+{
+    QListWidgetItem *item = m_jobList->currentItem();
+    if (item && item->data(kJobActiveRole).toBool()) {
+        emit cancelJobRequested(item->data(kJobIdRole).toInt());
+    }
+}
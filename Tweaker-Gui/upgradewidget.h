@@ -6,6 +6,7 @@
 #include <QLabel>
 #include <QProgressBar>
 #include <QTextEdit>
+#include <QListWidget>
 #include <QGroupBox>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -22,16 +23,26 @@ signals:
     void runUpgradeRequested();
     void patchSystemRequested();
     void rollbackRequested();
+    void cancelJobRequested(int job);
 
 public slots:
     void updateProgress(int value);
     void updateStatus(const QString &message);
-    void setButtonsEnabled(bool enabled);
+    // JobScheduler signals, for the job list
+    void addJob(int job, const QString &description);
+    void markJobStarted(int job);
+    void updateJobProgress(int job, int percent);
+    void markJobFinished(int job, bool success, const QString &message);
+
+private slots:
+    void onJobSelectionChanged();
+    void onCancelJob();
 
 private:
     void setupUI();
     QGroupBox* createStepGroup(const QString &title, const QString &description, 
                               QPushButton *button, const QString &helpText);
+    QListWidgetItem *jobItem(int job) const;
 
     // UI Components
     QGroupBox *m_extractGroup;
@@ -44,9 +55,11 @@ private:
     QPushButton *m_upgradeButton;
     QPushButton *m_patchButton;
     QPushButton *m_rollbackButton;
+    QPushButton *m_cancelButton;
     
     QProgressBar *m_progressBar;
     QLabel *m_statusLabel;
+    QListWidget *m_jobList;     // Queued, running and recently finished jobs
     QTextEdit *m_logOutput;
 };
 